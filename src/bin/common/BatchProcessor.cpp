@@ -0,0 +1,82 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BatchProcessor.h"
+#include "FileProvider.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace grk
+{
+BatchProcessor::BatchProcessor(const std::string& directoryPath, uint32_t numThreads,
+							   uint32_t numWorkers)
+	: m_numWorkers(1), m_numLibraryThreads(numThreads)
+{
+	FileProvider provider(directoryPath);
+	std::string filename;
+	while(provider.next(filename))
+		m_files.push_back(filename);
+	// process in a stable order, independent of directory layout
+	std::sort(m_files.begin(), m_files.end());
+
+	if(!numThreads)
+		numThreads = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+	if(!numWorkers)
+		numWorkers = numThreads;
+	m_numWorkers = (uint32_t)std::max<size_t>(std::min<size_t>(numWorkers, m_files.size()), 1);
+	if(m_numWorkers > 1)
+		m_numLibraryThreads = m_numWorkers >= numThreads ? 1 : numThreads;
+}
+size_t BatchProcessor::numFiles(void) const
+{
+	return m_files.size();
+}
+uint32_t BatchProcessor::numWorkers(void) const
+{
+	return m_numWorkers;
+}
+uint32_t BatchProcessor::numLibraryThreads(void) const
+{
+	return m_numLibraryThreads;
+}
+uint32_t BatchProcessor::run(std::function<int(uint32_t, size_t, const std::string&)> job)
+{
+	std::atomic<size_t> next(0);
+	std::atomic<uint32_t> numProcessed(0);
+	auto worker = [this, &job, &next, &numProcessed](uint32_t workerIndex) {
+		size_t index;
+		while((index = next++) < m_files.size())
+		{
+			if(job(workerIndex, index, m_files[index]) == 1)
+				numProcessed++;
+		}
+	};
+	if(m_numWorkers == 1)
+	{
+		worker(0);
+		return numProcessed;
+	}
+	std::vector<std::thread> workers;
+	for(uint32_t i = 0; i < m_numWorkers; ++i)
+		workers.emplace_back(worker, i);
+	for(auto& w : workers)
+		w.join();
+
+	return numProcessed;
+}
+
+} // namespace grk
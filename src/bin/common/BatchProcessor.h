@@ -0,0 +1,67 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace grk
+{
+/**
+ * Processes all files in a folder, with several images in flight at once.
+ *
+ * Workers pull file names from a shared queue, so that reading, coding and writing
+ * of different images overlap. Available threads are split between image-level
+ * parallelism (workers) and the library's shared thread pool: when there are at least
+ * as many images as threads, each image is coded single-threaded; otherwise the
+ * workers share a full-sized library pool.
+ */
+class BatchProcessor
+{
+  public:
+	/**
+	 * Create batch processor
+	 *
+	 * @param directoryPath	folder containing input files
+	 * @param numThreads	total number of threads; 0 for hardware concurrency
+	 * @param numWorkers	number of images in flight; 0 to choose automatically
+	 */
+	BatchProcessor(const std::string& directoryPath, uint32_t numThreads, uint32_t numWorkers);
+	size_t numFiles(void) const;
+	uint32_t numWorkers(void) const;
+	/**
+	 * Number of threads that should be used by the library thread pool
+	 */
+	uint32_t numLibraryThreads(void) const;
+	/**
+	 * Run job on every file
+	 *
+	 * @param job	called with worker index, file index (in name order) and file name;
+	 * returns 1 on success, 0 on failure, and 2 if the file is not suitable for processing
+	 * @return number of files successfully processed
+	 */
+	uint32_t run(std::function<int(uint32_t, size_t, const std::string&)> job);
+
+  private:
+	std::vector<std::string> m_files;
+	uint32_t m_numWorkers;
+	uint32_t m_numLibraryThreads;
+};
+
+} // namespace grk
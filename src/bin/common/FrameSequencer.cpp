@@ -0,0 +1,147 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FrameSequencer.h"
+#include <vector>
+
+namespace grk
+{
+FrameSequencer::FrameSequencer(const std::string& outfile, size_t numFrames,
+							   uint32_t maxFramesInFlight)
+	: m_outfile(outfile), m_fp(nullptr), m_numFrames(numFrames),
+	  m_maxFramesInFlight(std::max<uint32_t>(maxFramesInFlight, 1)), m_nextFrame(0),
+	  m_numFramesWritten(0), m_failed(false)
+{}
+FrameSequencer::~FrameSequencer()
+{
+	for(auto& frame : m_pending)
+	{
+		if(frame.second)
+			grk_object_unref(frame.second);
+	}
+	if(m_fp)
+		fclose(m_fp);
+}
+bool FrameSequencer::open(void)
+{
+	m_fp = fopen(m_outfile.c_str(), "wb");
+	if(!m_fp)
+	{
+		spdlog::error("Sequence: failed to open file {} for writing", m_outfile);
+		return false;
+	}
+
+	return true;
+}
+bool FrameSequencer::begin(size_t frameIndex)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	// the next frame to be written has always begun, so waiting frames
+	// are eventually released
+	m_cv.wait(lock, [this, frameIndex] {
+		return m_failed || frameIndex < m_nextFrame + m_maxFramesInFlight;
+	});
+
+	return !m_failed;
+}
+void FrameSequencer::skip(size_t frameIndex)
+{
+	submit(frameIndex, nullptr);
+}
+void FrameSequencer::fail(size_t frameIndex)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	spdlog::error("Sequence: aborted at frame {}", frameIndex);
+	abort();
+}
+bool FrameSequencer::submit(size_t frameIndex, grk_stream* stream)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_failed)
+	{
+		if(stream)
+			grk_object_unref(stream);
+		return false;
+	}
+	m_pending[frameIndex] = stream;
+	// write all frames that are now in order; writes are serialized by the lock,
+	// and are performed by whichever worker completes the next frame
+	auto iter = m_pending.begin();
+	while(iter != m_pending.end() && iter->first == m_nextFrame)
+	{
+		bool rc = !iter->second || write(iter->second);
+		if(iter->second)
+			grk_object_unref(iter->second);
+		iter = m_pending.erase(iter);
+		if(!rc)
+		{
+			abort();
+			return false;
+		}
+		m_nextFrame++;
+	}
+	m_cv.notify_all();
+
+	return true;
+}
+bool FrameSequencer::write(grk_stream* stream)
+{
+	size_t numChunks = grk_stream_get_chunks(stream, nullptr, 0);
+	std::vector<grk_stream_chunk> chunks(numChunks);
+	grk_stream_get_chunks(stream, chunks.data(), numChunks);
+	for(auto& chunk : chunks)
+	{
+		if(fwrite(chunk.data, 1, chunk.len, m_fp) != chunk.len)
+		{
+			spdlog::error("Sequence: failed to write frame {} to {}", m_nextFrame, m_outfile);
+			return false;
+		}
+	}
+	m_numFramesWritten++;
+
+	return true;
+}
+void FrameSequencer::abort(void)
+{
+	m_failed = true;
+	for(auto& frame : m_pending)
+	{
+		if(frame.second)
+			grk_object_unref(frame.second);
+	}
+	m_pending.clear();
+	m_cv.notify_all();
+}
+bool FrameSequencer::close(void)
+{
+	bool rc = !m_failed && m_nextFrame == m_numFrames;
+	if(m_fp)
+	{
+		if(fclose(m_fp))
+			rc = false;
+		m_fp = nullptr;
+	}
+	if(!rc)
+		(void)remove(m_outfile.c_str());
+
+	return rc;
+}
+size_t FrameSequencer::numFramesWritten(void) const
+{
+	return m_numFramesWritten;
+}
+
+} // namespace grk
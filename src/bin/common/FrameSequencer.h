@@ -0,0 +1,102 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "common.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace grk
+{
+/**
+ * Writes a sequence of compressed frames to a single file, in frame order.
+ *
+ * Frames are compressed concurrently, in any order, into chunked memory streams,
+ * and each frame is written as soon as all frames before it have been written.
+ * The number of frames in flight is bounded, so that slow frames do not cause
+ * an unbounded backlog of compressed frames in memory.
+ */
+class FrameSequencer
+{
+  public:
+	/**
+	 * Create frame sequencer
+	 *
+	 * @param outfile				output file
+	 * @param numFrames				number of frames in sequence
+	 * @param maxFramesInFlight		maximum number of frames between the next frame
+	 * to be written and the last frame started
+	 */
+	FrameSequencer(const std::string& outfile, size_t numFrames, uint32_t maxFramesInFlight);
+	~FrameSequencer();
+	bool open(void);
+	/**
+	 * Wait until frame may be compressed
+	 *
+	 * @param frameIndex	frame index
+	 * @return false if sequence has failed, and frame should not be compressed
+	 */
+	bool begin(size_t frameIndex);
+	/**
+	 * Queue compressed frame for writing. Sequencer takes ownership of stream.
+	 *
+	 * @param frameIndex	frame index
+	 * @param stream		chunked memory stream holding frame code stream,
+	 * or null for a skipped frame
+	 * @return false if sequence has failed, or could not be written
+	 */
+	bool submit(size_t frameIndex, grk_stream* stream);
+	/**
+	 * Skip frame that is not part of sequence
+	 *
+	 * @param frameIndex	frame index
+	 */
+	void skip(size_t frameIndex);
+	/**
+	 * Abort sequence, after frame failed to compress
+	 *
+	 * @param frameIndex	frame index
+	 */
+	void fail(size_t frameIndex);
+	/**
+	 * Close output file
+	 *
+	 * @return true if all frames were successfully written
+	 */
+	bool close(void);
+	size_t numFramesWritten(void) const;
+
+  private:
+	bool write(grk_stream* stream);
+	void abort(void);
+
+	std::string m_outfile;
+	FILE* m_fp;
+	size_t m_numFrames;
+	uint32_t m_maxFramesInFlight;
+	// compressed frames waiting for earlier frames; a null stream marks a skipped frame
+	std::map<size_t, grk_stream*> m_pending;
+	size_t m_nextFrame;
+	size_t m_numFramesWritten;
+	bool m_failed;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+};
+
+} // namespace grk
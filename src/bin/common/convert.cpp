@@ -62,21 +62,22 @@ long grk_lrintf(float f)
 
 
 
-/* Component clipping */
+/* Component clipping to the range of the new precision */
 template<typename T>
 void clip(grk_image_comp* component, uint8_t precision)
 {
 	uint32_t stride_diff = component->stride - component->w;
-	assert(precision <= 16);
+	assert(precision > 0 && precision <= 16);
 	auto data = component->data;
-	T max = std::numeric_limits<T>::max();
-	T min = std::numeric_limits<T>::min();
+	int32_t max = std::is_signed<T>::value ? (int32_t)((1U << (precision - 1)) - 1U)
+										   : (int32_t)((1U << precision) - 1U);
+	int32_t min = std::is_signed<T>::value ? -(int32_t)(1U << (precision - 1)) : 0;
 	size_t index = 0;
 	for(uint32_t j = 0; j < component->h; ++j)
 	{
 		for(uint32_t i = 0; i < component->w; ++i)
 		{
-			data[index] = (int32_t)std::clamp<T>((T)data[index], min, max);
+			data[index] = std::clamp<int32_t>(data[index], min, max);
 			index++;
 		}
 		index += stride_diff;
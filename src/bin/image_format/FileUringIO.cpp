@@ -23,58 +23,17 @@
 
 #include "FileUringIO.h"
 #include "common.h"
-#include <strings.h>
-#include <sys/time.h>
-#include <sys/resource.h>
-#include <sys/times.h>
 #include <unistd.h>
-#include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <dirent.h>
-#include <chrono>
+#include <cstdlib>
+#include <cerrno>
 
-#include <liburing.h>
-#include <liburing/io_uring.h>
-
-#define QD 1024
-#define BS (32 * 1024)
-struct io_uring ring;
-
-struct io_data
-{
-	io_data() : offset(0), iov{0, 0} {}
-	int64_t offset;
-	iovec iov;
-};
-
-static int setup_context(unsigned entries, io_uring* ring)
-{
-	int ret = io_uring_queue_init(entries, ring, 0);
-	if(ret < 0)
-	{
-		spdlog::error("queue_init: %s\n", strerror(-ret));
-		return -1;
-	}
-
-	return 0;
-}
-
-static void queue_prepped(io_uring* ring, io_data* data, int outfd)
-{
-	auto sqe = io_uring_get_sqe(ring);
-	assert(sqe);
-
-	io_uring_prep_writev(sqe, outfd, &data->iov, 1, data->offset);
-	io_uring_sqe_set_data(sqe, data);
-}
-
-static void queue_write(io_uring* ring, io_data* data, int outfd)
-{
-	queue_prepped(ring, data, outfd);
-	io_uring_submit(ring);
-}
+// number of staging buffers, which is also the ring's queue depth
+const uint32_t uringDefaultQueueDepth = 16;
+const size_t uringDefaultBufferSize = 512 * 1024;
+const size_t uringBufferAlignment = 4096;
 
 static int _getMode(const char* mode)
 {
@@ -100,9 +59,15 @@ static int _getMode(const char* mode)
 	return (m);
 }
 
-FileUringIO::FileUringIO() : m_fd(0), m_off(0), m_writeCount(0)
+FileUringIO::FileUringIO() : FileUringIO(uringDefaultQueueDepth, uringDefaultBufferSize) {}
+
+FileUringIO::FileUringIO(uint32_t queueDepth, size_t bufferSize)
+	: m_fd(-1), m_off(0), m_ringInitialized(false), m_fixedBuffers(false),
+	  m_queueDepth(queueDepth ? queueDepth : uringDefaultQueueDepth),
+	  m_bufferSize(bufferSize ? bufferSize : uringDefaultBufferSize), m_activeBuffer(-1),
+	  m_activeLength(0), m_inFlight(0), m_error(false)
 {
-	memset(&ring, 0, sizeof(ring));
+	memset(&m_ring, 0, sizeof(m_ring));
 }
 
 FileUringIO::~FileUringIO()
@@ -113,9 +78,13 @@ FileUringIO::~FileUringIO()
 bool FileUringIO::open(std::string fileName, std::string mode)
 {
 	bool useStdio = grk::useStdio(fileName.c_str());
-	bool doRead = mode[0] == -'r';
+	bool doRead = mode[0] == 'r';
+	m_fileName = fileName;
+	m_off = 0;
+	m_error = false;
 	if(useStdio)
 	{
+		// pipes can't be written at an offset, so stdio is written synchronously
 		m_fd = doRead ? STDIN_FILENO : STDOUT_FILENO;
 		return true;
 	}
@@ -133,86 +102,234 @@ bool FileUringIO::open(std::string fileName, std::string mode)
 		}
 		return false;
 	}
-	m_fileName = fileName;
-	if(!doRead)
+	if(!doRead && !initRing())
 	{
-		if(setup_context(QD, &ring))
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+bool FileUringIO::initRing(void)
+{
+	int ret = io_uring_queue_init(m_queueDepth, &m_ring, 0);
+	if(ret < 0)
+	{
+		spdlog::error("io_uring queue initialization failed: {}", strerror(-ret));
+		return false;
+	}
+	m_ringInitialized = true;
+	for(uint32_t i = 0; i < m_queueDepth; ++i)
+	{
+		void* mem = nullptr;
+		if(posix_memalign(&mem, uringBufferAlignment, m_bufferSize))
+		{
+			spdlog::error("Failed to allocate io_uring write buffer");
+			destroyRing();
 			return false;
+		}
+		m_buffers.push_back({mem, m_bufferSize});
+		m_freeBuffers.push_back((int32_t)i);
 	}
+	m_bufferOffsets.resize(m_queueDepth);
+	m_bufferLengths.resize(m_queueDepth);
+	// registered buffers avoid per-write page pinning in the kernel;
+	// fall back to regular writes if registration is not permitted (RLIMIT_MEMLOCK)
+	m_fixedBuffers =
+		io_uring_register_buffers(&m_ring, m_buffers.data(), (unsigned)m_buffers.size()) == 0;
+
 	return true;
 }
 
-int process_completion(struct io_uring* ring)
+void FileUringIO::destroyRing(void)
 {
-	io_uring_cqe* cqe;
-	int ret = io_uring_wait_cqe(ring, &cqe);
+	if(m_ringInitialized)
+	{
+		if(m_fixedBuffers)
+			io_uring_unregister_buffers(&m_ring);
+		io_uring_queue_exit(&m_ring);
+		memset(&m_ring, 0, sizeof(m_ring));
+		m_ringInitialized = false;
+	}
+	m_fixedBuffers = false;
+	for(auto& b : m_buffers)
+		free(b.iov_base);
+	m_buffers.clear();
+	m_bufferOffsets.clear();
+	m_bufferLengths.clear();
+	m_freeBuffers.clear();
+	m_activeBuffer = -1;
+	m_activeLength = 0;
+	m_inFlight = 0;
+}
 
-	if(ret < 0)
+bool FileUringIO::writeSynch(uint8_t* buf, size_t len, int64_t offset)
+{
+	while(len)
+	{
+		auto actual = offset >= 0 ? ::pwrite(m_fd, buf, len, offset) : ::write(m_fd, buf, len);
+		if(actual < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			spdlog::error("{}: write failed: {}", m_fileName, strerror(errno));
+			return false;
+		}
+		buf += actual;
+		len -= (size_t)actual;
+		if(offset >= 0)
+			offset += actual;
+	}
+
+	return true;
+}
+
+bool FileUringIO::reap(bool wait)
+{
+	io_uring_cqe* cqe = nullptr;
+	int ret = wait ? io_uring_wait_cqe(&m_ring, &cqe) : io_uring_peek_cqe(&m_ring, &cqe);
+	if(ret < 0 || !cqe)
+	{
+		if(wait)
+		{
+			spdlog::error("io_uring wait for completion failed: {}", strerror(-ret));
+			m_error = true;
+		}
+		return false;
+	}
+	auto index = (int32_t)(uintptr_t)io_uring_cqe_get_data(cqe);
+	int res = cqe->res;
+	io_uring_cqe_seen(&m_ring, cqe);
+	m_inFlight--;
+	auto len = m_bufferLengths[(size_t)index];
+	if(res < 0)
 	{
-		spdlog::error("io_uring_wait_cqe");
-		return 1;
+		spdlog::error("{}: io_uring write failed: {}", m_fileName, strerror(-res));
+		m_error = true;
 	}
-	if(cqe->res < 0)
+	else if((size_t)res < len)
 	{
-		spdlog::error("The system call invoked asynchonously failed");
-		return 1;
+		// complete short write synchronously
+		auto buf = (uint8_t*)m_buffers[(size_t)index].iov_base;
+		if(!writeSynch(buf + res, len - (size_t)res, m_bufferOffsets[(size_t)index] + res))
+			m_error = true;
 	}
+	m_freeBuffers.push_back(index);
 
-	/* Retrieve user data from CQE */
-	io_data* data = (io_data*)io_uring_cqe_get_data(cqe);
+	return true;
+}
 
-	/* process this request here */
-	delete[](uint8_t*) data->iov.iov_base;
-	delete data;
+int32_t FileUringIO::acquireBuffer(void)
+{
+	while(reap(false))
+	{
+	}
+	// all buffers are in flight: wait for one to complete
+	while(m_freeBuffers.empty())
+	{
+		if(!m_inFlight || !reap(true))
+			return -1;
+	}
+	auto index = m_freeBuffers.back();
+	m_freeBuffers.pop_back();
 
-	/* Mark this completion as seen */
-	io_uring_cqe_seen(ring, cqe);
+	return index;
+}
 
-	return 0;
+bool FileUringIO::submitActive(void)
+{
+	if(m_activeBuffer < 0)
+		return true;
+	auto index = (size_t)m_activeBuffer;
+	auto len = m_activeLength;
+	m_activeBuffer = -1;
+	m_activeLength = 0;
+	if(!len)
+	{
+		m_freeBuffers.push_back((int32_t)index);
+		return true;
+	}
+	m_bufferOffsets[index] = m_off;
+	m_bufferLengths[index] = len;
+	m_off += (int64_t)len;
+	auto sqe = io_uring_get_sqe(&m_ring);
+	if(!sqe)
+	{
+		// can't happen as long as in flight count is bounded by queue depth
+		m_freeBuffers.push_back((int32_t)index);
+		return writeSynch((uint8_t*)m_buffers[index].iov_base, len, m_bufferOffsets[index]);
+	}
+	if(m_fixedBuffers)
+		io_uring_prep_write_fixed(sqe, m_fd, m_buffers[index].iov_base, (unsigned)len,
+								  (off_t)m_bufferOffsets[index], (int)index);
+	else
+		io_uring_prep_write(sqe, m_fd, m_buffers[index].iov_base, (unsigned)len,
+							(off_t)m_bufferOffsets[index]);
+	io_uring_sqe_set_data(sqe, (void*)(uintptr_t)index);
+	int ret = io_uring_submit(&m_ring);
+	if(ret < 0)
+	{
+		spdlog::error("io_uring submit failed: {}", strerror(-ret));
+		m_freeBuffers.push_back((int32_t)index);
+		return false;
+	}
+	m_inFlight++;
+
+	return true;
 }
 
 bool FileUringIO::close(void)
 {
-	bool rc = false;
-	if(m_fd)
+	bool rc = true;
+	if(m_ringInitialized)
 	{
-		if(fsync(m_fd))
-			spdlog::error("failed to synch file");
+		if(!submitActive())
+			rc = false;
+		while(m_inFlight)
+		{
+			if(!reap(true))
+				break;
+		}
+		if(m_error)
+			rc = false;
+		destroyRing();
 	}
-	if(ring.ring_fd)
+	if(m_fd >= 0 && !grk::useStdio(m_fileName.c_str()))
 	{
-		for(uint32_t i = 0; i < m_writeCount; ++i)
-			process_completion(&ring);
-		io_uring_queue_exit(&ring);
-		memset(&ring, 0, sizeof(ring));
+		if(::close(m_fd))
+			rc = false;
 	}
-	if(!m_fd || grk::useStdio(m_fileName.c_str()))
-		rc = true;
-	else if(::close(m_fd) == 0)
-		rc = true;
-	m_fd = 0;
+	m_fd = -1;
+
 	return rc;
 }
 
 bool FileUringIO::write(uint8_t* buf, size_t len)
 {
-	bool rc = true;
-	// auto start = std::chrono::high_resolution_clock::now();
-	io_data* data = new io_data();
-	auto b = new uint8_t[len];
-	memcpy(b, buf, len);
-	data->offset = m_off;
-	m_off += (int64_t)len;
-	data->iov.iov_base = b;
-	data->iov.iov_len = len;
-	queue_write(&ring, data, m_fd);
-
-	// auto finish = std::chrono::high_resolution_clock::now();
-	// std::chrono::duration<double> elapsed = finish - start;
-	// spdlog::info("write time: {} ms",	elapsed.count() * 1000);
-	m_writeCount++;
+	if(!m_ringInitialized)
+		return writeSynch(buf, len, -1);
+	while(len)
+	{
+		if(m_error)
+			return false;
+		if(m_activeBuffer < 0)
+		{
+			m_activeBuffer = acquireBuffer();
+			if(m_activeBuffer < 0)
+				return false;
+		}
+		auto toCopy = std::min<size_t>(len, m_bufferSize - m_activeLength);
+		memcpy((uint8_t*)m_buffers[(size_t)m_activeBuffer].iov_base + m_activeLength, buf, toCopy);
+		m_activeLength += toCopy;
+		buf += toCopy;
+		len -= toCopy;
+		if(m_activeLength == m_bufferSize && !submitActive())
+			return false;
+	}
 
-	return rc;
+	return !m_error;
 }
 bool FileUringIO::read(uint8_t* buf, size_t len)
 {
@@ -224,5 +341,11 @@ bool FileUringIO::read(uint8_t* buf, size_t len)
 }
 bool FileUringIO::seek(int64_t pos)
 {
-	return lseek(m_fd, pos, SEEK_SET) == pos;
+	if(!m_ringInitialized)
+		return lseek(m_fd, pos, SEEK_SET) == pos;
+	if(!submitActive())
+		return false;
+	m_off = pos;
+
+	return true;
 }
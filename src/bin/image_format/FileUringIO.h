@@ -19,11 +19,23 @@
 #pragma once
 
 #include "IFileIO.h"
+#include <vector>
+#include <sys/uio.h>
+#include <liburing.h>
 
+/**
+ * io_uring file writer.
+ *
+ * Each instance owns its own ring, so several files can be written concurrently.
+ * Data is staged in a fixed pool of buffers that are registered with the kernel;
+ * a buffer is submitted once it is full, and completions are reaped while writing,
+ * so that at most queueDepth * bufferSize bytes are in flight at any time.
+ */
 class FileUringIO : public IFileIO
 {
   public:
 	FileUringIO();
+	FileUringIO(uint32_t queueDepth, size_t bufferSize);
 	virtual ~FileUringIO() override;
 	bool open(std::string fileName, std::string mode) override;
 	bool close(void) override;
@@ -32,8 +44,30 @@ class FileUringIO : public IFileIO
 	bool seek(int64_t pos) override;
 
   private:
+	bool initRing(void);
+	void destroyRing(void);
+	bool submitActive(void);
+	bool reap(bool wait);
+	int32_t acquireBuffer(void);
+	bool writeSynch(uint8_t* buf, size_t len, int64_t offset);
+
 	int m_fd;
 	std::string m_fileName;
+	// file offset of first byte in active buffer
 	int64_t m_off;
-	size_t m_writeCount;
+	io_uring m_ring;
+	bool m_ringInitialized;
+	bool m_fixedBuffers;
+	uint32_t m_queueDepth;
+	size_t m_bufferSize;
+	std::vector<iovec> m_buffers;
+	// file offset and length of each buffer's pending write
+	std::vector<int64_t> m_bufferOffsets;
+	std::vector<size_t> m_bufferLengths;
+	std::vector<int32_t> m_freeBuffers;
+	// buffer currently being filled, or -1
+	int32_t m_activeBuffer;
+	size_t m_activeLength;
+	uint32_t m_inFlight;
+	bool m_error;
 };
@@ -38,6 +38,12 @@
 #include <locale>
 #include "common.h"
 #include "FileStreamIO.h"
+#include <zlib.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include "util/Tracer.h"
+#include "util/ThreadPool.hpp"
 
 #define PNG_MAGIC "\x89PNG\x0d\x0a\x1a\x0a"
 #define MAGIC_SIZE 8
@@ -418,11 +424,15 @@ static void convert_32s16u_C1R(const int32_t* pSrc, uint8_t* pDst, size_t length
 	}
 }
 
-PNGFormat::PNGFormat()
-	: m_info(nullptr), png(nullptr), row_buf(nullptr), row_buf_array(nullptr), row32s(nullptr),
-	  m_colorSpace(GRK_CLRSPC_UNKNOWN), prec(0), nr_comp(0), m_planes{nullptr}
+PNGFormat::PNGFormat(uint32_t numThreads)
+	: m_info(nullptr), png(nullptr), row_buf_array(nullptr), row32s(nullptr),
+	  m_colorSpace(GRK_CLRSPC_UNKNOWN), prec(0), nr_comp(0), m_numThreads(numThreads),
+	  m_compressionLevel(0), m_rowBytes(0), m_adler(1), m_wroteZlibHeader(false),
+	  m_wroteFinalBlock(false)
 {}
 
+PNGFormat::~PNGFormat() = default;
+
 bool PNGFormat::encodeHeader(grk_image* img, const std::string& filename, uint32_t compressionLevel)
 {
 	m_image = img;
@@ -551,10 +561,10 @@ bool PNGFormat::encodeHeader(grk_image* img, const std::string& filename, uint32
 	 * color_type == PNG_COLOR_TYPE_RGB_ALPHA) && bit_depth < 8
 	 *
 	 */
-	png_set_compression_level(png,
-							  (int)((compressionLevel == GRK_DECOMPRESS_COMPRESSION_LEVEL_DEFAULT)
-										? 0
-										: compressionLevel));
+	m_compressionLevel = (int)((compressionLevel == GRK_DECOMPRESS_COMPRESSION_LEVEL_DEFAULT)
+								   ? 0
+								   : std::min<uint32_t>(compressionLevel, Z_BEST_COMPRESSION));
+	png_set_compression_level(png, m_compressionLevel);
 
 	if(nr_comp >= 3)
 	{ /* RGB(A) */
@@ -653,21 +663,15 @@ bool PNGFormat::encodeHeader(grk_image* img, const std::string& filename, uint32
 			spdlog::error("Invalid PNG row size");
 			goto beach;
 		}
-		row_buf = (png_bytep)malloc(png_row_size);
-		if(row_buf == nullptr)
-		{
-			spdlog::error("Can't allocate memory for PNG row");
-			goto beach;
-		}
-		row32s = (int32_t*)malloc((size_t)m_image->comps[0].w * (size_t)nr_comp * sizeof(int32_t));
-		if(row32s == nullptr)
-		{
-			spdlog::error("Can't allocate memory for interleaved 32s row");
-			goto beach;
-		}
+		m_rowBytes = png_row_size;
+		// first row is predicted from a row of zeros
+		m_prevRow.assign(m_rowBytes, 0);
 	}
-	for(uint32_t compno = 0; compno < nr_comp; ++compno)
-		m_planes[compno] = m_image->comps[compno].data;
+	if(!m_numThreads)
+		m_numThreads = std::max<uint32_t>(ThreadPool::hardware_concurrency(), 1);
+	// workers are not pinned, so as not to compete with the library's pool for cores
+	if(m_numThreads > 1 && !m_pool)
+		m_pool = std::make_unique<ThreadPool>(m_numThreads, GRK_THREAD_AFFINITY_NONE);
 
 	fails = false;
 
@@ -675,45 +679,313 @@ beach:
 	return !fails;
 }
 
-bool PNGFormat::encodeStrip(uint32_t rows)
+/*
+ * Rows are written pigz-style: image rows are split into groups of about
+ * pngRowGroupBytes, which are filtered and deflated concurrently. Each group is
+ * a raw deflate stream, primed with the last 32 KB of the previous group and
+ * ended with a sync flush, so that the groups can simply be concatenated,
+ * between a zlib header and a trailer holding the combined Adler-32 checksum,
+ * into the IDAT chunks of the image.
+ */
+const size_t pngRowGroupBytes = 256 * 1024;
+const size_t pngWindowBytes = 32 * 1024;
+
+struct PngRowGroup
+{
+	uint32_t y0 = 0;
+	uint32_t y1 = 0;
+	std::vector<uint8_t> filtered;
+	std::vector<uint8_t> compressed;
+	uint32_t adler = 1;
+};
+
+static void pngParallelFor(ThreadPool* pool, size_t numTasks,
+						   const std::function<void(size_t)>& task)
+{
+	if(!pool)
+	{
+		for(size_t index = 0; index < numTasks; ++index)
+			task(index);
+		return;
+	}
+	std::vector<std::future<void>> results;
+	for(size_t index = 0; index < numTasks; ++index)
+		results.push_back(pool->enqueue([&task, index] { task(index); }));
+	for(auto& result : results)
+		result.get();
+}
+
+// sum of absolute values of filtered bytes, taken as signed:
+// libpng's heuristic for choosing a row filter
+static uint32_t pngFilterCost(const uint8_t* row, size_t len)
+{
+	uint32_t sum = 0;
+	for(size_t i = 0; i < len; ++i)
+		sum += (uint32_t)std::abs((int32_t)(int8_t)row[i]);
+
+	return sum;
+}
+
+/**
+ * Filter row. With adaptive filtering, all five filter types are tried,
+ * and the type with lowest cost is kept; otherwise the row is not filtered.
+ * Loops are kept free of branches so that the compiler can vectorize them.
+ *
+ * @param cur			unfiltered row
+ * @param prev			unfiltered previous row
+ * @param len			row length in bytes
+ * @param bpp			bytes per complete pixel, rounded up to one
+ * @param adaptive		true for adaptive filtering
+ * @param dest			filter type, followed by filtered row
+ * @param scratch		scratch row
+ */
+static void pngFilterRow(const uint8_t* cur, const uint8_t* prev, size_t len, size_t bpp,
+						 bool adaptive, uint8_t* dest, uint8_t* scratch)
+{
+	dest[0] = PNG_FILTER_VALUE_NONE;
+	memcpy(dest + 1, cur, len);
+	if(!adaptive)
+		return;
+	uint8_t* best = dest + 1;
+	uint32_t bestCost = pngFilterCost(cur, len);
+	auto candidate = [&](uint8_t type, uint8_t* out) {
+		uint32_t cost = pngFilterCost(out, len);
+		if(cost < bestCost)
+		{
+			bestCost = cost;
+			dest[0] = type;
+			best = out;
+			return true;
+		}
+		return false;
+	};
+	auto next = [&]() { return best == scratch ? dest + 1 : scratch; };
+	size_t head = std::min(bpp, len);
+
+	auto out = next();
+	for(size_t i = 0; i < head; ++i)
+		out[i] = cur[i];
+	for(size_t i = bpp; i < len; ++i)
+		out[i] = (uint8_t)(cur[i] - cur[i - bpp]);
+	candidate(PNG_FILTER_VALUE_SUB, out);
+
+	out = next();
+	for(size_t i = 0; i < len; ++i)
+		out[i] = (uint8_t)(cur[i] - prev[i]);
+	candidate(PNG_FILTER_VALUE_UP, out);
+
+	out = next();
+	for(size_t i = 0; i < head; ++i)
+		out[i] = (uint8_t)(cur[i] - (prev[i] >> 1));
+	for(size_t i = bpp; i < len; ++i)
+		out[i] = (uint8_t)(cur[i] - ((cur[i - bpp] + prev[i]) >> 1));
+	candidate(PNG_FILTER_VALUE_AVG, out);
+
+	out = next();
+	for(size_t i = 0; i < head; ++i)
+		out[i] = (uint8_t)(cur[i] - prev[i]);
+	for(size_t i = bpp; i < len; ++i)
+	{
+		int32_t a = cur[i - bpp];
+		int32_t b = prev[i];
+		int32_t c = prev[i - bpp];
+		int32_t pa = std::abs(b - c);
+		int32_t pb = std::abs(a - c);
+		int32_t pc = std::abs(a + b - 2 * c);
+		int32_t pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+		out[i] = (uint8_t)(cur[i] - pred);
+	}
+	candidate(PNG_FILTER_VALUE_PAETH, out);
+
+	if(best != dest + 1)
+		memcpy(dest + 1, best, len);
+}
+
+/**
+ * Deflate row group as raw deflate stream
+ *
+ * @param group			row group
+ * @param level			compression level
+ * @param dictionary	preceding image data, or nullptr for first group
+ * @param dictionaryLen	length of preceding image data
+ * @param final			true if this is the last group of the image
+ */
+static bool pngDeflateGroup(PngRowGroup* group, int level, const uint8_t* dictionary,
+							size_t dictionaryLen, bool final)
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if(deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return false;
+	bool rc = true;
+	if(dictionary && dictionaryLen)
+		rc = deflateSetDictionary(&zs, dictionary, (uInt)dictionaryLen) == Z_OK;
+	if(rc)
+	{
+		// deflateBound does not include the empty block appended by a sync flush
+		group->compressed.resize(deflateBound(&zs, (uLong)group->filtered.size()) + 64);
+		zs.next_in = group->filtered.data();
+		zs.avail_in = (uInt)group->filtered.size();
+		zs.next_out = group->compressed.data();
+		zs.avail_out = (uInt)group->compressed.size();
+		int ret = deflate(&zs, final ? Z_FINISH : Z_SYNC_FLUSH);
+		rc = final ? ret == Z_STREAM_END : (ret == Z_OK && zs.avail_in == 0 && zs.avail_out != 0);
+		group->compressed.resize(group->compressed.size() - zs.avail_out);
+	}
+	deflateEnd(&zs);
+
+	return rc;
+}
+void PNGFormat::packRow(uint32_t y, int32_t* buffer32s, uint8_t* dest)
+{
+	int32_t const* planes[4] = {nullptr};
+	size_t offset = (size_t)y * m_image->comps[0].stride;
+	for(uint16_t compno = 0; compno < nr_comp; ++compno)
+		planes[compno] = m_image->comps[compno].data + offset;
+	int32_t adjust = m_image->comps[0].sgnd ? 1 << (prec - 1) : 0;
+	size_t width = m_image->comps[0].w;
+	cvtPlanarToInterleaved_LUT[nr_comp](planes, buffer32s, width, adjust);
+	if(prec == 16)
+		convert_32s16u_C1R(buffer32s, dest, width * (size_t)nr_comp);
+	else
+		cvtFrom32_LUT[prec](buffer32s, dest, width * (size_t)nr_comp);
+}
+bool PNGFormat::writeChunk(const char* name, const uint8_t* data, size_t len)
 {
-	(void)rows;
+	if(setjmp(png_jmpbuf(png)))
+		return false;
+	png_write_chunk(png, (png_const_bytep)name, data, len);
 
-	cvtPlanarToInterleaved cvtPxToCx = cvtPlanarToInterleaved_LUT[nr_comp];
-	cvtFrom32 cvt32sToPack = nullptr;
-	png_bytep row_buf_cpy = row_buf;
-	int32_t* buffer32s_cpy = row32s;
+	return true;
+}
+bool PNGFormat::writeImageData(std::vector<uint8_t>& data, bool final)
+{
+	if(!m_wroteZlibHeader)
+	{
+		// 32 KB window, with level hint; check bits make header a multiple of 31
+		uint8_t cmf = 0x78;
+		uint8_t flevel = m_compressionLevel < 2	  ? 0
+						 : m_compressionLevel < 6 ? 1
+						 : m_compressionLevel == 6 ? 2
+												   : 3;
+		uint8_t flg = (uint8_t)(flevel << 6);
+		flg = (uint8_t)(flg + (31 - ((cmf << 8) + flg) % 31) % 31);
+		data.insert(data.begin(), {cmf, flg});
+		m_wroteZlibHeader = true;
+	}
+	if(final)
+	{
+		for(int shift = 24; shift >= 0; shift -= 8)
+			data.push_back((uint8_t)(m_adler >> shift));
+		m_wroteFinalBlock = true;
+	}
+	if(data.empty())
+		return true;
 
+	return writeChunk("IDAT", data.data(), data.size());
+}
+bool PNGFormat::encodeStrip(uint32_t rows)
+{
 	switch(prec)
 	{
 		case 1:
 		case 2:
 		case 4:
 		case 8:
-			cvt32sToPack = cvtFrom32_LUT[prec];
-			break;
 		case 16:
-			cvt32sToPack = convert_32s16u_C1R;
 			break;
 		default:
 			/* never here */
 			return false;
 			break;
 	}
-
-	int32_t adjust = m_image->comps[0].sgnd ? 1 << (prec - 1) : 0;
+	uint32_t yBegin = m_rowCount;
+	uint32_t yEnd = maxY(rows);
+	uint32_t height = m_image->comps[0].h;
 	size_t width = m_image->comps[0].w;
-	uint32_t stride = m_image->comps[0].stride;
-	uint32_t max = maxY(rows);
-	for(uint32_t y = m_rowCount; y < max; ++y)
+	size_t bpp = std::max<size_t>(((size_t)nr_comp * prec) / 8, 1);
+	// filtering does not pay off for sub-byte samples, nor for uncompressed data
+	bool adaptive = prec >= 8 && m_compressionLevel > 0;
+	uint32_t rowsPerGroup =
+		(uint32_t)std::max<size_t>(pngRowGroupBytes / (m_rowBytes + 1), (size_t)1);
+	size_t groupsPerBatch = (size_t)m_numThreads * 4;
+
+	for(uint32_t batchY = yBegin; batchY < yEnd;)
 	{
-		cvtPxToCx(m_planes, buffer32s_cpy, width, adjust);
-		cvt32sToPack(buffer32s_cpy, row_buf_cpy, width * (size_t)nr_comp);
-		png_write_row(png, row_buf_cpy);
-		m_planes[0] += stride;
-		m_planes[1] += stride;
-		m_planes[2] += stride;
-		m_planes[3] += stride;
+		std::vector<PngRowGroup> groups;
+		for(uint32_t y = batchY; y < yEnd && groups.size() < groupsPerBatch; y += rowsPerGroup)
+		{
+			PngRowGroup group;
+			group.y0 = y;
+			group.y1 = std::min<uint32_t>(y + rowsPerGroup, yEnd);
+			groups.push_back(std::move(group));
+		}
+		uint32_t batchEnd = groups.back().y1;
+
+		// 1. pack and filter rows
+		pngParallelFor(m_pool.get(), groups.size(), [&](size_t index) {
+			auto group = &groups[index];
+			std::vector<int32_t> buffer32s(width * nr_comp);
+			std::vector<uint8_t> prev(m_rowBytes), cur(m_rowBytes), scratch(m_rowBytes);
+			if(group->y0 == batchY)
+				prev = m_prevRow;
+			else
+				packRow(group->y0 - 1, buffer32s.data(), prev.data());
+			group->filtered.resize((size_t)(group->y1 - group->y0) * (m_rowBytes + 1));
+			auto dest = group->filtered.data();
+			for(uint32_t y = group->y0; y < group->y1; ++y)
+			{
+				packRow(y, buffer32s.data(), cur.data());
+				pngFilterRow(cur.data(), prev.data(), m_rowBytes, bpp, adaptive, dest,
+							 scratch.data());
+				std::swap(cur, prev);
+				dest += m_rowBytes + 1;
+			}
+			group->adler =
+				(uint32_t)adler32(adler32(0L, Z_NULL, 0), group->filtered.data(),
+								  (uInt)group->filtered.size());
+		});
+		packRow(batchEnd - 1, std::vector<int32_t>(width * nr_comp).data(), m_prevRow.data());
+
+		// 2. deflate groups, each primed with the data preceding it
+		std::atomic<bool> success(true);
+		pngParallelFor(m_pool.get(), groups.size(), [&](size_t index) {
+			auto group = &groups[index];
+			const uint8_t* dictionary = m_window.data();
+			size_t dictionaryLen = m_window.size();
+			if(index > 0)
+			{
+				auto& previous = groups[index - 1].filtered;
+				dictionaryLen = std::min(previous.size(), pngWindowBytes);
+				dictionary = previous.data() + previous.size() - dictionaryLen;
+			}
+			if(!pngDeflateGroup(group, m_compressionLevel, dictionary, dictionaryLen,
+								group->y1 == height))
+				success = false;
+		});
+		if(!success)
+		{
+			spdlog::error("PNG: failed to compress rows {} to {}", batchY, batchEnd);
+			return false;
+		}
+
+		// 3. stitch groups, in order, into image data
+		std::vector<uint8_t> data;
+		for(auto& group : groups)
+		{
+			m_adler = (uint32_t)adler32_combine(m_adler, group.adler, (z_off_t)group.filtered.size());
+			data.insert(data.end(), group.compressed.begin(), group.compressed.end());
+			// keep tail of image data, to prime the next batch
+			m_window.insert(m_window.end(), group.filtered.end() - (ptrdiff_t)std::min(
+												group.filtered.size(), pngWindowBytes),
+							group.filtered.end());
+			if(m_window.size() > pngWindowBytes)
+				m_window.erase(m_window.begin(),
+							   m_window.end() - (ptrdiff_t)pngWindowBytes);
+		}
+		if(!writeImageData(data, batchEnd == height))
+			return false;
+		batchY = batchEnd;
 	}
 	m_rowCount += rows;
 
@@ -721,20 +993,28 @@ bool PNGFormat::encodeStrip(uint32_t rows)
 }
 bool PNGFormat::encodeFinish(void)
 {
-	if(setjmp(png_jmpbuf(png)))
-		return false;
-
 	if(m_rowCount < m_image->comps[0].h)
 		spdlog::warn("Full image was not written");
 
+	bool rc = true;
 	if(png)
 	{
-		png_write_end(png, m_info);
+		if(!m_wroteFinalBlock)
+		{
+			// terminate deflate stream with an empty final block
+			PngRowGroup group;
+			std::vector<uint8_t> data;
+			if(pngDeflateGroup(&group, m_compressionLevel, nullptr, 0, true))
+				data = group.compressed;
+			else
+				rc = false;
+			rc = rc && writeImageData(data, true);
+		}
+		rc = rc && writeChunk("IEND", nullptr, 0);
 		png_destroy_write_struct(&png, &m_info);
 	}
-	free(row_buf);
-	free(row32s);
-	bool rc = ImageFormat::encodeFinish();
+	if(!ImageFormat::encodeFinish())
+		rc = false;
 	m_fileStream = nullptr;
 	return rc;
 }
@@ -18,14 +18,25 @@
 
 #include "ImageFormat.h"
 #include <png.h>
+#include <memory>
 #include <string>
+#include <vector>
+
+class ThreadPool;
 
 void pngSetVerboseFlag(bool verbose);
 
 class PNGFormat : public ImageFormat
 {
   public:
-	PNGFormat();
+	/**
+	 * Create PNG format
+	 *
+	 * @param numThreads	number of threads used to filter and deflate rows
+	 * when writing; 0 for hardware concurrency
+	 */
+	explicit PNGFormat(uint32_t numThreads = 0);
+	~PNGFormat();
 	bool encodeHeader(grk_image* m_image, const std::string& filename,
 					  uint32_t compressionParam) override;
 	bool encodeStrip(uint32_t rows) override;
@@ -34,14 +45,27 @@ class PNGFormat : public ImageFormat
 
   private:
 	grk_image* do_decode(const char* read_idf, grk_cparameters* params);
+	void packRow(uint32_t y, int32_t* buffer32s, uint8_t* dest);
+	bool writeChunk(const char* name, const uint8_t* data, size_t len);
+	bool writeImageData(std::vector<uint8_t>& data, bool final);
 
 	png_infop m_info;
 	png_structp png;
-	uint8_t* row_buf;
 	uint8_t** row_buf_array;
 	int32_t* row32s;
 	GRK_COLOR_SPACE m_colorSpace;
 	uint8_t prec;
 	uint16_t nr_comp;
-	int32_t const* m_planes[4];
+	uint32_t m_numThreads;
+	// filters and deflates groups of rows
+	std::unique_ptr<ThreadPool> m_pool;
+	int m_compressionLevel;
+	size_t m_rowBytes;
+	// unfiltered last row written, which predicts the first row of the next strip
+	std::vector<uint8_t> m_prevRow;
+	// last bytes of filtered image data, which prime compression of the next strip
+	std::vector<uint8_t> m_window;
+	uint32_t m_adler;
+	bool m_wroteZlibHeader;
+	bool m_wroteFinalBlock;
 };
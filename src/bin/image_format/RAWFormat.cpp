@@ -26,14 +26,16 @@
 #include "RAWFormat.h"
 #include "convert.h"
 #include "common.h"
+#ifdef GROK_HAVE_URING
+#include "FileUringIO.h"
+#endif
 
 template<typename T>
-static bool write(FILE* m_fileStream, bool bigEndian, int32_t* ptr, uint32_t w, uint32_t stride,
+static bool write(IFileIO* fileIO, bool bigEndian, int32_t* ptr, uint32_t w, uint32_t stride,
 				  uint32_t h, int32_t lower, int32_t upper)
 {
 	const size_t bufSize = 4096;
 	T buf[bufSize];
-	T* outPtr = buf;
 	size_t outCount = 0;
 	auto stride_diff = stride - w;
 	for(uint32_t j = 0; j < h; ++j)
@@ -45,39 +47,43 @@ static bool write(FILE* m_fileStream, bool bigEndian, int32_t* ptr, uint32_t w,
 				curr = upper;
 			else if(curr < lower)
 				curr = lower;
-			if(!grk::writeBytes<T>((T)curr, buf, &outPtr, &outCount, bufSize, bigEndian,
-								   m_fileStream))
-				return false;
+			buf[outCount++] = grk::endian<T>((T)curr, bigEndian);
+			if(outCount == bufSize)
+			{
+				if(!fileIO->write((uint8_t*)buf, outCount * sizeof(T)))
+					return false;
+				outCount = 0;
+			}
 		}
 		ptr += stride_diff;
 	}
 	// flush
-	if(outCount)
-	{
-		size_t res = fwrite(buf, sizeof(T), outCount, m_fileStream);
-		if(res != outCount)
-			return false;
-	}
+	if(outCount && !fileIO->write((uint8_t*)buf, outCount * sizeof(T)))
+		return false;
 
 	return true;
 }
 
+RAWFormat::RAWFormat(bool isBig) : bigEndian(isBig)
+{
+#ifdef GROK_HAVE_URING
+	delete m_fileIO;
+	m_fileIO = new FileUringIO();
+#endif
+}
+
 bool RAWFormat::encodeHeader(grk_image* image, const std::string& filename,
 							 uint32_t compressionParam)
 {
-	(void)compressionParam;
-	m_image = image;
 	m_fileName = filename;
 
-	return true;
+	return ImageFormat::encodeHeader(image, filename, compressionParam);
 }
 bool RAWFormat::encodeStrip(uint32_t rows)
 {
 	(void)rows;
 
 	const char* outfile = m_fileName.c_str();
-	m_useStdIO = grk::useStdio(outfile);
-	m_fileStream = nullptr;
 	unsigned int compno, numcomps;
 	bool success = false;
 
@@ -113,9 +119,6 @@ bool RAWFormat::encodeStrip(uint32_t rows)
 					  "same sign.");
 		goto beach;
 	}
-	if(!grk::grk_open_for_output(&m_fileStream, outfile, m_useStdIO))
-		goto beach;
-
 	spdlog::info("imagetoraw: raw m_image characteristics: {} components", m_image->numcomps);
 
 	for(compno = 0; compno < m_image->numcomps; compno++)
@@ -144,18 +147,18 @@ bool RAWFormat::encodeStrip(uint32_t rows)
 		if(prec <= 8)
 		{
 			if(sgnd)
-				rc = write<int8_t>(m_fileStream, bigEndian, ptr, w, stride, h, lower, upper);
+				rc = write<int8_t>(m_fileIO, bigEndian, ptr, w, stride, h, lower, upper);
 			else
-				rc = write<uint8_t>(m_fileStream, bigEndian, ptr, w, stride, h, lower, upper);
+				rc = write<uint8_t>(m_fileIO, bigEndian, ptr, w, stride, h, lower, upper);
 			if(!rc)
 				spdlog::error("imagetoraw: failed to write bytes for {}", outfile);
 		}
 		else if(prec <= 16)
 		{
 			if(sgnd)
-				rc = write<int16_t>(m_fileStream, bigEndian, ptr, w, stride, h, lower, upper);
+				rc = write<int16_t>(m_fileIO, bigEndian, ptr, w, stride, h, lower, upper);
 			else
-				rc = write<uint16_t>(m_fileStream, bigEndian, ptr, w, stride, h, lower, upper);
+				rc = write<uint16_t>(m_fileIO, bigEndian, ptr, w, stride, h, lower, upper);
 			if(!rc)
 				spdlog::error("fimagetoraw: ailed to write bytes for {}", outfile);
 		}
@@ -178,14 +181,7 @@ beach:
 }
 bool RAWFormat::encodeFinish(void)
 {
-	bool success = true;
-
-	if(!m_useStdIO && m_fileStream)
-	{
-		if(!grk::safe_fclose(m_fileStream))
-			success = false;
-	}
-	return success;
+	return ImageFormat::encodeFinish();
 }
 grk_image* RAWFormat::decode(const std::string& filename, grk_cparameters* parameters)
 {
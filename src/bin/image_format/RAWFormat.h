@@ -21,7 +21,7 @@
 class RAWFormat : public ImageFormat
 {
   public:
-	explicit RAWFormat(bool isBig) : bigEndian(isBig) {}
+	explicit RAWFormat(bool isBig);
 	bool encodeHeader(grk_image* image, const std::string& filename,
 					  uint32_t compressionParam) override;
 	bool encodeStrip(uint32_t rows) override;
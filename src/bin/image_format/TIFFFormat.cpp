@@ -37,6 +37,10 @@
 #include <cassert>
 #include <memory>
 #include <string>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 static void convert_tif_3uto32s(const uint8_t* pSrc, int32_t* pDst, size_t length, bool invert);
 static void convert_tif_5uto32s(const uint8_t* pSrc, int32_t* pDst, size_t length, bool invert);
@@ -90,9 +94,8 @@ void tiffSetErrorAndWarningHandlers(bool verbose)
 	TIFFSetWarningHandler(MyTiffWarningHandler);
 }
 
-static bool readTiffPixelsUnsigned(TIFF* tif, grk_image_comp* comps, uint32_t numcomps,
-								   uint16_t tiSpp, uint16_t tiPC, uint16_t tiPhoto,
-								   uint32_t chroma_subsample_x, uint32_t chroma_subsample_y);
+static bool readTiffPixelsSubsampled(TIFF* tif, grk_image_comp* comps, uint16_t tiPC,
+									 uint32_t chroma_subsample_x, uint32_t chroma_subsample_y);
 
 static std::string getSampleFormatString(uint16_t tiSampleFormat)
 {
@@ -192,204 +195,207 @@ static void set_resolution(double* res, float resx, float resy, short resUnit)
 	}
 }
 
-static bool readTiffPixelsUnsigned(TIFF* tif, grk_image_comp* comps, uint32_t numcomps,
-								   uint16_t tiSpp, uint16_t tiPC, uint16_t tiPhoto,
-								   uint32_t chroma_subsample_x, uint32_t chroma_subsample_y)
+static cvtTo32 getTiffCvtTo32(uint32_t prec)
 {
-	if(!tif)
-		return false;
-
-	bool success = true;
-	cvtTo32 cvtTifTo32s = nullptr;
-	cvtInterleavedToPlanar cvtToPlanar = nullptr;
-	int32_t* planes[maxNumComponents];
-	tsize_t rowStride;
-	bool invert;
-	tdata_t buf = nullptr;
-	tstrip_t strip;
-	tsize_t strip_size;
-	uint32_t currentPlane = 0;
-	int32_t* buffer32s = nullptr;
-	bool subsampled = chroma_subsample_x != 1 || chroma_subsample_y != 1;
-	size_t luma_block = chroma_subsample_x * chroma_subsample_y;
-	size_t unitSize = luma_block + 2;
-
-	switch(comps[0].prec)
+	switch(prec)
 	{
 		case 1:
 		case 2:
 		case 4:
 		case 6:
 		case 8:
-			cvtTifTo32s = cvtTo32_LUT[comps[0].prec];
-			break;
+			return cvtTo32_LUT[prec];
 			/* others are specific to TIFF */
 		case 3:
-			cvtTifTo32s = convert_tif_3uto32s;
-			break;
+			return convert_tif_3uto32s;
 		case 5:
-			cvtTifTo32s = convert_tif_5uto32s;
-			break;
+			return convert_tif_5uto32s;
 		case 7:
-			cvtTifTo32s = convert_tif_7uto32s;
-			break;
+			return convert_tif_7uto32s;
 		case 9:
-			cvtTifTo32s = convert_tif_9uto32s;
-			break;
+			return convert_tif_9uto32s;
 		case 10:
-			cvtTifTo32s = convert_tif_10uto32s;
-			break;
+			return convert_tif_10uto32s;
 		case 11:
-			cvtTifTo32s = convert_tif_11uto32s;
-			break;
+			return convert_tif_11uto32s;
 		case 12:
-			cvtTifTo32s = convert_tif_12uto32s;
-			break;
+			return convert_tif_12uto32s;
 		case 13:
-			cvtTifTo32s = convert_tif_13uto32s;
-			break;
+			return convert_tif_13uto32s;
 		case 14:
-			cvtTifTo32s = convert_tif_14uto32s;
-			break;
+			return convert_tif_14uto32s;
 		case 15:
-			cvtTifTo32s = convert_tif_15uto32s;
-			break;
+			return convert_tif_15uto32s;
 		case 16:
-			cvtTifTo32s = (cvtTo32)convert_tif_16uto32s;
-			break;
+			return (cvtTo32)convert_tif_16uto32s;
 		default:
 			/* never here */
-			break;
+			return nullptr;
 	}
-	cvtToPlanar = cvtInterleavedToPlanar_LUT[numcomps];
-	if(tiPC == PLANARCONFIG_SEPARATE)
+}
+
+/**
+ * Decode a single strip or tile into the image components
+ *
+ * @param T	sample type; only used for signed samples
+ */
+template<typename T>
+static bool readTiffBlock(TIFF* tif, uint32_t blockIndex, grk_image_comp* comps,
+						  uint32_t numcomps, uint16_t tiSpp, uint16_t tiPC, cvtTo32 cvtTifTo32s,
+						  bool invert, tdata_t buf, tsize_t bufSize, int32_t* buffer32s)
+{
+	bool tiled = TIFFIsTiled(tif);
+	bool separate = tiPC == PLANARCONFIG_SEPARATE;
+	uint32_t width = comps[0].w;
+	uint32_t height = comps[0].h;
+	uint32_t blockWidth = width, blockHeight = height;
+	if(tiled)
 	{
-		cvtToPlanar = cvtInterleavedToPlanar_LUT[1]; /* override */
-		tiSpp = 1U; /* consider only one sample per plane */
+		TIFFGetField(tif, TIFFTAG_TILEWIDTH, &blockWidth);
+		TIFFGetField(tif, TIFFTAG_TILELENGTH, &blockHeight);
 	}
-
-	strip_size = TIFFStripSize(tif);
-	buf = _TIFFmalloc(strip_size);
-	if(buf == nullptr)
+	else
 	{
-		success = false;
-		goto local_cleanup;
+		TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &blockHeight);
+		blockHeight = std::min<uint32_t>(blockHeight, height);
+	}
+	uint32_t blocksAcross = (width + blockWidth - 1) / blockWidth;
+	uint32_t blocksDown = (height + blockHeight - 1) / blockHeight;
+	uint32_t blocksPerPlane = blocksAcross * blocksDown;
+	uint32_t plane = separate ? blockIndex / blocksPerPlane : 0;
+	uint32_t x0 = (blockIndex % blocksPerPlane % blocksAcross) * blockWidth;
+	uint32_t y0 = (blockIndex % blocksPerPlane / blocksAcross) * blockHeight;
+	uint32_t spp = separate ? 1U : tiSpp;
+	auto rowStride = (tsize_t)(((uint64_t)blockWidth * spp * comps[0].prec + 7U) / 8U);
+	uint32_t rows = std::min<uint32_t>(blockHeight, height - y0);
+	uint32_t cols = std::min<uint32_t>(blockWidth, width - x0);
+
+	tsize_t ssize;
+	if(tiled)
+		ssize = TIFFReadEncodedTile(tif, TIFFComputeTile(tif, x0, y0, 0, (tsample_t)plane), buf,
+									bufSize);
+	else
+		ssize = TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, y0, (tsample_t)plane), buf,
+									 bufSize);
+	if(ssize < rowStride * (tsize_t)rows || ssize > bufSize)
+	{
+		spdlog::error("tiftoimage: Bad value for ssize({}) "
+					  "vs. expected size({}).",
+					  (long long)ssize, (long long)(rowStride * (tsize_t)rows));
+		return false;
 	}
-	rowStride = (comps[0].w * tiSpp * comps[0].prec + 7U) / 8U;
-	buffer32s = new int32_t[(size_t)comps[0].w * tiSpp];
-	strip = 0;
-	invert = tiPhoto == PHOTOMETRIC_MINISWHITE;
-	for(uint32_t j = 0; j < numcomps; j++)
-		planes[j] = comps[j].data;
-	do
+	auto cvtToPlanar = cvtInterleavedToPlanar_LUT[separate ? 1 : numcomps];
+	int32_t* planes[maxNumComponents];
+	auto datau8 = (const uint8_t*)buf;
+	for(uint32_t j = 0; j < rows; ++j)
 	{
-		auto comp = comps + currentPlane;
-		planes[0] = comp->data;
-		uint32_t height = 0;
-		// if width % chroma_subsample_x != 0...
-		size_t units = (comp->w + chroma_subsample_x - 1) / chroma_subsample_x;
-		// each coded row will be padded to fill unit
-		size_t padding = (units * chroma_subsample_x - comp->w);
-		if(subsampled)
+		if(cvtTifTo32s)
 		{
-			rowStride = (tsize_t)(units * unitSize);
+			cvtTifTo32s(datau8, buffer32s, (size_t)blockWidth * spp, invert);
 		}
-		size_t xpos = 0;
-		for(; (height < comp->h) && (strip < TIFFNumberOfStrips(tif)); strip++)
+		else
 		{
-			tsize_t ssize = TIFFReadEncodedStrip(tif, strip, buf, strip_size);
-			if(ssize < 1 || ssize > strip_size)
-			{
-				spdlog::error("tiftoimage: Bad value for ssize({}) "
-							  "vs. strip_size({}).",
-							  (long long)ssize, (long long)strip_size);
-				success = false;
-				goto local_cleanup;
-			}
-			assert(ssize >= rowStride);
-			const uint8_t* datau8 = (const uint8_t*)buf;
-			while(ssize >= rowStride)
-			{
-				if(chroma_subsample_x == 1 && chroma_subsample_y == 1)
-				{
-					cvtTifTo32s(datau8, buffer32s, (size_t)comp->w * tiSpp, invert);
-					cvtToPlanar(buffer32s, planes, (size_t)comp->w);
-					for(uint32_t k = 0; k < numcomps; ++k)
-						planes[k] += comp->stride;
-					datau8 += rowStride;
-					ssize -= rowStride;
-					height++;
-				}
-				else
-				{
-					uint32_t strideDiffCb = comps[1].stride - comps[1].w;
-					uint32_t strideDiffCr = comps[2].stride - comps[2].w;
-					for(size_t i = 0; i < (size_t)rowStride; i += unitSize)
-					{
-						// process a unit
-						// 1. luma
-						for(size_t k = 0; k < chroma_subsample_y; ++k)
-						{
-							for(size_t j = 0; j < chroma_subsample_x; ++j)
-							{
-								bool accept = height + k < comp->h && xpos + j < comp->w;
-								if(accept)
-									planes[0][xpos + j + k * comp->stride] = datau8[j];
-							}
-							datau8 += chroma_subsample_x;
-						}
-						// 2. chroma
-						*planes[1]++ = *datau8++;
-						*planes[2]++ = *datau8++;
+			auto data = (const T*)datau8;
+			for(size_t i = 0; i < (size_t)blockWidth * spp; ++i)
+				buffer32s[i] = data[i];
+		}
+		size_t offset = (size_t)(y0 + j) * comps[0].stride + x0;
+		if(separate)
+			planes[0] = comps[plane].data + offset;
+		else
+			for(uint32_t k = 0; k < numcomps; ++k)
+				planes[k] = comps[k].data + offset;
+		cvtToPlanar(buffer32s, planes, cols);
+		datau8 += rowStride;
+	}
 
-						// 3. increment raster x
-						xpos += chroma_subsample_x;
-						if(xpos >= comp->w)
-						{
-							datau8 += padding;
-							xpos = 0;
-							planes[0] += comp->stride * chroma_subsample_y;
-							planes[1] += strideDiffCb;
-							planes[2] += strideDiffCr;
-							height += chroma_subsample_y;
-						}
-					}
-					ssize -= rowStride;
-				}
-			}
+	return true;
+}
+
+/**
+ * Decode all strips or tiles of an image that is not chroma subsampled.
+ *
+ * Strips and tiles are independent, so they are decoded in parallel. libtiff handles
+ * can't be shared between threads, so each additional thread opens its own handle.
+ *
+ * @param T	sample type; only used for signed samples
+ * @param cvtTifTo32s converter for unsigned samples, or nullptr for signed samples
+ */
+template<typename T>
+static bool readTiffPixels(TIFF* tif, const std::string& filename, grk_image_comp* comps,
+						   uint32_t numcomps, uint16_t tiSpp, uint16_t tiPC, cvtTo32 cvtTifTo32s,
+						   bool invert, uint32_t numThreads)
+{
+	if(!tif)
+		return false;
+	bool tiled = TIFFIsTiled(tif);
+	uint32_t numBlocks = tiled ? TIFFNumberOfTiles(tif) : TIFFNumberOfStrips(tif);
+	tsize_t bufSize = tiled ? TIFFTileSize(tif) : TIFFStripSize(tif);
+	uint32_t blockWidth = comps[0].w;
+	if(tiled)
+		TIFFGetField(tif, TIFFTAG_TILEWIDTH, &blockWidth);
+	auto directory = TIFFCurrentDirectory(tif);
+	if(!numThreads)
+		numThreads = std::thread::hardware_concurrency();
+	numThreads = std::max<uint32_t>(std::min<uint32_t>(numThreads, numBlocks), 1);
+
+	std::atomic<uint32_t> nextBlock(0);
+	std::atomic<bool> success(true);
+	auto worker = [&](TIFF* handle) {
+		tdata_t buf = _TIFFmalloc(bufSize);
+		auto buffer32s = new int32_t[(size_t)blockWidth * tiSpp];
+		if(!buf)
+			success = false;
+		uint32_t blockIndex;
+		while(success && (blockIndex = nextBlock++) < numBlocks)
+		{
+			if(!readTiffBlock<T>(handle, blockIndex, comps, numcomps, tiSpp, tiPC, cvtTifTo32s,
+								 invert, buf, bufSize, buffer32s))
+				success = false;
 		}
-		currentPlane++;
-	} while((tiPC == PLANARCONFIG_SEPARATE) && (currentPlane < numcomps));
-local_cleanup:
-	delete[] buffer32s;
-	if(buf)
-		_TIFFfree(buf);
+		delete[] buffer32s;
+		if(buf)
+			_TIFFfree(buf);
+	};
+	std::vector<std::thread> threads;
+	for(uint32_t i = 1; i < numThreads; ++i)
+	{
+		threads.emplace_back([&] {
+			auto handle = TIFFOpen(filename.c_str(), "r");
+			if(!handle || !TIFFSetDirectory(handle, directory))
+				success = false;
+			else
+				worker(handle);
+			if(handle)
+				TIFFClose(handle);
+		});
+	}
+	worker(tif);
+	for(auto& t : threads)
+		t.join();
+
 	return success;
 }
 
-template<typename T>
-bool readTiffPixelsSigned(TIFF* tif, grk_image_comp* comps, uint32_t numcomps, uint16_t tiSpp,
-						  uint16_t tiPC)
+/**
+ * Read strips of chroma subsampled YCbCr samples. Each unit of the strip holds
+ * a block of chroma_subsample_x * chroma_subsample_y luma samples, followed by
+ * one Cb and one Cr sample. Images without subsampling are read by readTiffPixels
+ */
+static bool readTiffPixelsSubsampled(TIFF* tif, grk_image_comp* comps, uint16_t tiPC,
+									 uint32_t chroma_subsample_x, uint32_t chroma_subsample_y)
 {
 	if(!tif)
 		return false;
 
 	bool success = true;
-	cvtInterleavedToPlanar cvtToPlanar = nullptr;
-	int32_t* planes[maxNumComponents];
-	tsize_t rowStride;
+	int32_t* planes[3];
 	tdata_t buf = nullptr;
 	tstrip_t strip;
 	tsize_t strip_size;
 	uint32_t currentPlane = 0;
-	int32_t* buffer32s = nullptr;
-
-	cvtToPlanar = cvtInterleavedToPlanar_LUT[numcomps];
-	if(tiPC == PLANARCONFIG_SEPARATE)
-	{
-		cvtToPlanar = cvtInterleavedToPlanar_LUT[1]; /* override */
-		tiSpp = 1U; /* consider only one sample per plane */
-	}
+	size_t luma_block = chroma_subsample_x * chroma_subsample_y;
+	size_t unitSize = luma_block + 2;
 
 	strip_size = TIFFStripSize(tif);
 	buf = _TIFFmalloc(strip_size);
@@ -398,18 +404,21 @@ bool readTiffPixelsSigned(TIFF* tif, grk_image_comp* comps, uint32_t numcomps, u
 		success = false;
 		goto local_cleanup;
 	}
-	rowStride = (comps[0].w * tiSpp * comps[0].prec + 7U) / 8U;
-	buffer32s = new int32_t[(size_t)comps[0].w * tiSpp];
 	strip = 0;
-	for(uint32_t j = 0; j < numcomps; j++)
+	for(uint32_t j = 0; j < 3; j++)
 		planes[j] = comps[j].data;
 	do
 	{
-		grk_image_comp* comp = comps + currentPlane;
-		planes[0] = comp->data; /* to manage planar data */
-		uint32_t height = comp->h;
-		/* Read the Image components */
-		for(; (height > 0) && (strip < TIFFNumberOfStrips(tif)); strip++)
+		auto comp = comps + currentPlane;
+		planes[0] = comp->data;
+		uint32_t height = 0;
+		// if width % chroma_subsample_x != 0...
+		size_t units = (comp->w + chroma_subsample_x - 1) / chroma_subsample_x;
+		// each coded row will be padded to fill unit
+		size_t padding = (units * chroma_subsample_x - comp->w);
+		tsize_t rowStride = (tsize_t)(units * unitSize);
+		size_t xpos = 0;
+		for(; (height < comp->h) && (strip < TIFFNumberOfStrips(tif)); strip++)
 		{
 			tsize_t ssize = TIFFReadEncodedStrip(tif, strip, buf, strip_size);
 			if(ssize < 1 || ssize > strip_size)
@@ -420,23 +429,48 @@ bool readTiffPixelsSigned(TIFF* tif, grk_image_comp* comps, uint32_t numcomps, u
 				success = false;
 				goto local_cleanup;
 			}
-			const T* data = (const T*)buf;
+			assert(ssize >= rowStride);
+			const uint8_t* datau8 = (const uint8_t*)buf;
 			while(ssize >= rowStride)
 			{
-				for(size_t i = 0; i < (size_t)comp->w * tiSpp; ++i)
-					buffer32s[i] = data[i];
-				cvtToPlanar(buffer32s, planes, (size_t)comp->w);
-				for(uint32_t k = 0; k < numcomps; ++k)
-					planes[k] += comp->stride;
-				data += (size_t)rowStride / sizeof(T);
+				uint32_t strideDiffCb = comps[1].stride - comps[1].w;
+				uint32_t strideDiffCr = comps[2].stride - comps[2].w;
+				for(size_t i = 0; i < (size_t)rowStride; i += unitSize)
+				{
+					// process a unit
+					// 1. luma
+					for(size_t k = 0; k < chroma_subsample_y; ++k)
+					{
+						for(size_t j = 0; j < chroma_subsample_x; ++j)
+						{
+							bool accept = height + k < comp->h && xpos + j < comp->w;
+							if(accept)
+								planes[0][xpos + j + k * comp->stride] = datau8[j];
+						}
+						datau8 += chroma_subsample_x;
+					}
+					// 2. chroma
+					*planes[1]++ = *datau8++;
+					*planes[2]++ = *datau8++;
+
+					// 3. increment raster x
+					xpos += chroma_subsample_x;
+					if(xpos >= comp->w)
+					{
+						datau8 += padding;
+						xpos = 0;
+						planes[0] += comp->stride * chroma_subsample_y;
+						planes[1] += strideDiffCb;
+						planes[2] += strideDiffCr;
+						height += chroma_subsample_y;
+					}
+				}
 				ssize -= rowStride;
-				height--;
 			}
 		}
 		currentPlane++;
-	} while((tiPC == PLANARCONFIG_SEPARATE) && (currentPlane < numcomps));
+	} while((tiPC == PLANARCONFIG_SEPARATE) && (currentPlane < 3));
 local_cleanup:
-	delete[] buffer32s;
 	if(buf)
 		_TIFFfree(buf);
 	return success;
@@ -1329,17 +1363,30 @@ grk_image* TIFFFormat::decode(const std::string& filename, grk_cparameters* para
 		memcpy(image->meta->xmp_buf, xmp_buf, xmp_len);
 	}
 	// 9. read pixel data
-	if(isSigned)
+	if(chroma_subsample_x != 1 || chroma_subsample_y != 1)
+	{
+		if(TIFFIsTiled(tif))
+		{
+			spdlog::error("tiftoimage: tiled image with chroma subsampling is not supported");
+			goto cleanup;
+		}
+		success = readTiffPixelsSubsampled(tif, image->comps, tiPC, chroma_subsample_x,
+										   chroma_subsample_y);
+	}
+	else if(isSigned)
 	{
 		if(tiBps == 8)
-			success = readTiffPixelsSigned<int8_t>(tif, image->comps, numcomps, tiSpp, tiPC);
+			success = readTiffPixels<int8_t>(tif, filename, image->comps, numcomps, tiSpp, tiPC,
+											 nullptr, false, parameters->numThreads);
 		else
-			success = readTiffPixelsSigned<int16_t>(tif, image->comps, numcomps, tiSpp, tiPC);
+			success = readTiffPixels<int16_t>(tif, filename, image->comps, numcomps, tiSpp,
+											  tiPC, nullptr, false, parameters->numThreads);
 	}
 	else
 	{
-		success = readTiffPixelsUnsigned(tif, image->comps, numcomps, tiSpp, tiPC, tiPhoto,
-										 chroma_subsample_x, chroma_subsample_y);
+		success = readTiffPixels<uint8_t>(tif, filename, image->comps, numcomps, tiSpp, tiPC,
+										  getTiffCvtTo32(image->comps[0].prec),
+										  tiPhoto == PHOTOMETRIC_MINISWHITE, parameters->numThreads);
 	}
 cleanup:
 	if(tif)
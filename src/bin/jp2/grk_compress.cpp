@@ -71,10 +71,14 @@ using namespace grk;
 #include "spdlog/sinks/basic_file_sink.h"
 #include "exif.h"
 #include "FileProvider.h"
+#include "BatchProcessor.h"
+#include "FrameSequencer.h"
 
 #include "grk_compress.h"
 
 static bool pluginCompressCallback(grk_plugin_compress_user_callback_info* info);
+static bool compressImage(grk_plugin_compress_user_callback_info* info,
+						  grk_stream* sequenceStream);
 
 void exit_func()
 {
@@ -154,7 +158,10 @@ static void compress_help_display(void)
 	fprintf(stdout, "\n");
 	fprintf(stdout, "[-i|-InputFile] <file>\n");
 	fprintf(stdout, "    Input file\n");
-	fprintf(stdout, "    Supported extensions: <PBM|PGM|PPM|PNM|PAM|PGX|PNG|BMP|TIF|RAW|RAWL>\n");
+	fprintf(stdout, "    Supported extensions: <PBM|PGM|PPM|PNM|PAM|PGX|PNG|BMP|TIF|RAW|RAWL|J2K|JP2>\n");
+	fprintf(stdout, "    JPEG 2000 input (*.j2k, *.j2c, *.jp2) is transcoded between the Part 1\n"
+					"    and HTJ2K block coders (see -M 64), keeping its wavelet coefficients,\n"
+					"    tiling and quantization. All coding passes go into a single layer.\n");
 	fprintf(stdout, "    If used, '-o <file>' must be provided\n");
 	fprintf(stdout, "[-o|-OutputFile] <compressed file>\n");
 	fprintf(stdout, "    Output file (supported extensions are j2k or jp2).\n");
@@ -321,6 +328,14 @@ static void compress_help_display(void)
 	fprintf(stdout, "    Path to T1 plugin.\n");
 	fprintf(stdout, "[-H|-num_threads] <number of threads>\n");
 	fprintf(stdout, "    Number of threads used by libgrokj2k library.\n");
+	fprintf(stdout, "[-B|-BatchWorkers] <number of workers>\n");
+	fprintf(stdout, "    Number of images compressed concurrently when compressing a folder.\n"
+					"    Default: chosen automatically from the number of threads and images.\n");
+	fprintf(stdout, "[-j|-Sequence] <file>\n");
+	fprintf(stdout, "    Compress all images in input folder, in file name order, as a sequence of\n"
+					"    code streams concatenated in a single file. Several frames are compressed\n"
+					"    concurrently (see -BatchWorkers), and each frame must fit in the maximum\n"
+					"    code stream size of the cinema, IMF or broadcast profile, if any.\n");
 	fprintf(stdout, "[-G|-DeviceId] <device ID>\n");
 	fprintf(stdout, "    (GPU) Specify which GPU accelerator to run codec on.\n");
 	fprintf(stdout, "    A value of -1 will specify all devices.\n");
@@ -343,7 +358,8 @@ static GRK_PROG_ORDER getProgression(const char progression[4])
 
 	return GRK_PROG_UNKNOWN;
 }
-CompressInitParams::CompressInitParams() : initialized(false), transferExifTags(false)
+CompressInitParams::CompressInitParams()
+	: initialized(false), transferExifTags(false), batchWorkers(0)
 {
 	pluginPath[0] = 0;
 	*indexfilename = 0;
@@ -412,12 +428,65 @@ static bool isDecodedFormatSupported(GRK_SUPPORTED_FILE_FMT format)
 		case GRK_RAWL_FMT:
 		case GRK_PNG_FMT:
 		case GRK_JPG_FMT:
+		case GRK_J2K_FMT:
+		case GRK_JP2_FMT:
 			break;
 		default:
 			return false;
 	}
 	return true;
 }
+/**
+ * Transcode JPEG 2000 input to the Part 1 or HTJ2K block coder,
+ * without decompressing to image samples
+ */
+static bool transcode(const char* infile, const char* outfile, grk_cparameters* parameters,
+					  grk_stream* sequenceStream)
+{
+	bool rc = false;
+	grk_codec* decompressCodec = nullptr;
+	grk_codec* compressCodec = nullptr;
+	grk_dparameters dparameters;
+	auto inStream = grk_stream_create_file_stream(infile, 1024 * 1024, true);
+	auto outStream = sequenceStream ? sequenceStream
+									: grk_stream_create_file_stream(outfile, 1024 * 1024, false);
+	if(!inStream || !outStream)
+	{
+		spdlog::error("failed to create stream");
+		goto cleanup;
+	}
+	decompressCodec = grk_decompress_create(
+		parameters->decod_format == GRK_JP2_FMT ? GRK_CODEC_JP2 : GRK_CODEC_J2K, inStream);
+	compressCodec = grk_compress_create(
+		parameters->cod_format == GRK_JP2_FMT ? GRK_CODEC_JP2 : GRK_CODEC_J2K, outStream);
+	if(!decompressCodec || !compressCodec)
+		goto cleanup;
+	if(parameters->verbose)
+	{
+		grk_set_info_handler(grk::infoCallback, nullptr);
+		grk_set_warning_handler(grk::warningCallback, nullptr);
+	}
+	grk_set_error_handler(grk::errorCallback, nullptr);
+	grk_decompress_set_default_params(&dparameters);
+	if(!grk_decompress_init(decompressCodec, &dparameters) ||
+	   !grk_decompress_read_header(decompressCodec, nullptr))
+	{
+		spdlog::error("failed to read header of {}", infile);
+		goto cleanup;
+	}
+	rc = grk_transcode(decompressCodec, compressCodec, parameters);
+	if(!rc)
+		spdlog::error("failed to transcode {}", infile);
+cleanup:
+	grk_object_unref(decompressCodec);
+	grk_object_unref(compressCodec);
+	if(inStream)
+		grk_object_unref(inStream);
+	if(outStream && !sequenceStream)
+		grk_object_unref(outStream);
+
+	return rc;
+}
 
 class GrokOutput : public TCLAP::StdOutput
 {
@@ -511,6 +580,10 @@ static int parseCommandLine(int argc, char** argv, CompressInitParams* initParam
 												   "string", cmd);
 		TCLAP::ValueArg<uint32_t> numThreadsArg("H", "num_threads", "Number of threads", false, 0,
 												"unsigned integer", cmd);
+		TCLAP::ValueArg<uint32_t> batchWorkersArg("B", "BatchWorkers", "Number of batch workers",
+												  false, 0, "unsigned integer", cmd);
+		TCLAP::ValueArg<std::string> sequenceArg("j", "Sequence", "Sequence file", false, "",
+												 "string", cmd);
 
 		TCLAP::ValueArg<int32_t> deviceIdArg("G", "DeviceId", "Device ID", false, 0, "integer",
 											 cmd);
@@ -642,6 +715,23 @@ static int parseCommandLine(int argc, char** argv, CompressInitParams* initParam
 
 		if(numThreadsArg.isSet())
 			parameters->numThreads = numThreadsArg.getValue();
+		if(batchWorkersArg.isSet())
+			initParams->batchWorkers = batchWorkersArg.getValue();
+
+		if(sequenceArg.isSet())
+		{
+			if(outForArg.isSet() || outputFileArg.isSet())
+			{
+				spdlog::error("options -Sequence and -OutFor/-o cannot be used together ");
+				return 1;
+			}
+			if(!imgDirArg.isSet())
+			{
+				spdlog::error("option -Sequence requires -ImgDir ");
+				return 1;
+			}
+			initParams->sequenceFile = sequenceArg.getValue();
+		}
 
 		if(deviceIdArg.isSet())
 			parameters->deviceId = deviceIdArg.getValue();
@@ -674,7 +764,7 @@ static int parseCommandLine(int argc, char** argv, CompressInitParams* initParam
 				{
 					spdlog::error("Unknown input file format: {} \n"
 								  "        Known file formats are *.pnm, *.pgm, *.ppm, *.pgx, "
-								  "*png, *.bmp, *.tif, *.jpg or *.raw",
+								  "*png, *.bmp, *.tif, *.jpg, *.raw, *.j2k or *.jp2",
 								  infile);
 					return 1;
 				}
@@ -720,6 +810,14 @@ static int parseCommandLine(int argc, char** argv, CompressInitParams* initParam
 					return 1;
 			}
 		}
+		else if(sequenceArg.isSet())
+		{
+			// frames are compressed to memory as code streams, and then
+			// appended to the sequence file
+			inputFolder->set_out_format = true;
+			inputFolder->out_format = "j2k";
+			parameters->cod_format = GRK_J2K_FMT;
+		}
 
 		if(outputFileArg.isSet())
 		{
@@ -1709,37 +1807,45 @@ static int pluginMain(int argc, char** argv, CompressInitParams* initParams);
 
 // returns 0 if failed, 1 if succeeded,
 // and 2 if file is not suitable for compression
-static int compress(const std::string& inputFile, CompressInitParams* initParams)
+static int compress(const std::string& inputFile, CompressInitParams* initParams,
+					grk_cparameters* parameters, grk_stream* sequenceStream = nullptr)
 {
 	// clear for next file compress
-	initParams->parameters.write_capture_resolution_from_file = false;
+	parameters->write_capture_resolution_from_file = false;
 	// don't reset format if reading from STDIN
-	if(initParams->parameters.infile[0])
-		initParams->parameters.decod_format = GRK_UNK_FMT;
+	if(parameters->infile[0])
+		parameters->decod_format = GRK_UNK_FMT;
 	if(initParams->inputFolder.set_imgdir)
 	{
 		if(nextFile(inputFile, &initParams->inputFolder,
 					initParams->outFolder.set_imgdir ? &initParams->outFolder
 													 : &initParams->inputFolder,
-					&initParams->parameters))
+					parameters))
 		{
 			return 2;
 		}
 	}
 	grk_plugin_compress_user_callback_info callbackInfo;
 	memset(&callbackInfo, 0, sizeof(grk_plugin_compress_user_callback_info));
-	callbackInfo.compressor_parameters = &initParams->parameters;
+	callbackInfo.compressor_parameters = parameters;
 	callbackInfo.image = nullptr;
-	callbackInfo.output_file_name = initParams->parameters.outfile;
-	callbackInfo.input_file_name = initParams->parameters.infile;
+	callbackInfo.output_file_name = parameters->outfile;
+	callbackInfo.input_file_name = parameters->infile;
 	callbackInfo.transferExifTags = initParams->transferExifTags;
 
-	return pluginCompressCallback(&callbackInfo) ? 1 : 0;
+	return compressImage(&callbackInfo, sequenceStream) ? 1 : 0;
 }
 
 grk_img_fol img_fol_plugin, out_fol_plugin;
 
 static bool pluginCompressCallback(grk_plugin_compress_user_callback_info* info)
+{
+	return compressImage(info, nullptr);
+}
+// if sequence stream is not null, compress to this stream, which is owned by the caller,
+// rather than to the output file
+static bool compressImage(grk_plugin_compress_user_callback_info* info,
+						  grk_stream* sequenceStream)
 {
 	auto parameters = info->compressor_parameters;
 	bool bSuccess = true;
@@ -1794,6 +1900,11 @@ static bool pluginCompressCallback(grk_plugin_compress_user_callback_info* info)
 				goto cleanup;
 			}
 		}
+		if(parameters->decod_format == GRK_J2K_FMT || parameters->decod_format == GRK_JP2_FMT)
+		{
+			bSuccess = transcode(info->input_file_name, outfile, parameters, sequenceStream);
+			goto cleanup;
+		}
 		/* decode the source image */
 		/* ----------------------- */
 
@@ -2054,7 +2165,11 @@ static bool pluginCompressCallback(grk_plugin_compress_user_callback_info* info)
 			spdlog::warn("MSamples/sec is {}, whereas limit is {}.", msamplespersec, limit);
 	}
 
-	if(info->compressBuffer)
+	if(sequenceStream)
+	{
+		stream = sequenceStream;
+	}
+	else if(info->compressBuffer)
 	{
 		// let stream clean up compress buffer
 		stream = grk_stream_create_mem_stream(info->compressBuffer, info->compressBufferLen, true,
@@ -2149,12 +2264,12 @@ static bool pluginCompressCallback(grk_plugin_compress_user_callback_info* info)
 		}
 	}
 cleanup:
-	if(stream)
+	if(stream && !sequenceStream)
 		grk_object_unref(stream);
 	grk_object_unref(codec);
 	if(createdImage)
 		grk_object_unref(&image->obj);
-	if(!bSuccess)
+	if(!bSuccess && !sequenceStream)
 	{
 		spdlog::error("failed to compress image");
 		if(parameters->outfile[0])
@@ -2199,6 +2314,13 @@ static int pluginMain(int argc, char** argv, CompressInitParams* initParams)
 		success = 1;
 		goto cleanup;
 	}
+	// sequences are compressed by the FrameSequencer in batchCompress,
+	// so that frames are written in order
+	if(!initParams->sequenceFile.empty())
+	{
+		success = 1;
+		goto cleanup;
+	}
 	img_fol_plugin = initParams->inputFolder;
 	out_fol_plugin = initParams->outFolder;
 
@@ -2271,6 +2393,70 @@ cleanup:
 	return success;
 }
 
+// compress all images in input folder, several at a time
+static uint32_t batchCompress(CompressInitParams* initParams,
+							  const grk_cparameters& parametersCache)
+{
+	BatchProcessor batch(initParams->inputFolder.imgdirpath, initParams->parameters.numThreads,
+						 initParams->batchWorkers);
+	uint32_t numWorkers = batch.numWorkers();
+	if(numWorkers > 1)
+	{
+		// re-size library thread pool to leave room for image-level parallelism
+		grk_set_num_threads(batch.numLibraryThreads());
+		spdlog::info("Batch compress: {} images, {} workers, {} library threads",
+					 batch.numFiles(), numWorkers, batch.numLibraryThreads());
+	}
+	// each worker owns a copy of the parameters
+	std::vector<grk_cparameters> parameters(numWorkers);
+	if(initParams->sequenceFile.empty())
+	{
+		return batch.run([initParams, &batch, &parametersCache, &parameters](
+							 uint32_t worker, size_t fileIndex, const std::string& filename) {
+			(void)fileIndex;
+			parameters[worker] = parametersCache;
+			// also limits the number of threads used to read the input image
+			parameters[worker].numThreads = batch.numLibraryThreads();
+			return compress(filename, initParams, &parameters[worker]);
+		});
+	}
+
+	// sequence: frames are compressed concurrently, and written in order.
+	// Allow some slack beyond one frame per worker, so that a slow frame
+	// does not immediately stall the other workers
+	FrameSequencer sequencer(initParams->sequenceFile, batch.numFiles(), 2 * numWorkers);
+	if(!sequencer.open())
+		return 0;
+	batch.run([initParams, &batch, &parametersCache, &parameters, &sequencer](
+				  uint32_t worker, size_t fileIndex, const std::string& filename) {
+		if(!sequencer.begin(fileIndex))
+			return 0;
+		parameters[worker] = parametersCache;
+		parameters[worker].numThreads = batch.numLibraryThreads();
+		auto stream = grk_stream_create_chunked_mem_stream(0);
+		int rc = compress(filename, initParams, &parameters[worker], stream);
+		// the library already holds each frame to the profile's maximum code stream size
+		if(rc == 1)
+			return sequencer.submit(fileIndex, stream) ? 1 : 0;
+		grk_object_unref(stream);
+		if(rc == 2)
+			sequencer.skip(fileIndex);
+		else
+			sequencer.fail(fileIndex);
+
+		return rc;
+	});
+	if(!sequencer.close())
+	{
+		spdlog::error("failed to compress sequence {}", initParams->sequenceFile);
+		return 0;
+	}
+	spdlog::info("Sequence: {} frames written to {}", sequencer.numFramesWritten(),
+				 initParams->sequenceFile);
+
+	return (uint32_t)sequencer.numFramesWritten();
+}
+
 int main(int argc, char** argv)
 {
 	CompressInitParams initParams;
@@ -2297,7 +2483,7 @@ int main(int argc, char** argv)
 			if(!initParams.inputFolder.set_imgdir)
 			{
 				initParams.parameters = parametersCache;
-				if(compress("", &initParams) == 0)
+				if(compress("", &initParams, &initParams.parameters) == 0)
 				{
 					success = 1;
 					goto cleanup;
@@ -2306,14 +2492,7 @@ int main(int argc, char** argv)
 			}
 			else
 			{
-				std::string filename;
-				FileProvider provider(initParams.inputFolder.imgdirpath);
-				while(provider.next(filename))
-				{
-					initParams.parameters = parametersCache;
-					if(compress(filename, &initParams) == 1)
-						numCompressedFiles++;
-				}
+				numCompressedFiles += batchCompress(&initParams, parametersCache);
 			}
 		}
 		auto finish = std::chrono::high_resolution_clock::now();
@@ -36,6 +36,10 @@ struct CompressInitParams
 	grk_img_fol inputFolder;
 	grk_img_fol outFolder;
 	bool transferExifTags;
+	// number of images compressed concurrently in batch mode (0 for automatic)
+	uint32_t batchWorkers;
+	// if not empty, compress input folder as a sequence of frames in this file
+	std::string sequenceFile;
 };
 
 } // namespace grk
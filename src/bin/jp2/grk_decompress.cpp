@@ -71,6 +71,7 @@
 #include "spdlog/sinks/basic_file_sink.h"
 #include "exif.h"
 #include "FileProvider.h"
+#include "BatchProcessor.h"
 
 namespace grk
 {
@@ -144,13 +145,22 @@ static void decompress_help_display(void)
 					"    components: an index starting from 0 will then be appended to the\n"
 					"    output filename, just before the \"pgx\" extension. If a PGM filename\n"
 					"    is given and there are more than one component, only the first component\n"
-					"    will be written to the file.\n");
+					"    will be written to the file.\n"
+					"    If a J2K or JP2 filename is given, the code stream is not decompressed:\n"
+					"    instead, the subset selected by the [-r], [-l] and [-d] options\n"
+					"    is extracted and written to the file.\n");
 	fprintf(stdout, "  [-a | -OutDir] <output directory>\n"
 					"    Output directory where decompressed files will be stored.\n");
 	fprintf(stdout, "  [-g | -PluginPath] <plugin path>\n"
 					"    Path to T1 plugin.\n");
 	fprintf(stdout, "  [-H | -num_threads] <number of threads>\n"
 					"    Number of threads used by libgrokj2k library.\n");
+	fprintf(stdout, "  [-B | -BatchWorkers] <number of workers>\n"
+					"    Number of images decompressed concurrently when decompressing a folder.\n"
+					"    Default: chosen automatically from the number of threads and images.\n");
+	fprintf(stdout, "  [-J | -TraceFile] <json file name>\n"
+					"    Write per tile timing of codec stages to a Chrome trace JSON file.\n"
+					"    Only available if the library was built with the GRK_TRACE option.\n");
 	fprintf(stdout,
 			"  [-c|-Compression] <compression method>\n"
 			"	Compress output image data. Currently, this option is only applicable when\n"
@@ -171,6 +181,14 @@ static void decompress_help_display(void)
 					"    image resolution is effectively divided by 2 to the power of the\n"
 					"    number of discarded levels. The reduce factor is limited by the\n"
 					"    smallest total number of decomposition levels among tiles.\n"
+					"  [-S | -StripHeight] <strip height>\n"
+					"    Decompress whole tiles in horizontal strips of this many rows, to bound\n"
+					"    the memory used for code blocks and wavelet coefficients. Default: 0 (off).\n"
+					"  [-T | -TimeBudget] <milliseconds>\n"
+					"    Limit decompression to roughly this many milliseconds. When time runs out,\n"
+					"    no more packets are read and no more code blocks are decompressed, and a\n"
+					"    lower quality image is reconstructed from what has been decoded.\n"
+					"    Default: 0 (no limit).\n"
 					"  [-l | -Layer] <number of quality layers to decompress>\n"
 					"    Set the maximum number of quality layers to decompress. If there are\n"
 					"    fewer quality layers than the specified number, all the quality layers\n"
@@ -207,6 +225,20 @@ void GrkDecompress::printTiming(uint32_t num_images, std::chrono::duration<doubl
 		return;
 	std::string temp = (num_images > 1) ? "ms/image" : "ms";
 	spdlog::info("decompress time: {} {}", (elapsed.count() * 1000) / (double)num_images, temp);
+	grk_trace_stats stats;
+	if(!grk_trace_get_stats(&stats))
+		return;
+	const char* stageNames[GRK_TRACE_STAGE_COUNT] = {
+		"T2", "T1", "DWT", "MCT", "DC shift", "rate control", "precision", "composite"};
+	for(uint32_t i = 0; i < GRK_TRACE_STAGE_COUNT; ++i)
+	{
+		if(stats.stageUs[i])
+			spdlog::info("{}: {} ms (summed over tiles)", stageNames[i],
+						 (double)stats.stageUs[i] / 1000);
+	}
+	spdlog::info("code blocks: {}, bytes parsed: {}, allocations: {} ({} bytes), thread idle: {} ms",
+				 stats.numCodeBlocks, stats.bytesParsed, stats.numAllocations,
+				 stats.bytesAllocated, (double)stats.threadIdleUs / 1000);
 }
 
 bool GrkDecompress::parsePrecision(const char* option, grk_decompress_parameters* parameters)
@@ -461,12 +493,20 @@ int GrkDecompress::parseCommandLine(int argc, char** argv, DecompressInitParams*
 												   "string", cmd);
 		TCLAP::ValueArg<uint32_t> numThreadsArg("H", "num_threads", "Number of threads", false, 0,
 												"unsigned integer", cmd);
+		TCLAP::ValueArg<uint32_t> batchWorkersArg("B", "BatchWorkers", "Number of batch workers",
+												  false, 0, "unsigned integer", cmd);
+		TCLAP::ValueArg<std::string> traceFileArg("J", "TraceFile", "Trace file", false, "",
+												  "string", cmd);
 		TCLAP::ValueArg<std::string> inputFileArg("i", "InputFile", "Input file", false, "",
 												  "string", cmd);
 		TCLAP::ValueArg<std::string> outputFileArg("o", "OutputFile", "Output file", false, "",
 												   "string", cmd);
 		TCLAP::ValueArg<uint32_t> reduceArg("r", "Reduce", "Reduce resolutions", false, 0,
 											"unsigned integer", cmd);
+		TCLAP::ValueArg<uint32_t> stripHeightArg("S", "StripHeight", "Strip height", false, 0,
+												 "unsigned integer", cmd);
+		TCLAP::ValueArg<uint32_t> timeBudgetArg("T", "TimeBudget", "Time budget in milliseconds",
+												false, 0, "unsigned integer", cmd);
 		TCLAP::ValueArg<uint16_t> layerArg("l", "Layer", "Layer", false, 0, "unsigned integer",
 										   cmd);
 		TCLAP::ValueArg<uint32_t> tileArg("t", "TileInfo", "Input tile index", false, 0,
@@ -611,9 +651,16 @@ int GrkDecompress::parseCommandLine(int argc, char** argv, DecompressInitParams*
 				case GRK_PNG_FMT:
 					inputFolder->out_format = "png";
 					break;
+				case GRK_J2K_FMT:
+					inputFolder->out_format = "j2k";
+					break;
+				case GRK_JP2_FMT:
+					inputFolder->out_format = "jp2";
+					break;
 				default:
 					spdlog::error("Unknown output format image {} [only *.png, *.pnm, *.pgm, "
-								  "*.ppm, *.pgx, *.bmp, *.tif, *.jpg, *.jpeg, *.raw or *.rawl]",
+								  "*.ppm, *.pgx, *.bmp, *.tif, *.jpg, *.jpeg, *.raw, *.rawl, "
+								  "*.j2k or *.jp2]",
 								  outformat);
 					return 1;
 			}
@@ -633,11 +680,13 @@ int GrkDecompress::parseCommandLine(int argc, char** argv, DecompressInitParams*
 				case GRK_RAWL_FMT:
 				case GRK_PNG_FMT:
 				case GRK_JPG_FMT:
+				case GRK_J2K_FMT:
+				case GRK_JP2_FMT:
 					break;
 				default:
 					spdlog::error(
 						"Unknown output format image {} [only *.png, *.pnm, *.pgm, *.ppm, *.pgx, "
-						"*.bmp, *.tif, *.tiff, *jpg, *jpeg, *.raw or *rawl]",
+						"*.bmp, *.tif, *.tiff, *jpg, *jpeg, *.raw, *rawl, *.j2k or *.jp2]",
 						outfile);
 					return 1;
 			}
@@ -688,6 +737,10 @@ int GrkDecompress::parseCommandLine(int argc, char** argv, DecompressInitParams*
 			else
 				parameters->core.cp_reduce = (uint8_t)reduceArg.getValue();
 		}
+		if(stripHeightArg.isSet())
+			parameters->core.dwtStripHeight = stripHeightArg.getValue();
+		if(timeBudgetArg.isSet())
+			parameters->core.timeBudgetMs = timeBudgetArg.getValue();
 		if(layerArg.isSet())
 		{
 			parameters->core.cp_layer = layerArg.getValue();
@@ -706,6 +759,10 @@ int GrkDecompress::parseCommandLine(int argc, char** argv, DecompressInitParams*
 		{
 			parameters->numThreads = numThreadsArg.getValue();
 		}
+		if(batchWorkersArg.isSet())
+			initParams->batchWorkers = batchWorkersArg.getValue();
+		if(traceFileArg.isSet())
+			initParams->traceFile = traceFileArg.getValue();
 
 		if(decodeRegionArg.isSet())
 		{
@@ -843,14 +900,15 @@ void MycmsLogErrorHandlerFunction(cmsContext ContextID, cmsUInt32Number ErrorCod
 static int decompress_callback(grk_plugin_decompress_callback_info* info);
 
 // returns 0 for failure, 1 for success, and 2 if file is not suitable for decoding
-int GrkDecompress::decompress(std::string& fileName, DecompressInitParams* initParams)
+int GrkDecompress::decompress(const std::string& fileName, DecompressInitParams* initParams,
+							  grk_decompress_parameters* parameters)
 {
 	if(initParams->inputFolder.set_imgdir)
 	{
 		if(nextFile(fileName, &initParams->inputFolder,
 					initParams->outFolder.set_imgdir ? &initParams->outFolder
 													 : &initParams->inputFolder,
-					&initParams->parameters))
+					parameters))
 		{
 			return 2;
 		}
@@ -861,7 +919,7 @@ int GrkDecompress::decompress(std::string& fileName, DecompressInitParams* initP
 	info.decod_format = GRK_UNK_FMT;
 	info.cod_format = GRK_UNK_FMT;
 	info.decompress_flags = GRK_DECODE_ALL;
-	info.decompressor_parameters = &initParams->parameters;
+	info.decompressor_parameters = parameters;
 	info.user_data = this;
 
 	if(preProcess(&info))
@@ -875,8 +933,8 @@ int GrkDecompress::decompress(std::string& fileName, DecompressInitParams* initP
 		return 0;
 	}
 #ifdef GROK_HAVE_EXIFTOOL
-	if(initParams->transferExifTags && initParams->parameters.decod_format == GRK_JP2_FMT)
-		transferExifTags(initParams->parameters.infile, initParams->parameters.outfile);
+	if(initParams->transferExifTags && parameters->decod_format == GRK_JP2_FMT)
+		transferExifTags(parameters->infile, parameters->outfile);
 #endif
 	grk_object_unref(info.codec);
 	info.codec = nullptr;
@@ -1032,10 +1090,46 @@ int decompress_callback(grk_plugin_decompress_callback_info* info)
 enum grk_stream_type
 {
 	GRK_FILE_STREAM,
-	GRK_MAPPED_FILE_STREAM
+	GRK_MAPPED_FILE_STREAM,
+	GRK_URING_FILE_STREAM
 };
 
+#ifdef GROK_HAVE_URING
+grk_stream_type stream_type = GRK_URING_FILE_STREAM;
+#else
 grk_stream_type stream_type = GRK_MAPPED_FILE_STREAM;
+#endif
+
+/**
+ * Write the packets selected by the decompressor's reduce, layer and window
+ * settings to a new JPEG 2000 file, without decompressing them
+ */
+static bool subset(grk_codec* decompressCodec, const char* outfile,
+				   GRK_SUPPORTED_FILE_FMT cod_format, bool verbose)
+{
+	bool rc = false;
+	grk_codec* compressCodec = nullptr;
+	grk_cparameters parameters;
+	auto outStream = grk_stream_create_file_stream(outfile, 1024 * 1024, false);
+	if(!outStream)
+	{
+		spdlog::error("failed to create stream");
+		goto cleanup;
+	}
+	compressCodec =
+		grk_compress_create(cod_format == GRK_JP2_FMT ? GRK_CODEC_JP2 : GRK_CODEC_J2K, outStream);
+	if(!compressCodec)
+		goto cleanup;
+	grk_compress_set_default_params(&parameters);
+	parameters.verbose = verbose;
+	rc = grk_subset(decompressCodec, compressCodec, &parameters);
+cleanup:
+	grk_object_unref(compressCodec);
+	if(outStream)
+		grk_object_unref(outStream);
+
+	return rc;
+}
 
 // return: 0 for success, non-zero for failure
 int GrkDecompress::preProcess(grk_plugin_decompress_callback_info* info)
@@ -1081,9 +1175,13 @@ int GrkDecompress::preProcess(grk_plugin_decompress_callback_info* info)
 #endif
 #ifdef GROK_HAVE_LIBPNG
 		case GRK_PNG_FMT:
-			imageFormat = new PNGFormat();
+			imageFormat = new PNGFormat(parameters->numThreads);
 			break;
 #endif
+		case GRK_J2K_FMT:
+		case GRK_JP2_FMT:
+			// code stream subset: no image is written
+			break;
 		default:
 			spdlog::error("Unsupported output format {}", convertFileFmtToString(cod_format));
 			goto cleanup;
@@ -1138,7 +1236,14 @@ int GrkDecompress::preProcess(grk_plugin_decompress_callback_info* info)
 		}
 		else
 		{
-			if(stream_type == GRK_MAPPED_FILE_STREAM)
+			if(stream_type == GRK_URING_FILE_STREAM)
+			{
+				info->stream = grk_stream_create_uring_file_stream(infile, 1024 * 1024, 16);
+				// fall back to memory mapping if io_uring is not available
+				if(!info->stream)
+					info->stream = grk_stream_create_mapped_file_stream(infile, true);
+			}
+			else if(stream_type == GRK_MAPPED_FILE_STREAM)
 				info->stream = grk_stream_create_mapped_file_stream(infile, true);
 			else
 				info->stream = grk_stream_create_file_stream(infile, 1024 * 1024, true);
@@ -1256,12 +1361,44 @@ int GrkDecompress::preProcess(grk_plugin_decompress_callback_info* info)
 			goto cleanup;
 		}
 	}
+	// colour conversion in postProcess needs the original samples, otherwise
+	// the library changes precision in its tile workers, as each tile is decompressed
+	if(parameters->precision)
+	{
+		auto image = info->image;
+		bool sycc = image->color_space == GRK_CLRSPC_SYCC ||
+					(image->numcomps == 3 && image->comps[0].dx == image->comps[0].dy &&
+					 image->comps[1].dx != 1);
+		bool canDelegate = !sycc && image->color_space != GRK_CLRSPC_EYCC &&
+						   image->color_space != GRK_CLRSPC_CMYK && !parameters->force_rgb &&
+						   !(image->meta && image->meta->color.icc_profile_buf);
+		parameters->core.precision = canDelegate ? parameters->precision : nullptr;
+		parameters->core.numPrecision = canDelegate ? parameters->nb_precision : 0;
+		if(!grk_decompress_init(info->codec, &(parameters->core)))
+		{
+			spdlog::error("grk_decompress: failed to set up the decompressor");
+			goto cleanup;
+		}
+	}
 	if(!grk_decompress_set_window(info->codec, parameters->DA_x0, parameters->DA_y0,
 								  parameters->DA_x1, parameters->DA_y1))
 	{
 		spdlog::error("grk_decompress: failed to set the decompressed area");
 		goto cleanup;
 	}
+	// extract code stream subset
+	if(cod_format == GRK_J2K_FMT || cod_format == GRK_JP2_FMT)
+	{
+		if(!subset(info->codec,
+				   parameters->outfile[0] ? parameters->outfile : info->output_file_name,
+				   cod_format, parameters->verbose))
+		{
+			spdlog::error("grk_decompress: failed to extract code stream subset of {}", infile);
+			goto cleanup;
+		}
+		failed = false;
+		goto cleanup;
+	}
 	// decompress all tiles
 	if(!parameters->nb_tile_to_decompress)
 	{
@@ -1269,6 +1406,8 @@ int GrkDecompress::preProcess(grk_plugin_decompress_callback_info* info)
 		{
 			goto cleanup;
 		}
+		if(grk_decompress_was_interrupted(info->codec))
+			spdlog::warn("grk_decompress: time budget ran out; image quality is reduced");
 	}
 	// or, decompress one particular tile
 	else
@@ -1331,6 +1470,9 @@ int GrkDecompress::postProcess(grk_plugin_decompress_callback_info* info)
 
 	GRK_SUPPORTED_FILE_FMT cod_format = (GRK_SUPPORTED_FILE_FMT)(
 		info->cod_format != GRK_UNK_FMT ? info->cod_format : parameters->cod_format);
+	// code stream subset was already written in preProcess
+	if(cod_format == GRK_J2K_FMT || cod_format == GRK_JP2_FMT)
+		return 0;
 
 	if(image->color_space != GRK_CLRSPC_SYCC && image->numcomps == 3 &&
 	   image->comps[0].dx == image->comps[0].dy && image->comps[1].dx != 1)
@@ -1478,6 +1620,9 @@ int GrkDecompress::postProcess(grk_plugin_decompress_callback_info* info)
 			auto comp = image->comps + compno;
 			if(prec == 0)
 				prec = comp->prec;
+			// already changed by the library's tile workers
+			if(prec == comp->prec)
+				continue;
 
 			switch(parameters->precision[precisionno].mode)
 			{
@@ -1580,6 +1725,38 @@ cleanup:
 
 	return failed ? 1 : 0;
 }
+uint32_t GrkDecompress::batchDecompress(DecompressInitParams* initParams)
+{
+	BatchProcessor batch(initParams->inputFolder.imgdirpath, initParams->parameters.numThreads,
+						 initParams->batchWorkers);
+	uint32_t numWorkers = batch.numWorkers();
+	if(numWorkers == 1)
+	{
+		return batch.run([this, initParams](uint32_t worker, size_t fileIndex,
+											const std::string& filename) {
+			(void)worker;
+			(void)fileIndex;
+			return decompress(filename, initParams, &initParams->parameters);
+		});
+	}
+	// re-size library thread pool to leave room for image-level parallelism
+	grk_set_num_threads(batch.numLibraryThreads());
+	spdlog::info("Batch decompress: {} images, {} workers, {} library threads", batch.numFiles(),
+				 numWorkers, batch.numLibraryThreads());
+
+	// each worker owns its decompressor and a copy of the parameters
+	std::vector<GrkDecompress> decompressors(numWorkers);
+	std::vector<grk_decompress_parameters> parameters(numWorkers, initParams->parameters);
+	// also limits the number of threads used to write each output image
+	for(auto& p : parameters)
+		p.numThreads = batch.numLibraryThreads();
+
+	return batch.run([initParams, &decompressors, &parameters](
+						 uint32_t worker, size_t fileIndex, const std::string& filename) {
+		(void)fileIndex;
+		return decompressors[worker].decompress(filename, initParams, &parameters[worker]);
+	});
+}
 int GrkDecompress::main(int argc, char** argv)
 {
 	int rc = EXIT_SUCCESS;
@@ -1610,7 +1787,7 @@ int GrkDecompress::main(int argc, char** argv)
 			std::string filename;
 			if(!initParams.inputFolder.set_imgdir)
 			{
-				if(decompress(filename, &initParams) == 1)
+				if(decompress(filename, &initParams, &initParams.parameters) == 1)
 				{
 					numDecompressed++;
 				}
@@ -1622,15 +1799,13 @@ int GrkDecompress::main(int argc, char** argv)
 			}
 			else
 			{
-				FileProvider provider(initParams.inputFolder.imgdirpath);
-				while(provider.next(filename))
-				{
-					if(decompress(filename, &initParams) == 1)
-						numDecompressed++;
-				}
+				numDecompressed += batchDecompress(&initParams);
 			}
 		}
 		printTiming(numDecompressed, std::chrono::high_resolution_clock::now() - start);
+		if(!initParams.traceFile.empty() &&
+		   !grk_trace_write_chrome_json(initParams.traceFile.c_str()))
+			rc = EXIT_FAILURE;
 	}
 	catch(std::bad_alloc& ba)
 	{
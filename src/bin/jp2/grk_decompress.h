@@ -27,7 +27,7 @@ namespace grk
 {
 struct DecompressInitParams
 {
-	DecompressInitParams() : initialized(false), transferExifTags(false)
+	DecompressInitParams() : initialized(false), transferExifTags(false), batchWorkers(0)
 	{
 		pluginPath[0] = 0;
 		memset(&inputFolder, 0, sizeof(inputFolder));
@@ -46,6 +46,10 @@ struct DecompressInitParams
 	grk_img_fol inputFolder;
 	grk_img_fol outFolder;
 	bool transferExifTags;
+	// number of images decompressed concurrently in batch mode (0 for automatic)
+	uint32_t batchWorkers;
+	// Chrome trace JSON file written after decompression (empty for none)
+	std::string traceFile;
 };
 
 class GrkDecompress
@@ -59,7 +63,9 @@ class GrkDecompress
 
   private:
 	// returns 0 for failure, 1 for success, and 2 if file is not suitable for decoding
-	int decompress(std::string& fileName, DecompressInitParams* initParams);
+	int decompress(const std::string& fileName, DecompressInitParams* initParams,
+				   grk_decompress_parameters* parameters);
+	uint32_t batchDecompress(DecompressInitParams* initParams);
 	int pluginMain(int argc, char** argv, DecompressInitParams* initParams);
 	bool parsePrecision(const char* option, grk_decompress_parameters* parameters);
 	int loadImages(grk_dircnt* dirptr, char* imgdirpath);
@@ -44,7 +44,11 @@
 #include "tclap/CmdLine.h"
 #include "convert.h"
 #include "grk_string.h"
+#include "BatchProcessor.h"
 #include <string>
+#include <mutex>
+#include <atomic>
+#include <cinttypes>
 
 typedef struct _dircnt
 {
@@ -66,6 +70,10 @@ typedef struct _img_folder
 	bool set_out_format;
 
 	uint32_t flag;
+	/** scan headers rather than dumping codec info */
+	bool scan;
+	/** number of threads used to scan headers */
+	uint32_t numThreads;
 } inputFolder;
 
 static int loadImages(dircnt* dirptr, char* imgdirpath);
@@ -96,6 +104,14 @@ static void decompress_help_display(void)
 	fprintf(stdout, "    OPTIONAL\n");
 	fprintf(stdout, "    Output file where file info will be dump.\n");
 	fprintf(stdout, "    By default it will be in the stdout.\n");
+	fprintf(stdout, "  -s \n");
+	fprintf(stdout, "    OPTIONAL\n");
+	fprintf(stdout, "    Scan main header and JP2 boxes only, printing one line of\n");
+	fprintf(stdout, "    key=value pairs per file. With -ImgDir, files are scanned in\n");
+	fprintf(stdout, "    parallel, and lines are printed in order of completion.\n");
+	fprintf(stdout, "  -H <number of threads>\n");
+	fprintf(stdout, "    OPTIONAL\n");
+	fprintf(stdout, "    Number of threads used to scan files. Default: number of cores.\n");
 	fprintf(stdout, "  -v ");
 	fprintf(stdout, "    OPTIONAL\n");
 	fprintf(stdout, "    Enable informative messages\n");
@@ -203,6 +219,9 @@ static int parseCommandLine(int argc, char** argv, grk_dparameters* parameters,
 
 		TCLAP::SwitchArg verboseArg("v", "verbose", "verbose", cmd);
 		TCLAP::ValueArg<uint32_t> flagArg("f", "flag", "flag", false, 0, "unsigned integer", cmd);
+		TCLAP::SwitchArg scanArg("s", "scan", "scan headers", cmd);
+		TCLAP::ValueArg<uint32_t> numThreadsArg("H", "num_threads", "Number of threads", false, 0,
+												"unsigned integer", cmd);
 
 		cmd.parse(argc, argv);
 
@@ -251,6 +270,11 @@ static int parseCommandLine(int argc, char** argv, grk_dparameters* parameters,
 		{
 			inputFolder->flag = flagArg.getValue();
 		}
+		inputFolder->scan = scanArg.isSet();
+		if(numThreadsArg.isSet())
+		{
+			inputFolder->numThreads = numThreadsArg.getValue();
+		}
 	}
 	catch(TCLAP::ArgException& e) // catch any exceptions
 	{
@@ -266,14 +290,14 @@ static int parseCommandLine(int argc, char** argv, grk_dparameters* parameters,
 			spdlog::error("options -ImgDir and -i cannot be used together.");
 			return 1;
 		}
-		if(!inputFolder->set_out_format)
+		if(!inputFolder->scan && !inputFolder->set_out_format)
 		{
 			spdlog::error("When -ImgDir is used, -OutFor <FORMAT> must be used.");
 			spdlog::error("Only one format allowed.\n"
 						  "Valid format are PGM, PPM, PNM, PGX, BMP, TIF and RAW.");
 			return 1;
 		}
-		if(!(parameters->outfile[0] == 0))
+		if(!inputFolder->scan && !(parameters->outfile[0] == 0))
 		{
 			spdlog::error("options -ImgDir and -o cannot be used together");
 			return 1;
@@ -320,6 +344,129 @@ static void infoCallback(const char* msg, void* client_data)
 	spdlog::info(msg);
 }
 
+/* -------------------------------------------------------------------------- */
+static const char* progressionName(GRK_PROG_ORDER prog)
+{
+	switch(prog)
+	{
+		case GRK_LRCP:
+			return "LRCP";
+		case GRK_RLCP:
+			return "RLCP";
+		case GRK_RPCL:
+			return "RPCL";
+		case GRK_PCRL:
+			return "PCRL";
+		case GRK_CPRL:
+			return "CPRL";
+		default:
+			return "unknown";
+	}
+}
+static void printScan(FILE* fout, const std::string& fname, const grk_header_scan* scan)
+{
+	uint16_t numComps = std::min<uint16_t>(scan->numcomps, GRK_HEADER_SCAN_MAX_COMPS);
+	fprintf(fout, "file=%s format=%s size=%" PRIu64 " bounds=%u,%u,%u,%u comps=%u", fname.c_str(),
+			scan->format == GRK_CODEC_JP2 ? "jp2" : "j2k", scan->file_size, scan->x0, scan->y0,
+			scan->x1, scan->y1, scan->numcomps);
+	fprintf(fout, " prec=");
+	for(uint16_t i = 0; i < numComps; ++i)
+		fprintf(fout, "%s%u%s", i ? "," : "", scan->comps[i].prec, scan->comps[i].sgnd ? "s" : "");
+	fprintf(fout, " subsampling=");
+	for(uint16_t i = 0; i < numComps; ++i)
+		fprintf(fout, "%s%ux%u", i ? "," : "", scan->comps[i].dx, scan->comps[i].dy);
+	fprintf(fout,
+			" rsiz=0x%x tile=%ux%u tile_origin=%u,%u tiles=%ux%u resolutions=%u layers=%u "
+			"progression=%s cblk=%ux%u cblk_sty=0x%x transform=%s mct=%u qntsty=%u "
+			"guard_bits=%u tlm=%d plm=%d ppm=%d comments=%u main_header=%" PRIu64,
+			scan->rsiz, scan->t_width, scan->t_height, scan->tx0, scan->ty0, scan->t_grid_width,
+			scan->t_grid_height, scan->numresolutions, scan->numlayers,
+			progressionName(scan->prog_order), scan->cblockw, scan->cblockh, scan->cblk_sty,
+			scan->irreversible ? "9-7" : "5-3", scan->mct, scan->qntsty, scan->numgbits,
+			scan->has_tlm, scan->has_plm, scan->has_ppm, scan->num_comments,
+			scan->main_header_len);
+	if(scan->format == GRK_CODEC_JP2)
+	{
+		fprintf(fout, " codestream=%" PRIu64, scan->codestream_offset);
+		if(scan->has_colr)
+		{
+			fprintf(fout, " colr_meth=%u", scan->colr_meth);
+			if(scan->colr_meth == 1)
+				fprintf(fout, " enumcs=%u", scan->enumcs);
+			else if(scan->colr_meth == 2)
+				fprintf(fout, " icc=%u", scan->icc_profile_len);
+		}
+		if(scan->has_capture_resolution)
+			fprintf(fout, " capture_res=%g,%g", scan->capture_resolution[0],
+					scan->capture_resolution[1]);
+		if(scan->has_display_resolution)
+			fprintf(fout, " display_res=%g,%g", scan->display_resolution[0],
+					scan->display_resolution[1]);
+		if(scan->xml_offset)
+			fprintf(fout, " xml=%" PRIu64 ",%" PRIu64, scan->xml_offset, scan->xml_len);
+	}
+	fprintf(fout, "\n");
+}
+/**
+ * Scan headers of input file, or of all files in input folder
+ */
+static int scanHeaders(const grk_dparameters* parameters, const inputFolder* inputFolder)
+{
+	FILE* fout = stdout;
+	if(parameters->outfile[0] != 0)
+	{
+		fout = fopen(parameters->outfile, "w");
+		if(!fout)
+		{
+			spdlog::error("failed to open {} for writing", parameters->outfile);
+			return EXIT_FAILURE;
+		}
+	}
+	std::mutex mutex;
+	auto scanFile = [fout, &mutex](const std::string& fname) {
+		grk_header_scan scan;
+		if(!grk_scan_header(fname.c_str(), &scan))
+		{
+			spdlog::error("grk_dump: failed to scan the header of {}", fname);
+			return 0;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		printScan(fout, fname, &scan);
+		return 1;
+	};
+	int rc = EXIT_SUCCESS;
+	if(inputFolder->set_imgdir)
+	{
+		std::string dir(inputFolder->imgdirpath);
+		grk::BatchProcessor batch(dir, inputFolder->numThreads, 0);
+		std::atomic<size_t> numSkipped(0);
+		uint32_t numScanned =
+			batch.run([&dir, &scanFile, &numSkipped](uint32_t worker, size_t fileIndex,
+													 const std::string& filename) {
+				(void)worker;
+				(void)fileIndex;
+				// select files by extension: the scanner itself detects the format
+				auto fmt = grk::get_file_format(filename.c_str());
+				if(fmt != GRK_J2K_FMT && fmt != GRK_JP2_FMT)
+				{
+					numSkipped++;
+					return 2;
+				}
+				return scanFile(dir + grk::pathSeparator() + filename);
+			});
+		if(numScanned + numSkipped != batch.numFiles())
+			rc = EXIT_FAILURE;
+	}
+	else if(!scanFile(parameters->infile))
+	{
+		rc = EXIT_FAILURE;
+	}
+	if(fout != stdout)
+		fclose(fout);
+
+	return rc;
+}
+
 /* -------------------------------------------------------------------------- */
 /**
  * GRK_DUMP MAIN
@@ -359,6 +506,12 @@ int main(int argc, char* argv[])
 		goto cleanup;
 	}
 
+	if(inputFolder.scan)
+	{
+		rc = scanHeaders(&parameters, &inputFolder);
+		goto cleanup;
+	}
+
 	/* Initialize reading of directory */
 	if(inputFolder.set_imgdir)
 	{
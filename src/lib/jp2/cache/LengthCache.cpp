@@ -434,6 +434,27 @@ bool TileLengthMarkers::skipTo(uint16_t skipTileIndex, IBufferedStream* stream,
 
 	return stream->seek(firstSotPos + skip);
 }
+void TileLengthMarkers::prefetch(IBufferedStream* stream, uint64_t firstSotPos,
+								 std::function<bool(uint16_t)> doPrefetch)
+{
+	assert(stream);
+	rewind();
+	uint64_t position = firstSotPos;
+	uint16_t tileIndex = 0;
+	bool first = true;
+	for(auto tl = getNext(); tl.length != 0; tl = getNext())
+	{
+		if(tl.hasTileIndex)
+			tileIndex = tl.tileIndex;
+		else if(!first)
+			tileIndex++;
+		first = false;
+		if(doPrefetch(tileIndex))
+			stream->prefetch(position, tl.length);
+		position += tl.length;
+	}
+	rewind();
+}
 bool TileLengthMarkers::writeBegin(uint16_t numTilePartsTotal)
 {
 	streamStart = m_stream->tell();
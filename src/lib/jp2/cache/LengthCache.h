@@ -17,6 +17,8 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <tuple>
+#include <functional>
 
 namespace grk
 {
@@ -123,6 +125,14 @@ struct TileLengthMarkers
 	void rewind(void);
 	TilePartLengthInfo getNext(void);
 	bool skipTo(uint16_t skipTileIndex, IBufferedStream* stream, uint64_t firstSotPos);
+	/**
+	 Hint stream to read ahead all tile parts belonging to tiles that will be decompressed
+	 @param stream			stream
+	 @param firstSotPos		position of first SOT marker
+	 @param doPrefetch		returns true if tile with given index will be decompressed
+	 */
+	void prefetch(IBufferedStream* stream, uint64_t firstSotPos,
+				  std::function<bool(uint16_t)> doPrefetch);
 
 	bool writeBegin(uint16_t numTilePartsTotal);
 	void push(uint16_t tileIndex, uint32_t tile_part_size);
@@ -165,4 +175,24 @@ struct PacketInfoCache
 	std::vector<PacketInfo*> packetInfo;
 };
 
+/**
+ Location of a packet in the compressed data of a tile, for packets
+ that are copied between code streams rather than decompressed
+ */
+struct PacketSpan
+{
+	PacketSpan(uint8_t* packetData, size_t packetLength, bool inWindow)
+		: data(packetData), length(packetLength), keep(inWindow)
+	{}
+	uint8_t* data;
+	size_t length;
+	/** false if packet lies outside of the decompress window, and is copied as an empty packet */
+	bool keep;
+};
+
+/**
+ Packet spans keyed on (component, resolution, precinct, layer)
+ */
+typedef std::map<std::tuple<uint16_t, uint8_t, uint64_t, uint16_t>, PacketSpan> PACKET_SPANS;
+
 } // namespace grk
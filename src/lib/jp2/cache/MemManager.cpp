@@ -30,6 +30,12 @@
 #define SIZE_MAX ((size_t)-1)
 #endif
 
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__linux__) || defined(_WIN32)
+#include <malloc.h>
+#endif
+
 namespace grk
 {
 const uint32_t grkWidthAlignment = 32;
@@ -41,6 +47,35 @@ uint32_t grkMakeAlignedWidth(uint32_t width)
 	return (uint32_t)((((uint64_t)width + grkWidthAlignment - 1) / grkWidthAlignment) *
 					  grkWidthAlignment);
 }
+/**
+ * Size of block returned by malloc, calloc or realloc, for memory budget
+ * accounting. Zero if not available on this platform.
+ */
+static size_t grkAllocSize(void* ptr)
+{
+#if defined(__APPLE__)
+	return malloc_size(ptr);
+#elif defined(_WIN32)
+	return _msize(ptr);
+#elif defined(__linux__)
+	return malloc_usable_size(ptr);
+#else
+	GRK_UNUSED(ptr);
+	return 0;
+#endif
+}
+static size_t grkAlignedAllocSize(void* ptr)
+{
+#if defined(GROK_HAVE_POSIX_MEMALIGN) || defined(GROK_HAVE_ALIGNED_ALLOC) || \
+	defined(GROK_HAVE_MEMALIGN)
+	return grkAllocSize(ptr);
+#elif defined(GROK_HAVE__ALIGNED_MALLOC)
+	return _aligned_msize(ptr, grkBufferALignment, 0);
+#else
+	GRK_UNUSED(ptr);
+	return 0;
+#endif
+}
 static inline void* grkAlignedAllocN(size_t alignment, size_t size)
 {
 	void* ptr;
@@ -107,23 +142,40 @@ void* grkMalloc(size_t size)
 {
 	if(size == 0U) /* prevent implementation defined behavior of realloc */
 		return nullptr;
+	GRK_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+	GRK_TRACE_COUNT(TRACE_BYTES_ALLOCATED, size);
 
-	return malloc(size);
+	auto ptr = malloc(size);
+	if(ptr && MemoryBudget::isTracking())
+		MemoryBudget::get()->allocated(grkAllocSize(ptr));
+	return ptr;
 }
 void* grkCalloc(size_t num, size_t size)
 {
 	if(num == 0 || size == 0)
 		/* prevent implementation defined behavior of realloc */
 		return nullptr;
+	GRK_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+	GRK_TRACE_COUNT(TRACE_BYTES_ALLOCATED, num * size);
 
-	return calloc(num, size);
+	auto ptr = calloc(num, size);
+	if(ptr && MemoryBudget::isTracking())
+		MemoryBudget::get()->allocated(grkAllocSize(ptr));
+	return ptr;
 }
 void* grkAlignedMalloc(size_t size)
 {
-	return grkAlignedAllocN(grkBufferALignment, size);
+	GRK_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+	GRK_TRACE_COUNT(TRACE_BYTES_ALLOCATED, size);
+	auto ptr = grkAlignedAllocN(grkBufferALignment, size);
+	if(ptr && MemoryBudget::isTracking())
+		MemoryBudget::get()->allocated(grkAlignedAllocSize(ptr));
+	return ptr;
 }
 void grkAlignedFree(void* ptr)
 {
+	if(ptr && MemoryBudget::isTracking())
+		MemoryBudget::get()->freed(grkAlignedAllocSize(ptr));
 #if defined(GROK_HAVE_POSIX_MEMALIGN) || defined(GROK_HAVE_ALIGNED_ALLOC) || \
 	defined(GROK_HAVE_MEMALIGN)
 	free(ptr);
@@ -139,12 +191,26 @@ void* grkRealloc(void* ptr, size_t new_size)
 {
 	if(new_size == 0U) /* prevent implementation defined behavior of realloc */
 		return nullptr;
+	GRK_TRACE_COUNT(TRACE_ALLOCATIONS, 1);
+	GRK_TRACE_COUNT(TRACE_BYTES_ALLOCATED, new_size);
 
-	return realloc(ptr, new_size);
+	bool tracking = MemoryBudget::isTracking();
+	size_t oldSize = (ptr && tracking) ? grkAllocSize(ptr) : 0;
+	auto newPtr = realloc(ptr, new_size);
+	if(newPtr && tracking)
+	{
+		MemoryBudget::get()->freed(oldSize);
+		MemoryBudget::get()->allocated(grkAllocSize(newPtr));
+	}
+	return newPtr;
 }
 void grkFree(void* ptr)
 {
 	if(ptr)
+	{
+		if(MemoryBudget::isTracking())
+			MemoryBudget::get()->freed(grkAllocSize(ptr));
 		free(ptr);
+	}
 }
 } // namespace grk
@@ -269,6 +269,10 @@ struct grkBuffer2d : private grkBuffer<T, A>, public grkRectU32
 
 		return true;
 	}
+	void dealloc2d(void)
+	{
+		grkBuffer<T, A>::dealloc();
+	}
 	// set buf to buf without owning it
 	void attach(T* buffer, uint32_t strd)
 	{
@@ -71,12 +71,24 @@ PacketInfo* PacketLengthCache::next(void)
 
 void PacketLengthCache::rewind(void)
 {
-	auto packetLengths = pltMarkers;
-	// we don't currently support PLM markers,
-	// so we disable packet length markers if we have both PLT and PLM
-	bool usePlt = packetLengths && !m_cp->plm_markers;
-	if(usePlt)
-		packetLengths->rewind();
+	// packet lengths that have already been read from PLT markers are
+	// kept in the packet info cache, so markers only need to be rewound
+	// when the cache is empty
+	if(packetInfoCache.empty())
+	{
+		auto packetLengths = pltMarkers;
+		// we don't currently support PLM markers,
+		// so we disable packet length markers if we have both PLT and PLM
+		bool usePlt = packetLengths && !m_cp->plm_markers;
+		if(usePlt)
+			packetLengths->rewind();
+	}
+	packetInfoCache.rewind();
+}
+
+void PacketLengthCache::clear(void)
+{
+	packetInfoCache.clear();
 }
 
 } // namespace grk
@@ -30,6 +30,7 @@ class PacketLengthCache
 	void deleteMarkers(void);
 	PacketInfo* next(void);
 	void rewind(void);
+	void clear(void);
 
   private:
 	PacketLengthMarkers* pltMarkers;
@@ -37,6 +37,10 @@ PacketLengthMarkers::PacketLengthMarkers(IBufferedStream* strm) : PacketLengthMa
 	m_stream = strm;
 	pushInit();
 }
+void PacketLengthMarkers::setStream(IBufferedStream* strm)
+{
+	m_stream = strm;
+}
 PacketLengthMarkers::~PacketLengthMarkers()
 {
 	if(m_markers)
@@ -48,6 +48,7 @@ struct PacketLengthMarkers
 	uint32_t popNextPacketLength(void);
 
 	// compressor packet lengths
+	void setStream(IBufferedStream* strm);
 	void pushInit(void);
 	void pushNextPacketLength(uint32_t len);
 	uint32_t write(bool simulate);
@@ -82,6 +82,8 @@ const uint32_t GRK_COMP_PARAM_DEFAULT_NUMRESOLUTION = 6;
 #define J2K_MS_UNK 0 /**< UNKNOWN marker value */
 
 class GrkImage;
+class CodeStreamCompress;
+class CodeStreamDecompress;
 
 template<typename S, typename D>
 void j2k_write(const void* p_src_data, void* p_dest_data, uint64_t nb_elem)
@@ -108,6 +110,7 @@ struct ICodeStreamCompress
 	virtual bool compress(grk_plugin_tile* tile) = 0;
 	virtual bool compressTile(uint16_t tileIndex, uint8_t* p_data, uint64_t data_size) = 0;
 	virtual bool endCompress(void) = 0;
+	virtual CodeStreamCompress* getCodeStream(void) = 0;
 };
 
 struct ICodeStreamDecompress
@@ -123,6 +126,7 @@ struct ICodeStreamDecompress
 	virtual bool decompressTile(uint16_t tileIndex) = 0;
 	virtual bool endDecompress(void) = 0;
 	virtual void dump(uint32_t flag, FILE* outputFileStream) = 0;
+	virtual CodeStreamDecompress* getCodeStream(void) = 0;
 };
 
 class TileCache;
@@ -619,7 +619,8 @@ bool CodeStreamCompress::compress(grk_plugin_tile* tile)
 		return false;
 	}
 	auto pool_size = std::min<uint32_t>((uint32_t)ThreadPool::get()->num_threads(), numTiles);
-	ThreadPool pool(pool_size);
+	// with NUMA affinity, each tile is compressed by workers on the node of its tile thread
+	ThreadPool pool(pool_size, ThreadPool::get()->affinity());
 	std::vector<std::future<int>> results;
 	std::atomic<bool> success(true);
 	bool rc = false;
@@ -628,12 +629,15 @@ bool CodeStreamCompress::compress(grk_plugin_tile* tile)
 		for(uint16_t i = 0; i < numTiles; ++i)
 		{
 			uint16_t tileIndex = i;
-			results.emplace_back(pool.enqueue([this, tile, tileIndex, &heap, &success] {
+			// wait for room in the memory budget before scheduling the tile
+			auto tileProcessor = new TileProcessor(this, m_stream, true, false);
+			tileProcessor->m_tileIndex = tileIndex;
+			tileProcessor->current_plugin_tile = tile;
+			uint64_t reservation = tileProcessor->estimateMemory();
+			MemoryBudget::get()->reserve(reservation);
+			results.emplace_back(pool.enqueue([tileProcessor, reservation, &heap, &success] {
 				if(success)
 				{
-					auto tileProcessor = new TileProcessor(this, m_stream, true, false);
-					tileProcessor->m_tileIndex = tileIndex;
-					tileProcessor->current_plugin_tile = tile;
 					if(!tileProcessor->preCompressTile())
 						success = false;
 					else
@@ -641,9 +645,19 @@ bool CodeStreamCompress::compress(grk_plugin_tile* tile)
 						if(!tileProcessor->doCompress())
 							success = false;
 					}
-					if(success)
-						heap.push(tileProcessor);
 				}
+				if(success)
+				{
+					// only compressed code blocks are needed to write the tile,
+					// so release sample buffers while waiting for the other tiles
+					tileProcessor->deallocBuffers();
+					heap.push(tileProcessor);
+				}
+				else
+				{
+					delete tileProcessor;
+				}
+				MemoryBudget::get()->release(reservation);
 				return 0;
 			}));
 		}
@@ -679,6 +693,14 @@ bool CodeStreamCompress::compress(grk_plugin_tile* tile)
 		}
 		if(!success)
 			goto cleanup;
+		std::vector<TileProcessor*> tileProcessors;
+		for(auto tileProcessor = heap.pop(); tileProcessor; tileProcessor = heap.pop())
+			tileProcessors.push_back(tileProcessor);
+		success = writeTiles(&pool, tileProcessors);
+		for(auto tileProcessor : tileProcessors)
+			delete tileProcessor;
+		if(!success)
+			goto cleanup;
 	}
 	rc = true;
 cleanup:
@@ -730,6 +752,99 @@ cleanup:
 
 	return rc;
 }
+CodeStreamCompress* CodeStreamCompress::getCodeStream(void)
+{
+	return this;
+}
+bool CodeStreamCompress::initTranscode(TileCodingParams* source, bool copyPackets)
+{
+	if(!source || !m_cp.tcps)
+		return false;
+	uint32_t numTiles = (uint32_t)m_cp.t_grid_width * m_cp.t_grid_height;
+	for(uint32_t tileno = 0; tileno < numTiles; ++tileno)
+	{
+		auto tcp = m_cp.tcps + tileno;
+		for(uint16_t compno = 0; compno < getHeaderImage()->numcomps; ++compno)
+		{
+			auto tccp = tcp->tccps + compno;
+			auto srcTccp = source->tccps + compno;
+			// irreversible coefficients are already quantized, so step sizes
+			// must be preserved. Reversible step sizes only signal dynamic range,
+			// which the target block coder sets up for itself, unless packets are
+			// copied, as packet headers signal bit planes relative to this range
+			if(copyPackets || srcTccp->qntsty != J2K_CCP_QNTSTY_NOQNT)
+			{
+				tccp->qntsty = srcTccp->qntsty;
+				tccp->numgbits = srcTccp->numgbits;
+				memcpy(tccp->stepsizes, srcTccp->stepsizes, sizeof(tccp->stepsizes));
+			}
+			tccp->roishift = srcTccp->roishift;
+		}
+	}
+
+	return true;
+}
+bool CodeStreamCompress::compressTile(TileProcessor* source)
+{
+	if(!source)
+		return false;
+	uint16_t tileIndex = source->m_tileIndex;
+	bool rc = false;
+
+	auto currentTileProcessor = new TileProcessor(this, m_stream, true, false);
+	currentTileProcessor->m_tileIndex = tileIndex;
+
+	if(!currentTileProcessor->preCompressTile())
+	{
+		GRK_ERROR("Error while preCompressTile with tile index = %u", tileIndex);
+		goto cleanup;
+	}
+	if(!currentTileProcessor->ingestCoefficients(source))
+	{
+		GRK_ERROR("Unable to transcode tile %u", tileIndex);
+		goto cleanup;
+	}
+	if(!currentTileProcessor->doCompress())
+		goto cleanup;
+	if(!writeTileParts(currentTileProcessor))
+	{
+		GRK_ERROR("Error while j2k_post_write_tile with tile index = %u", tileIndex);
+		goto cleanup;
+	}
+	rc = true;
+cleanup:
+	delete currentTileProcessor;
+
+	return rc;
+}
+bool CodeStreamCompress::copyTile(uint16_t tileIndex, PACKET_SPANS* packets)
+{
+	if(!packets)
+		return false;
+	bool rc = false;
+
+	auto currentTileProcessor = new TileProcessor(this, m_stream, true, false);
+	currentTileProcessor->m_tileIndex = tileIndex;
+	currentTileProcessor->packetSpans = packets;
+
+	if(!currentTileProcessor->preCompressTile())
+	{
+		GRK_ERROR("Error while preCompressTile with tile index = %u", tileIndex);
+		goto cleanup;
+	}
+	if(!currentTileProcessor->doCompress())
+		goto cleanup;
+	if(!writeTileParts(currentTileProcessor))
+	{
+		GRK_ERROR("Error while j2k_post_write_tile with tile index = %u", tileIndex);
+		goto cleanup;
+	}
+	rc = true;
+cleanup:
+	delete currentTileProcessor;
+
+	return rc;
+}
 bool CodeStreamCompress::endCompress(void)
 {
 	/* customization of the compressing */
@@ -852,50 +967,127 @@ bool CodeStreamCompress::init_header_writing(void)
 
 	return true;
 }
-bool CodeStreamCompress::writeTilePart(TileProcessor* tileProcessor)
+bool CodeStreamCompress::serializeTilePart(TileProcessor* tileProcessor,
+										   uint32_t* tilePartBytesWritten)
 {
-	uint64_t currentPos;
+	auto stream = tileProcessor->getStream();
+	uint64_t currentPos = 0;
 	if(tileProcessor->canPreCalculateTileLen())
-		currentPos = m_stream->tell();
+		currentPos = stream->tell();
 	uint16_t currentTileIndex = tileProcessor->m_tileIndex;
 	auto calculatedBytesWritten = tileProcessor->getPreCalculatedTileLen();
 	// 1. write SOT
 	SOTMarker sot;
 	if(!sot.write(tileProcessor, calculatedBytesWritten))
 		return false;
-	uint32_t tilePartBytesWritten = sot_marker_segment_len;
+	*tilePartBytesWritten = sot_marker_segment_len;
 	// 2. write POC marker to first tile part
 	if(tileProcessor->canWritePocMarker())
 	{
 		if(!writePoc())
 			return false;
 		auto tcp = m_cp.tcps + currentTileIndex;
-		tilePartBytesWritten += getPocSize(m_headerImage->numcomps, tcp->getNumProgressions());
+		*tilePartBytesWritten += getPocSize(m_headerImage->numcomps, tcp->getNumProgressions());
 	}
 	// 3. compress tile part and write to stream
-	if(!tileProcessor->writeTilePartT2(&tilePartBytesWritten))
+	if(!tileProcessor->writeTilePartT2(tilePartBytesWritten))
 	{
 		GRK_ERROR("Cannot compress tile");
 		return false;
 	}
 	// 4. now that we know the tile part length, we can
 	// write the Psot in the SOT marker
-	if(!sot.write_psot(m_stream, tilePartBytesWritten))
+	if(!sot.write_psot(stream, *tilePartBytesWritten))
 		return false;
-	// 5. update TLM
 	if(tileProcessor->canPreCalculateTileLen())
 	{
-		auto actualBytes = m_stream->tell() - currentPos;
-		assert(actualBytes == calculatedBytesWritten);
-		(void)actualBytes;
-		tilePartBytesWritten = calculatedBytesWritten;
+		auto actualBytes = stream->tell() - currentPos;
+		if(actualBytes != calculatedBytesWritten)
+		{
+			GRK_ERROR("Tile %u: wrote %u bytes, but expected %u bytes", currentTileIndex,
+					  (uint32_t)actualBytes, calculatedBytesWritten);
+			return false;
+		}
+		*tilePartBytesWritten = calculatedBytesWritten;
 	}
+
+	return true;
+}
+bool CodeStreamCompress::writeTilePart(TileProcessor* tileProcessor)
+{
+	uint32_t tilePartBytesWritten = 0;
+	if(!serializeTilePart(tileProcessor, &tilePartBytesWritten))
+		return false;
+	// update TLM
 	if(m_cp.tlm_markers)
-		m_cp.tlm_markers->push(currentTileIndex, tilePartBytesWritten);
+		m_cp.tlm_markers->push(tileProcessor->m_tileIndex, tilePartBytesWritten);
 	++tileProcessor->m_tilePartIndex;
 
 	return true;
 }
+/**
+ * Write compressed tiles, in tile order.
+ *
+ * If every tile is a single tile part of pre-calculated length, then each tile's
+ * offset in the stream is known before any tile is written, so tiles are
+ * serialized (T2) concurrently and written at their offsets with positional
+ * writes. TLM entries are then pushed in tile order.
+ */
+bool CodeStreamCompress::writeTiles(ThreadPool* pool,
+									const std::vector<TileProcessor*>& tileProcessors)
+{
+	bool concurrent = pool->num_threads() > 1 && m_stream->supportsWriteAt();
+	for(auto tileProcessor : tileProcessors)
+		concurrent = concurrent && tileProcessor->canPreCalculateTileLen();
+	if(!concurrent)
+	{
+		for(auto tileProcessor : tileProcessors)
+		{
+			if(!writeTileParts(tileProcessor))
+				return false;
+		}
+		return true;
+	}
+	if(!m_stream->flush())
+		return false;
+	const size_t maxTileStreamBufferSize = 1024 * 1024;
+	uint64_t offset = m_stream->tell();
+	std::atomic<bool> success(true);
+	std::vector<std::future<int>> results;
+	for(auto tileProcessor : tileProcessors)
+	{
+		auto tileLength = tileProcessor->getPreCalculatedTileLen();
+		auto bufferSize = std::min<size_t>(tileLength, maxTileStreamBufferSize);
+		results.emplace_back(pool->enqueue([this, tileProcessor, offset, bufferSize, &success] {
+			if(!success)
+				return 0;
+			auto stream = BufferedStream::createWriteAtStream(m_stream, offset, bufferSize);
+			auto streamImpl = BufferedStream::getImpl(stream);
+			tileProcessor->setStream(streamImpl);
+			tileProcessor->pino = 0;
+			tileProcessor->m_first_poc_tile_part = true;
+			uint32_t tilePartBytesWritten = 0;
+			if(!serializeTilePart(tileProcessor, &tilePartBytesWritten) || !streamImpl->flush())
+				success = false;
+			tileProcessor->setStream(m_stream);
+			grk_object_unref(stream);
+			return 0;
+		}));
+		offset += tileLength;
+	}
+	for(auto& result : results)
+		result.get();
+	if(!success)
+		return false;
+	for(auto tileProcessor : tileProcessors)
+	{
+		if(m_cp.tlm_markers)
+			m_cp.tlm_markers->push(tileProcessor->m_tileIndex,
+								   tileProcessor->getPreCalculatedTileLen());
+	}
+
+	return m_stream->seek(offset);
+}
 bool CodeStreamCompress::writeTileParts(TileProcessor* tileProcessor)
 {
 	m_currentTileProcessor = tileProcessor;
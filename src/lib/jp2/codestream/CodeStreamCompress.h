@@ -39,12 +39,38 @@ class CodeStreamCompress : public CodeStream, public ICodeStreamCompress
 	bool compress(grk_plugin_tile* tile);
 	bool compressTile(uint16_t tileIndex, uint8_t* p_data, uint64_t data_size);
 	bool endCompress(void);
+	CodeStreamCompress* getCodeStream(void);
+	/**
+	 * Adopt per-component quantization and ROI shift of a transcoding
+	 * source. Must be called after initCompress and before startCompress.
+	 *
+	 * @param source		main header coding parameters of source code stream
+	 * @param copyPackets	true if packets will be copied from source with copyTile
+	 */
+	bool initTranscode(TileCodingParams* source, bool copyPackets);
+	/**
+	 * Compress tile from quantized wavelet coefficients of a source tile,
+	 * skipping DC level shift, MCT and DWT
+	 *
+	 * @param source	source tile processor, decompressed as far as T1
+	 */
+	bool compressTile(TileProcessor* source);
+	/**
+	 * Write tile from packets copied from a source code stream,
+	 * skipping all of T1 and T2 compression
+	 *
+	 * @param tileIndex		tile index
+	 * @param packets		packets located in source code stream
+	 */
+	bool copyTile(uint16_t tileIndex, PACKET_SPANS* packets);
 
   private:
 	bool init_header_writing(void);
 	bool get_end_header(void);
+	bool serializeTilePart(TileProcessor* tileProcessor, uint32_t* tilePartBytesWritten);
 	bool writeTilePart(TileProcessor* tileProcessor);
 	bool writeTileParts(TileProcessor* tileProcessor);
+	bool writeTiles(ThreadPool* pool, const std::vector<TileProcessor*>& tileProcessors);
 	bool updateRates(void);
 	bool compressValidation(void);
 	bool mct_validation(void);
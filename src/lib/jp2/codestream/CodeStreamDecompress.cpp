@@ -67,10 +67,12 @@ static const j2k_mct_function j2k_mct_read_functions_to_int32[] = {
 CodeStreamDecompress::CodeStreamDecompress(IBufferedStream* stream)
 	: CodeStream(stream), wholeTileDecompress(true), m_curr_marker(0), m_headerError(false),
 	  m_tile_ind_to_dec(-1), m_marker_scratch(nullptr), m_marker_scratch_size(0),
-	  m_output_image(nullptr), m_tileCache(new TileCache())
+	  m_output_image(nullptr), m_tileCache(new TileCache()), m_stopAfterT1(false),
+	  m_packetSpans(nullptr)
 {
 	m_decompressorState.m_default_tcp = new TileCodingParams();
 	m_decompressorState.lastSotReadPosition = 0;
+	m_cp.m_coding_params.m_dec.m_deadline = &m_deadline;
 
 	/* code stream index creation */
 	codeStreamInfo = new CodeStreamInfo(stream);
@@ -172,13 +174,17 @@ TileProcessor* CodeStreamDecompress::allocateProcessor(uint16_t tileIndex)
 			grk_object_unref(&m_output_image->obj);
 		m_output_image = nullptr;
 	}
+	createOutputImage();
+
+	return m_currentTileProcessor;
+}
+void CodeStreamDecompress::createOutputImage(void)
+{
 	if(!m_output_image)
 	{
 		m_output_image = new GrkImage();
 		getCompositeImage()->copyHeader(m_output_image);
 	}
-
-	return m_currentTileProcessor;
 }
 TileCodingParams* CodeStreamDecompress::get_current_decode_tcp()
 {
@@ -400,9 +406,48 @@ void CodeStreamDecompress::initDecompress(grk_dparameters* parameters)
 {
 	if(parameters)
 	{
+		bool reduceChanged = m_cp.m_coding_params.m_dec.m_reduce != parameters->cp_reduce;
 		m_cp.m_coding_params.m_dec.m_layer = parameters->cp_layer;
 		m_cp.m_coding_params.m_dec.m_reduce = parameters->cp_reduce;
+		m_cp.m_coding_params.m_dec.m_stripHeight = parameters->dwtStripHeight;
+		m_cp.m_coding_params.m_dec.m_deadline = &m_deadline;
+		m_deadline.setBudget(parameters->timeBudgetMs);
+		m_cp.m_coding_params.m_dec.m_previewCallback = parameters->previewCallback;
+		m_cp.m_coding_params.m_dec.m_previewUserData = parameters->previewUserData;
+		if(parameters->precision && parameters->numPrecision)
+			m_precision.assign(parameters->precision,
+							   parameters->precision + parameters->numPrecision);
+		else
+			m_precision.clear();
+		m_cp.m_coding_params.m_dec.m_precision = m_precision.empty() ? nullptr : m_precision.data();
+		m_cp.m_coding_params.m_dec.m_numPrecision = (uint32_t)m_precision.size();
 		m_tileCache->setStrategy(parameters->tileCacheStrategy);
+		// tiles that have already been read will refine (or coarsen) their
+		// cached state to the new number of layers on the next decompress
+		if(m_cp.tcps)
+		{
+			// main header has already been read: resize header and composite
+			// images to the new reduction
+			if(reduceChanged)
+			{
+				SIZMarker siz;
+				siz.subsampleAndReduceHeaderImageComponents(m_headerImage, &m_cp);
+				getCompositeImage()->subsampleAndReduce(parameters->cp_reduce);
+				if(m_output_image)
+				{
+					grk_object_unref(&m_output_image->obj);
+					m_output_image = nullptr;
+				}
+			}
+			uint32_t numTiles = m_cp.t_grid_width * m_cp.t_grid_height;
+			for(uint32_t i = 0; i < numTiles; ++i)
+			{
+				auto tcp = m_cp.tcps + i;
+				if(tcp->numlayers)
+					tcp->numLayersToDecompress =
+						parameters->cp_layer ? parameters->cp_layer : tcp->numlayers;
+			}
+		}
 	}
 }
 bool CodeStreamDecompress::decompress(grk_plugin_tile* tile)
@@ -491,6 +536,279 @@ bool CodeStreamDecompress::decompressTile(uint16_t tileIndex)
 
 	return decompressExec();
 }
+CodeStreamDecompress* CodeStreamDecompress::getCodeStream(void)
+{
+	return this;
+}
+Deadline* CodeStreamDecompress::getDeadline(void)
+{
+	return &m_deadline;
+}
+bool CodeStreamDecompress::initTranscode(grk_cparameters* parameters)
+{
+	auto tcp = m_decompressorState.m_default_tcp;
+	if(!parameters || !tcp)
+		return false;
+	if(m_cp.m_coding_params.m_dec.m_reduce ||
+	   (m_cp.m_coding_params.m_dec.m_layer && m_cp.m_coding_params.m_dec.m_layer < tcp->numlayers))
+	{
+		GRK_ERROR("Transcoding requires all resolutions and layers to be decompressed");
+		return false;
+	}
+	auto tccp = tcp->tccps;
+	bool isHT = parameters->cblk_sty & GRK_CBLKSTY_HT;
+	if(tccp->qmfbid == 0 && (isHT || tcp->getIsHT()))
+	{
+		GRK_ERROR("Irreversible HTJ2K code streams can't be transcoded");
+		return false;
+	}
+	if(!initCompressParams(parameters, tccp->numresolutions))
+		return false;
+	parameters->isHT = isHT;
+	parameters->cblk_sty = isHT ? GRK_CBLKSTY_HT : (uint8_t)(tccp->cblk_sty & ~GRK_CBLKSTY_HT);
+	// all coding passes go into a single lossless layer
+	parameters->numlayers = 1;
+	parameters->layer_rate[0] = 0;
+
+	return true;
+}
+bool CodeStreamDecompress::initSubset(grk_cparameters* parameters, GrkImage* image)
+{
+	auto tcp = m_decompressorState.m_default_tcp;
+	if(!parameters || !image || !tcp)
+		return false;
+	// PPT markers are in tile headers, which have not been read yet,
+	// so tiles with PPT markers are rejected when their packets are located
+	if(m_cp.ppm_marker)
+	{
+		GRK_ERROR("Code streams with packed packet headers can't be subset");
+		return false;
+	}
+	auto tccp = tcp->tccps;
+	uint8_t reduce = m_cp.m_coding_params.m_dec.m_reduce;
+	if(!initCompressParams(parameters, (uint8_t)(tccp->numresolutions - reduce)))
+		return false;
+	parameters->isHT = tcp->getIsHT();
+	parameters->cblk_sty = tccp->cblk_sty;
+	uint16_t numLayers = tcp->numlayers;
+	if(m_cp.m_coding_params.m_dec.m_layer && m_cp.m_coding_params.m_dec.m_layer < numLayers)
+		numLayers = m_cp.m_coding_params.m_dec.m_layer;
+	parameters->numlayers = numLayers;
+	for(uint16_t layno = 0; layno < numLayers; ++layno)
+		parameters->layer_rate[layno] = 0;
+
+	// crop tile grid to the tiles that intersect the decompress window
+	auto decompressor = &m_decompressorState;
+	uint32_t numTilesX = decompressor->m_end_tile_x_index - decompressor->m_start_tile_x_index;
+	uint32_t numTilesY = decompressor->m_end_tile_y_index - decompressor->m_start_tile_y_index;
+	// tile boundaries must land on the same reduced resolution samples
+	uint32_t mask = (1U << reduce) - 1;
+	if((numTilesX > 1 && (m_cp.t_width & mask)) || (numTilesY > 1 && (m_cp.t_height & mask)))
+	{
+		GRK_ERROR("Tile dimensions (%u,%u) must be divisible by %u to reduce tiled image "
+				  "by %u resolutions",
+				  m_cp.t_width, m_cp.t_height, 1U << reduce, reduce);
+		return false;
+	}
+	uint64_t tx0 = m_cp.tx0 + (uint64_t)decompressor->m_start_tile_x_index * m_cp.t_width;
+	uint64_t ty0 = m_cp.ty0 + (uint64_t)decompressor->m_start_tile_y_index * m_cp.t_height;
+	uint64_t tx1 = tx0 + (uint64_t)numTilesX * m_cp.t_width;
+	uint64_t ty1 = ty0 + (uint64_t)numTilesY * m_cp.t_height;
+	image->x0 = ceildivpow2<uint32_t>(std::max<uint32_t>(m_headerImage->x0, (uint32_t)tx0), reduce);
+	image->y0 = ceildivpow2<uint32_t>(std::max<uint32_t>(m_headerImage->y0, (uint32_t)ty0), reduce);
+	image->x1 = ceildivpow2<uint32_t>((uint32_t)std::min<uint64_t>(m_headerImage->x1, tx1), reduce);
+	image->y1 = ceildivpow2<uint32_t>((uint32_t)std::min<uint64_t>(m_headerImage->y1, ty1), reduce);
+	parameters->tx0 = ceildivpow2<uint32_t>((uint32_t)tx0, reduce);
+	parameters->ty0 = ceildivpow2<uint32_t>((uint32_t)ty0, reduce);
+	parameters->t_width = (numTilesX > 1) ? m_cp.t_width >> reduce
+										  : std::max<uint32_t>(image->x1, parameters->tx0 + 1) -
+												parameters->tx0;
+	parameters->t_height = (numTilesY > 1) ? m_cp.t_height >> reduce
+										   : std::max<uint32_t>(image->y1, parameters->ty0 + 1) -
+												 parameters->ty0;
+
+	return image->subsampleAndReduce(0);
+}
+bool CodeStreamDecompress::hasDefaultCoding(TileCodingParams* tcp)
+{
+	auto defaultTcp = m_decompressorState.m_default_tcp;
+	// PPT markers are only found in tile headers
+	if(tcp->ppt)
+		return false;
+	if((tcp->csty & (J2K_CP_CSTY_SOP | J2K_CP_CSTY_EPH)) !=
+	   (defaultTcp->csty & (J2K_CP_CSTY_SOP | J2K_CP_CSTY_EPH)))
+		return false;
+	for(uint16_t compno = 0; compno < m_headerImage->numcomps; ++compno)
+	{
+		auto tccp = tcp->tccps + compno;
+		auto defaultTccp = defaultTcp->tccps + compno;
+		if(tccp->numresolutions != defaultTccp->numresolutions ||
+		   tccp->cblkw != defaultTccp->cblkw || tccp->cblkh != defaultTccp->cblkh ||
+		   tccp->cblk_sty != defaultTccp->cblk_sty || tccp->qmfbid != defaultTccp->qmfbid ||
+		   tccp->qntsty != defaultTccp->qntsty || tccp->numgbits != defaultTccp->numgbits ||
+		   tccp->roishift != defaultTccp->roishift)
+			return false;
+		for(uint32_t resno = 0; resno < tccp->numresolutions; ++resno)
+		{
+			if(tccp->precinctWidthExp[resno] != defaultTccp->precinctWidthExp[resno] ||
+			   tccp->precinctHeightExp[resno] != defaultTccp->precinctHeightExp[resno])
+				return false;
+		}
+		for(uint32_t bandno = 0; bandno < tccp->numresolutions * 3U - 2; ++bandno)
+		{
+			if(tccp->stepsizes[bandno].expn != defaultTccp->stepsizes[bandno].expn ||
+			   tccp->stepsizes[bandno].mant != defaultTccp->stepsizes[bandno].mant)
+				return false;
+		}
+	}
+
+	return true;
+}
+bool CodeStreamDecompress::initCompressParams(grk_cparameters* parameters,
+											  uint8_t numResolutions)
+{
+	auto tcp = m_decompressorState.m_default_tcp;
+	if(tcp->mct == 2)
+	{
+		GRK_ERROR("Custom multiple component transforms are not supported");
+		return false;
+	}
+	auto tccp = tcp->tccps;
+	for(uint16_t compno = 1; compno < m_headerImage->numcomps; ++compno)
+	{
+		auto other = tcp->tccps + compno;
+		bool sameCoding = other->numresolutions == tccp->numresolutions &&
+						  other->cblkw == tccp->cblkw && other->cblkh == tccp->cblkh &&
+						  other->qmfbid == tccp->qmfbid && other->csty == tccp->csty;
+		for(uint32_t resno = 0; sameCoding && resno < tccp->numresolutions; ++resno)
+			sameCoding = other->precinctWidthExp[resno] == tccp->precinctWidthExp[resno] &&
+						 other->precinctHeightExp[resno] == tccp->precinctHeightExp[resno];
+		if(!sameCoding)
+		{
+			GRK_ERROR("Component-specific coding styles are not supported");
+			return false;
+		}
+	}
+	if(tcp->hasPoc())
+		GRK_WARN("Progression order changes will not be preserved");
+
+	parameters->rsiz = GRK_PROFILE_NONE;
+	parameters->tile_size_on = true;
+	parameters->tx0 = m_cp.tx0;
+	parameters->ty0 = m_cp.ty0;
+	parameters->t_width = m_cp.t_width;
+	parameters->t_height = m_cp.t_height;
+	parameters->numresolution = numResolutions;
+	parameters->cblockw_init = 1U << tccp->cblkw;
+	parameters->cblockh_init = 1U << tccp->cblkh;
+	parameters->irreversible = tccp->qmfbid == 0;
+	parameters->numgbits = tccp->numgbits;
+	parameters->csty = (uint8_t)(tcp->csty | (tccp->csty & J2K_CCP_CSTY_PRT));
+	parameters->res_spec = 0;
+	if(tccp->csty & J2K_CCP_CSTY_PRT)
+	{
+		// precinct sizes are listed from highest resolution down
+		parameters->res_spec = numResolutions;
+		for(uint32_t p = 0; p < numResolutions; ++p)
+		{
+			uint32_t resno = numResolutions - 1U - p;
+			parameters->prcw_init[p] = 1U << tccp->precinctWidthExp[resno];
+			parameters->prch_init[p] = 1U << tccp->precinctHeightExp[resno];
+		}
+	}
+	parameters->prog_order = tcp->prg;
+	parameters->numpocs = 0;
+	parameters->mct = tcp->mct;
+	parameters->mct_data = nullptr;
+	parameters->roi_compno = -1;
+	parameters->allocationByRateDistoration = false;
+	parameters->allocationByQuality = false;
+
+	return true;
+}
+bool CodeStreamDecompress::decompressCoefficients(std::function<bool(TileProcessor*)> consumer)
+{
+	// stop tile decompression after T1, leaving quantized
+	// wavelet coefficients in the tile component buffers
+	m_stopAfterT1 = true;
+	bool rc = true;
+	uint16_t numTiles = (uint16_t)(m_cp.t_grid_width * m_cp.t_grid_height);
+	for(uint16_t tileIndex = 0; tileIndex < numTiles && rc; ++tileIndex)
+	{
+		rc = decompressTile(tileIndex);
+		auto entry = m_tileCache->get(tileIndex);
+		auto processor = entry ? entry->processor : nullptr;
+		if(rc && !processor)
+		{
+			GRK_ERROR("Tile %u could not be decompressed", tileIndex);
+			rc = false;
+		}
+		if(rc)
+			rc = consumer(processor);
+		if(processor)
+			processor->deallocBuffers();
+	}
+	m_stopAfterT1 = false;
+
+	return rc;
+}
+bool CodeStreamDecompress::decompressPackets(
+	std::function<bool(uint16_t, PACKET_SPANS*)> consumer)
+{
+	auto decompressor = &m_decompressorState;
+	auto compositeImage = getCompositeImage();
+	auto window =
+		grkRectU32(compositeImage->x0, compositeImage->y0, compositeImage->x1, compositeImage->y1);
+	PACKET_SPANS packetSpans;
+	m_packetSpans = &packetSpans;
+	bool rc = true;
+	uint16_t subsetTileIndex = 0;
+	for(uint32_t ty = decompressor->m_start_tile_y_index;
+		ty < decompressor->m_end_tile_y_index && rc; ++ty)
+	{
+		for(uint32_t tx = decompressor->m_start_tile_x_index;
+			tx < decompressor->m_end_tile_x_index && rc; ++tx)
+		{
+			uint16_t tileIndex = (uint16_t)(tx + ty * m_cp.t_grid_width);
+			// decompressTile resets composite image to the full image once an output
+			// image exists, so restore the decompress window for each tile
+			if(m_output_image)
+			{
+				grk_object_unref(&m_output_image->obj);
+				m_output_image = nullptr;
+			}
+			m_headerImage->copyHeader(compositeImage);
+			compositeImage->x0 = window.x0;
+			compositeImage->y0 = window.y0;
+			compositeImage->x1 = window.x1;
+			compositeImage->y1 = window.y1;
+			packetSpans.clear();
+			rc = decompressTile(tileIndex);
+			auto entry = m_tileCache->get(tileIndex);
+			auto processor = entry ? entry->processor : nullptr;
+			if(rc && !processor)
+			{
+				GRK_ERROR("Packets of tile %u could not be located", tileIndex);
+				rc = false;
+			}
+			if(rc && !hasDefaultCoding(m_cp.tcps + tileIndex))
+			{
+				GRK_ERROR("Tile %u: tile-specific coding styles can't be subset", tileIndex);
+				rc = false;
+			}
+			if(rc)
+				rc = consumer(subsetTileIndex++, &packetSpans);
+			if(processor)
+			{
+				processor->packetSpans = nullptr;
+				processor->deallocBuffers();
+			}
+		}
+	}
+	m_packetSpans = nullptr;
+
+	return rc;
+}
 bool CodeStreamDecompress::endOfCodeStream(void)
 {
 	return m_decompressorState.getState() == J2K_DEC_STATE_EOC ||
@@ -508,11 +826,21 @@ bool CodeStreamDecompress::decompressTiles(void)
 			return false;
 		}
 	}
+	// each tile is composited into the output image by its worker
+	if(m_multiTile)
+	{
+		createOutputImage();
+		if(!m_output_image->allocData())
+			return false;
+	}
 	std::vector<std::future<int>> results;
 	std::atomic<bool> success(true);
 	std::atomic<uint32_t> numTilesDecompressed(0);
+	// with NUMA affinity, each tile is decompressed by workers on the node of its tile thread,
+	// which also allocates (and first touches) the tile's buffers
 	ThreadPool pool(
-		std::min<uint32_t>((uint32_t)ThreadPool::get()->num_threads(), numTilesToDecompress));
+		std::min<uint32_t>((uint32_t)ThreadPool::get()->num_threads(), numTilesToDecompress),
+		ThreadPool::get()->affinity());
 	bool breakAfterT1 = false;
 	bool canDecompress = true;
 	if(endOfCodeStream())
@@ -525,10 +853,14 @@ bool CodeStreamDecompress::decompressTiles(void)
 		for(uint16_t i = 0; i < numTilesToDecompress; ++i)
 		{
 			auto entry = m_tileCache->get(i);
-			if(!entry || !entry->processor)
+			// skip tiles outside of the decompress window
+			if(!entry || !entry->processor || !m_cp.tcps[i].m_compressedTileData)
 				continue;
 			auto processor = entry->processor;
-			auto exec = [this, processor, numTilesToDecompress, &numTilesDecompressed, &success] {
+			uint64_t reservation = processor->estimateMemory();
+			MemoryBudget::get()->reserve(reservation);
+			auto exec = [this, processor, reservation, numTilesToDecompress,
+						 &numTilesDecompressed, &success] {
 				if(success)
 				{
 					if(!decompressT2T1(processor))
@@ -542,6 +874,7 @@ bool CodeStreamDecompress::decompressTiles(void)
 						numTilesDecompressed++;
 					}
 				}
+				MemoryBudget::get()->release(reservation);
 				return 0;
 			};
 			if(pool.num_threads() > 1)
@@ -563,6 +896,20 @@ bool CodeStreamDecompress::decompressTiles(void)
 
 		return true;
 	}
+	// with TLM markers, we know where all tile parts are located in the stream,
+	// so the stream can start reading tiles in the decompress window ahead of time
+	if(m_cp.tlm_markers && codeStreamInfo)
+	{
+		auto state = &m_decompressorState;
+		m_cp.tlm_markers->prefetch(
+			m_stream, codeStreamInfo->getMainHeaderEnd(), [this, state](uint16_t tileIndex) {
+				uint32_t tile_x = tileIndex % m_cp.t_grid_width;
+				uint32_t tile_y = tileIndex / m_cp.t_grid_width;
+				return tile_x >= state->m_start_tile_x_index &&
+					   tile_x < state->m_end_tile_x_index &&
+					   tile_y >= state->m_start_tile_y_index && tile_y < state->m_end_tile_y_index;
+			});
+	}
 	while(!endOfCodeStream() && !breakAfterT1)
 	{
 		// 1. read header
@@ -608,8 +955,13 @@ bool CodeStreamDecompress::decompressTiles(void)
 		}
 		// 3. T2 + T1 decompress
 		// once we schedule a processor for T1 compression, we will destroy it
-		// regardless of success or not
-		auto exec = [this, processor, numTilesToDecompress, &numTilesDecompressed, &success] {
+		// regardless of success or not.
+		// Wait for room in the memory budget before scheduling the tile: with many tiles,
+		// or many codecs, in flight, this bounds peak memory at the cost of parallelism
+		uint64_t reservation = processor->estimateMemory();
+		MemoryBudget::get()->reserve(reservation);
+		auto exec = [this, processor, reservation, numTilesToDecompress, &numTilesDecompressed,
+					 &success] {
 			if(success)
 			{
 				if(!decompressT2T1(processor))
@@ -623,6 +975,7 @@ bool CodeStreamDecompress::decompressTiles(void)
 					numTilesDecompressed++;
 				}
 			}
+			MemoryBudget::get()->release(reservation);
 			return 0;
 		};
 		if(pool.num_threads() > 1)
@@ -940,23 +1293,62 @@ bool CodeStreamDecompress::readHeaderProcedureImpl(void)
 }
 bool CodeStreamDecompress::decompressExec(void)
 {
-	if(!exec(m_procedure_list))
+	// a tile composited by an earlier pass must be composited again by this pass,
+	// even if that pass failed before the composite images were reconciled
+	uint16_t numTiles = (uint16_t)(m_cp.t_grid_width * m_cp.t_grid_height);
+	for(uint16_t i = 0; i < numTiles; ++i)
+	{
+		auto entry = m_tileCache->get(i);
+		if(entry && entry->processor)
+			entry->processor->imageComposited = false;
+	}
+	m_deadline.start();
+	bool rc = exec(m_procedure_list);
+	m_deadline.finish();
+	if(!rc)
 		return false;
 	if(m_multiTile)
 	{
 		if(!m_output_image->allocData())
 			return false;
-		auto images = m_tileCache->getTileImages();
-		for(auto& img : images)
+		// composite cached tiles that were not decompressed by this pass
+		for(uint16_t i = 0; i < numTiles; ++i)
 		{
-			if(!m_output_image->compositeFrom(img))
-				return false;
+			auto entry = m_tileCache->get(i);
+			auto processor = entry ? entry->processor : nullptr;
+			if(!processor)
+				continue;
+			if(!processor->imageComposited && processor->getImage())
+			{
+				if(!m_output_image->compositeFrom(processor->getImage()))
+					return false;
+			}
 		}
 	}
 	m_output_image->transferDataTo(getCompositeImage());
+	if(doPostT1())
+		setOutputPrecision(getCompositeImage());
 
 	return true;
 }
+bool CodeStreamDecompress::doPostT1(void)
+{
+	return !m_stopAfterT1 &&
+		   (!current_plugin_tile || (current_plugin_tile->decompress_flags & GRK_DECODE_POST_T1));
+}
+void CodeStreamDecompress::setOutputPrecision(GrkImage* image)
+{
+	// tile samples have already been converted by the tile workers
+	for(uint16_t compno = 0; compno < image->numcomps; ++compno)
+	{
+		grk_precision precision;
+		if(m_cp.m_coding_params.m_dec.getPrecision(compno, m_headerImage->comps[compno].prec,
+												   &precision))
+			image->comps[compno].prec = precision.prec;
+		else
+			image->comps[compno].prec = m_headerImage->comps[compno].prec;
+	}
+}
 /*
  * Read and decompress one tile.
  */
@@ -1035,13 +1427,25 @@ bool CodeStreamDecompress::decompressT2T1(TileProcessor* tileProcessor)
 		GRK_ERROR("Decompress: Tile %d has no compressed data", tileProcessor->m_tileIndex);
 		return false;
 	}
-	bool doPost =
-		!current_plugin_tile || (current_plugin_tile->decompress_flags & GRK_DECODE_POST_T1);
+	bool doPost = doPostT1();
+	tileProcessor->packetSpans = m_packetSpans;
 	if(!tileProcessor->decompressT2T1(tcp, m_output_image, m_multiTile, doPost))
 	{
 		m_decompressorState.orState(J2K_DEC_STATE_ERR);
 		return false;
 	}
+	// composite while the tile image is still hot in this worker's cache:
+	// tiles cover disjoint regions of the output image
+	if(m_multiTile && doPost && tileProcessor->getImage())
+	{
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_COMPOSITE, tileProcessor->m_tileIndex, -1);
+		if(!m_output_image->compositeFrom(tileProcessor->getImage()))
+			return false;
+		tileProcessor->imageComposited = true;
+	}
+	// code blocks have been decompressed, so the stream can drop this tile's data
+	if(!tileProcessor->packetSpans)
+		tileProcessor->releaseCompressedData();
 
 	return true;
 }
@@ -2495,6 +2899,12 @@ bool CodeStreamDecompress::parseTileHeaderMarkers(bool* canDecompress)
 					}
 					break;
 				}
+				// without TLM markers, Psot tells us how much of this tile part is left to read
+				else if(!m_cp.tlm_markers)
+				{
+					m_stream->prefetch(m_stream->tell(),
+									   m_currentTileProcessor->tilePartDataLength);
+				}
 			}
 			if(!readMarker())
 				return false;
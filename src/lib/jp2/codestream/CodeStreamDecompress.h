@@ -60,8 +60,55 @@ class CodeStreamDecompress : public CodeStream, public ICodeStreamDecompress
 	int32_t tileIndexToDecode();
 	bool isWholeTileDecompress();
 	void dump(uint32_t flag, FILE* outputFileStream);
+	CodeStreamDecompress* getCodeStream(void);
+	Deadline* getDeadline(void);
+	/**
+	 * Set compress parameters so that a transcoded code stream
+	 * matches the tiling, wavelet, code block, precinct, progression
+	 * and quantization setup of this code stream
+	 *
+	 * @param parameters	compress parameters
+	 */
+	bool initTranscode(grk_cparameters* parameters);
+	/**
+	 * Decompress all tiles in sequence, as far as T1, and pass
+	 * each tile's quantized wavelet coefficients on to a consumer
+	 *
+	 * @param consumer	called with each decompressed tile processor
+	 */
+	bool decompressCoefficients(std::function<bool(TileProcessor*)> consumer);
+	/**
+	 * Set compress parameters and image bounds for a subset of this code stream,
+	 * restricted to the reduction factor, layers and decompress window that have
+	 * been set for decompression. Code block and packet data are not modified,
+	 * so the subset can be written without decompressing.
+	 *
+	 * @param parameters	compress parameters
+	 * @param image		 	subset image header: copy of header image, whose bounds are updated
+	 */
+	bool initSubset(grk_cparameters* parameters, GrkImage* image);
+	/**
+	 * Locate, without decompressing, the packets of each tile in the subset
+	 * set up by initSubset, and pass them on to a consumer
+	 *
+	 * @param consumer	called with each tile's index in the subset, and its packets
+	 */
+	bool decompressPackets(std::function<bool(uint16_t, PACKET_SPANS*)> consumer);
 
   protected:
+	/**
+	 * Set compress parameters common to transcoding and subsetting
+	 *
+	 * @param parameters		compress parameters
+	 * @param numResolutions	number of resolutions in compressed code stream
+	 */
+	bool initCompressParams(grk_cparameters* parameters, uint8_t numResolutions);
+	/**
+	 * Check whether tile coding parameters match main header coding parameters
+	 *
+	 * @param tcp	tile coding parameters
+	 */
+	bool hasDefaultCoding(TileCodingParams* tcp);
 	void dump_MH_info(FILE* outputFileStream);
 	/**
 	 * Dump an image header structure.
@@ -91,6 +138,9 @@ class CodeStreamDecompress : public CodeStream, public ICodeStreamDecompress
 	bool readHeaderProcedureImpl(void);
 	bool decompressExec();
 	bool decompressT2T1(TileProcessor* tileProcessor);
+	bool doPostT1(void);
+	void createOutputImage(void);
+	void setOutputPrecision(GrkImage* image);
 	bool decompressTile();
 	bool findNextTile(TileProcessor* tileProcessor);
 	bool decompressTiles(void);
@@ -323,6 +373,13 @@ class CodeStreamDecompress : public CodeStream, public ICodeStreamDecompress
 	uint16_t m_marker_scratch_size;
 	GrkImage* m_output_image;
 	TileCache* m_tileCache;
+	// true if tiles are only decompressed as far as quantized wavelet coefficients
+	bool m_stopAfterT1;
+	// packets of current tile, when tiles are located rather than decompressed
+	PACKET_SPANS* m_packetSpans;
+	Deadline m_deadline;
+	// output precision for each component, referenced by decoding params
+	std::vector<grk_precision> m_precision;
 };
 
 } // namespace grk
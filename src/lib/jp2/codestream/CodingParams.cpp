@@ -44,6 +44,18 @@ grkRectU32 CodingParams::getTileBounds(const GrkImage* p_image, uint32_t tile_x,
 	return rc;
 }
 
+bool DecodingParams::getPrecision(uint16_t compno, uint8_t prec, grk_precision* precision) const
+{
+	if(!m_precision || !m_numPrecision)
+		return false;
+	// last entry applies to remaining components
+	*precision = m_precision[std::min<uint32_t>(compno, m_numPrecision - 1)];
+	if(precision->prec == 0)
+		precision->prec = prec;
+
+	return precision->prec != prec;
+}
+
 void CodingParams::destroy()
 {
 	if(tcps != nullptr)
@@ -238,6 +238,26 @@ struct DecodingParams
 	/** if != 0, then only the first "layer" layers are decompressed; if == 0 or not used, all the
 	 * quality layers are decompressed */
 	uint16_t m_layer;
+	/** if != 0, then whole tiles are decompressed in horizontal strips of this height */
+	uint32_t m_stripHeight;
+	/** time budget and cancellation of the current decompress (owned by decompressor) */
+	Deadline* m_deadline;
+	/** resolution-progressive preview callback (optional) */
+	grk_decompress_preview_fn m_previewCallback;
+	void* m_previewUserData;
+	/** output precision for each component (optional, owned by decompressor) */
+	grk_precision* m_precision;
+	uint32_t m_numPrecision;
+
+	/**
+	 * Get output precision of component
+	 *
+	 * @param compno component number
+	 * @param prec decompressed precision of component
+	 * @param precision output precision of component
+	 * @return true if output precision differs from decompressed precision
+	 */
+	bool getPrecision(uint16_t compno, uint8_t prec, grk_precision* precision) const;
 };
 
 /**
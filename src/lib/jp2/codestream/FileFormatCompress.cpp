@@ -925,6 +925,10 @@ bool FileFormatCompress::endCompress(void)
 	/* write header */
 	return exec(m_procedure_list);
 }
+CodeStreamCompress* FileFormatCompress::getCodeStream(void)
+{
+	return codeStream;
+}
 void FileFormatCompress::init_end_header_writing(void)
 {
 	m_procedure_list->push_back(std::bind(&FileFormatCompress::write_jp2c, this));
@@ -33,6 +33,7 @@ class FileFormatCompress : public FileFormat, public ICodeStreamCompress
 	bool compress(grk_plugin_tile* tile);
 	bool compressTile(uint16_t tileIndex, uint8_t* p_data, uint64_t data_size);
 	bool endCompress(void);
+	CodeStreamCompress* getCodeStream(void);
 
   private:
 	void find_cf(double x, uint32_t* num, uint32_t* den);
@@ -334,8 +334,19 @@ void FileFormatDecompress::initDecompress(grk_dparameters* parameters)
 	/* further JP2 initializations go here */
 	color.has_colour_specification_box = false;
 }
+void FileFormatDecompress::disableOutputPrecision(void)
+{
+	// palette and channel definitions change the components that precision refers to
+	if(color.palette || color.channel_definition)
+	{
+		auto dec = &codeStream->getCodingParams()->m_coding_params.m_dec;
+		dec->m_precision = nullptr;
+		dec->m_numPrecision = 0;
+	}
+}
 bool FileFormatDecompress::decompress(grk_plugin_tile* tile)
 {
+	disableOutputPrecision();
 	if(!codeStream->decompress(tile))
 	{
 		GRK_ERROR("Failed to decompress JP2 file");
@@ -346,6 +357,7 @@ bool FileFormatDecompress::decompress(grk_plugin_tile* tile)
 }
 bool FileFormatDecompress::decompressTile(uint16_t tileIndex)
 {
+	disableOutputPrecision();
 	if(!codeStream->decompressTile(tileIndex))
 	{
 		GRK_ERROR("Failed to decompress JP2 file");
@@ -477,6 +489,10 @@ void FileFormatDecompress::dump(uint32_t flag, FILE* outputFileStream)
 {
 	codeStream->dump(flag, outputFileStream);
 }
+CodeStreamDecompress* FileFormatDecompress::getCodeStream(void)
+{
+	return codeStream;
+}
 bool FileFormatDecompress::readHeaderProcedureImpl(void)
 {
 	FileFormatBox box;
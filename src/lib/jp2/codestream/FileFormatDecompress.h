@@ -42,6 +42,7 @@ class FileFormatDecompress : public FileFormat, public ICodeStreamDecompress
 	bool decompressTile(uint16_t tileIndex);
 	bool endDecompress(void);
 	void dump(uint32_t flag, FILE* outputFileStream);
+	CodeStreamDecompress* getCodeStream(void);
 
   private:
 	static void alloc_palette(grk_color* color, uint8_t num_channels, uint16_t num_entries);
@@ -79,6 +80,7 @@ class FileFormatDecompress : public FileFormat, public ICodeStreamDecompress
 
 	bool applyColour(GrkImage* img);
 	bool applyColour(void);
+	void disableOutputPrecision(void);
 	std::map<uint32_t, BOX_FUNC> header;
 	std::map<uint32_t, BOX_FUNC> img_header;
 
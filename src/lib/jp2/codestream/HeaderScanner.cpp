@@ -0,0 +1,585 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#include "grk_includes.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else /* _WIN32 */
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include <fcntl.h>
+
+namespace grk
+{
+// Rsiz, Xsiz, Ysiz, XOsiz, YOsiz, XTsiz, YTsiz, XTOsiz, YTOsiz and Csiz
+const uint32_t sizFixedLength = 2 + 8 * 4 + 2;
+// Scod, SGcod and SPcod, excluding precinct sizes
+const uint32_t codFixedLength = 1 + 4 + 5;
+
+static double calcResolution(uint16_t num, uint16_t den, int8_t exponent)
+{
+	if(den == 0)
+		return 0;
+
+	return ((double)num / den) * pow(10, exponent);
+}
+
+HeaderScanner::HeaderScanner(void)
+	: m_fd((grk_handle)-1), m_isOpen(false), m_fileSize(0), m_windowOffset(0), m_windowLen(0)
+{}
+HeaderScanner::~HeaderScanner(void)
+{
+	close();
+}
+#ifdef _WIN32
+bool HeaderScanner::open(const char* fname)
+{
+	m_fd = (grk_handle)CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+								   OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if(m_fd == INVALID_HANDLE_VALUE)
+		return false;
+	m_isOpen = true;
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_fd, &size))
+		return false;
+	m_fileSize = (uint64_t)size.QuadPart;
+
+	return true;
+}
+void HeaderScanner::close(void)
+{
+	if(m_isOpen)
+		CloseHandle(m_fd);
+	m_isOpen = false;
+}
+size_t HeaderScanner::readAt(uint64_t offset, uint8_t* dest, size_t len)
+{
+	size_t total = 0;
+	while(total < len)
+	{
+		OVERLAPPED overlapped = {};
+		uint64_t pos = offset + total;
+		overlapped.Offset = (DWORD)pos;
+		overlapped.OffsetHigh = (DWORD)(pos >> 32);
+		DWORD numRead = 0;
+		if(!ReadFile(m_fd, dest + total, (DWORD)(len - total), &numRead, &overlapped) ||
+		   numRead == 0)
+			break;
+		total += numRead;
+	}
+
+	return total;
+}
+#else
+bool HeaderScanner::open(const char* fname)
+{
+	m_fd = ::open(fname, O_RDONLY);
+	if(m_fd == -1)
+		return false;
+	m_isOpen = true;
+	struct stat sb;
+	if(fstat(m_fd, &sb) != 0)
+		return false;
+	m_fileSize = (uint64_t)sb.st_size;
+
+	return true;
+}
+void HeaderScanner::close(void)
+{
+	if(m_isOpen)
+		::close(m_fd);
+	m_isOpen = false;
+}
+size_t HeaderScanner::readAt(uint64_t offset, uint8_t* dest, size_t len)
+{
+	size_t total = 0;
+	while(total < len)
+	{
+		auto numRead = pread(m_fd, dest + total, len - total, (off_t)(offset + total));
+		if(numRead < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+		if(numRead == 0)
+			break;
+		total += (size_t)numRead;
+	}
+
+	return total;
+}
+#endif
+/**
+ * Read from file, through the window: a read outside of the window
+ * refills the window starting at the read offset
+ */
+bool HeaderScanner::read(uint64_t offset, uint8_t* dest, size_t len)
+{
+	if(offset >= m_windowOffset && offset + len <= m_windowOffset + m_windowLen)
+	{
+		memcpy(dest, m_window + (offset - m_windowOffset), len);
+		return true;
+	}
+	if(len > windowSize)
+		return readAt(offset, dest, len) == len;
+	m_windowOffset = offset;
+	m_windowLen = readAt(offset, m_window, windowSize);
+	if(m_windowLen < len)
+		return false;
+	memcpy(dest, m_window, len);
+
+	return true;
+}
+bool HeaderScanner::scan(const char* fname, grk_header_scan* scan)
+{
+	memset(scan, 0, sizeof(grk_header_scan));
+	scan->format = GRK_CODEC_UNKNOWN;
+	scan->prog_order = GRK_PROG_UNKNOWN;
+	scan->enumcs = GRK_ENUM_CLRSPC_UNKNOWN;
+	if(!open(fname))
+	{
+		GRK_ERROR("Unable to open file %s", fname);
+		close();
+		return false;
+	}
+	scan->file_size = m_fileSize;
+	bool rc = readBoxes(scan);
+	close();
+
+	return rc;
+}
+bool HeaderScanner::readBoxHeader(uint64_t offset, uint64_t end, uint32_t* type,
+								  uint64_t* headerLen, uint64_t* boxLen)
+{
+	uint8_t buf[16];
+	if(end - offset < 8 || !read(offset, buf, 8))
+	{
+		GRK_ERROR("Truncated box header");
+		return false;
+	}
+	uint32_t len;
+	grk_read<uint32_t>(buf, &len);
+	grk_read<uint32_t>(buf + 4, type);
+	*headerLen = 8;
+	if(len == 1)
+	{
+		if(end - offset < 16 || !read(offset + 8, buf + 8, 8))
+		{
+			GRK_ERROR("Truncated box header");
+			return false;
+		}
+		grk_read<uint64_t>(buf + 8, boxLen);
+		*headerLen = 16;
+	}
+	else if(len == 0)
+	{
+		// box extends to end of its super box, or to end of file
+		*boxLen = end - offset;
+	}
+	else
+	{
+		*boxLen = len;
+	}
+	if(*boxLen < *headerLen || *boxLen > end - offset)
+	{
+		GRK_ERROR("Box 0x%x has bad length %" PRIu64, *type, *boxLen);
+		return false;
+	}
+
+	return true;
+}
+bool HeaderScanner::readBoxes(grk_header_scan* scan)
+{
+	uint8_t buf[12];
+	if(!read(0, buf, 12))
+	{
+		GRK_ERROR("File is too short to be a JPEG 2000 file");
+		return false;
+	}
+	uint16_t marker;
+	grk_read<uint16_t>(buf, &marker);
+	if(marker == J2K_MS_SOC)
+	{
+		scan->format = GRK_CODEC_J2K;
+		return readMainHeader(0, m_fileSize, scan);
+	}
+	uint32_t len, type, magic;
+	grk_read<uint32_t>(buf, &len);
+	grk_read<uint32_t>(buf + 4, &type);
+	grk_read<uint32_t>(buf + 8, &magic);
+	if(len != 12 || type != JP2_JP || magic != 0x0d0a870a)
+	{
+		GRK_ERROR("File is not a JPEG 2000 file");
+		return false;
+	}
+	scan->format = GRK_CODEC_JP2;
+	uint64_t offset = 12;
+	while(offset < m_fileSize)
+	{
+		uint64_t headerLen, boxLen;
+		if(!readBoxHeader(offset, m_fileSize, &type, &headerLen, &boxLen))
+			return false;
+		uint64_t dataOffset = offset + headerLen;
+		uint64_t end = offset + boxLen;
+		switch(type)
+		{
+			case JP2_JP2H:
+				if(!readJP2Header(dataOffset, end, scan))
+					return false;
+				break;
+			case JP2_XML:
+				if(!scan->xml_offset)
+				{
+					scan->xml_offset = dataOffset;
+					scan->xml_len = end - dataOffset;
+				}
+				break;
+			case JP2_JP2C:
+				scan->codestream_offset = dataOffset;
+				return readMainHeader(dataOffset, end, scan);
+			default:
+				break;
+		}
+		offset = end;
+	}
+	GRK_ERROR("File has no contiguous code stream box");
+
+	return false;
+}
+bool HeaderScanner::readJP2Header(uint64_t offset, uint64_t end, grk_header_scan* scan)
+{
+	while(offset < end)
+	{
+		uint32_t type;
+		uint64_t headerLen, boxLen;
+		if(!readBoxHeader(offset, end, &type, &headerLen, &boxLen))
+			return false;
+		switch(type)
+		{
+			case JP2_COLR:
+				if(!readColour(offset + headerLen, boxLen - headerLen, scan))
+					return false;
+				break;
+			case JP2_RES:
+				if(!readResolution(offset + headerLen, offset + boxLen, scan))
+					return false;
+				break;
+			default:
+				break;
+		}
+		offset += boxLen;
+	}
+
+	return true;
+}
+bool HeaderScanner::readColour(uint64_t offset, uint64_t len, grk_header_scan* scan)
+{
+	// Part 1, I.5.3.3 : 'A conforming JP2 reader shall ignore all colour
+	// specification boxes after the first.'
+	if(scan->has_colr)
+		return true;
+	uint8_t buf[7];
+	if(len < 3 || !read(offset, buf, 3))
+	{
+		GRK_ERROR("Bad COLR header box (bad size)");
+		return false;
+	}
+	scan->has_colr = true;
+	scan->colr_meth = buf[0];
+	if(scan->colr_meth == 1)
+	{
+		if(len < 7 || !read(offset + 3, buf + 3, 4))
+		{
+			GRK_ERROR("Bad COLR header box (bad size: %" PRIu64 ")", len);
+			return false;
+		}
+		uint32_t enumcs;
+		grk_read<uint32_t>(buf + 3, &enumcs);
+		scan->enumcs = (GRK_ENUM_COLOUR_SPACE)enumcs;
+	}
+	else if(scan->colr_meth == 2)
+	{
+		scan->icc_profile_len = (uint32_t)(len - 3);
+	}
+
+	return true;
+}
+bool HeaderScanner::readResolution(uint64_t offset, uint64_t end, grk_header_scan* scan)
+{
+	while(offset < end)
+	{
+		uint32_t type;
+		uint64_t headerLen, boxLen;
+		if(!readBoxHeader(offset, end, &type, &headerLen, &boxLen))
+			return false;
+		double* res = nullptr;
+		switch(type)
+		{
+			case JP2_CAPTURE_RES:
+				res = scan->capture_resolution;
+				scan->has_capture_resolution = true;
+				break;
+			case JP2_DISPLAY_RES:
+				res = scan->display_resolution;
+				scan->has_display_resolution = true;
+				break;
+			default:
+				break;
+		}
+		if(res)
+		{
+			uint8_t buf[10];
+			if(boxLen != GRK_RESOLUTION_BOX_SIZE || !read(offset + headerLen, buf, 10))
+			{
+				GRK_ERROR("Bad resolution box (bad size)");
+				return false;
+			}
+			// vertical numerator and denominator, then horizontal,
+			// followed by vertical and horizontal exponents
+			uint16_t num[2], den[2];
+			grk_read<uint16_t>(buf, num + 1);
+			grk_read<uint16_t>(buf + 2, den + 1);
+			grk_read<uint16_t>(buf + 4, num);
+			grk_read<uint16_t>(buf + 6, den);
+			res[0] = calcResolution(num[0], den[0], (int8_t)buf[9]);
+			res[1] = calcResolution(num[1], den[1], (int8_t)buf[8]);
+		}
+		offset += boxLen;
+	}
+
+	return true;
+}
+bool HeaderScanner::readMainHeader(uint64_t offset, uint64_t end, grk_header_scan* scan)
+{
+	uint8_t buf[4];
+	uint16_t marker;
+	if(end - offset < 2 || !read(offset, buf, 2))
+	{
+		GRK_ERROR("Truncated main header");
+		return false;
+	}
+	grk_read<uint16_t>(buf, &marker);
+	if(marker != J2K_MS_SOC)
+	{
+		GRK_ERROR("Code stream does not begin with SOC marker");
+		return false;
+	}
+	bool hasSIZ = false, hasCOD = false, hasQCD = false;
+	uint64_t pos = offset + 2;
+	while(true)
+	{
+		if(end - pos < 2 || !read(pos, buf, 2))
+		{
+			GRK_ERROR("Truncated main header");
+			return false;
+		}
+		grk_read<uint16_t>(buf, &marker);
+		if(marker == J2K_MS_SOT)
+			break;
+		if(marker < 0xff00)
+		{
+			GRK_ERROR("Corrupt main header: expected marker, found 0x%x", marker);
+			return false;
+		}
+		uint16_t markerLen;
+		if(end - pos < 4 || !read(pos + 2, buf + 2, 2))
+		{
+			GRK_ERROR("Truncated main header");
+			return false;
+		}
+		grk_read<uint16_t>(buf + 2, &markerLen);
+		if(markerLen < 2 || markerLen > end - pos - 2)
+		{
+			GRK_ERROR("Marker 0x%x has bad length %u", marker, markerLen);
+			return false;
+		}
+		if(!hasSIZ && marker != J2K_MS_SIZ)
+		{
+			GRK_ERROR("SIZ marker must immediately follow SOC marker");
+			return false;
+		}
+		uint64_t segOffset = pos + 4;
+		uint16_t segLen = (uint16_t)(markerLen - 2);
+		switch(marker)
+		{
+			case J2K_MS_SIZ:
+				if(hasSIZ)
+				{
+					GRK_ERROR("Main header has more than one SIZ marker");
+					return false;
+				}
+				if(!readSIZ(segOffset, segLen, scan))
+					return false;
+				hasSIZ = true;
+				break;
+			case J2K_MS_COD:
+				if(!readCOD(segOffset, segLen, scan))
+					return false;
+				hasCOD = true;
+				break;
+			case J2K_MS_QCD:
+				if(segLen < 1 || !read(segOffset, buf, 1))
+				{
+					GRK_ERROR("Bad QCD marker");
+					return false;
+				}
+				scan->qntsty = buf[0] & 0x1f;
+				scan->numgbits = buf[0] >> 5;
+				hasQCD = true;
+				break;
+			case J2K_MS_TLM:
+				scan->has_tlm = true;
+				break;
+			case J2K_MS_PLM:
+				scan->has_plm = true;
+				break;
+			case J2K_MS_PPM:
+				scan->has_ppm = true;
+				break;
+			case J2K_MS_COM:
+				scan->num_comments++;
+				break;
+			default:
+				break;
+		}
+		pos += 2 + (uint64_t)markerLen;
+	}
+	if(!hasSIZ || !hasCOD || !hasQCD)
+	{
+		GRK_ERROR("Main header is missing %s marker", !hasSIZ ? "SIZ" : (!hasCOD ? "COD" : "QCD"));
+		return false;
+	}
+	scan->main_header_len = pos - offset;
+
+	return true;
+}
+bool HeaderScanner::readSIZ(uint64_t offset, uint16_t len, grk_header_scan* scan)
+{
+	uint8_t buf[sizFixedLength + 3 * GRK_HEADER_SCAN_MAX_COMPS];
+	if(len < sizFixedLength || !read(offset, buf, sizFixedLength))
+	{
+		GRK_ERROR("Bad SIZ marker");
+		return false;
+	}
+	auto ptr = buf;
+	grk_read<uint16_t>(ptr, &scan->rsiz);
+	ptr += 2;
+	grk_read<uint32_t>(ptr, &scan->x1);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->y1);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->x0);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->y0);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->t_width);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->t_height);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->tx0);
+	ptr += 4;
+	grk_read<uint32_t>(ptr, &scan->ty0);
+	ptr += 4;
+	grk_read<uint16_t>(ptr, &scan->numcomps);
+	ptr += 2;
+	if(scan->numcomps == 0 || scan->numcomps > maxNumComponentsJ2K ||
+	   len != sizFixedLength + 3U * scan->numcomps)
+	{
+		GRK_ERROR("Bad SIZ marker: %u components", scan->numcomps);
+		return false;
+	}
+	if(scan->x0 >= scan->x1 || scan->y0 >= scan->y1)
+	{
+		GRK_ERROR("Bad SIZ marker: image bounds (%u,%u,%u,%u)", scan->x0, scan->y0, scan->x1,
+				  scan->y1);
+		return false;
+	}
+	if(!scan->t_width || !scan->t_height || scan->tx0 > scan->x0 || scan->ty0 > scan->y0 ||
+	   (uint64_t)scan->tx0 + scan->t_width <= scan->x0 ||
+	   (uint64_t)scan->ty0 + scan->t_height <= scan->y0)
+	{
+		GRK_ERROR("Bad SIZ marker: tile grid");
+		return false;
+	}
+	scan->t_grid_width = ceildiv<uint32_t>(scan->x1 - scan->tx0, scan->t_width);
+	scan->t_grid_height = ceildiv<uint32_t>(scan->y1 - scan->ty0, scan->t_height);
+	uint16_t numComps = std::min<uint16_t>(scan->numcomps, GRK_HEADER_SCAN_MAX_COMPS);
+	if(!read(offset + sizFixedLength, ptr, 3U * numComps))
+	{
+		GRK_ERROR("Bad SIZ marker");
+		return false;
+	}
+	for(uint16_t i = 0; i < numComps; ++i)
+	{
+		auto comp = scan->comps + i;
+		comp->prec = (uint8_t)((ptr[0] & 0x7f) + 1);
+		comp->sgnd = (ptr[0] >> 7) != 0;
+		comp->dx = ptr[1];
+		comp->dy = ptr[2];
+		if(!comp->dx || !comp->dy)
+		{
+			GRK_ERROR("Bad SIZ marker: component %u has zero subsampling factor", i);
+			return false;
+		}
+		ptr += 3;
+	}
+
+	return true;
+}
+bool HeaderScanner::readCOD(uint64_t offset, uint16_t len, grk_header_scan* scan)
+{
+	uint8_t buf[codFixedLength];
+	if(len < codFixedLength || !read(offset, buf, codFixedLength))
+	{
+		GRK_ERROR("Bad COD marker");
+		return false;
+	}
+	scan->csty = buf[0];
+	if(buf[1] >= GRK_NUM_PROGRESSION_ORDERS)
+	{
+		GRK_ERROR("Bad COD marker: unknown progression order %u", buf[1]);
+		return false;
+	}
+	scan->prog_order = (GRK_PROG_ORDER)buf[1];
+	grk_read<uint16_t>(buf + 2, &scan->numlayers);
+	scan->mct = buf[4];
+	if(!scan->numlayers || buf[5] > GRK_J2K_MAX_DECOMP_LVLS)
+	{
+		GRK_ERROR("Bad COD marker");
+		return false;
+	}
+	scan->numresolutions = (uint8_t)(buf[5] + 1);
+	// code block width and height exponents, each offset by 2
+	if(buf[6] > 8 || buf[7] > 8 || buf[6] + buf[7] > 8)
+	{
+		GRK_ERROR("Bad COD marker: code block dimensions");
+		return false;
+	}
+	scan->cblockw = 1U << (buf[6] + 2);
+	scan->cblockh = 1U << (buf[7] + 2);
+	scan->cblk_sty = buf[8];
+	scan->irreversible = buf[9] == 0;
+
+	return true;
+}
+
+} // namespace grk
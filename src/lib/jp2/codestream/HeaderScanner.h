@@ -0,0 +1,70 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+#pragma once
+
+namespace grk
+{
+/*  HeaderScanner
+
+ Lightweight scanner for a file's JP2 boxes and J2K main header.
+ Rather than creating a codec with a buffered stream, the scanner makes
+ small positional reads through a fixed window, skipping over box and
+ marker payloads that it does not need, and stops at the first SOT marker.
+ It performs no heap allocation, so many files can be scanned concurrently,
+ one scanner per thread.
+ */
+class HeaderScanner
+{
+  public:
+	HeaderScanner(void);
+	~HeaderScanner(void);
+	/**
+	 * Scan file
+	 *
+	 * @param fname	file name
+	 * @param scan	scan results
+	 *
+	 * @return true if the main header was successfully scanned
+	 */
+	bool scan(const char* fname, grk_header_scan* scan);
+
+  private:
+	bool open(const char* fname);
+	void close(void);
+	bool read(uint64_t offset, uint8_t* dest, size_t len);
+	size_t readAt(uint64_t offset, uint8_t* dest, size_t len);
+	bool readBoxHeader(uint64_t offset, uint64_t end, uint32_t* type, uint64_t* headerLen,
+					   uint64_t* boxLen);
+	bool readBoxes(grk_header_scan* scan);
+	bool readJP2Header(uint64_t offset, uint64_t end, grk_header_scan* scan);
+	bool readColour(uint64_t offset, uint64_t len, grk_header_scan* scan);
+	bool readResolution(uint64_t offset, uint64_t end, grk_header_scan* scan);
+	bool readMainHeader(uint64_t offset, uint64_t end, grk_header_scan* scan);
+	bool readSIZ(uint64_t offset, uint16_t len, grk_header_scan* scan);
+	bool readCOD(uint64_t offset, uint16_t len, grk_header_scan* scan);
+
+	static const size_t windowSize = 4096;
+	grk_handle m_fd;
+	bool m_isOpen;
+	uint64_t m_fileSize;
+	uint8_t m_window[windowSize];
+	uint64_t m_windowOffset;
+	size_t m_windowLen;
+};
+
+} // namespace grk
@@ -23,23 +23,29 @@
 
 namespace grk
 {
+uint32_t Quantizer::getBandGain(uint8_t orientation)
+{
+	/* Table E-1 - Sub-band gains */
+	return (orientation == BAND_ORIENT_LL) ? 0 : (orientation == BAND_ORIENT_HH) ? 2 : 1;
+}
+float Quantizer::getBandStepSize(const grk_stepsize* stepSize, uint32_t numbps)
+{
+	return (float)(((1.0 + stepSize->mant / 2048.0) *
+					pow(2.0, (int32_t)(numbps - stepSize->expn))));
+}
 bool Quantizer::setBandStepSizeAndBps(TileCodingParams* tcp, Subband* band, uint32_t resno,
 									  uint8_t bandIndex, TileComponentCodingParams* tccp,
 									  uint8_t image_precision, bool compress)
 {
-	/* Table E-1 - Sub-band gains */
 	/* BUG_WEIRD_TWO_INVK (look for this identifier in dwt.c): */
 	/* the test (!isEncoder && l_tccp->qmfbid == 0) is strongly */
 	/* linked to the use of two_invK instead of invK */
-	const uint32_t log2_gain = (!compress && tccp->qmfbid == 0) ? 0
-							   : (band->orientation == 0)		? 0
-							   : (band->orientation == 3)		? 2
-																: 1;
+	const uint32_t log2_gain =
+		(!compress && tccp->qmfbid == 0) ? 0 : getBandGain(band->orientation);
 	uint32_t numbps = image_precision + log2_gain;
 	auto offset = (resno == 0) ? 0 : 3 * resno - 2;
 	auto step_size = tccp->stepsizes + offset + bandIndex;
-	band->stepsize =
-		(float)(((1.0 + step_size->mant / 2048.0) * pow(2.0, (int32_t)(numbps - step_size->expn))));
+	band->stepsize = getBandStepSize(step_size, numbps);
 	// printf("res=%d, band=%d, mant=%d,expn=%d, numbps=%d, step size=
 	// %f\n",resno,band->orientation,step_size->mant,step_size->expn,numbps, band->stepsize);
 
@@ -44,6 +44,20 @@ struct TileCodingParams;
 class Quantizer
 {
   public:
+	/**
+	 * Get log2 of the nominal gain of a sub-band (Table E-1)
+	 *
+	 * @param orientation	band orientation
+	 */
+	static uint32_t getBandGain(uint8_t orientation);
+	/**
+	 * Get the step size signalled for a sub-band, relative to a dynamic range
+	 *
+	 * @param stepSize	signalled exponent and mantissa
+	 * @param numbps	nominal dynamic range of the band: image precision plus
+	 * log2 of the band gain
+	 */
+	static float getBandStepSize(const grk_stepsize* stepSize, uint32_t numbps);
 	bool setBandStepSizeAndBps(TileCodingParams* tcp, Subband* band, uint32_t resno,
 							   uint8_t bandIndex, TileComponentCodingParams* tccp,
 							   uint8_t image_precision, bool compress);
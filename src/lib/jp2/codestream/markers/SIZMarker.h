@@ -47,7 +47,12 @@ class SIZMarker
 	 */
 	bool write(CodeStreamCompress* codeStream, IBufferedStream* stream);
 
-  private:
+	/**
+	 * Apply resolution reduction to header image components
+	 *
+	 * @param headerImage	header image
+	 * @param p_cp			the coding parameters from which to update the image.
+	 */
 	void subsampleAndReduceHeaderImageComponents(GrkImage* headerImage, const CodingParams* p_cp);
 };
 
@@ -103,13 +103,18 @@
 #include "GrkObjectWrapper.h"
 #include "logger.h"
 #include "testing.h"
+#include "Tracer.h"
+#include "MemoryBudget.h"
 #include "ThreadPool.hpp"
 #include "MemStream.h"
 #include "GrkMappedFile.h"
+#include "GrkUringFile.h"
+#include "ChunkedMemStream.h"
 #include "GrkMatrix.h"
 #include "GrkImage.h"
 #include "grk_exceptions.h"
 #include "SparseBuffer.h"
+#include "Deadline.h"
 #include "BitIO.h"
 #include "BufferedStream.h"
 #include "Quantizer.h"
@@ -126,6 +131,7 @@
 #include "FileFormat.h"
 #include "FileFormatCompress.h"
 #include "FileFormatDecompress.h"
+#include "HeaderScanner.h"
 #include "BitIO.h"
 #include "TagTree.h"
 #include "t1_common.h"
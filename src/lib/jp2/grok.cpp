@@ -74,7 +74,12 @@ std::mutex ThreadPool::singleton_mutex;
 static bool is_plugin_initialized = false;
 bool GRK_CALLCONV grk_initialize(const char* pluginPath, uint32_t numthreads)
 {
-	ThreadPool::instance(numthreads);
+	return grk_initialize_ex(pluginPath, numthreads, GRK_THREAD_AFFINITY_CORE);
+}
+bool GRK_CALLCONV grk_initialize_ex(const char* pluginPath, uint32_t numthreads,
+									GRK_THREAD_AFFINITY affinity)
+{
+	ThreadPool::instance(numthreads, affinity);
 	if(!is_plugin_initialized)
 	{
 		grk_plugin_load_info info;
@@ -84,6 +89,28 @@ bool GRK_CALLCONV grk_initialize(const char* pluginPath, uint32_t numthreads)
 
 	return is_plugin_initialized;
 }
+void GRK_CALLCONV grk_set_num_threads(uint32_t numthreads)
+{
+	ThreadPool::resize(numthreads);
+}
+
+void GRK_CALLCONV grk_set_memory_budget(uint64_t max_bytes)
+{
+	MemoryBudget::get()->setLimit(max_bytes);
+}
+void GRK_CALLCONV grk_get_memory_stats(grk_memory_stats* stats)
+{
+	if(!stats)
+		return;
+	MemoryBudget::get()->getStats(stats);
+}
+bool GRK_CALLCONV grk_scan_header(const char* fname, grk_header_scan* scan)
+{
+	if(!fname || !scan)
+		return false;
+	HeaderScanner scanner;
+	return scanner.scan(fname, scan);
+}
 
 GRK_API void GRK_CALLCONV grk_deinitialize()
 {
@@ -154,6 +181,27 @@ static bool grk_seek_in_file(int64_t numBytes, FILE* p_user_data)
 {
 	return GRK_FSEEK(p_user_data, numBytes, SEEK_SET) ? false : true;
 }
+#ifndef _WIN32
+static bool grk_write_at_file(const uint8_t* buffer, size_t numBytes, uint64_t offset,
+							  FILE* p_file)
+{
+	// bytes still buffered by the FILE must reach the file first
+	if(fflush(p_file))
+		return false;
+	int fd = fileno(p_file);
+	while(numBytes)
+	{
+		auto written = pwrite(fd, buffer, numBytes, (off_t)offset);
+		if(written <= 0)
+			return false;
+		buffer += written;
+		offset += (uint64_t)written;
+		numBytes -= (size_t)written;
+	}
+
+	return true;
+}
+#endif
 
 /* ---------------------------------------------------------------------- */
 
@@ -315,7 +363,25 @@ bool GRK_CALLCONV grk_decompress_end(grk_codec* codecWrapper)
 	}
 	return false;
 }
-
+void GRK_CALLCONV grk_decompress_cancel(grk_codec* codecWrapper)
+{
+	if(codecWrapper)
+	{
+		auto codec = GrkCodec::getImpl(codecWrapper);
+		if(codec->m_decompressor)
+			codec->m_decompressor->getCodeStream()->getDeadline()->cancel();
+	}
+}
+bool GRK_CALLCONV grk_decompress_was_interrupted(grk_codec* codecWrapper)
+{
+	if(codecWrapper)
+	{
+		auto codec = GrkCodec::getImpl(codecWrapper);
+		if(codec->m_decompressor)
+			return codec->m_decompressor->getCodeStream()->getDeadline()->interrupted();
+	}
+	return false;
+}
 void GRK_CALLCONV grk_dump_codec(grk_codec* codecWrapper, uint32_t info_flag, FILE* output_stream)
 {
 	assert(codecWrapper);
@@ -327,6 +393,54 @@ void GRK_CALLCONV grk_dump_codec(grk_codec* codecWrapper, uint32_t info_flag, FI
 	}
 }
 
+bool GRK_CALLCONV grk_trace_enabled(void)
+{
+#ifdef GROK_HAVE_TRACE
+	return true;
+#else
+	return false;
+#endif
+}
+bool GRK_CALLCONV grk_trace_get_stats(grk_trace_stats* stats)
+{
+	if(!stats)
+		return false;
+	memset(stats, 0, sizeof(grk_trace_stats));
+#ifdef GROK_HAVE_TRACE
+	Tracer::get()->getStats(stats);
+	return true;
+#else
+	return false;
+#endif
+}
+size_t GRK_CALLCONV grk_trace_get_events(grk_trace_event* events, size_t max_events)
+{
+#ifdef GROK_HAVE_TRACE
+	return Tracer::get()->getEvents(events, max_events);
+#else
+	GRK_UNUSED(events);
+	GRK_UNUSED(max_events);
+	return 0;
+#endif
+}
+bool GRK_CALLCONV grk_trace_write_chrome_json(const char* file_name)
+{
+	if(!file_name)
+		return false;
+#ifdef GROK_HAVE_TRACE
+	return Tracer::get()->writeChromeTrace(file_name);
+#else
+	GRK_WARN("Unable to write trace file %s: library was built without tracing", file_name);
+	return false;
+#endif
+}
+void GRK_CALLCONV grk_trace_reset(void)
+{
+#ifdef GROK_HAVE_TRACE
+	Tracer::get()->reset();
+#endif
+}
+
 bool GRK_CALLCONV grk_set_MCT(grk_cparameters* parameters, float* pEncodingMatrix,
 							  int32_t* p_dc_shift, uint32_t pNbComp)
 {
@@ -488,6 +602,67 @@ bool GRK_CALLCONV grk_compress_tile(grk_codec* codecWrapper, uint16_t tileIndex,
 	return false;
 }
 
+bool GRK_CALLCONV grk_transcode(grk_codec* decompressCodec, grk_codec* compressCodec,
+								grk_cparameters* parameters)
+{
+	if(!decompressCodec || !compressCodec || !parameters)
+		return false;
+	auto decompressor = GrkCodec::getImpl(decompressCodec)->m_decompressor;
+	auto compressor = GrkCodec::getImpl(compressCodec)->m_compressor;
+	if(!decompressor || !compressor || !decompressor->readHeader(nullptr))
+		return false;
+	auto source = decompressor->getCodeStream();
+	auto dest = compressor->getCodeStream();
+	if(!source->initTranscode(parameters))
+		return false;
+	auto image = decompressor->getImage();
+	// a raw code stream carries no colour space, which a JP2 file requires
+	if(image->color_space == GRK_CLRSPC_UNKNOWN)
+		image->color_space = image->numcomps >= 3 ? GRK_CLRSPC_SRGB : GRK_CLRSPC_GRAY;
+	if(!compressor->initCompress(parameters, image))
+		return false;
+	if(!dest->initTranscode(source->getDecompressorState()->m_default_tcp, false))
+		return false;
+	if(!compressor->startCompress())
+		return false;
+	if(!source->decompressCoefficients(
+		   [dest](TileProcessor* tileProcessor) { return dest->compressTile(tileProcessor); }))
+		return false;
+
+	return compressor->endCompress();
+}
+bool GRK_CALLCONV grk_subset(grk_codec* decompressCodec, grk_codec* compressCodec,
+							 grk_cparameters* parameters)
+{
+	if(!decompressCodec || !compressCodec || !parameters)
+		return false;
+	auto decompressor = GrkCodec::getImpl(decompressCodec)->m_decompressor;
+	auto compressor = GrkCodec::getImpl(compressCodec)->m_compressor;
+	if(!decompressor || !compressor || !decompressor->readHeader(nullptr))
+		return false;
+	auto source = decompressor->getCodeStream();
+	auto dest = compressor->getCodeStream();
+	auto image = new GrkImage();
+	source->getHeaderImage()->copyHeader(image);
+	// a raw code stream carries no colour space, which a JP2 file requires
+	if(image->color_space == GRK_CLRSPC_UNKNOWN)
+		image->color_space = image->numcomps >= 3 ? GRK_CLRSPC_SRGB : GRK_CLRSPC_GRAY;
+	bool rc = source->initSubset(parameters, image) && compressor->initCompress(parameters, image);
+	grk_object_unref(&image->obj);
+	if(!rc)
+		return false;
+	if(!dest->initTranscode(source->getDecompressorState()->m_default_tcp, true))
+		return false;
+	if(!compressor->startCompress())
+		return false;
+	if(!source->decompressPackets([dest](uint16_t tileIndex, PACKET_SPANS* packets) {
+		   return dest->copyTile(tileIndex, packets);
+	   }))
+		return false;
+
+	return compressor->endCompress();
+}
+
 static void grkFree_file(void* p_user_data)
 {
 	if(p_user_data)
@@ -528,6 +703,11 @@ grk_stream* GRK_CALLCONV grk_stream_create_file_stream(const char* fname, size_t
 	grk_stream_set_read_function(stream, (grk_stream_read_fn)grk_read_from_file);
 	grk_stream_set_write_function(stream, (grk_stream_write_fn)grk_write_to_file);
 	grk_stream_set_seek_function(stream, (grk_stream_seek_fn)grk_seek_in_file);
+#ifndef _WIN32
+	if(!is_read_stream && !stdin_stdout)
+		BufferedStream::getImpl(stream)->setWriteAtFunction(
+			(grk_stream_write_at_fn)grk_write_at_file);
+#endif
 	return stream;
 }
 /* ---------------------------------------------------------------------- */
@@ -542,6 +722,15 @@ grk_stream* GRK_CALLCONV grk_stream_create_mem_stream(uint8_t* buf, size_t len,
 {
 	return create_mem_stream(buf, len, ownsBuffer, is_read_stream);
 }
+grk_stream* GRK_CALLCONV grk_stream_create_chunked_mem_stream(size_t chunk_size)
+{
+	return create_chunked_mem_write_stream(chunk_size);
+}
+size_t GRK_CALLCONV grk_stream_get_chunks(grk_stream* stream, grk_stream_chunk* chunks,
+										  size_t max_chunks)
+{
+	return get_chunked_mem_stream_chunks(stream, chunks, max_chunks);
+}
 grk_stream* GRK_CALLCONV grk_stream_create_mapped_file_stream(const char* fname, bool read_stream)
 {
 	if(read_stream)
@@ -549,6 +738,12 @@ grk_stream* GRK_CALLCONV grk_stream_create_mapped_file_stream(const char* fname,
 	else
 		return create_mapped_file_write_stream(fname);
 }
+grk_stream* GRK_CALLCONV grk_stream_create_uring_file_stream(const char* fname,
+															 size_t buffer_size,
+															 uint32_t queue_depth)
+{
+	return create_uring_file_read_stream(fname, buffer_size, queue_depth);
+}
 /* ---------------------------------------------------------------------- */
 
 /**********************************************************************
@@ -369,6 +369,62 @@ typedef enum GRK_TILE_CACHE_STRATEGY
 	GRK_TILE_CACHE_ALL,
 } GRK_TILE_CACHE_STRATEGY;
 
+/**
+ * Thread affinity policy for the library thread pool
+ */
+typedef enum _GRK_THREAD_AFFINITY
+{
+	GRK_THREAD_AFFINITY_NONE, /**< threads are not pinned */
+	GRK_THREAD_AFFINITY_CORE, /**< thread i is pinned to CPU i (default) */
+	/** threads are spread evenly over NUMA nodes, and pinned to the CPUs of their node.
+	 * Each tile is processed, and its buffers allocated, on a single node. Linux only */
+	GRK_THREAD_AFFINITY_NUMA
+} GRK_THREAD_AFFINITY;
+
+/**
+ * Codec stages timed by the built-in tracer
+ */
+typedef enum _GRK_TRACE_STAGE
+{
+	GRK_TRACE_STAGE_T2, /**< packet parsing / packet writing */
+	GRK_TRACE_STAGE_T1, /**< code block decoding / encoding */
+	GRK_TRACE_STAGE_DWT, /**< wavelet transform */
+	GRK_TRACE_STAGE_MCT, /**< multi-component transform */
+	GRK_TRACE_STAGE_DC_SHIFT, /**< DC level shift */
+	GRK_TRACE_STAGE_RATE_CONTROL, /**< rate control (compress only) */
+	GRK_TRACE_STAGE_PRECISION, /**< output precision change (decompress only) */
+	GRK_TRACE_STAGE_COMPOSITE, /**< compositing of tile into output image (decompress only) */
+	GRK_TRACE_STAGE_COUNT
+} GRK_TRACE_STAGE;
+
+/**
+ * Timed stage event recorded by the built-in tracer
+ */
+typedef struct _grk_trace_event
+{
+	GRK_TRACE_STAGE stage;
+	uint16_t tileIndex;
+	int32_t compno; /* component number, or -1 if event covers all components */
+	uint32_t thread; /* 0 for calling thread, otherwise thread pool worker number + 1 */
+	uint64_t startUs; /* start time in microseconds, relative to last trace reset */
+	uint64_t durationUs; /* duration in microseconds */
+} grk_trace_event;
+
+/**
+ * Totals collected by the built-in tracer since the last trace reset
+ */
+typedef struct _grk_trace_stats
+{
+	uint64_t stageUs[GRK_TRACE_STAGE_COUNT]; /* total time spent in each stage, in microseconds */
+	uint64_t numCodeBlocks; /* number of code blocks decoded or encoded */
+	uint64_t bytesParsed; /* number of compressed bytes parsed by T2 */
+	uint64_t numAllocations; /* number of heap allocations */
+	uint64_t bytesAllocated; /* number of heap bytes allocated */
+	uint64_t threadIdleUs; /* total time thread pool workers spent waiting for work */
+	uint64_t numEvents; /* number of events recorded */
+	uint64_t numDroppedEvents; /* number of events not recorded because event buffer was full */
+} grk_trace_stats;
+
 /**
  * Callback function prototype for logging
  *
@@ -710,6 +766,37 @@ typedef struct _grk_header_info
 
 } grk_header_info;
 
+/**
+ * Callback function prototype for resolution-progressive previews
+ *
+ * @param tileIndex         index of tile
+ * @param reduce            number of highest resolutions not yet reconstructed
+ * @param image             tile reconstructed at this resolution: the image is owned by
+ * 							the library and is only valid for the duration of the call
+ * @param user_data         user data
+ * */
+struct _grk_image;
+typedef void (*grk_decompress_preview_fn)(uint16_t tileIndex, uint8_t reduce,
+										  struct _grk_image* image, void* user_data);
+
+/**
+ * Precision mode
+ */
+typedef enum grk_prec_mode
+{
+	GRK_PREC_MODE_CLIP,
+	GRK_PREC_MODE_SCALE
+} grk_precision_mode;
+
+/**
+ * Precision
+ */
+typedef struct _grk_prec
+{
+	uint8_t prec;
+	grk_precision_mode mode;
+} grk_precision;
+
 /**
  * Core decompress parameters
  * */
@@ -727,7 +814,13 @@ typedef struct _grk_dparameters
 	 Set the maximum number of quality layers to decompress.
 	 If there are fewer quality layers than the specified number, all quality layers will be
 	 decompressed. if != 0, then only the first "layer" layers are decompressed; if == 0 or not
-	 used, all the quality layers are decompressed
+	 used, all the quality layers are decompressed.
+	 After a decompress, this value may be changed with grk_decompress_init, and
+	 the next call to grk_decompress will refine the cached tiles: only packets from additional
+	 layers are read, and only code blocks with new coding passes are decompressed again.
+	 Incremental refinement only applies to MQ (Part 1) code blocks: HTJ2K code blocks do not
+	 track decompressed passes, so they are always decompressed again. Cached tile images are
+	 only reused if the reduction and output precision are also unchanged.
 	 */
 	uint16_t cp_layer;
 	/** input file name */
@@ -754,26 +847,40 @@ typedef struct _grk_dparameters
 	uint32_t nb_tile_to_decompress;
 	uint32_t flags;
 	GRK_TILE_CACHE_STRATEGY tileCacheStrategy;
+	/**
+	 If non-zero, whole tiles are decompressed in horizontal strips of this many
+	 rows (at the decompressed resolution). Only the wavelet coefficients needed for
+	 the current strip are held in memory; code blocks that straddle two strips are
+	 decompressed once and kept until the second strip is done. The output image
+	 still holds the whole tile. Zero disables strip decompression.
+	 */
+	uint32_t dwtStripHeight;
+	/**
+	 If non-zero, each call to grk_decompress or grk_decompress_tile is limited to roughly
+	 this many milliseconds: once the budget is spent, no more packets are read and
+	 no more code blocks are decompressed, and the image is reconstructed from
+	 what has been decoded so far. See grk_decompress_was_interrupted.
+	 */
+	uint32_t timeBudgetMs;
+	/**
+	 If set, then while each whole tile is decompressed, this callback receives the tile
+	 reconstructed at every intermediate resolution (after inverse MCT and DC level shift),
+	 lowest resolution first. Ignored for windowed or strip decompression.
+	 */
+	grk_decompress_preview_fn previewCallback;
+	/** user data passed to previewCallback */
+	void* previewUserData;
+	/**
+	 * output precision for each component, applied to each tile by its worker
+	 * thread after DC level shift. If there are fewer entries than components,
+	 * the last entry is used for the remaining components. Ignored for images
+	 * with a palette.
+	 */
+	grk_precision* precision;
+	/** number of entries in precision array; zero disables precision change */
+	uint32_t numPrecision;
 } grk_dparameters;
 
-/**
- * Precision mode
- */
-typedef enum grk_prec_mode
-{
-	GRK_PREC_MODE_CLIP,
-	GRK_PREC_MODE_SCALE
-} grk_precision_mode;
-
-/**
- * Precision
- */
-typedef struct _grk_prec
-{
-	uint8_t prec;
-	grk_precision_mode mode;
-} grk_precision;
-
 #define GRK_DECOMPRESS_COMPRESSION_LEVEL_DEFAULT (UINT_MAX)
 
 /**
@@ -1089,6 +1196,138 @@ GRK_API const char* GRK_CALLCONV grk_version(void);
  */
 GRK_API bool GRK_CALLCONV grk_initialize(const char* pluginPath, uint32_t numthreads);
 
+/**
+ * Initialize library, with thread affinity policy. Affinity only takes effect
+ * on the first initialization, when the thread pool is created.
+ *
+ * @param pluginPath 	path to plugin
+ * @param numthreads 	number of threads to use for compress/decompress
+ * @param affinity 		thread affinity policy
+ */
+GRK_API bool GRK_CALLCONV grk_initialize_ex(const char* pluginPath, uint32_t numthreads,
+											GRK_THREAD_AFFINITY affinity);
+
+/**
+ * Resize library thread pool. The pool keeps its thread affinity policy, and the
+ * plugin stays loaded. Must not be called while compressing or decompressing.
+ *
+ * @param numthreads 	number of threads to use for compress/decompress;
+ * 0 for hardware concurrency
+ */
+GRK_API void GRK_CALLCONV grk_set_num_threads(uint32_t numthreads);
+
+/**
+ * Process-wide memory statistics. Heap bytes are only tracked while a budget
+ * is set, and are counted from the time it was set.
+ */
+typedef struct _grk_memory_stats
+{
+	uint64_t budget; /* memory budget in bytes, or zero if there is no limit */
+	uint64_t liveBytes; /* heap bytes currently allocated by library */
+	uint64_t peakBytes; /* peak heap bytes allocated by library */
+	uint64_t reservedBytes; /* bytes reserved by tiles in flight */
+	uint64_t numThrottledTiles; /* number of tiles that waited for budget */
+} grk_memory_stats;
+
+/**
+ * Set process-wide memory budget, shared by all codecs. When the budget is
+ * exhausted, tiles wait for tiles in flight to complete before starting,
+ * down to one tile at a time.
+ *
+ * @param max_bytes 	maximum number of bytes, or zero for no limit
+ */
+GRK_API void GRK_CALLCONV grk_set_memory_budget(uint64_t max_bytes);
+
+/**
+ * Get process-wide memory statistics
+ *
+ * @param stats 	pointer to stats struct
+ */
+GRK_API void GRK_CALLCONV grk_get_memory_stats(grk_memory_stats* stats);
+
+#define GRK_HEADER_SCAN_MAX_COMPS 4
+
+/**
+ * Header scan component info
+ */
+typedef struct _grk_header_scan_comp
+{
+	uint8_t dx; /* XRsiz */
+	uint8_t dy; /* YRsiz */
+	uint8_t prec; /* precision */
+	bool sgnd; /* signed */
+} grk_header_scan_comp;
+
+/**
+ * Compact summary of a JPEG 2000 file's main header and JP2 boxes,
+ * filled in by grk_scan_header
+ */
+typedef struct _grk_header_scan
+{
+	GRK_CODEC_FORMAT format;
+	uint64_t file_size;
+	/** SIZ */
+	uint16_t rsiz;
+	uint32_t x0;
+	uint32_t y0;
+	uint32_t x1;
+	uint32_t y1;
+	uint32_t tx0;
+	uint32_t ty0;
+	uint32_t t_width;
+	uint32_t t_height;
+	uint32_t t_grid_width;
+	uint32_t t_grid_height;
+	uint16_t numcomps;
+	/** first GRK_HEADER_SCAN_MAX_COMPS components */
+	grk_header_scan_comp comps[GRK_HEADER_SCAN_MAX_COMPS];
+	/** COD */
+	uint8_t csty;
+	GRK_PROG_ORDER prog_order;
+	uint16_t numlayers;
+	uint8_t mct;
+	uint8_t numresolutions;
+	uint32_t cblockw;
+	uint32_t cblockh;
+	uint8_t cblk_sty;
+	bool irreversible;
+	/** QCD */
+	uint8_t qntsty;
+	uint8_t numgbits;
+	/** other main header markers */
+	bool has_tlm;
+	bool has_plm;
+	bool has_ppm;
+	uint32_t num_comments;
+	/** offset of first SOT marker, relative to start of code stream */
+	uint64_t main_header_len;
+	/** JP2 boxes */
+	uint64_t codestream_offset; /* offset of code stream in file */
+	bool has_colr;
+	uint8_t colr_meth;
+	GRK_ENUM_COLOUR_SPACE enumcs;
+	uint32_t icc_profile_len;
+	bool has_capture_resolution;
+	double capture_resolution[2];
+	bool has_display_resolution;
+	double display_resolution[2];
+	/** first top-level XML box, whose contents can be read directly from the file */
+	uint64_t xml_offset;
+	uint64_t xml_len;
+} grk_header_scan;
+
+/**
+ * Scan a JPEG 2000 file's main header and JP2 boxes, without creating a codec.
+ * Only the header bytes are read from the file, and nothing is allocated
+ * on the heap, so the function can be called on many files concurrently.
+ *
+ * @param fname		file name of J2K or JP2 file
+ * @param scan		pointer to scan struct
+ *
+ * @return true if the main header was successfully scanned
+ */
+GRK_API bool GRK_CALLCONV grk_scan_header(const char* fname, grk_header_scan* scan);
+
 /**
  * De-initialize library
  */
@@ -1241,6 +1480,41 @@ GRK_API grk_stream* GRK_CALLCONV grk_stream_create_mem_stream(uint8_t* buf, size
  */
 GRK_API size_t GRK_CALLCONV grk_stream_get_write_mem_stream_length(grk_stream* stream);
 
+/**
+ * Chunk of a chunked memory stream. Its layout matches struct iovec,
+ * so an array of chunks can be passed directly to writev or sendmsg
+ */
+typedef struct _grk_stream_chunk
+{
+	void* data;
+	size_t len;
+} grk_stream_chunk;
+
+/**
+ * Create growable memory write stream. Bytes are stored in fixed size chunks,
+ * allocated as the stream grows, so no worst-case output buffer is needed.
+ * When the stream is destroyed, its chunks are recycled by later chunked streams.
+ *
+ * @param chunk_size	size of each chunk: zero selects the default of 1 MB
+ *
+ * @return stream
+ */
+GRK_API grk_stream* GRK_CALLCONV grk_stream_create_chunked_mem_stream(size_t chunk_size);
+
+/**
+ * Get contents of chunked memory stream as a scatter-gather list, without copying.
+ * Chunks are owned by the stream, and remain valid until the stream is destroyed.
+ *
+ * @param stream		stream created with grk_stream_create_chunked_mem_stream
+ * @param chunks		array to fill with chunks (may be null, to query number of chunks)
+ * @param max_chunks	number of entries in chunks array
+ *
+ * @return total number of chunks in stream, or zero if stream is not
+ * a chunked memory stream
+ */
+GRK_API size_t GRK_CALLCONV grk_stream_get_chunks(grk_stream* stream, grk_stream_chunk* chunks,
+												  size_t max_chunks);
+
 /**
  * Create mapped file stream
  *
@@ -1250,6 +1524,21 @@ GRK_API size_t GRK_CALLCONV grk_stream_get_write_mem_stream_length(grk_stream* s
 GRK_API grk_stream* GRK_CALLCONV grk_stream_create_mapped_file_stream(const char* fname,
 																	  bool read_stream);
 
+/**
+ * Create io_uring file read stream. Blocks of the file are read asynchronously
+ * ahead of the decompressor, following tile part positions from TLM and SOT markers
+ * when available. Only supported on Linux builds with io_uring enabled.
+ *
+ * @param fname			file name
+ * @param buffer_size 	size of each read-ahead block
+ * @param queue_depth 	maximum number of blocks in flight
+ *
+ * @return stream if successful, otherwise nullptr
+ */
+GRK_API grk_stream* GRK_CALLCONV grk_stream_create_uring_file_stream(const char* fname,
+																	 size_t buffer_size,
+																	 uint32_t queue_depth);
+
 /**
  * Create J2K/JP2 decompression structure
  *
@@ -1352,6 +1641,25 @@ GRK_API bool GRK_CALLCONV grk_decompress_tile(grk_codec* codec, uint16_t tileInd
  */
 GRK_API bool GRK_CALLCONV grk_decompress_end(grk_codec* codec);
 
+/**
+ * Cancel decompression from another thread. The decompress that is running, or the
+ * next one if none is running, stops reading packets and decompressing code blocks,
+ * and returns an image reconstructed from the data decoded so far.
+ *
+ * @param	codec	decompression codec
+ */
+GRK_API void GRK_CALLCONV grk_decompress_cancel(grk_codec* codec);
+
+/**
+ * Check whether the last decompress was cut short, by its time budget
+ * or by grk_decompress_cancel, and so returned a lower quality image
+ *
+ * @param	codec	decompression codec
+ *
+ * @return	true if decompress was interrupted
+ */
+GRK_API bool GRK_CALLCONV grk_decompress_was_interrupted(grk_codec* codec);
+
 /* COMPRESSION FUNCTIONS*/
 
 /**
@@ -1450,6 +1758,49 @@ GRK_API bool GRK_CALLCONV grk_compress_with_plugin(grk_codec* codec, grk_plugin_
  */
 GRK_API bool GRK_CALLCONV grk_compress_end(grk_codec* codec);
 
+/**
+ * Transcode a JPEG 2000 code stream between the Part 1 and the HTJ2K block coders.
+ *
+ * Code blocks are decompressed to quantized wavelet coefficients, which are then
+ * re-coded with the target block coder: inverse and forward DWT, MCT and DC level shift
+ * are skipped. Tiling, decomposition levels, code block and precinct sizes, progression
+ * order and quantization are taken from the source code stream, and all coding passes
+ * are written into a single quality layer.
+ *
+ * @param	decompressCodec	decompressor handle for source code stream; all resolutions
+ * 							and layers must be decompressed
+ * @param	compressCodec	compressor handle created with grk_compress_create
+ * @param	parameters		compress parameters; set GRK_CBLKSTY_HT in cblk_sty
+ * 							to transcode to HTJ2K, otherwise the Part 1 block coder is used.
+ * 							Coding parameters taken from the source code stream
+ * 							are overwritten.
+ *
+ * @return	true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_transcode(grk_codec* decompressCodec, grk_codec* compressCodec,
+										grk_cparameters* parameters);
+
+/**
+ * Extract a subset of a JPEG 2000 code stream without decompressing it.
+ *
+ * Only packets belonging to the reduced resolutions, layers and decompress window
+ * set on the decompressor (see grk_decompress_init and grk_decompress_set_window)
+ * are kept: these are copied unchanged, so no T1, DWT or rate control is performed.
+ * Tiles that don't intersect the window are removed, and the image and tile
+ * geometry are re-written accordingly; precincts that don't intersect the window,
+ * inside the remaining tiles, are replaced by empty packets. Other coding parameters
+ * are taken from the source code stream.
+ *
+ * @param	decompressCodec	decompressor handle for source code stream
+ * @param	compressCodec	compressor handle created with grk_compress_create
+ * @param	parameters		compress parameters. Coding parameters taken from the
+ * 							source code stream are overwritten.
+ *
+ * @return	true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_subset(grk_codec* decompressCodec, grk_codec* compressCodec,
+									 grk_cparameters* parameters);
+
 /**
  * Dump codec information to file
  *
@@ -1460,6 +1811,49 @@ GRK_API bool GRK_CALLCONV grk_compress_end(grk_codec* codec);
  */
 GRK_API void GRK_CALLCONV grk_dump_codec(grk_codec* codec, uint32_t info_flag, FILE* output_stream);
 
+/**
+ * Check if the built-in tracer is available. Tracing is only compiled in
+ * when the library is built with the GRK_TRACE CMake option; otherwise
+ * all other trace functions do nothing.
+ *
+ * @return true if tracing is available
+ */
+GRK_API bool GRK_CALLCONV grk_trace_enabled(void);
+
+/**
+ * Get totals collected by the built-in tracer since the last reset
+ *
+ * @param	stats	stats to fill in
+ *
+ * @return true if tracing is available
+ */
+GRK_API bool GRK_CALLCONV grk_trace_get_stats(grk_trace_stats* stats);
+
+/**
+ * Get events recorded by the built-in tracer since the last reset
+ *
+ * @param	events		array of events to fill in, or nullptr to just query number of events
+ * @param	max_events	size of events array
+ *
+ * @return number of events recorded
+ */
+GRK_API size_t GRK_CALLCONV grk_trace_get_events(grk_trace_event* events, size_t max_events);
+
+/**
+ * Write events recorded by the built-in tracer to a Chrome trace JSON file,
+ * which can be viewed with chrome://tracing or Perfetto
+ *
+ * @param	file_name	JSON file name
+ *
+ * @return true if successful
+ */
+GRK_API bool GRK_CALLCONV grk_trace_write_chrome_json(const char* file_name);
+
+/**
+ * Discard all events and counters collected by the built-in tracer
+ */
+GRK_API void GRK_CALLCONV grk_trace_reset(void);
+
 /**
  * Set the MCT matrix to use.
  *
@@ -96,6 +96,63 @@ namespace HWY_NAMESPACE
 		}
 	};
 
+	class DecompressScaleUp
+	{
+	  public:
+		int32_t vtrans(std::vector<int32_t*> channels, std::vector<ShiftInfo> shiftInfo,
+					   size_t index, size_t chunkSize)
+		{
+			int32_t* GRK_RESTRICT chan0 = channels[0];
+			size_t begin = (size_t)index * chunkSize;
+			const HWY_FULL(int32_t) d;
+			const HWY_FULL(float) df;
+			auto vscale = Set(df, shiftInfo[0]._scale);
+			for(auto j = begin; j < begin + chunkSize; j += Lanes(d))
+			{
+				auto ni = NearestInt(ConvertTo(df, Load(d, chan0 + j)) * vscale);
+				Store(ni, d, chan0 + j);
+			}
+			return 0;
+		}
+		void trans(std::vector<int32_t*> channels, std::vector<ShiftInfo> shiftInfo, size_t i,
+				   size_t n)
+		{
+			int32_t* GRK_RESTRICT chan0 = channels[0];
+			float scale = shiftInfo[0]._scale;
+			for(; i < n; ++i)
+				chan0[i] = (int32_t)grk_lrintf((float)chan0[i] * scale);
+		}
+	};
+
+	class DecompressScaleDown
+	{
+	  public:
+		int32_t vtrans(std::vector<int32_t*> channels, std::vector<ShiftInfo> shiftInfo,
+					   size_t index, size_t chunkSize)
+		{
+			int32_t* GRK_RESTRICT chan0 = channels[0];
+			size_t begin = (size_t)index * chunkSize;
+			const HWY_FULL(int32_t) d;
+			int shift = shiftInfo[0]._shift;
+			// bias negative samples so that arithmetic shift truncates towards zero
+			auto vbias = Set(d, (int32_t)((1U << shift) - 1));
+			for(auto j = begin; j < begin + chunkSize; j += Lanes(d))
+			{
+				auto v = Load(d, chan0 + j);
+				Store(ShiftRightSame(v + (BroadcastSignBit(v) & vbias), shift), d, chan0 + j);
+			}
+			return 0;
+		}
+		void trans(std::vector<int32_t*> channels, std::vector<ShiftInfo> shiftInfo, size_t i,
+				   size_t n)
+		{
+			int32_t* GRK_RESTRICT chan0 = channels[0];
+			int32_t divisor = (int32_t)(1U << shiftInfo[0]._shift);
+			for(; i < n; ++i)
+				chan0[i] /= divisor;
+		}
+	};
+
 	class CompressRev
 	{
 	  public:
@@ -433,6 +490,18 @@ namespace HWY_NAMESPACE
 	{
 		return vscheduler<DecompressDcShiftRev>(channels, shiftInfo, n);
 	}
+
+	size_t hwy_decompress_scale_up(std::vector<int32_t*> channels, std::vector<ShiftInfo> shiftInfo,
+								   size_t n)
+	{
+		return vscheduler<DecompressScaleUp>(channels, shiftInfo, n);
+	}
+
+	size_t hwy_decompress_scale_down(std::vector<int32_t*> channels,
+									 std::vector<ShiftInfo> shiftInfo, size_t n)
+	{
+		return vscheduler<DecompressScaleDown>(channels, shiftInfo, n);
+	}
 } // namespace HWY_NAMESPACE
 } // namespace grk
 HWY_AFTER_NAMESPACE();
@@ -446,6 +515,8 @@ HWY_EXPORT(hwy_decompress_rev);
 HWY_EXPORT(hwy_decompress_irrev);
 HWY_EXPORT(hwy_decompress_dc_shift_irrev);
 HWY_EXPORT(hwy_decompress_dc_shift_rev);
+HWY_EXPORT(hwy_decompress_scale_up);
+HWY_EXPORT(hwy_decompress_scale_down);
 
 void mct::decompress_dc_shift_irrev(Tile* tile, GrkImage* image, TileComponentCodingParams* tccps,
 									uint32_t compno)
@@ -538,6 +609,52 @@ void mct::decompress_dc_shift_rev(Tile* tile, GrkImage* image, TileComponentCodi
 	HWY_DYNAMIC_DISPATCH(hwy_decompress_dc_shift_rev)({c0}, {ShiftInfo(_min, _max, shift)}, n);
 }
 
+void mct::decompress_precision(Tile* tile, GrkImage* image, uint32_t compno,
+								grk_precision precision)
+{
+	int32_t* GRK_RESTRICT c0 =
+		tile->comps[compno].getBuffer()->getHighestBufferResWindowREL()->getBuffer();
+	size_t n = (tile->comps + compno)->getBuffer()->stridedArea();
+	auto img_comp = image->comps + compno;
+	uint8_t prec = img_comp->prec;
+	if(precision.mode == GRK_PREC_MODE_SCALE)
+	{
+		if(precision.prec > prec)
+		{
+			// match the rounding of a scalar float multiply
+			int64_t oldMax =
+				img_comp->sgnd ? ((int64_t)1 << (prec - 1)) : ((int64_t)1 << prec) - 1;
+			int64_t newMax = img_comp->sgnd ? ((int64_t)1 << (precision.prec - 1))
+											: ((int64_t)1 << precision.prec) - 1;
+			float scale = (float)newMax / (float)oldMax;
+			HWY_DYNAMIC_DISPATCH(hwy_decompress_scale_up)
+			({c0}, {ShiftInfo(0, 0, 0, scale)}, n);
+		}
+		else
+		{
+			HWY_DYNAMIC_DISPATCH(hwy_decompress_scale_down)
+			({c0}, {ShiftInfo(0, 0, prec - precision.prec)}, n);
+		}
+	}
+	else if(precision.prec < prec)
+	{
+		// samples are already clamped to original precision by inverse dc shift
+		int32_t _min;
+		int32_t _max;
+		if(img_comp->sgnd)
+		{
+			_min = -(1 << (precision.prec - 1));
+			_max = (1 << (precision.prec - 1)) - 1;
+		}
+		else
+		{
+			_min = 0;
+			_max = (int32_t)(((int64_t)1 << precision.prec) - 1);
+		}
+		HWY_DYNAMIC_DISPATCH(hwy_decompress_dc_shift_rev)({c0}, {ShiftInfo(_min, _max, 0)}, n);
+	}
+}
+
 /* <summary> */
 /* Inverse reversible MCT. */
 /* </summary> */
@@ -577,6 +694,30 @@ void mct::decompress_rev(Tile* tile, GrkImage* image, TileComponentCodingParams*
 	  ShiftInfo(_min[2], _max[2], shift[2])},
 	 n);
 }
+void mct::decompress_channels(std::vector<int32_t*> channels, std::vector<ShiftInfo> shiftInfo,
+							  uint64_t n, bool reversible)
+{
+	if(channels.size() == 3)
+	{
+		if(reversible)
+		{
+			HWY_DYNAMIC_DISPATCH(hwy_decompress_rev)(channels, shiftInfo, n);
+		}
+		else
+		{
+			hwy::DisableTargets(uint32_t(~HWY_SCALAR));
+			HWY_DYNAMIC_DISPATCH(hwy_decompress_irrev)(channels, shiftInfo, n);
+		}
+	}
+	else if(reversible)
+	{
+		HWY_DYNAMIC_DISPATCH(hwy_decompress_dc_shift_rev)(channels, shiftInfo, n);
+	}
+	else
+	{
+		HWY_DYNAMIC_DISPATCH(hwy_decompress_dc_shift_irrev)(channels, shiftInfo, n);
+	}
+}
 /* <summary> */
 /* Forward reversible MCT. */
 /* </summary> */
@@ -24,11 +24,16 @@ namespace grk
 {
 struct ShiftInfo
 {
-	ShiftInfo(int32_t mn, int32_t mx, int32_t shift) : _min(mn), _max(mx), _shift(shift) {}
+	ShiftInfo(int32_t mn, int32_t mx, int32_t shift, float scale)
+		: _min(mn), _max(mx), _shift(shift), _scale(scale)
+	{}
+	ShiftInfo(int32_t mn, int32_t mx, int32_t shift) : ShiftInfo(mn, mx, shift, 1.0f) {}
 	ShiftInfo() : ShiftInfo(0, 0, 0) {}
 	int32_t _min;
 	int32_t _max;
 	int32_t _shift;
+	// precision scaling factor
+	float _scale;
 };
 
 class mct
@@ -123,6 +128,27 @@ class mct
 	 */
 	static void decompress_dc_shift_irrev(Tile* tile, GrkImage* image,
 										  TileComponentCodingParams* tccps, uint32_t compno);
+
+	/**
+	 Change precision of a tile component, in place, after inverse dc shift
+	 @param tile tile
+	 @param image image
+	 @param compno component number
+	 @param precision output precision and mode
+	 */
+	static void decompress_precision(Tile* tile, GrkImage* image, uint32_t compno,
+									 grk_precision precision);
+
+	/**
+	 Apply inverse MCT (three channels) or inverse dc shift (one channel)
+	 to samples stored outside of a tile, in place
+	 @param channels channel samples (float samples for irreversible transform)
+	 @param shiftInfo clamping range and dc shift for each channel
+	 @param n number of samples for each channel
+	 @param reversible true if reversible transform
+	 */
+	static void decompress_channels(std::vector<int32_t*> channels,
+									std::vector<ShiftInfo> shiftInfo, uint64_t n, bool reversible);
 };
 
 /* ----------------------------------------------------------------------- */
@@ -41,7 +41,7 @@ struct BlockExec
 };
 struct DecompressBlockExec : public BlockExec
 {
-	DecompressBlockExec() : cblk(nullptr), resno(0), roishift(0) {}
+	DecompressBlockExec() : cblk(nullptr), resno(0), roishift(0), retain(false) {}
 	bool open(T1Interface* t1)
 	{
 		return t1->decompress(this);
@@ -50,6 +50,8 @@ struct DecompressBlockExec : public BlockExec
 	DecompressCodeblock* cblk;
 	uint8_t resno;
 	uint8_t roishift;
+	// keep post-processed coefficients, as the next strip also needs them
+	bool retain;
 };
 struct CompressBlockExec : public BlockExec
 {
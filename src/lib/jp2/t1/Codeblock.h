@@ -185,7 +185,8 @@ struct DecompressCodeblock : public Codeblock
 #ifdef DEBUG_LOSSLESS_T2
 		  included(0),
 #endif
-		  numSegmentsAllocated(0)
+		  numSegmentsAllocated(0), numPassesDecompressed(0), numBytesDecompressed(0),
+		  retainedCoefficients(false)
 	{}
 	virtual ~DecompressCodeblock()
 	{
@@ -237,6 +238,79 @@ struct DecompressCodeblock : public Codeblock
 		seg_buffers.clear();
 		numSegments = 0;
 	}
+	/**
+	 * Discard all state read from packets (segments and packet header state),
+	 * while keeping the decompressed coefficients
+	 */
+	void clearPacketState(void)
+	{
+		cleanUpSegBuffers();
+		compressedStream.len = 0;
+		numbps = 0;
+		numlenbits = 0;
+		numPassesInPacket = 0;
+	}
+	uint32_t getNumPasses(void)
+	{
+		uint32_t rc = 0;
+		for(uint32_t i = 0; i < numSegments; ++i)
+			rc += segs[i].numpasses;
+
+		return rc;
+	}
+	/**
+	 * Record the coding passes that the decompressed coefficients are based on
+	 */
+	void setPassesDecompressed(void)
+	{
+		numPassesDecompressed = getNumPasses();
+		numBytesDecompressed = getSegBuffersLen();
+	}
+	/**
+	 * Check if packets have contributed coding passes that are not yet reflected
+	 * in the decompressed coefficients
+	 */
+	bool hasNewPasses(void)
+	{
+		return getNumPasses() != numPassesDecompressed ||
+			   getSegBuffersLen() != numBytesDecompressed;
+	}
+	bool needsDecompress(void)
+	{
+		return isClosed() ? !seg_buffers.empty() : hasNewPasses();
+	}
+	/**
+	 * Keep post-processed coefficients in the code block buffer, so that the next strip
+	 * of a strip decompress can use them without decompressing the code block again
+	 *
+	 * @param src		post-processed coefficients
+	 * @param srcStride	stride of src
+	 */
+	bool retainCoefficients(const int32_t* src, uint32_t srcStride)
+	{
+		if(!alloc2d(false))
+			return false;
+		// retained coefficients are stored with a stride equal to the code block width
+		auto dest = getBuffer();
+		if(src != dest)
+		{
+			for(uint32_t j = 0; j < height(); ++j)
+				memcpy(dest + (uint64_t)j * width(), src + (uint64_t)j * srcStride,
+					   width() * sizeof(int32_t));
+		}
+		retainedCoefficients = true;
+
+		return true;
+	}
+	bool hasRetainedCoefficients(void)
+	{
+		return retainedCoefficients;
+	}
+	void releaseCoefficients(void)
+	{
+		retainedCoefficients = false;
+		dealloc2d();
+	}
 	size_t getSegBuffersLen()
 	{
 		return std::accumulate(seg_buffers.begin(), seg_buffers.end(), (size_t)0,
@@ -263,6 +337,9 @@ struct DecompressCodeblock : public Codeblock
 	Segment* segs; /* information on segments */
 	uint16_t numSegments; /* number of segment in block*/
 	uint16_t numSegmentsAllocated; // number of segments allocated for segs array
+	uint32_t numPassesDecompressed; // number of passes in decompressed coefficients
+	size_t numBytesDecompressed; // number of compressed bytes in decompressed coefficients
+	bool retainedCoefficients; // buffer holds post-processed coefficients for the next strip
 };
 
 } // namespace grk
@@ -31,66 +31,97 @@ T1CompressScheduler::~T1CompressScheduler()
 void T1CompressScheduler::scheduleCompress(TileCodingParams* tcp, const double* mct_norms,
 										   uint16_t mct_numcomps)
 {
-	uint16_t compno;
-	uint8_t resno, bandIndex;
 	tile->distortion = 0;
 	std::vector<CompressBlockExec*> blocks;
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+	{
+		auto tilec = tile->comps + compno;
+		for(uint8_t resno = 0; resno < tilec->numresolutions; ++resno)
+			createBlocks(tcp, mct_norms, mct_numcomps, compno, resno, &blocks);
+	}
+	createImplementations(tcp);
+	compress(&blocks);
+}
+void T1CompressScheduler::createImplementations(TileCodingParams* tcp)
+{
 	uint32_t maxCblkW = 0;
 	uint32_t maxCblkH = 0;
-
-	for(compno = 0; compno < tile->numcomps; ++compno)
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
 	{
-		auto tilec = tile->comps + compno;
 		auto tccp = tcp->tccps + compno;
-		for(resno = 0; resno < tilec->numresolutions; ++resno)
+		maxCblkW = std::max<uint32_t>(maxCblkW, (uint32_t)(1 << tccp->cblkw));
+		maxCblkH = std::max<uint32_t>(maxCblkH, (uint32_t)(1 << tccp->cblkh));
+	}
+	for(auto i = 0U; i < ThreadPool::get()->num_threads(); ++i)
+		t1Implementations.push_back(T1Factory::get_t1(true, tcp, maxCblkW, maxCblkH));
+}
+void T1CompressScheduler::createBlocks(TileCodingParams* tcp, const double* mct_norms,
+									   uint16_t mct_numcomps, uint16_t compno, uint8_t resno,
+									   std::vector<CompressBlockExec*>* blocks)
+{
+	auto tilec = tile->comps + compno;
+	auto tccp = tcp->tccps + compno;
+	auto res = &tilec->tileCompResolution[resno];
+	for(uint8_t bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
+	{
+		auto band = &res->tileBand[bandIndex];
+		for(auto prc : band->precincts)
 		{
-			auto res = &tilec->tileCompResolution[resno];
-			for(bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
+			auto nominalBlockSize = prc->getNominalBlockSize();
+			for(uint64_t cblkno = 0; cblkno < prc->getNumCblks(); ++cblkno)
 			{
-				auto band = &res->tileBand[bandIndex];
-				for(auto prc : band->precincts)
-				{
-					auto nominalBlockSize = prc->getNominalBlockSize();
-					for(uint64_t cblkno = 0; cblkno < prc->getNumCblks(); ++cblkno)
-					{
-						auto cblk = prc->getCompressedBlockPtr(cblkno);
-						if(!cblk->allocData(nominalBlockSize))
-							continue;
-						auto block = new CompressBlockExec();
-						block->tile = tile;
-						block->doRateControl = needsRateControl;
-						block->x = cblk->x0;
-						block->y = cblk->y0;
-						tilec->getBuffer()->toRelativeCoordinates(resno, band->orientation,
-																  block->x, block->y);
-						block->tiledp =
-							tilec->getBuffer()->getHighestBufferResWindowREL()->getBuffer() +
-							(uint64_t)block->x +
-							block->y * (uint64_t)tilec->getBuffer()
-										   ->getHighestBufferResWindowREL()
-										   ->stride;
-						maxCblkW = std::max<uint32_t>(maxCblkW, (uint32_t)(1 << tccp->cblkw));
-						maxCblkH = std::max<uint32_t>(maxCblkH, (uint32_t)(1 << tccp->cblkh));
-						block->compno = compno;
-						block->bandOrientation = band->orientation;
-						block->cblk = cblk;
-						block->cblk_sty = tccp->cblk_sty;
-						block->qmfbid = tccp->qmfbid;
-						block->resno = resno;
-						block->inv_step_ht = 1.0f / band->stepsize;
-						block->stepsize = band->stepsize;
-						block->mct_norms = mct_norms;
-						block->mct_numcomps = mct_numcomps;
-						block->k_msbs = (uint8_t)(band->numbps - cblk->numbps);
-						blocks.push_back(block);
-					}
-				}
+				auto cblk = prc->getCompressedBlockPtr(cblkno);
+				if(!cblk->allocData(nominalBlockSize))
+					continue;
+				auto block = new CompressBlockExec();
+				block->tile = tile;
+				block->doRateControl = needsRateControl;
+				block->x = cblk->x0;
+				block->y = cblk->y0;
+				tilec->getBuffer()->toRelativeCoordinates(resno, band->orientation, block->x,
+														  block->y);
+				block->tiledp =
+					tilec->getBuffer()->getHighestBufferResWindowREL()->getBuffer() +
+					(uint64_t)block->x +
+					block->y *
+						(uint64_t)tilec->getBuffer()->getHighestBufferResWindowREL()->stride;
+				block->compno = compno;
+				block->bandOrientation = band->orientation;
+				block->cblk = cblk;
+				block->cblk_sty = tccp->cblk_sty;
+				block->qmfbid = tccp->qmfbid;
+				block->resno = resno;
+				block->inv_step_ht = 1.0f / band->stepsize;
+				block->stepsize = band->stepsize;
+				block->mct_norms = mct_norms;
+				block->mct_numcomps = mct_numcomps;
+				block->k_msbs = (uint8_t)(band->numbps - cblk->numbps);
+				blocks->push_back(block);
 			}
 		}
 	}
-	for(auto i = 0U; i < ThreadPool::get()->num_threads(); ++i)
-		t1Implementations.push_back(T1Factory::get_t1(true, tcp, maxCblkW, maxCblkH));
-	compress(&blocks);
+}
+void T1CompressScheduler::beginCompress(TileCodingParams* tcp)
+{
+	tile->distortion = 0;
+	createImplementations(tcp);
+}
+void T1CompressScheduler::enqueue(CompressBlockExec* block)
+{
+	auto result = ThreadPool::get()->enqueue([this, block] {
+		auto threadnum = ThreadPool::get()->thread_number(std::this_thread::get_id());
+		compress(t1Implementations[(size_t)threadnum], block);
+		delete block;
+		return 0;
+	});
+	std::unique_lock<std::mutex> lk(block_mutex);
+	results.push_back(std::move(result));
+}
+void T1CompressScheduler::endCompress(void)
+{
+	for(auto& result : results)
+		result.get();
+	results.clear();
 }
 
 void T1CompressScheduler::compress(std::vector<CompressBlockExec*>* blocks)
@@ -146,6 +177,7 @@ bool T1CompressScheduler::compress(size_t threadId, uint64_t maxBlocks)
 void T1CompressScheduler::compress(T1Interface* impl, CompressBlockExec* block)
 {
 	block->open(impl);
+	GRK_TRACE_COUNT(TRACE_CODE_BLOCKS, 1);
 	if(needsRateControl)
 	{
 		std::unique_lock<std::mutex> lk(distortion_mutex);
@@ -30,7 +30,16 @@ class T1CompressScheduler
 
 	void scheduleCompress(TileCodingParams* tcp, const double* mct_norms, uint16_t mct_numcomps);
 
+	// pipelined compression: blocks are enqueued individually, as soon as
+	// their wavelet coefficients are final
+	void beginCompress(TileCodingParams* tcp);
+	void createBlocks(TileCodingParams* tcp, const double* mct_norms, uint16_t mct_numcomps,
+					  uint16_t compno, uint8_t resno, std::vector<CompressBlockExec*>* blocks);
+	void enqueue(CompressBlockExec* block);
+	void endCompress(void);
+
   private:
+	void createImplementations(TileCodingParams* tcp);
 	bool compress(size_t threadId, uint64_t maxBlocks);
 	void compress(T1Interface* impl, CompressBlockExec* block);
 
@@ -41,6 +50,7 @@ class T1CompressScheduler
 	mutable std::mutex block_mutex;
 	CompressBlockExec** encodeBlocks;
 	std::atomic<int64_t> blockCount;
+	std::vector<std::future<int>> results;
 };
 
 } // namespace grk
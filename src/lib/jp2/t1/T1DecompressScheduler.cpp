@@ -18,7 +18,9 @@
 
 namespace grk
 {
-T1DecompressScheduler::T1DecompressScheduler() : success(true), decodeBlocks(nullptr) {}
+T1DecompressScheduler::T1DecompressScheduler(Deadline* deadline)
+	: success(true), deadline(deadline), decodeBlocks(nullptr)
+{}
 T1DecompressScheduler::~T1DecompressScheduler()
 {
 	for(auto& t : t1Implementations)
@@ -91,6 +93,7 @@ bool T1DecompressScheduler::decompressBlock(T1Interface* impl, DecompressBlockEx
 	try
 	{
 		bool rc = block->open(impl);
+		GRK_TRACE_COUNT(TRACE_CODE_BLOCKS, 1);
 		delete block;
 		return rc;
 	}
@@ -103,6 +106,15 @@ bool T1DecompressScheduler::decompressBlock(T1Interface* impl, DecompressBlockEx
 
 	return true;
 }
+/**
+ * Once time has run out, blocks that need T1 decoding are skipped. They keep their
+ * new coding passes, so a later decompress will decode them. Blocks whose retained
+ * coefficients are still valid are cheap, and are always post-processed.
+ */
+bool T1DecompressScheduler::skipBlock(DecompressBlockExec* block)
+{
+	return deadline && block->cblk->needsDecompress() && deadline->expired();
+}
 bool T1DecompressScheduler::decompress(std::vector<DecompressBlockExec*>* blocks)
 {
 	if(!blocks || !blocks->size())
@@ -114,7 +126,7 @@ bool T1DecompressScheduler::decompress(std::vector<DecompressBlockExec*>* blocks
 		for(size_t i = 0; i < blocks->size(); ++i)
 		{
 			auto block = blocks->operator[](i);
-			if(!success)
+			if(!success || skipBlock(block))
 			{
 				delete block;
 			}
@@ -146,7 +158,7 @@ bool T1DecompressScheduler::decompress(std::vector<DecompressBlockExec*>* blocks
 				if(index >= maxBlocks)
 					return 0;
 				auto block = decodeBlocks[index];
-				if(!success)
+				if(!success || skipBlock(block))
 				{
 					delete block;
 					continue;
@@ -27,7 +27,11 @@ class T1Interface;
 class T1DecompressScheduler
 {
   public:
-	T1DecompressScheduler(void);
+	/**
+	 * @param deadline	time budget: once it expires, remaining blocks are
+	 * 					not decompressed and their coefficients stay zero
+	 */
+	explicit T1DecompressScheduler(Deadline* deadline);
 	~T1DecompressScheduler();
 	bool decompress(std::vector<DecompressBlockExec*>* blocks);
 
@@ -39,8 +43,10 @@ class T1DecompressScheduler
 
   private:
 	bool decompressBlock(T1Interface* impl, DecompressBlockExec* block);
+	bool skipBlock(DecompressBlockExec* block);
 	std::vector<T1Interface*> t1Implementations;
 	std::atomic_bool success;
+	Deadline* deadline;
 
 	DecompressBlockExec** decodeBlocks;
 };
@@ -307,7 +307,8 @@ int32_t* T1::getUncompressedData(void)
 }
 bool T1::allocUncompressedData(size_t len)
 {
-	if(uncompressedData && uncompressedDataLen > len)
+	// code blocks of empty bands have no samples
+	if(!len || (uncompressedData && uncompressedDataLen > len))
 		return true;
 	deallocUncompressedData();
 	uncompressedData = (int32_t*)grk::grkAlignedMalloc(len);
@@ -133,6 +133,12 @@ namespace t1_part1
 	bool T1Part1::decompress(DecompressBlockExec* block)
 	{
 		auto cblk = block->cblk;
+		// coefficients retained from a previous decompress are stale once
+		// packets have contributed new coding passes
+		if(!cblk->isClosed() && cblk->hasNewPasses())
+			cblk->setCacheState(GRK_CACHE_STATE_CLOSED);
+		if(cblk->isClosed() && cblk->getBuffer())
+			memset(cblk->getBuffer(), 0, (size_t)cblk->stride * cblk->height() * sizeof(int32_t));
 		cblk->alloc2d(true);
 		t1->attachUncompressedData(cblk->getBuffer(), cblk->width(), cblk->height());
 		if(cblk->isClosed())
@@ -154,10 +160,22 @@ namespace t1_part1
 				cblk->setCacheState(ret ? GRK_CACHE_STATE_OPEN : GRK_CACHE_STATE_ERROR);
 				if(!ret)
 					return false;
+				cblk->setPassesDecompressed();
 			}
 		}
 
-		return block->tilec->postProcess(t1->getUncompressedData(), block);
+		bool rc = block->tilec->postProcess(t1->getUncompressedData(), block);
+		// sparse canvas post processing is done in place,
+		// so coefficients can't be retained for a later decompress
+		if(block->tilec->getSparseCanvas())
+		{
+			if(cblk->isOpen())
+				cblk->setCacheState(GRK_CACHE_STATE_CLOSED);
+			if(!cblk->hasRetainedCoefficients())
+				cblk->dealloc2d();
+		}
+
+		return rc;
 	}
 
 } // namespace t1_part1
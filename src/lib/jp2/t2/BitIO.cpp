@@ -24,16 +24,23 @@ namespace grk
 {
 BitIO::BitIO(uint8_t* bp, uint64_t len, bool isCompressor)
 	: start(bp), offset(0), buf_len(len), buf(0), ct(isCompressor ? 8 : 0), stream(nullptr),
-	  read0xFF(false)
+	  growable(nullptr), read0xFF(false)
 {
 	assert(isCompressor || bp);
 }
 
 BitIO::BitIO(IBufferedStream* strm, bool isCompressor)
 	: start(nullptr), offset(0), buf_len(0), buf(0), ct(isCompressor ? 8 : 0), stream(strm),
-	  read0xFF(false)
+	  growable(nullptr), read0xFF(false)
 {}
 
+BitIO::BitIO(std::vector<uint8_t>* dest)
+	: start(nullptr), offset(0), buf_len(0), buf(0), ct(8), stream(nullptr), growable(dest),
+	  read0xFF(false)
+{
+	assert(dest);
+}
+
 bool BitIO::writeByte()
 {
 	if(stream)
@@ -41,6 +48,11 @@ bool BitIO::writeByte()
 		if(!stream->writeByte(buf))
 			return false;
 	}
+	else if(growable)
+	{
+		growable->push_back(buf);
+		offset++;
+	}
 	else
 	{
 		if(start)
@@ -34,6 +34,11 @@ class BitIO : public IBitIO
   public:
 	BitIO(uint8_t* bp, uint64_t len, bool isCompressor);
 	BitIO(IBufferedStream* stream, bool isCompressor);
+	/*
+	 Compressor that appends to a growable buffer
+	 @param dest destination buffer
+	 */
+	BitIO(std::vector<uint8_t>* dest);
 
 	/*
 	 Number of bytes written.
@@ -81,6 +86,8 @@ class BitIO : public IBitIO
 
 	IBufferedStream* stream;
 
+	std::vector<uint8_t>* growable;
+
 	bool read0xFF;
 
 	/*
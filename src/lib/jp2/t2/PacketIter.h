@@ -252,4 +252,21 @@ struct PacketIter
 
 /*@}*/
 
+/**
+ Identifies a packet, independently of the packet iterator that produced it
+ */
+struct PacketId
+{
+	PacketId(const PacketIter* pi, uint64_t sequence)
+		: compno(pi->compno), resno(pi->resno), precinctIndex(pi->precinctIndex),
+		  layno(pi->layno), sequenceNumber(sequence)
+	{}
+	uint16_t compno;
+	uint8_t resno;
+	uint64_t precinctIndex;
+	uint16_t layno;
+	/** position of packet in tile, used for the SOP marker packet counter */
+	uint64_t sequenceNumber;
+};
+
 } // namespace grk
@@ -42,6 +42,61 @@ bool T2Compress::compressPackets(uint16_t tile_no, uint16_t max_layers, IBuffere
 		GRK_ERROR("compressPackets: Unknown progression order");
 		return false;
 	}
+	if(tileProcessor->packetSpans)
+	{
+		while(current_pi->next())
+		{
+			if(current_pi->layno < max_layers)
+			{
+				uint32_t numBytes = 0;
+				if(!copyPacket(tcp, PacketId(current_pi, tilePtr->numProcessedPackets), stream,
+							   &numBytes))
+					return false;
+				*tileBytesWritten += numBytes;
+				tilePtr->numProcessedPackets++;
+			}
+		}
+
+		return true;
+	}
+	if(ThreadPool::get()->num_threads() > 1)
+	{
+		std::vector<PendingPacket> packets;
+		auto tracker = tileProcessor->getPacketTracker();
+		while(current_pi->next())
+		{
+			if(current_pi->layno < max_layers)
+			{
+				if(current_pi->compno >= tilePtr->numcomps)
+				{
+					GRK_ERROR("compress packet: component number %d must be less than total "
+							  "number of components %d",
+							  current_pi->compno, tilePtr->numcomps);
+					return false;
+				}
+				if(!tracker->is_packet_encoded(current_pi->compno, current_pi->resno,
+											   current_pi->precinctIndex, current_pi->layno))
+				{
+					tracker->packet_encoded(current_pi->compno, current_pi->resno,
+											current_pi->precinctIndex, current_pi->layno);
+					packets.push_back(
+						PendingPacket(PacketId(current_pi, tilePtr->numProcessedPackets), 0));
+				}
+				tilePtr->numProcessedPackets++;
+			}
+		}
+		if(!compressHeaders(&packets, false))
+			return false;
+		for(auto& packet : packets)
+		{
+			uint32_t numBytes = 0;
+			if(!writePacket(tcp, &packet, stream, &numBytes))
+				return false;
+			*tileBytesWritten += numBytes;
+		}
+
+		return true;
+	}
 	while(current_pi->next())
 	{
 		if(current_pi->layno < max_layers)
@@ -71,10 +126,13 @@ bool T2Compress::compressPacketsSimulate(uint16_t tile_no, uint16_t max_layers,
 	// so in this case, we set max_comp to the number of components, so we can ensure that
 	// each component length meets spec. Otherwise, set to 1.
 	uint32_t max_comp = cp->m_coding_params.m_enc.m_max_comp_size > 0 ? image->numcomps : 1;
+	bool concurrent = ThreadPool::get()->num_threads() > 1;
+	std::vector<PendingPacket> packets;
+	auto tracker = tileProcessor->getPacketTracker();
 
 	PacketManager packetManager(true, image, cp, tile_no, THRESH_CALC, tileProcessor);
 	*allPacketBytes = 0;
-	tileProcessor->getPacketTracker()->clear();
+	tracker->clear();
 	for(uint32_t compno = 0; compno < max_comp; ++compno)
 	{
 		uint64_t componentBytes = 0;
@@ -93,6 +151,25 @@ bool T2Compress::compressPacketsSimulate(uint16_t tile_no, uint16_t max_layers,
 			{
 				if(current_pi->layno < max_layers)
 				{
+					if(concurrent)
+					{
+						if(current_pi->compno >= tileProcessor->tile->numcomps)
+						{
+							GRK_ERROR("compress packet simulate: component number %d must be "
+									  "less than total number of components %d",
+									  current_pi->compno, tileProcessor->tile->numcomps);
+							return false;
+						}
+						if(!tracker->is_packet_encoded(current_pi->compno, current_pi->resno,
+													   current_pi->precinctIndex,
+													   current_pi->layno))
+						{
+							tracker->packet_encoded(current_pi->compno, current_pi->resno,
+													current_pi->precinctIndex, current_pi->layno);
+							packets.push_back(PendingPacket(PacketId(current_pi, 0), compno));
+						}
+						continue;
+					}
 					uint32_t bytesInPacket = 0;
 					if(!compressPacketSimulate(tcp, current_pi, &bytesInPacket, maxBytes, markers))
 						return false;
@@ -108,8 +185,310 @@ bool T2Compress::compressPacketsSimulate(uint16_t tile_no, uint16_t max_layers,
 			}
 		}
 	}
+	if(!concurrent)
+		return true;
+	if(!compressHeaders(&packets, true))
+		return false;
+	uint32_t componentPass = 0;
+	uint64_t componentBytes = 0;
+	for(auto& packet : packets)
+	{
+		if(packet.componentPass != componentPass)
+		{
+			componentPass = packet.componentPass;
+			componentBytes = 0;
+		}
+		uint32_t bytesInPacket = 0;
+		if(!simulatePacket(tcp, &packet, &bytesInPacket, maxBytes, markers))
+			return false;
+
+		componentBytes += bytesInPacket;
+		if(maxBytes != UINT_MAX)
+			maxBytes -= bytesInPacket;
+		*allPacketBytes += bytesInPacket;
+		if(cp->m_coding_params.m_enc.m_max_comp_size &&
+		   componentBytes > cp->m_coding_params.m_enc.m_max_comp_size)
+			return false;
+	}
+
 	return true;
 }
+bool T2Compress::copyPacketsSimulate(uint16_t tile_no, uint16_t max_layers,
+									 uint32_t* allPacketBytes, PacketLengthMarkers* markers)
+{
+	assert(allPacketBytes);
+	auto cp = tileProcessor->m_cp;
+	auto tcp = cp->tcps + tile_no;
+	PacketManager packetManager(true, tileProcessor->headerImage, cp, tile_no, FINAL_PASS,
+								tileProcessor);
+	uint64_t byteCount = 0;
+	*allPacketBytes = 0;
+	if(markers)
+		markers->pushInit();
+	for(uint32_t pino = 0; pino < tcp->getNumProgressions(); ++pino)
+	{
+		auto current_pi = packetManager.getPacketIter(pino);
+		packetManager.enableTilePartGeneration(pino, true, 0);
+		if(current_pi->prog.progression == GRK_PROG_UNKNOWN)
+		{
+			GRK_ERROR("copyPacketsSimulate: Unknown progression order");
+			return false;
+		}
+		while(current_pi->next())
+		{
+			if(current_pi->layno < max_layers)
+			{
+				uint32_t bytesInPacket = 0;
+				if(!copyPacket(tcp, PacketId(current_pi, 0), nullptr, &bytesInPacket))
+					return false;
+				if(markers)
+					markers->pushNextPacketLength(bytesInPacket);
+				byteCount += bytesInPacket;
+			}
+		}
+	}
+	if(byteCount > UINT_MAX)
+	{
+		GRK_ERROR("Tile part size exceeds standard maximum value of %d."
+				  "Please enable tile part generation to keep tile part size below max",
+				  UINT_MAX);
+		return false;
+	}
+	*allPacketBytes = (uint32_t)byteCount;
+
+	return true;
+}
+bool T2Compress::copyPacket(TileCodingParams* tcp, const PacketId& id, IBufferedStream* stream,
+							uint32_t* packet_bytes_written)
+{
+	auto spans = tileProcessor->packetSpans;
+	auto span = spans->find(std::make_tuple(id.compno, id.resno, id.precinctIndex, id.layno));
+	bool sop = tcp->csty & J2K_CP_CSTY_SOP;
+	bool eph = tcp->csty & J2K_CP_CSTY_EPH;
+	uint8_t* data = nullptr;
+	size_t len = 0;
+	if(span != spans->end() && span->second.keep)
+	{
+		data = span->second.data;
+		len = span->second.length;
+		// SOP marker is re-written, since packet sequence numbers change.
+		// SOP markers are optional, even when enabled in the coding style
+		if(sop && len >= 2 && data[0] == (J2K_MS_SOP >> 8) && data[1] == (J2K_MS_SOP & 0xff))
+		{
+			if(len < 6)
+			{
+				GRK_ERROR("Packet is too short to contain SOP marker");
+				return false;
+			}
+			data += 6;
+			len -= 6;
+		}
+	}
+	// empty packet: single zero bit header, padded to one byte
+	uint64_t byteCount = (sop ? 6 : 0) + (data ? len : 1 + (eph ? 2 : 0));
+	if(byteCount > UINT_MAX)
+	{
+		GRK_ERROR("Packet length %" PRIu64 " exceeds maximum of %u", byteCount, UINT_MAX);
+		return false;
+	}
+	if(stream)
+	{
+		if(sop && !writeSOP(stream, id.sequenceNumber))
+			return false;
+		if(data)
+		{
+			if(!stream->writeBytes(data, len))
+				return false;
+		}
+		else
+		{
+			if(!stream->writeByte(0))
+				return false;
+			if(eph && !writeEPH(stream))
+				return false;
+		}
+	}
+	*packet_bytes_written += (uint32_t)byteCount;
+
+	return true;
+}
+bool T2Compress::compressHeaders(std::vector<PendingPacket>* packets, bool simulate)
+{
+	auto tile = tileProcessor->tile;
+	std::map<std::tuple<uint16_t, uint8_t, uint64_t>, std::vector<PendingPacket*>> precinctMap;
+	for(auto& packet : *packets)
+		precinctMap[std::make_tuple(packet.id.compno, packet.id.resno, packet.id.precinctIndex)]
+			.push_back(&packet);
+	std::vector<std::vector<PendingPacket*>*> precincts;
+	precincts.reserve(precinctMap.size());
+	for(auto& p : precinctMap)
+		precincts.push_back(&p.second);
+	std::atomic<bool> success(true);
+	std::atomic<size_t> precinctCount(0);
+	auto exec = [this, tile, simulate, &precincts, &success, &precinctCount] {
+		size_t index;
+		while(success && (index = precinctCount++) < precincts.size())
+		{
+			for(auto packet : *precincts[index])
+			{
+				auto id = &packet->id;
+				auto res = tile->comps[id->compno].tileCompResolution + id->resno;
+				std::unique_ptr<BitIO> bio(simulate ? new BitIO(nullptr, UINT_MAX, true)
+													: new BitIO(&packet->header));
+				if(!compressHeader(bio.get(), res, id->layno, id->precinctIndex))
+				{
+					success = false;
+					break;
+				}
+				packet->headerBytes = bio->numBytes();
+				// code block state for next layer
+				for(uint8_t bandIndex = 0; bandIndex < res->numTileBandWindows; bandIndex++)
+				{
+					auto band = res->tileBand + bandIndex;
+					auto prc = band->precincts[id->precinctIndex];
+					uint64_t nb_blocks = prc->getNumCblks();
+					if(band->isEmpty() || !nb_blocks)
+						continue;
+					for(uint64_t cblkno = 0; cblkno < nb_blocks; ++cblkno)
+					{
+						auto cblk = prc->getCompressedBlockPtr(cblkno);
+						cblk->numPassesInPacket += cblk->layers[id->layno].numpasses;
+					}
+				}
+			}
+		}
+		return 0;
+	};
+	auto numThreads = std::min<size_t>(ThreadPool::get()->num_threads(), precincts.size());
+	std::vector<std::future<int>> results;
+	for(size_t i = 0; i < numThreads; ++i)
+		results.emplace_back(ThreadPool::get()->enqueue(exec));
+	for(auto& result : results)
+		result.get();
+
+	return success;
+}
+bool T2Compress::writePacket(TileCodingParams* tcp, PendingPacket* packet,
+							 IBufferedStream* stream, uint32_t* packet_bytes_written)
+{
+	auto id = &packet->id;
+	auto res = tileProcessor->tile->comps[id->compno].tileCompResolution + id->resno;
+	size_t stream_start = stream->tell();
+	if((tcp->csty & J2K_CP_CSTY_SOP) && !writeSOP(stream, id->sequenceNumber))
+		return false;
+	if(!stream->writeBytes(packet->header.data(), packet->header.size()))
+		return false;
+	if((tcp->csty & J2K_CP_CSTY_EPH) && !writeEPH(stream))
+		return false;
+	for(uint8_t bandIndex = 0; bandIndex < res->numTileBandWindows; bandIndex++)
+	{
+		auto band = res->tileBand + bandIndex;
+		auto prc = band->precincts[id->precinctIndex];
+		uint64_t nb_blocks = prc->getNumCblks();
+
+		if(band->isEmpty() || !nb_blocks)
+			continue;
+		for(uint64_t cblkno = 0; cblkno < nb_blocks; ++cblkno)
+		{
+			auto cblk_layer = prc->getCompressedBlockPtr(cblkno)->layers + id->layno;
+			if(!cblk_layer->numpasses)
+				continue;
+			if(cblk_layer->len && !stream->writeBytes(cblk_layer->data, cblk_layer->len))
+				return false;
+		}
+	}
+	*packet_bytes_written += (uint32_t)(stream->tell() - stream_start);
+
+	return true;
+}
+bool T2Compress::simulatePacket(TileCodingParams* tcp, PendingPacket* packet,
+								uint32_t* packet_bytes_written, uint32_t max_bytes_available,
+								PacketLengthMarkers* markers)
+{
+	auto id = &packet->id;
+	auto res = tileProcessor->tile->comps[id->compno].tileCompResolution + id->resno;
+	uint64_t byteCount = 0;
+	*packet_bytes_written = 0;
+
+	// budget checks mirror those of compressPacketSimulate
+	if(tcp->csty & J2K_CP_CSTY_SOP)
+	{
+		if(max_bytes_available < 6)
+			return false;
+		if(max_bytes_available != UINT_MAX)
+			max_bytes_available -= 6;
+		byteCount += 6;
+	}
+	if(packet->headerBytes >= max_bytes_available)
+		return false;
+	byteCount += packet->headerBytes;
+	if(max_bytes_available != UINT_MAX)
+		max_bytes_available -= (uint32_t)packet->headerBytes;
+	if(tcp->csty & J2K_CP_CSTY_EPH)
+	{
+		if(max_bytes_available < 2)
+			return false;
+		if(max_bytes_available != UINT_MAX)
+			max_bytes_available -= 2;
+		byteCount += 2;
+	}
+	for(uint32_t bandIndex = 0; bandIndex < res->numTileBandWindows; bandIndex++)
+	{
+		auto band = res->tileBand + bandIndex;
+		auto prc = band->precincts[id->precinctIndex];
+		uint64_t nb_blocks = prc->getNumCblks();
+		// empty bands are skipped by writePacket
+		if(band->isEmpty() || !nb_blocks)
+			continue;
+		for(uint64_t cblkno = 0; cblkno < nb_blocks; ++cblkno)
+		{
+			auto layer = prc->getCompressedBlockPtr(cblkno)->layers + id->layno;
+			if(!layer->numpasses)
+				continue;
+			if(layer->len > max_bytes_available)
+				return false;
+			byteCount += layer->len;
+			if(max_bytes_available != UINT_MAX)
+				max_bytes_available -= layer->len;
+		}
+	}
+	if(byteCount > UINT_MAX)
+	{
+		GRK_ERROR("Tile part size exceeds standard maximum value of %d."
+				  "Please enable tile part generation to keep tile part size below max",
+				  UINT_MAX);
+		return false;
+	}
+	*packet_bytes_written = (uint32_t)byteCount;
+	if(markers)
+		markers->pushNextPacketLength(*packet_bytes_written);
+
+	return true;
+}
+bool T2Compress::writeSOP(IBufferedStream* stream, uint64_t packetSequenceNumber)
+{
+	if(!stream->writeByte(J2K_MS_SOP >> 8))
+		return false;
+	if(!stream->writeByte(J2K_MS_SOP & 0xff))
+		return false;
+	if(!stream->writeByte(0))
+		return false;
+	if(!stream->writeByte(4))
+		return false;
+	/* packet sequence number is uint64_t modulo 65536, in big endian format */
+	uint16_t numProcessedPackets = (uint16_t)(packetSequenceNumber & 0xFFFF);
+	if(!stream->writeByte((uint8_t)(numProcessedPackets >> 8)))
+		return false;
+
+	return stream->writeByte((uint8_t)(numProcessedPackets & 0xff));
+}
+bool T2Compress::writeEPH(IBufferedStream* stream)
+{
+	if(!stream->writeByte(J2K_MS_EPH >> 8))
+		return false;
+
+	return stream->writeByte(J2K_MS_EPH & 0xff);
+}
 
 bool T2Compress::compressHeader(BitIO* bio, Resolution* res, uint16_t layno, uint64_t precinctIndex)
 {
@@ -284,23 +663,8 @@ bool T2Compress::compressPacket(TileCodingParams* tcp, PacketIter* pi, IBuffered
 			 precinctIndex, layno);
 #endif
 	// SOP marker
-	if(tcp->csty & J2K_CP_CSTY_SOP)
-	{
-		if(!stream->writeByte(J2K_MS_SOP >> 8))
-			return false;
-		if(!stream->writeByte(J2K_MS_SOP & 0xff))
-			return false;
-		if(!stream->writeByte(0))
-			return false;
-		if(!stream->writeByte(4))
-			return false;
-		/* numProcessedPackets is uint64_t modulo 65536, in big endian format */
-		uint16_t numProcessedPackets = (uint16_t)(tile->numProcessedPackets & 0xFFFF);
-		if(!stream->writeByte((uint8_t)(numProcessedPackets >> 8)))
-			return false;
-		if(!stream->writeByte((uint8_t)(numProcessedPackets & 0xff)))
-			return false;
-	}
+	if((tcp->csty & J2K_CP_CSTY_SOP) && !writeSOP(stream, tile->numProcessedPackets))
+		return false;
 	std::unique_ptr<BitIO> bio;
 	bio = std::unique_ptr<BitIO>(new BitIO(stream, true));
 
@@ -310,13 +674,8 @@ bool T2Compress::compressPacket(TileCodingParams* tcp, PacketIter* pi, IBuffered
 		return false;
 
 	// EPH marker
-	if(tcp->csty & J2K_CP_CSTY_EPH)
-	{
-		if(!stream->writeByte(J2K_MS_EPH >> 8))
-			return false;
-		if(!stream->writeByte(J2K_MS_EPH & 0xff))
-			return false;
-	}
+	if((tcp->csty & J2K_CP_CSTY_EPH) && !writeEPH(stream))
+		return false;
 	// GRK_INFO("Written packet header bytes %d for layer %d", (uint32_t)(stream->tell() -
 	// stream_start),layno);
 	/* Writing the packet body */
@@ -375,6 +734,8 @@ bool T2Compress::compressPacketSimulate(TileCodingParams* tcp, PacketIter* pi,
 #endif
 	if(tcp->csty & J2K_CP_CSTY_SOP)
 	{
+		if(max_bytes_available < 6)
+			return false;
 		if(max_bytes_available != UINT_MAX)
 			max_bytes_available -= 6;
 		byteCount += 6;
@@ -382,6 +743,10 @@ bool T2Compress::compressPacketSimulate(TileCodingParams* tcp, PacketIter* pi,
 	std::unique_ptr<BitIO> bio(new BitIO(nullptr, max_bytes_available, true));
 	if(!compressHeader(bio.get(), res, layno, precinctIndex))
 		return false;
+	// number of passes and comma codes don't report overflow,
+	// so header length must also be checked once the header is complete
+	if(bio->numBytes() >= max_bytes_available)
+		return false;
 
 	byteCount += (uint32_t)bio->numBytes();
 	// if (max_bytes_available == UINT_MAX)
@@ -390,6 +755,8 @@ bool T2Compress::compressPacketSimulate(TileCodingParams* tcp, PacketIter* pi,
 		max_bytes_available -= (uint32_t)bio->numBytes();
 	if(tcp->csty & J2K_CP_CSTY_EPH)
 	{
+		if(max_bytes_available < 2)
+			return false;
 		if(max_bytes_available != UINT_MAX)
 			max_bytes_available -= 2;
 		byteCount += 2;
@@ -401,6 +768,9 @@ bool T2Compress::compressPacketSimulate(TileCodingParams* tcp, PacketIter* pi,
 		auto prc = band->precincts[precinctIndex];
 
 		nb_blocks = prc->getNumCblks();
+		// empty bands are skipped by compressPacket
+		if(band->isEmpty() || !nb_blocks)
+			continue;
 		for(uint64_t cblkno = 0; cblkno < nb_blocks; ++cblkno)
 		{
 			auto cblk = prc->getCompressedBlockPtr(cblkno);
@@ -25,6 +25,24 @@ namespace grk
 {
 struct TileProcessor;
 
+/**
+ Packet whose header is compressed concurrently with the packets of other precincts,
+ and which is then written out, or measured, in progression order
+ */
+struct PendingPacket
+{
+	PendingPacket(const PacketId& packetId, uint32_t compPass)
+		: id(packetId), componentPass(compPass), headerBytes(0)
+	{}
+	PacketId id;
+	/** component pass of packet simulation (see maximum component size) */
+	uint32_t componentPass;
+	/** compressed packet header (empty when simulating) */
+	std::vector<uint8_t> header;
+	/** number of bytes in compressed packet header */
+	size_t headerBytes;
+};
+
 /**
  Tier-2 coding
  */
@@ -58,6 +76,17 @@ struct T2Compress
 	bool compressPacketsSimulate(uint16_t tileno, uint16_t maxlayers, uint32_t* p_data_written,
 								 uint32_t max_len, uint32_t tppos, PacketLengthMarkers* markers);
 
+	/**
+	 Calculate length of the packets of a tile that are copied from another code stream
+	 (see TileProcessor::packetSpans), rather than compressed
+	 @param tileno           number of the tile encoded
+	 @param maxlayers        maximum number of layers
+	 @param p_data_written   amount of data written
+	 @param markers			 markers
+	 */
+	bool copyPacketsSimulate(uint16_t tileno, uint16_t maxlayers, uint32_t* p_data_written,
+							 PacketLengthMarkers* markers);
+
   private:
 	TileProcessor* tileProcessor;
 
@@ -85,6 +114,52 @@ struct T2Compress
 								uint32_t len, PacketLengthMarkers* markers);
 
 	bool compressHeader(BitIO* bio, Resolution* res, uint16_t layno, uint64_t precinctIndex);
+
+	/**
+	 Compress packet headers, with precincts distributed across the thread pool.
+	 Packets belonging to the same precinct are compressed in layer order.
+	 @param packets 		packets in progression order
+	 @param simulate 		if true, only measure the packet headers
+	 @return true if successful
+	 */
+	bool compressHeaders(std::vector<PendingPacket>* packets, bool simulate);
+
+	/**
+	 Write a packet whose header has already been compressed
+	 @param tcp 			Tile coding parameters
+	 @param packet 			pending packet
+	 @param stream 			stream
+	 @param p_data_written  amount of data written
+	 @return true if successful
+	 */
+	bool writePacket(TileCodingParams* tcp, PendingPacket* packet, IBufferedStream* stream,
+					 uint32_t* p_data_written);
+
+	/**
+	 Calculate length of a packet whose header has already been measured
+	 @param tcp 			Tile coding parameters
+	 @param packet 			pending packet
+	 @param p_data_written  amount of data written
+	 @param len 			length of the destination buffer
+	 @param markers			packet length markers
+	 @return true if packet fits in destination buffer
+	 */
+	bool simulatePacket(TileCodingParams* tcp, PendingPacket* packet, uint32_t* p_data_written,
+						uint32_t len, PacketLengthMarkers* markers);
+
+	/**
+	 Write a packet copied from another code stream. Packets outside of the
+	 source decompress window, or missing from the source, are written as empty packets
+	 @param tcp 			Tile coding parameters
+	 @param id 				packet id
+	 @param stream 			stream (if null, only calculate the packet length)
+	 @param p_data_written  amount of data written
+	 @return true if successful
+	 */
+	bool copyPacket(TileCodingParams* tcp, const PacketId& id, IBufferedStream* stream,
+					uint32_t* p_data_written);
+	bool writeSOP(IBufferedStream* stream, uint64_t packetSequenceNumber);
+	bool writeEPH(IBufferedStream* stream);
 };
 
 } // namespace grk
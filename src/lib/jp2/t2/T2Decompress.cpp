@@ -52,7 +52,8 @@ void T2Decompress::initSegment(DecompressCodeblock* cblk, uint32_t index, uint8_
 		seg->maxpasses = maxPassesPerSegmentJ2K;
 	}
 }
-bool T2Decompress::processPacket(TileCodingParams* tcp, PacketIter* currPi, SparseBuffer* srcBuf)
+bool T2Decompress::processPacket(TileCodingParams* tcp, PacketIter* currPi, SparseBuffer* srcBuf,
+								PRECINCT_PACKETS* deferred)
 {
 	auto tilec = tileProcessor->tile->comps + currPi->compno;
 	auto tilecBuffer = tilec->getBuffer();
@@ -60,8 +61,9 @@ bool T2Decompress::processPacket(TileCodingParams* tcp, PacketIter* currPi, Spar
 	if(!packetInfo)
 		return false;
 	auto res = tilec->tileCompResolution + currPi->resno;
-	auto skipPacket = currPi->layno >= tcp->numLayersToDecompress ||
+	auto dropPacket = currPi->layno >= tcp->numLayersToDecompress ||
 					  currPi->resno >= tilec->resolutions_to_decompress;
+	auto skipPacket = dropPacket;
 	if(!skipPacket)
 	{
 		if(!tilec->isWholeTileDecoding())
@@ -84,7 +86,7 @@ bool T2Decompress::processPacket(TileCodingParams* tcp, PacketIter* currPi, Spar
 			}
 		}
 	}
-	if(!skipPacket || !packetInfo->packetLength)
+	if((!skipPacket && !tileProcessor->packetSpans) || !packetInfo->packetLength)
 	{
 		for(uint32_t bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
 		{
@@ -96,10 +98,27 @@ bool T2Decompress::processPacket(TileCodingParams* tcp, PacketIter* currPi, Spar
 				return false;
 		}
 	}
-	if(!skipPacket)
+	if(tileProcessor->packetSpans)
+	{
+		if(!locatePacket(tcp, currPi, srcBuf, packetInfo, dropPacket, skipPacket))
+			return false;
+	}
+	else if(!skipPacket)
 	{
-		if(!decompressPacket(tcp, currPi, srcBuf, packetInfo, false))
+		PacketId id(currPi, tileProcessor->tile->numProcessedPackets);
+		if(deferred)
+		{
+			// packet must not extend past end of tile part
+			auto length =
+				std::min<size_t>(packetInfo->packetLength, srcBuf->getCurrentChunkLength());
+			(*deferred)[std::make_tuple(id.compno, id.resno, id.precinctIndex)].push_back(
+				DeferredPacket(id, packetInfo, srcBuf->getCurrentChunkPtr(), length));
+			srcBuf->incrementCurrentChunkOffset(length);
+		}
+		else if(!decompressPacket(tcp, id, srcBuf, packetInfo, false))
+		{
 			return false;
+		}
 		tilec->resolutions_decompressed =
 			std::max<uint8_t>(currPi->resno, tilec->resolutions_decompressed);
 		tileProcessor->tile->numDecompressedPackets++;
@@ -107,22 +126,94 @@ bool T2Decompress::processPacket(TileCodingParams* tcp, PacketIter* currPi, Spar
 	else
 	{
 		if(packetInfo->packetLength)
+		{
 			srcBuf->incrementCurrentChunkOffset(packetInfo->packetLength);
-		else if(!decompressPacket(tcp, currPi, srcBuf, packetInfo, true))
-			return false;
+		}
+		else
+		{
+			PacketId id(currPi, tileProcessor->tile->numProcessedPackets);
+			if(!decompressPacket(tcp, id, srcBuf, packetInfo, true))
+				return false;
+			tileProcessor->setHeaderOnlyPacket();
+		}
 	}
 	tileProcessor->tile->numProcessedPackets++;
 
 	return true;
 }
+bool T2Decompress::locatePacket(TileCodingParams* tcp, PacketIter* currPi, SparseBuffer* srcBuf,
+								 PacketInfo* packetInfo, bool dropPacket, bool skipPacket)
+{
+	// packed packet headers are not stored with their packets, so located
+	// packets would be copied without their headers
+	if(tileProcessor->m_cp->ppm_marker || tcp->ppt)
+	{
+		GRK_ERROR("Code streams with packed packet headers can't be subset");
+		return false;
+	}
+	auto data = srcBuf->getCurrentChunkPtr();
+	auto available = srcBuf->getCurrentChunkLength();
+	// packet length is known from PLT marker
+	bool knownLength = packetInfo->packetLength != 0;
+	if(!knownLength)
+	{
+		// packet header must be parsed to find packet length. Code block
+		// data is referenced rather than copied, so it is parsed as well,
+		// keeping code block segment state correct for subsequent layers
+		PacketId id(currPi, tileProcessor->tile->numProcessedPackets);
+		if(!decompressPacket(tcp, id, srcBuf, packetInfo, false))
+			return false;
+	}
+	// a packet extending past the end of its tile part would be copied
+	// truncated, and all following packets would be located wrongly
+	if(packetInfo->packetLength > available)
+	{
+		GRK_ERROR("Tile %u: packet length %u exceeds remaining tile part length %" PRIu64
+				  ": code stream is truncated or corrupt",
+				  tileProcessor->m_tileIndex, packetInfo->packetLength, (uint64_t)available);
+		return false;
+	}
+	if(knownLength)
+		srcBuf->incrementCurrentChunkOffset(packetInfo->packetLength);
+	if(!dropPacket)
+	{
+		tileProcessor->packetSpans->emplace(
+			std::make_tuple(currPi->compno, currPi->resno, currPi->precinctIndex, currPi->layno),
+			PacketSpan(data, packetInfo->packetLength, !skipPacket));
+		tileProcessor->tile->numDecompressedPackets++;
+	}
+
+	return true;
+}
+bool T2Decompress::canDecompressPrecinctsConcurrently(TileCodingParams* tcp)
+{
+	auto cp = tileProcessor->m_cp;
+	// packets that are located rather than decompressed need no parsing
+	if(tileProcessor->packetSpans)
+		return false;
+	// we don't currently support PLM markers, so packet lengths
+	// are only known when PLT markers are present on their own
+	if(!tileProcessor->packetLengthCache.getMarkers() || cp->plm_markers)
+		return false;
+	// packed packet headers must be read in progression order
+	if(cp->ppm_marker || tcp->ppt)
+		return false;
+
+	return ThreadPool::get()->num_threads() > 1;
+}
 bool T2Decompress::decompressPackets(uint16_t tile_no, SparseBuffer* srcBuf, bool* stopProcessionPackets)
 {
 	auto cp = tileProcessor->m_cp;
 	auto tcp = cp->tcps + tile_no;
 	*stopProcessionPackets = false;
+	// located packets must all be found, so they ignore the time budget
+	auto deadline = tileProcessor->packetSpans ? nullptr : cp->m_coding_params.m_dec.m_deadline;
+	bool interrupted = false;
 	PacketManager packetManager(false, tileProcessor->headerImage, cp, tile_no, FINAL_PASS,
 								tileProcessor);
 	tileProcessor->packetLengthCache.rewind();
+	std::unique_ptr<PRECINCT_PACKETS> deferred(
+		canDecompressPrecinctsConcurrently(tcp) ? new PRECINCT_PACKETS() : nullptr);
 	for(uint32_t pino = 0; pino < tcp->getNumProgressions(); ++pino)
 	{
 		auto currPi = packetManager.getPacketIter(pino);
@@ -139,9 +230,16 @@ bool T2Decompress::decompressPackets(uint16_t tile_no, SparseBuffer* srcBuf, boo
 				*stopProcessionPackets = true;
 				break;
 			}
+			// remaining packets are read by the next decompress, if any
+			if(deadline && deadline->expired())
+			{
+				interrupted = true;
+				*stopProcessionPackets = true;
+				break;
+			}
 			try
 			{
-				if(!processPacket(tcp, currPi, srcBuf))
+				if(!processPacket(tcp, currPi, srcBuf, deferred.get()))
 					return false;
 			}
 			catch(TruncatedPacketHeaderException& tex)
@@ -169,16 +267,87 @@ bool T2Decompress::decompressPackets(uint16_t tile_no, SparseBuffer* srcBuf, boo
 		if(*stopProcessionPackets)
 			break;
 	}
+	if(deferred && !decompressDeferredPackets(tile_no, tcp, deferred.get(), stopProcessionPackets))
+		return false;
+	// tile with no packets is still reconstructed, if time ran out before any were read
+	if(interrupted)
+		return true;
 	if(tileProcessor->tile->numDecompressedPackets == 0)
 		GRK_WARN("T2Decompress: no packets for tile %d were successfully read", tile_no);
 
 	return tileProcessor->tile->numDecompressedPackets > 0;
 }
-bool T2Decompress::decompressPacket(TileCodingParams* tcp, const PacketIter* pi,
+bool T2Decompress::decompressDeferredPackets(uint16_t tile_no, TileCodingParams* tcp,
+											 PRECINCT_PACKETS* deferred, bool* truncated)
+{
+	std::vector<std::vector<DeferredPacket>*> precincts;
+	precincts.reserve(deferred->size());
+	for(auto& p : *deferred)
+		precincts.push_back(&p.second);
+	std::atomic<bool> success(true);
+	std::atomic<bool> stop(false);
+	std::atomic<size_t> precinctCount(0);
+	auto deadline = tileProcessor->m_cp->m_coding_params.m_dec.m_deadline;
+	auto exec = [this, tile_no, tcp, deadline, &precincts, &success, &stop, &precinctCount] {
+		size_t index;
+		while(success && (index = precinctCount++) < precincts.size())
+		{
+			if(deadline && deadline->expired())
+			{
+				stop = true;
+				break;
+			}
+			for(auto& packet : *precincts[index])
+			{
+				auto id = &packet.id;
+				try
+				{
+					SparseBuffer packetBuf;
+					packetBuf.pushBack(packet.data, packet.length, false);
+					if(!decompressPacket(tcp, *id, &packetBuf, packet.packetInfo, false))
+					{
+						success = false;
+						break;
+					}
+				}
+				catch(TruncatedPacketHeaderException& tex)
+				{
+					GRK_UNUSED(tex);
+					GRK_WARN("Truncated packet: tile=%d component=%02d resolution=%02d "
+							 "precinct=%03d layer=%02d",
+							 tile_no, id->compno, id->resno, id->precinctIndex, id->layno);
+					stop = true;
+					break;
+				}
+				catch(CorruptPacketHeaderException& cex)
+				{
+					GRK_UNUSED(cex);
+					GRK_WARN("Corrupt packet: tile=%d component=%02d resolution=%02d "
+							 "precinct=%03d layer=%02d",
+							 tile_no, id->compno, id->resno, id->precinctIndex, id->layno);
+					stop = true;
+					break;
+				}
+			}
+		}
+		return 0;
+	};
+	auto numThreads = std::min<size_t>(ThreadPool::get()->num_threads(), precincts.size());
+	std::vector<std::future<int>> results;
+	for(size_t i = 0; i < numThreads; ++i)
+		results.emplace_back(ThreadPool::get()->enqueue(exec));
+	for(auto& result : results)
+		result.get();
+	if(stop)
+		*truncated = true;
+
+	return success;
+}
+bool T2Decompress::decompressPacket(TileCodingParams* tcp, const PacketId& id,
 									SparseBuffer* srcBuf, PacketInfo* packetInfo, bool skipData)
 {
 	auto tile = tileProcessor->tile;
-	auto res = tile->comps[pi->compno].tileCompResolution + pi->resno;
+	auto res = tile->comps[id.compno].tileCompResolution + id.resno;
 	bool dataPresent;
 	uint32_t packetDataBytes = 0;
 	uint32_t packetBytes = 0;
@@ -191,7 +360,7 @@ bool T2Decompress::decompressPacket(TileCodingParams* tcp, const PacketIter* pi,
 	}
 	else
 	{
-		if(!readPacketHeader(tcp, pi, &dataPresent, srcBuf, &packetBytes, &packetDataBytes))
+		if(!readPacketHeader(tcp, id, &dataPresent, srcBuf, &packetBytes, &packetDataBytes))
 			return false;
 		packetInfo->headerLength = packetBytes;
 		packetInfo->packetLength = packetBytes + packetDataBytes;
@@ -205,7 +374,7 @@ bool T2Decompress::decompressPacket(TileCodingParams* tcp, const PacketIter* pi,
 		}
 		else
 		{
-			if(!readPacketData(res, pi, srcBuf))
+			if(!readPacketData(res, id, srcBuf))
 				return false;
 			packetInfo->parsedData = true;
 		}
@@ -213,12 +382,12 @@ bool T2Decompress::decompressPacket(TileCodingParams* tcp, const PacketIter* pi,
 
 	return true;
 }
-bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p_pi,
+bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketId& id,
 									bool* p_is_data_present, SparseBuffer* srcBuf,
 									uint32_t* dataRead, uint32_t* packetDataBytes)
 {
 	auto tilePtr = tileProcessor->tile;
-	auto res = tilePtr->comps[p_pi->compno].tileCompResolution + p_pi->resno;
+	auto res = tilePtr->comps[id.compno].tileCompResolution + id.resno;
 	auto p_src_data = srcBuf->getCurrentChunkPtr();
 	size_t available_bytes = srcBuf->getCurrentChunkLength();
 	auto active_src = p_src_data;
@@ -238,10 +407,10 @@ bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p
 		{
 			uint16_t numIteratedPackets =
 				(uint16_t)(((uint16_t)active_src[4] << 8) | active_src[5]);
-			if(numIteratedPackets != (tilePtr->numProcessedPackets % 0x10000))
+			if(numIteratedPackets != (id.sequenceNumber % 0x10000))
 			{
 				GRK_ERROR("SOP marker packet counter %u does not match expected counter %u",
-						  numIteratedPackets, tilePtr->numProcessedPackets);
+						  numIteratedPackets, id.sequenceNumber);
 				throw CorruptPacketHeaderException();
 			}
 			active_src += 6;
@@ -274,7 +443,7 @@ bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p
 	auto header_data = *header_data_start;
 	uint32_t present = 0;
 	std::unique_ptr<BitIO> bio(new BitIO(header_data, *remaining_length, false));
-	auto tccp = p_tcp->tccps + p_pi->compno;
+	auto tccp = p_tcp->tccps + id.compno;
 	try
 	{
 		bio->read(&present, 1);
@@ -286,7 +455,7 @@ bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p
 				auto band = res->tileBand + bandIndex;
 				if(band->isEmpty())
 					continue;
-				auto prc = band->getPrecinct(p_pi->precinctIndex);
+				auto prc = band->getPrecinct(id.precinctIndex);
 				if(!prc)
 					continue;
 				for(uint64_t cblkno = 0; cblkno < prc->getNumCblks(); cblkno++)
@@ -299,9 +468,9 @@ bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p
 					if(!cblk || !cblk->numlenbits)
 					{
 						uint16_t value;
-						prc->getInclTree()->decodeValue(bio.get(), cblkno, p_pi->layno + 1, &value);
+						prc->getInclTree()->decodeValue(bio.get(), cblkno, id.layno + 1, &value);
 						if(value != prc->getInclTree()->getUninitializedValue() &&
-						   value != p_pi->layno)
+						   value != id.layno)
 						{
 							GRK_WARN("Tile number: %u", tileProcessor->m_tileIndex + 1);
 							std::string msg =
@@ -320,7 +489,7 @@ bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p
 							GRK_WARN("%s", msg.c_str());
 							tileProcessor->setCorruptPacket();
 						}
-						included = (value <= p_pi->layno) ? 1 : 0;
+						included = (value <= id.layno) ? 1 : 0;
 					}
 					/* else one bit */
 					else
@@ -499,14 +668,14 @@ bool T2Decompress::readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p
 
 	return true;
 }
-bool T2Decompress::readPacketData(Resolution* res, const PacketIter* p_pi, SparseBuffer* srcBuf)
+bool T2Decompress::readPacketData(Resolution* res, const PacketId& id, SparseBuffer* srcBuf)
 {
 	for(uint32_t bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
 	{
 		auto band = res->tileBand + bandIndex;
 		if(band->isEmpty())
 			continue;
-		auto prc = band->getPrecinct(p_pi->precinctIndex);
+		auto prc = band->getPrecinct(id.precinctIndex);
 		if(!prc)
 			continue;
 		for(uint64_t cblkno = 0; cblkno < prc->getNumCblks(); ++cblkno)
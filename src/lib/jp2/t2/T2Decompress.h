@@ -18,10 +18,34 @@
 
 #pragma once
 
+#include <map>
+#include <tuple>
+
 namespace grk
 {
 struct TileProcessor;
 
+/**
+ Packet whose parsing has been deferred until its precinct is scheduled
+ */
+struct DeferredPacket
+{
+	DeferredPacket(const PacketId& packetId, PacketInfo* info, uint8_t* packetData,
+				   size_t packetDataLength)
+		: id(packetId), packetInfo(info), data(packetData), length(packetDataLength)
+	{}
+	PacketId id;
+	PacketInfo* packetInfo;
+	uint8_t* data;
+	size_t length;
+};
+
+/**
+ Deferred packets keyed on (component, resolution, precinct), in layer order
+ */
+typedef std::map<std::tuple<uint16_t, uint8_t, uint64_t>, std::vector<DeferredPacket>>
+	PRECINCT_PACKETS;
+
 /**
  Tier-2 decoding
  */
@@ -46,12 +70,38 @@ struct T2Decompress
 	 @param srcBuf 	source buffer
 	 @return  true if packet was successfully decompressed
 	 */
-	bool decompressPacket(TileCodingParams* tcp, const PacketIter* pi, SparseBuffer* srcBuf,
+	bool decompressPacket(TileCodingParams* tcp, const PacketId& id, SparseBuffer* srcBuf,
 						  PacketInfo* packetInfo, bool skipData);
-	bool processPacket(TileCodingParams* tcp, PacketIter* pi, SparseBuffer* srcBuf);
-	bool readPacketHeader(TileCodingParams* p_tcp, const PacketIter* p_pi, bool* dataPresent,
+	/**
+	 Process next packet in progression. If deferred is not null,
+	 then packets to be decompressed are collected by precinct
+	 rather than being parsed immediately.
+	 */
+	bool processPacket(TileCodingParams* tcp, PacketIter* pi, SparseBuffer* srcBuf,
+					   PRECINCT_PACKETS* deferred);
+	/**
+	 Parse deferred packets, with precincts distributed across the thread pool.
+	 Precincts have independent tag trees and code block state, so only packets
+	 belonging to the same precinct need to be parsed in sequence.
+	 */
+	bool decompressDeferredPackets(uint16_t tileno, TileCodingParams* tcp,
+								   PRECINCT_PACKETS* deferred, bool* truncated);
+	/**
+	 Packet headers can be parsed out of order when every packet length
+	 is known from PLT markers, and headers are stored in-line
+	 */
+	bool canDecompressPrecinctsConcurrently(TileCodingParams* tcp);
+	/**
+	 Find the location and length of the next packet, and store it in the tile
+	 processor's packet spans (see TileProcessor::packetSpans) unless it is dropped
+	 @param dropPacket 	true if packet's layer or resolution is not decompressed
+	 @param skipPacket 	true if packet is dropped, or lies outside of the decompress window
+	 */
+	bool locatePacket(TileCodingParams* tcp, PacketIter* pi, SparseBuffer* srcBuf,
+					  PacketInfo* packetInfo, bool dropPacket, bool skipPacket);
+	bool readPacketHeader(TileCodingParams* p_tcp, const PacketId& id, bool* dataPresent,
 						  SparseBuffer* srcBuf, uint32_t* dataRead, uint32_t* packetDataBytes);
-	bool readPacketData(Resolution* l_res, const PacketIter* p_pi, SparseBuffer* srcBuf);
+	bool readPacketData(Resolution* l_res, const PacketId& id, SparseBuffer* srcBuf);
 	void initSegment(DecompressCodeblock* cblk, uint32_t index, uint8_t cblk_sty, bool first);
 };
 
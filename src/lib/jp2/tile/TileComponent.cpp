@@ -236,7 +236,9 @@ bool TileComponent::allocSparseCanvas(uint32_t numres, bool truncatedTile)
 
 	auto tr_max = tileCompResolution + numres - 1;
 	temp.grow(5, tr_max->width(), tr_max->height());
-	auto sa = new SparseCanvas<6, 6>(temp);
+	// sparse canvas is anchored at the buffer origin, since windows
+	// are validated against its width and height
+	auto sa = new SparseCanvas<6, 6>(temp.x1, temp.y1);
 
 	for(uint8_t resno = 0; resno < numres; ++resno)
 	{
@@ -326,6 +328,10 @@ bool TileComponent::isWholeTileDecoding()
 {
 	return wholeTileDecompress;
 }
+void TileComponent::setWholeTileDecoding(bool whole)
+{
+	wholeTileDecompress = whole;
+}
 ISparseCanvas* TileComponent::getSparseCanvas()
 {
 	return m_sa;
@@ -424,9 +430,21 @@ bool TileComponent::postDecompressImpl(int32_t* srcData, DecompressBlockExec* bl
 		{
 			return false;
 		}
+		if(block->retain && srcData && !cblk->retainCoefficients(srcData, stride))
+			return false;
 	}
 
 	return true;
 }
+bool TileComponent::postProcessRetained(DecompressBlockExec* block)
+{
+	auto cblk = block->cblk;
+	buf->toRelativeCoordinates(block->resno, block->bandOrientation, block->x, block->y);
+
+	return m_sa->write(
+		block->resno,
+		grkRectU32(block->x, block->y, block->x + cblk->width(), block->y + cblk->height()),
+		cblk->getBuffer(), 1, cblk->width(), true);
+}
 
 } // namespace grk
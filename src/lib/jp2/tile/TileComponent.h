@@ -38,9 +38,12 @@ struct TileComponent : public grkRectU32
 
 	TileComponentWindowBuffer<int32_t>* getBuffer() const;
 	bool isWholeTileDecoding();
+	void setWholeTileDecoding(bool whole);
 	ISparseCanvas* getSparseCanvas();
 	bool postProcess(int32_t* srcData, DecompressBlockExec* block);
 	bool postProcessHT(int32_t* srcData, DecompressBlockExec* block, uint16_t stride);
+	// write coefficients retained by the previous strip to the sparse canvas
+	bool postProcessRetained(DecompressBlockExec* block);
 
 	Resolution* tileCompResolution; // in canvas coordinates
 	uint8_t numresolutions;
@@ -27,9 +27,13 @@ TileProcessor::TileProcessor(CodeStream* codeStream, IBufferedStream* stream, bo
 	  numTilePartsTotal(0), pino(0), tile(nullptr), headerImage(codeStream->getHeaderImage()),
 	  current_plugin_tile(codeStream->getCurrentPluginTile()),
 	  wholeTileDecompress(isWholeTileDecompress), m_cp(codeStream->getCodingParams()),
-	  packetLengthCache(PacketLengthCache(m_cp)), m_stream(stream), m_corrupt_packet(false),
-	  newTilePartProgressionPosition(0), m_tcp(nullptr), truncated(false), m_image(nullptr),
-	  m_isCompressor(isCompressor), preCalculatedTileLen(0)
+	  packetLengthCache(PacketLengthCache(m_cp)), packetSpans(nullptr),
+	  imageComposited(false), m_stream(stream),
+	  m_corrupt_packet(false),
+	  newTilePartProgressionPosition(0), m_tcp(nullptr), truncated(false),
+	  numLayersDecompressed(0), headerOnlyPackets(false), m_image(nullptr),
+	  m_initReduce(0), m_imageReduce(0),
+	  m_isCompressor(isCompressor), ingestedCoefficients(false), preCalculatedTileLen(0)
 {
 	tile = new Tile();
 	tile->comps = new TileComponent[headerImage->numcomps];
@@ -47,6 +51,12 @@ IBufferedStream* TileProcessor::getStream(void)
 {
 	return m_stream;
 }
+void TileProcessor::setStream(IBufferedStream* stream)
+{
+	m_stream = stream;
+	if(packetLengthCache.getMarkers())
+		packetLengthCache.getMarkers()->setStream(stream);
+}
 uint32_t TileProcessor::getPreCalculatedTileLen(void)
 {
 	return preCalculatedTileLen;
@@ -60,6 +70,12 @@ void TileProcessor::generateImage(GrkImage* src_image, Tile* src_tile)
 	if(m_image)
 		grk_object_unref(&m_image->obj);
 	m_image = src_image->duplicate(src_tile);
+	m_imageWindow = unreducedTileWindow;
+	m_imageReduce = m_cp->m_coding_params.m_dec.m_reduce;
+	m_imagePrecision = outputPrecision();
+	// tile samples have already been converted to output precision
+	for(uint16_t compno = 0; compno < m_image->numcomps; ++compno)
+		m_image->comps[compno].prec = m_imagePrecision[compno].prec;
 }
 GrkImage* TileProcessor::getImage(void)
 {
@@ -69,6 +85,10 @@ void TileProcessor::setCorruptPacket(void)
 {
 	m_corrupt_packet = true;
 }
+void TileProcessor::setHeaderOnlyPacket(void)
+{
+	headerOnlyPackets = true;
+}
 PacketTracker* TileProcessor::getPacketTracker(void)
 {
 	return &m_packetTracker;
@@ -102,6 +122,9 @@ bool TileProcessor::init(void)
 	if(tcp->m_compressedTileData)
 		tcp->m_compressedTileData->rewind();
 
+	if(!m_isCompressor)
+		m_initReduce = m_cp->m_coding_params.m_dec.m_reduce;
+
 	// generate tile bounds from tile grid coordinates
 	uint32_t tile_x = m_tileIndex % m_cp->t_grid_width;
 	uint32_t tile_y = m_tileIndex / m_cp->t_grid_width;
@@ -186,6 +209,93 @@ bool TileProcessor::allocWindowBuffers(const GrkImage* outputImage)
 	return true;
 }
 
+template<typename F>
+static void forEachPrecinct(Tile* tile, F f)
+{
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+	{
+		auto tilec = tile->comps + compno;
+		for(uint8_t resno = 0; resno < tilec->numresolutions; ++resno)
+		{
+			auto res = tilec->tileCompResolution + resno;
+			for(uint32_t bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
+			{
+				for(auto precinct : res->tileBand[bandIndex].precincts)
+					f(precinct);
+			}
+		}
+	}
+}
+void TileProcessor::clearPacketState(void)
+{
+	forEachPrecinct(tile, [](Precinct* precinct) {
+		precinct->deleteTagTrees();
+		for(uint64_t cblkno = 0; cblkno < precinct->getNumCblks(); ++cblkno)
+		{
+			auto cblk = precinct->tryGetDecompressedBlockPtr(cblkno);
+			if(cblk)
+				cblk->clearPacketState();
+		}
+	});
+	packetLengthCache.clear();
+	headerOnlyPackets = false;
+}
+bool TileProcessor::codeBlocksNeedDecompress(void)
+{
+	bool rc = false;
+	forEachPrecinct(tile, [&rc](Precinct* precinct) {
+		for(uint64_t cblkno = 0; cblkno < precinct->getNumCblks() && !rc; ++cblkno)
+		{
+			auto cblk = precinct->tryGetDecompressedBlockPtr(cblkno);
+			rc = cblk && cblk->needsDecompress();
+		}
+	});
+
+	return rc;
+}
+/**
+ * Discard resolutions, code blocks and packet state, and initialize tile components
+ * again for the current reduction
+ */
+bool TileProcessor::reinit(void)
+{
+	delete[] tile->comps;
+	tile->comps = new TileComponent[headerImage->numcomps];
+	packetLengthCache.clear();
+	numLayersDecompressed = 0;
+	headerOnlyPackets = false;
+
+	return init();
+}
+std::vector<grk_precision> TileProcessor::outputPrecision(void)
+{
+	std::vector<grk_precision> rc;
+	for(uint16_t compno = 0; compno < headerImage->numcomps; ++compno)
+	{
+		grk_precision precision;
+		if(!m_cp->m_coding_params.m_dec.getPrecision(compno, headerImage->comps[compno].prec,
+													 &precision))
+			precision = {headerImage->comps[compno].prec, GRK_PREC_MODE_CLIP};
+		rc.push_back(precision);
+	}
+
+	return rc;
+}
+bool TileProcessor::isImageCurrent(void)
+{
+	if(!m_image || !(m_imageWindow == unreducedTileWindow) ||
+	   m_imageReduce != m_cp->m_coding_params.m_dec.m_reduce)
+		return false;
+	auto precision = outputPrecision();
+	for(uint16_t compno = 0; compno < headerImage->numcomps; ++compno)
+	{
+		if(precision[compno].prec != m_imagePrecision[compno].prec ||
+		   precision[compno].mode != m_imagePrecision[compno].mode)
+			return false;
+	}
+
+	return !codeBlocksNeedDecompress();
+}
 grkRectU32 TileProcessor::getUnreducedTileWindow(void)
 {
 	return unreducedTileWindow;
@@ -214,7 +324,15 @@ bool TileProcessor::doCompress(void)
 	bool debugEncode = state & GRK_PLUGIN_STATE_DEBUG;
 	bool debugMCT = (state & GRK_PLUGIN_STATE_MCT_ONLY) ? true : false;
 
-	if(!current_plugin_tile || debugEncode)
+	if(packetSpans)
+	{
+		// packets are copied from another code stream
+	}
+	else if(ingestedCoefficients)
+	{
+		t1_encode();
+	}
+	else if(!current_plugin_tile || debugEncode)
 	{
 		if(!debugEncode)
 		{
@@ -223,12 +341,20 @@ bool TileProcessor::doCompress(void)
 			if(!mct_encode())
 				return false;
 		}
-		if(!debugEncode || debugMCT)
+		if(!debugEncode && ThreadPool::get()->num_threads() > 1)
 		{
-			if(!dwt_encode())
+			if(!dwt_t1_encode())
 				return false;
 		}
-		t1_encode();
+		else
+		{
+			if(!debugEncode || debugMCT)
+			{
+				if(!dwt_encode())
+					return false;
+			}
+			t1_encode();
+		}
 	}
 	// 1. create PLT marker if required
 	packetLengthCache.deleteMarkers();
@@ -236,8 +362,17 @@ bool TileProcessor::doCompress(void)
 		packetLengthCache.createMarkers(m_stream);
 	// 2. rate control
 	uint32_t allPacketBytes = 0;
-	if(!rateAllocate(&allPacketBytes))
+	if(packetSpans)
+	{
+		T2Compress t2(this);
+		if(!t2.copyPacketsSimulate(m_tileIndex, m_tcp->numlayers, &allPacketBytes,
+								   packetLengthCache.getMarkers()))
+			return false;
+	}
+	else if(!rateAllocate(&allPacketBytes))
+	{
 		return false;
+	}
 	m_packetTracker.clear();
 
 	if(canPreCalculateTileLen())
@@ -320,57 +455,362 @@ bool TileProcessor::decompressT2(SparseBuffer* srcBuf)
 
 	if(doT2)
 	{
+		// Packet state from a previous decompress is retained, so that only packets
+		// from additional layers need to be read. This state can't be extended
+		// if there are fewer layers, or if packet headers were read without their data
+		if(numLayersDecompressed && numLayersDecompressed != m_tcp->numLayersToDecompress &&
+		   (headerOnlyPackets || m_tcp->numLayersToDecompress < numLayersDecompressed))
+			clearPacketState();
+		srcBuf->rewind();
+		tile->numProcessedPackets = 0;
+		tile->numDecompressedPackets = 0;
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_T2, m_tileIndex, -1);
 		auto t2 = new T2Decompress(this);
 		bool rc = t2->decompressPackets(m_tileIndex, srcBuf, &truncated);
 		delete t2;
+		GRK_TRACE_COUNT(TRACE_BYTES_PARSED, srcBuf->getGlobalOffset());
 		if(!rc)
 			return false;
+		numLayersDecompressed = m_tcp->numLayersToDecompress;
 		// synch plugin with T2 data
 		decompress_synch_plugin_with_host(this);
 	}
 
 	return true;
 }
-bool TileProcessor::decompressT1(void)
+/**
+ * Decompress code blocks of tile components as a single batch, lowest resolutions
+ * first, so that a decompress that runs out of time loses detail from all
+ * components rather than losing entire components
+ */
+bool TileProcessor::decompressComponentsT1(const std::vector<uint16_t>& components,
+										   bool doPostT1, bool retainStripBlocks)
 {
-	bool doT1 = !current_plugin_tile || (current_plugin_tile->decompress_flags & GRK_DECODE_T1);
-	bool doPostT1 =
-		!current_plugin_tile || (current_plugin_tile->decompress_flags & GRK_DECODE_POST_T1);
-	if(doT1)
+	std::vector<DecompressBlockExec*> blocks;
+	std::vector<uint16_t> decompressed;
+	uint16_t blockw = 0;
+	uint16_t blockh = 0;
+	auto scheduler = std::unique_ptr<T1DecompressScheduler>(
+		new T1DecompressScheduler(m_cp->m_coding_params.m_dec.m_deadline));
+	for(auto compno : components)
 	{
-		for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+		auto tilec = tile->comps + compno;
+		auto tccp = m_tcp->tccps + compno;
+		if(!wholeTileDecompress)
 		{
-			auto tilec = tile->comps + compno;
-			auto tccp = m_tcp->tccps + compno;
-
-			if(!wholeTileDecompress)
+			try
 			{
-				try
-				{
-					tilec->allocSparseCanvas(tilec->resolutions_decompressed + 1U, truncated);
-				}
-				catch(runtime_error& ex)
-				{
-					GRK_UNUSED(ex);
-					continue;
-				}
+				tilec->allocSparseCanvas(tilec->resolutions_decompressed + 1U, truncated);
 			}
-			std::vector<DecompressBlockExec*> blocks;
-			auto scheduler = std::unique_ptr<T1DecompressScheduler>(new T1DecompressScheduler());
-			if(!scheduler->prepareScheduleDecompress(tilec, tccp, &blocks))
-				return false;
-			if(!scheduler->scheduleDecompress(m_tcp, (uint16_t)tccp->cblkw, (uint16_t)tccp->cblkh,
-											  &blocks))
+			catch(runtime_error& ex)
+			{
+				GRK_UNUSED(ex);
+				continue;
+			}
+		}
+		size_t first = blocks.size();
+		if(!scheduler->prepareScheduleDecompress(tilec, tccp, &blocks) ||
+		   (!wholeTileDecompress && !prepareStripBlocks(tilec, &blocks, first, retainStripBlocks)))
+		{
+			for(auto block : blocks)
+				delete block;
+			return false;
+		}
+		blockw = std::max<uint16_t>(blockw, (uint16_t)tccp->cblkw);
+		blockh = std::max<uint16_t>(blockh, (uint16_t)tccp->cblkh);
+		decompressed.push_back(compno);
+	}
+	std::stable_sort(blocks.begin(), blocks.end(),
+					 [](const DecompressBlockExec* a, const DecompressBlockExec* b) {
+						 return a->resno < b->resno;
+					 });
+	if(doPostT1 && canPreview(decompressed))
+		return decompressProgressive(scheduler.get(), blockw, blockh, &blocks);
+	{
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_T1, m_tileIndex,
+						decompressed.size() == 1 ? decompressed[0] : -1);
+		if(!scheduler->scheduleDecompress(m_tcp, blockw, blockh, &blocks))
+			return false;
+	}
+
+	if(doPostT1)
+	{
+		for(auto compno : decompressed)
+		{
+			GRK_TRACE_SCOPE(GRK_TRACE_STAGE_DWT, m_tileIndex, compno);
+			auto tilec = tile->comps + compno;
+			WaveletReverse w;
+			if(!w.decompress(this, tilec, compno, tilec->getBuffer()->unreducedBounds(),
+							 tilec->resolutions_decompressed + 1U, m_tcp->tccps[compno].qmfbid))
 				return false;
+		}
+	}
 
-			if(doPostT1)
+	return true;
+}
+/**
+ * Previews need every component of a whole tile, decompressed to the same
+ * resolution, and a standard (or no) multi-component transform.
+ */
+bool TileProcessor::canPreview(const std::vector<uint16_t>& components)
+{
+	if(!m_cp->m_coding_params.m_dec.m_previewCallback || !wholeTileDecompress ||
+	   components.size() != tile->numcomps || m_tcp->mct == 2)
+		return false;
+	for(auto compno : components)
+	{
+		auto tilec = tile->comps + compno;
+		if(tilec->numresolutions != tile->comps->numresolutions ||
+		   tilec->resolutions_decompressed != tile->comps->resolutions_decompressed)
+			return false;
+	}
+
+	return tile->comps->resolutions_decompressed > 0;
+}
+/**
+ * Decompress code blocks (sorted by resolution) one resolution at a time:
+ * once a resolution has been T1 decompressed, it is synthesized from the
+ * resolution below it, and, if it is not the final resolution, handed
+ * to the preview callback.
+ */
+bool TileProcessor::decompressProgressive(T1DecompressScheduler* scheduler, uint16_t blockw,
+										  uint16_t blockh, std::vector<DecompressBlockExec*>* blocks)
+{
+	auto numres = (uint8_t)(tile->comps->resolutions_decompressed + 1U);
+	auto begin = blocks->begin();
+	for(uint8_t resno = 0; resno < numres; ++resno)
+	{
+		auto end = std::find_if(begin, blocks->end(), [resno](const DecompressBlockExec* b) {
+			return b->resno > resno;
+		});
+		std::vector<DecompressBlockExec*> resBlocks(begin, end);
+		begin = end;
+		bool rc;
+		{
+			GRK_TRACE_SCOPE(GRK_TRACE_STAGE_T1, m_tileIndex, -1);
+			rc = resno == 0 ? scheduler->scheduleDecompress(m_tcp, blockw, blockh, &resBlocks)
+							: scheduler->decompress(&resBlocks);
+		}
+		for(uint16_t compno = 0; rc && resno > 0 && compno < tile->numcomps; ++compno)
+		{
+			GRK_TRACE_SCOPE(GRK_TRACE_STAGE_DWT, m_tileIndex, compno);
+			WaveletReverse w;
+			rc = w.decompressResolution(this, tile->comps + compno, resno,
+										m_tcp->tccps[compno].qmfbid);
+		}
+		if(!rc)
+		{
+			for(auto it = begin; it != blocks->end(); ++it)
+				delete *it;
+			return false;
+		}
+		if(resno + 1U < numres)
+			preview(resno);
+	}
+
+	return true;
+}
+/**
+ * Copy resolution resno of all tile components into a new image, apply
+ * inverse MCT and DC level shift to the copy, and pass it to the preview callback
+ */
+void TileProcessor::preview(uint8_t resno)
+{
+	auto image = new GrkImage();
+	headerImage->copyHeader(image);
+	auto reduce = (uint8_t)(tile->comps->numresolutions - 1U - resno);
+	auto bounds = tile->rectceildivpow2(reduce);
+	image->x0 = bounds.x0;
+	image->y0 = bounds.y0;
+	image->x1 = bounds.x1;
+	image->y1 = bounds.y1;
+	bool applyMct = m_tcp->mct == 1 && tile->numcomps >= 3;
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+	{
+		auto res = tile->comps[compno].tileCompResolution + resno;
+		auto comp = image->comps + compno;
+		comp->x0 = res->x0;
+		comp->y0 = res->y0;
+		comp->w = res->width();
+		comp->h = res->height();
+		if(!GrkImage::allocData(comp))
+			goto cleanup;
+		auto src = tile->comps[compno].getBuffer()->getBufferResWindowREL(resno);
+		auto srcPtr = src->getBuffer();
+		auto destPtr = comp->data;
+		for(uint32_t j = 0; j < comp->h; ++j)
+		{
+			memcpy(destPtr, srcPtr, comp->w * sizeof(int32_t));
+			srcPtr += src->stride;
+			destPtr += comp->stride;
+		}
+		if(compno > 0 && compno < 3 && (comp->w != image->comps->w || comp->h != image->comps->h))
+			applyMct = false;
+	}
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+	{
+		if(applyMct && compno > 0 && compno < 3)
+			continue;
+		std::vector<int32_t*> channels;
+		std::vector<ShiftInfo> shiftInfo;
+		for(uint16_t i = compno; i < (applyMct && compno == 0 ? 3 : compno + 1); ++i)
+		{
+			auto comp = image->comps + i;
+			int32_t mn = comp->sgnd ? -(1 << (comp->prec - 1)) : 0;
+			int32_t mx = comp->sgnd ? (1 << (comp->prec - 1)) - 1 : (1 << comp->prec) - 1;
+			channels.push_back(comp->data);
+			shiftInfo.push_back(ShiftInfo(mn, mx, m_tcp->tccps[i].m_dc_level_shift));
+		}
+		auto comp = image->comps + compno;
+		mct::decompress_channels(channels, shiftInfo, (uint64_t)comp->stride * comp->h,
+								 m_tcp->tccps[compno].qmfbid == 1);
+	}
+	m_cp->m_coding_params.m_dec.m_previewCallback(
+		m_tileIndex, reduce, image, m_cp->m_coding_params.m_dec.m_previewUserData);
+cleanup:
+	grk_object_unref(&image->obj);
+}
+/**
+ * Code blocks retained by the previous strip are written to the sparse canvas
+ * straight away, rather than being decompressed again. Remaining code blocks that
+ * extend below the current strip are retained for the next strip.
+ *
+ * @param tilec		tile component
+ * @param blocks	blocks to decompress
+ * @param first		index of first block of tile component in blocks
+ * @param retain	true if there is a next strip
+ */
+bool TileProcessor::prepareStripBlocks(TileComponent* tilec,
+									   std::vector<DecompressBlockExec*>* blocks, size_t first,
+									   bool retain)
+{
+	bool rc = true;
+	size_t next = first;
+	for(size_t i = first; i < blocks->size(); ++i)
+	{
+		auto block = (*blocks)[i];
+		auto cblk = block->cblk;
+		auto window = tilec->getBuffer()->getPaddedBandWindow(block->resno, block->bandOrientation);
+		bool extendsBelow = retain && window && cblk->y1 > window->y1;
+		if(cblk->hasRetainedCoefficients())
+		{
+			rc = tilec->postProcessRetained(block) && rc;
+			if(!extendsBelow)
+				cblk->releaseCoefficients();
+			delete block;
+			continue;
+		}
+		block->retain = extendsBelow;
+		(*blocks)[next++] = block;
+	}
+	blocks->resize(next);
+
+	return rc;
+}
+/**
+ * Get strip height in (unreduced) canvas coordinates, so that every component
+ * has at least the requested number of rows per strip at its decompressed resolution
+ *
+ * @return strip height, or zero if strips are disabled
+ */
+uint64_t TileProcessor::getStripHeight(void)
+{
+	uint32_t maxDy = 1;
+	uint32_t maxReduce = 0;
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+	{
+		auto tilec = tile->comps + compno;
+		maxDy = std::max<uint32_t>(maxDy, headerImage->comps[compno].dy);
+		maxReduce = std::max<uint32_t>(
+			maxReduce, (uint32_t)(tilec->numresolutions - tilec->resolutions_to_decompress));
+	}
+
+	return ((uint64_t)m_cp->m_coding_params.m_dec.m_stripHeight << maxReduce) * maxDy;
+}
+bool TileProcessor::useStrips(void)
+{
+	auto stripHeight = getStripHeight();
+
+	// strips are only worthwhile if the tile spans more than one strip
+	return stripHeight && wholeTileDecompress && !current_plugin_tile &&
+		   unreducedTileWindow.height() >= 2 * stripHeight;
+}
+/**
+ * Decompress whole tile as a sequence of horizontal strips, directly into
+ * the tile image (or into the output image, for a single tile).
+ *
+ * Each strip is decompressed through the windowed (sparse canvas) path into strip
+ * sized buffers, which go through MCT, DC level shift and precision, are copied
+ * into the image, and are then released. Code blocks that straddle strip boundaries
+ * are decompressed once, and retained until the next strip has used them.
+ */
+bool TileProcessor::decompressStrips(GrkImage* outputImage, bool multiTile)
+{
+	auto dest = outputImage;
+	if(multiTile)
+	{
+		generateImage(outputImage, tile);
+		dest = m_image;
+	}
+	if(!dest->allocData())
+		return false;
+	auto stripHeight = getStripHeight();
+	auto window = unreducedTileWindow;
+	wholeTileDecompress = false;
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+		tile->comps[compno].setWholeTileDecoding(false);
+
+	std::vector<uint16_t> components;
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+		components.push_back(compno);
+	bool rc = true;
+	uint32_t y1 = 0;
+	for(uint32_t y0 = window.y0; rc && y0 < window.y1; y0 = y1)
+	{
+		// last strip absorbs a remainder shorter than the strip height
+		y1 = (window.y1 - y0 < 2 * stripHeight) ? window.y1 : (uint32_t)(y0 + stripHeight);
+		grkRectU32 strip(window.x0, y0, window.x1, y1);
+		for(uint16_t compno = 0; rc && compno < tile->numcomps; ++compno)
+		{
+			auto imageComp = headerImage->comps + compno;
+			rc = tile->comps[compno].allocWindowBuffer(
+				strip.rectceildiv(imageComp->dx, imageComp->dy));
+		}
+		rc = rc && decompressComponentsT1(components, true, y1 < window.y1);
+		// components without code blocks are skipped by T1
+		for(uint16_t compno = 0; rc && compno < tile->numcomps; ++compno)
+			rc = tile->comps[compno].getBuffer()->alloc();
+		rc = rc && mctDecompress() && dcLevelShiftDecompress() && precisionDecompress() &&
+			 dest->compositeFrom(tile);
+	}
+	// discard coefficients retained for a strip that was never decompressed
+	if(!rc)
+	{
+		forEachPrecinct(tile, [](Precinct* precinct) {
+			for(uint64_t cblkno = 0; cblkno < precinct->getNumCblks(); ++cblkno)
 			{
-				WaveletReverse w;
-				if(!w.decompress(this, tilec, compno, tilec->getBuffer()->unreducedBounds(),
-								 tilec->resolutions_decompressed + 1U, tccp->qmfbid))
-					return false;
+				auto cblk = precinct->tryGetDecompressedBlockPtr(cblkno);
+				if(cblk && cblk->hasRetainedCoefficients())
+					cblk->releaseCoefficients();
 			}
-		}
+		});
+	}
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+		tile->comps[compno].setWholeTileDecoding(true);
+	wholeTileDecompress = true;
+
+	return rc;
+}
+bool TileProcessor::decompressT1(bool doPostT1)
+{
+	bool doT1 = !current_plugin_tile || (current_plugin_tile->decompress_flags & GRK_DECODE_T1);
+	if(doT1)
+	{
+		std::vector<uint16_t> components;
+		for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+			components.push_back(compno);
+		if(!decompressComponentsT1(components, doPostT1))
+			return false;
 	}
 	if(doPostT1)
 	{
@@ -378,12 +818,17 @@ bool TileProcessor::decompressT1(void)
 			return false;
 		if(!dcLevelShiftDecompress())
 			return false;
+		if(!precisionDecompress())
+			return false;
 	}
 	return true;
 }
 bool TileProcessor::decompressT2T1(TileCodingParams* tcp, GrkImage* outputImage, bool multiTile,
 								   bool doPost)
 {
+	// resolutions of a cached tile depend on the reduction
+	if(m_initReduce != m_cp->m_coding_params.m_dec.m_reduce && !reinit())
+		return false;
 	if(!allocWindowBuffers(outputImage))
 		return false;
 	if(!decompressT2(tcp->m_compressedTileData) || m_corrupt_packet)
@@ -391,7 +836,24 @@ bool TileProcessor::decompressT2T1(TileCodingParams* tcp, GrkImage* outputImage,
 		GRK_WARN("Tile %d was not decompressed", m_tileIndex);
 		return multiTile;
 	}
-	if(!decompressT1())
+	if(packetSpans)
+		return true;
+	// tile image from previous decompress is still valid if it was generated
+	// with the same window, reduction and precision, and no code blocks
+	// have new coding passes
+	if(multiTile && doPost && isImageCurrent())
+	{
+		deallocBuffers();
+		return true;
+	}
+	if(doPost && useStrips())
+	{
+		if(!decompressStrips(outputImage, multiTile))
+			return false;
+		deallocBuffers();
+		return true;
+	}
+	if(!decompressT1(doPost))
 	{
 		return false;
 	}
@@ -413,6 +875,9 @@ void TileProcessor::ingestImage()
 	{
 		auto tilec = tile->comps + i;
 		auto img_comp = headerImage->comps + i;
+		// tile data is supplied later, for example by ingestUncompressedData
+		if(!img_comp->data)
+			continue;
 
 		uint32_t offset_x = ceildiv<uint32_t>(headerImage->x0, img_comp->dx);
 		uint32_t offset_y = ceildiv<uint32_t>(headerImage->y0, img_comp->dy);
@@ -458,6 +923,7 @@ bool TileProcessor::mctDecompress()
 {
 	if(!needsMctDecompress(0))
 		return true;
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_MCT, m_tileIndex, -1);
 	if(m_tcp->mct == 2)
 	{
 		auto data = new uint8_t*[tile->numcomps];
@@ -489,6 +955,7 @@ bool TileProcessor::mctDecompress()
 
 bool TileProcessor::dcLevelShiftDecompress()
 {
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_DC_SHIFT, m_tileIndex, -1);
 	for(uint16_t compno = 0; compno < tile->numcomps; compno++)
 	{
 		if(!needsMctDecompress(compno) || m_tcp->mct == 2)
@@ -503,20 +970,39 @@ bool TileProcessor::dcLevelShiftDecompress()
 	return true;
 }
 
+bool TileProcessor::precisionDecompress()
+{
+	for(uint16_t compno = 0; compno < tile->numcomps; compno++)
+	{
+		grk_precision precision;
+		if(!m_cp->m_coding_params.m_dec.getPrecision(compno, headerImage->comps[compno].prec,
+													 &precision))
+			continue;
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_PRECISION, m_tileIndex, compno);
+		mct::decompress_precision(tile, headerImage, compno, precision);
+	}
+	return true;
+}
+
 bool TileProcessor::dcLevelShiftCompress()
 {
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_DC_SHIFT, m_tileIndex, -1);
 	for(uint16_t compno = 0; compno < tile->numcomps; compno++)
 	{
 		auto tile_comp = tile->comps + compno;
 		auto tccp = m_tcp->tccps + compno;
 		auto current_ptr = tile_comp->getBuffer()->getHighestBufferResWindowREL()->getBuffer();
 		uint64_t samples = tile_comp->getBuffer()->stridedArea();
+		// the irreversible DWT works on floats, which the irreversible MCT
+		// otherwise converts to
 		if(!m_tcp->mct && tccp->qmfbid == 0)
 		{
+			auto float_ptr = (float*)current_ptr;
 			for(uint64_t i = 0; i < samples; ++i)
 			{
-				*current_ptr = (*current_ptr - tccp->m_dc_level_shift) * 2048;
+				*float_ptr = (float)(*current_ptr - tccp->m_dc_level_shift);
 				++current_ptr;
+				++float_ptr;
 			}
 		}
 		else
@@ -539,6 +1025,7 @@ bool TileProcessor::mct_encode()
 
 	if(!m_tcp->mct)
 		return true;
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_MCT, m_tileIndex, -1);
 	if(m_tcp->mct == 2)
 	{
 		if(!m_tcp->m_mct_coding_matrix)
@@ -576,6 +1063,7 @@ bool TileProcessor::dwt_encode()
 	bool rc = true;
 	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
 	{
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_DWT, m_tileIndex, compno);
 		auto tile_comp = tile->comps + compno;
 		auto tccp = m_tcp->tccps + compno;
 		WaveletFwdImpl w;
@@ -587,33 +1075,99 @@ bool TileProcessor::dwt_encode()
 	}
 	return rc;
 }
-void TileProcessor::t1_encode()
+void TileProcessor::getMctNorms(const double** mct_norms, uint16_t* mct_numcomps)
 {
-	const double* mct_norms;
-	uint16_t mct_numcomps = 0U;
 	auto tcp = m_tcp;
-
 	if(tcp->mct == 1)
 	{
-		mct_numcomps = 3U;
+		*mct_numcomps = 3U;
 		/* irreversible compressing */
 		if(tcp->tccps->qmfbid == 0)
-			mct_norms = mct::get_norms_irrev();
+			*mct_norms = mct::get_norms_irrev();
 		else
-			mct_norms = mct::get_norms_rev();
+			*mct_norms = mct::get_norms_rev();
 	}
 	else
 	{
-		mct_numcomps = headerImage->numcomps;
-		mct_norms = (const double*)(tcp->mct_norms);
+		*mct_numcomps = headerImage->numcomps;
+		*mct_norms = (const double*)(tcp->mct_norms);
 	}
+}
+void TileProcessor::t1_encode()
+{
+	const double* mct_norms;
+	uint16_t mct_numcomps = 0U;
+	getMctNorms(&mct_norms, &mct_numcomps);
+
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_T1, m_tileIndex, -1);
+	auto scheduler =
+		std::unique_ptr<T1CompressScheduler>(new T1CompressScheduler(tile, needsRateControl()));
+	scheduler->scheduleCompress(m_tcp, mct_norms, mct_numcomps);
+}
+/**
+ * Forward DWT and T1, pipelined: the horizontal pass of each decomposition
+ * level runs in code block height stripes, and code blocks are queued for T1
+ * as soon as all of their rows are final, while still cache resident.
+ * The LL band is queued once the transform of its component is complete.
+ */
+bool TileProcessor::dwt_t1_encode()
+{
+	const double* mct_norms;
+	uint16_t mct_numcomps = 0U;
+	getMctNorms(&mct_norms, &mct_numcomps);
 
 	auto scheduler =
 		std::unique_ptr<T1CompressScheduler>(new T1CompressScheduler(tile, needsRateControl()));
-	scheduler->scheduleCompress(tcp, mct_norms, mct_numcomps);
+	scheduler->beginCompress(m_tcp);
+	bool rc = true;
+	for(uint16_t compno = 0; compno < tile->numcomps && rc; ++compno)
+	{
+		auto tilec = tile->comps + compno;
+		auto tccp = m_tcp->tccps + compno;
+		// blocks for each resolution, sorted by bottom row in buffer coordinates
+		std::vector<std::vector<CompressBlockExec*>> blocks(tilec->numresolutions);
+		std::vector<size_t> nextBlock(tilec->numresolutions, 0);
+		for(uint8_t resno = 0; resno < tilec->numresolutions; ++resno)
+		{
+			scheduler->createBlocks(m_tcp, mct_norms, mct_numcomps, compno, resno,
+									&blocks[resno]);
+			std::sort(blocks[resno].begin(), blocks[resno].end(),
+					  [](CompressBlockExec* a, CompressBlockExec* b) {
+						  return a->y + a->cblk->height() < b->y + b->cblk->height();
+					  });
+		}
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_DWT, m_tileIndex, compno);
+		WaveletFwdImpl w;
+		rc = w.compress(tilec, tccp->qmfbid, 1U << tccp->cblkh,
+						[&blocks, &nextBlock, &scheduler](uint8_t resno, uint32_t rows) {
+							auto& resBlocks = blocks[resno];
+							auto& i = nextBlock[resno];
+							while(i < resBlocks.size() &&
+								  resBlocks[i]->y + resBlocks[i]->cblk->height() <= rows)
+								scheduler->enqueue(resBlocks[i++]);
+						});
+		for(uint8_t resno = 0; resno < tilec->numresolutions; ++resno)
+		{
+			for(auto i = nextBlock[resno]; i < blocks[resno].size(); ++i)
+			{
+				if(rc)
+					scheduler->enqueue(blocks[resno][i]);
+				else
+					delete blocks[resno][i];
+			}
+		}
+	}
+	{
+		// T1 overlaps the transform: this only times the code blocks still queued
+		GRK_TRACE_SCOPE(GRK_TRACE_STAGE_T1, m_tileIndex, -1);
+		scheduler->endCompress();
+	}
+
+	return rc;
 }
 bool TileProcessor::encodeT2(uint32_t* tileBytesWritten)
 {
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_T2, m_tileIndex, -1);
 	auto l_t2 = new T2Compress(this);
 #ifdef DEBUG_LOSSLESS_T2
 	for(uint32_t compno = 0; compno < p_image->m_numcomps; ++compno)
@@ -731,6 +1285,9 @@ bool TileProcessor::preCompressTile()
 	rc = allocWindowBuffers(nullptr);
 	if(!rc)
 		return false;
+	// copied packets don't need sample buffers
+	if(packetSpans)
+		return true;
 	uint32_t numTiles = (uint32_t)m_cp->t_grid_height * m_cp->t_grid_width;
 	bool transfer_image_to_tile = (numTiles == 1);
 
@@ -833,6 +1390,94 @@ bool TileProcessor::ingestUncompressedData(uint8_t* p_src, uint64_t src_length)
 	}
 	return true;
 }
+/**
+ * Copy quantized wavelet coefficients of a tile that was decompressed as far as T1.
+ * The source tile must share this tile's geometry and quantization.
+ */
+bool TileProcessor::ingestCoefficients(TileProcessor* source)
+{
+	auto srcTcp = source->getTileCodingParams();
+	auto tcp = m_cp->tcps + m_tileIndex;
+	if(!srcTcp || source->tile->numcomps != tile->numcomps)
+		return false;
+	for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+	{
+		auto srcTccp = srcTcp->tccps + compno;
+		auto tccp = tcp->tccps + compno;
+		uint32_t numBands = tccp->numresolutions * 3U - 2;
+		bool sameCoding = srcTccp->numresolutions == tccp->numresolutions &&
+						  srcTccp->cblkw == tccp->cblkw && srcTccp->cblkh == tccp->cblkh &&
+						  srcTccp->qmfbid == tccp->qmfbid && srcTccp->roishift == tccp->roishift;
+		for(uint32_t resno = 0; sameCoding && resno < tccp->numresolutions; ++resno)
+			sameCoding = srcTccp->precinctWidthExp[resno] == tccp->precinctWidthExp[resno] &&
+						 srcTccp->precinctHeightExp[resno] == tccp->precinctHeightExp[resno];
+		for(uint32_t bandno = 0; sameCoding && tccp->qmfbid == 0 && bandno < numBands; ++bandno)
+			sameCoding = srcTccp->stepsizes[bandno].expn == tccp->stepsizes[bandno].expn &&
+						 srcTccp->stepsizes[bandno].mant == tccp->stepsizes[bandno].mant;
+		if(!sameCoding)
+		{
+			GRK_ERROR("Tile %u: tile-specific coding styles can't be transcoded", m_tileIndex);
+			return false;
+		}
+		auto srcBuf = source->tile->comps[compno].getBuffer();
+		auto destBuf = tile->comps[compno].getBuffer();
+		if(!srcBuf || srcBuf->bounds().width() != destBuf->bounds().width() ||
+		   srcBuf->bounds().height() != destBuf->bounds().height())
+		{
+			GRK_ERROR("Tile %u: component %u bounds differ from source", m_tileIndex, compno);
+			return false;
+		}
+		auto src = srcBuf->getHighestBufferResWindowREL();
+		auto dest = destBuf->getHighestBufferResWindowREL();
+		auto srcPtr = src->getBuffer();
+		auto destPtr = dest->getBuffer();
+		if(!srcPtr || !destPtr)
+			return false;
+		uint32_t w = destBuf->bounds().width();
+		for(uint32_t j = 0; j < destBuf->bounds().height(); ++j)
+		{
+			memcpy(destPtr, srcPtr, w * sizeof(int32_t));
+			srcPtr += src->stride;
+			destPtr += dest->stride;
+		}
+		// irreversible decompression dequantizes with step sizes that omit the
+		// sub-band gain (see Quantizer::setBandStepSizeAndBps), while compression
+		// quantizes with this tile's band step sizes, so rescale each band from
+		// the former to the latter
+		if(tccp->qmfbid == 0)
+		{
+			auto tilec = tile->comps + compno;
+			uint8_t srcPrec = source->headerImage->comps[compno].prec;
+			for(uint8_t resno = 0; resno < tilec->numresolutions; ++resno)
+			{
+				auto res = tilec->tileCompResolution + resno;
+				auto resLower = resno ? tilec->tileCompResolution + resno - 1 : nullptr;
+				uint32_t offset = (resno == 0) ? 0 : 3U * resno - 2;
+				for(uint8_t bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
+				{
+					auto band = res->tileBand + bandIndex;
+					uint8_t orientation = band->orientation;
+					float srcStepSize =
+						Quantizer::getBandStepSize(srcTccp->stepsizes + offset + bandIndex, srcPrec);
+					float scale = band->stepsize / srcStepSize;
+					if(scale == 1.0f)
+						continue;
+					uint32_t x0 = (orientation & 1) ? resLower->width() : 0;
+					uint32_t y0 = (orientation & 2) ? resLower->height() : 0;
+					for(uint32_t j = 0; j < band->height(); ++j)
+					{
+						auto row = (float*)(dest->getBuffer() + (uint64_t)(y0 + j) * dest->stride + x0);
+						for(uint32_t i = 0; i < band->width(); ++i)
+							row[i] *= scale;
+					}
+				}
+			}
+		}
+	}
+	ingestedCoefficients = true;
+
+	return true;
+}
 bool TileProcessor::prepareSodDecompress(CodeStreamDecompress* codeStream)
 {
 	assert(codeStream);
@@ -922,8 +1567,11 @@ bool TileProcessor::prepareSodDecompress(CodeStreamDecompress* codeStream)
 				return false;
 			}
 		}
+		auto offset = m_stream->tell();
 		current_read_size = m_stream->read(zeroCopy ? nullptr : buff, len);
 		tcp->m_compressedTileData->pushBack(buff, len, !zeroCopy);
+		if(current_read_size)
+			tilePartDataSpans.push_back(std::make_pair(offset, (uint64_t)current_read_size));
 	}
 	if(current_read_size != tilePartDataLength)
 		codeStream->getDecompressorState()->setState(J2K_DEC_STATE_NO_EOC);
@@ -932,9 +1580,43 @@ bool TileProcessor::prepareSodDecompress(CodeStreamDecompress* codeStream)
 
 	return true;
 }
+void TileProcessor::releaseCompressedData(void)
+{
+	for(auto& span : tilePartDataSpans)
+		m_stream->release(span.first, span.second);
+	tilePartDataSpans.clear();
+}
+uint64_t TileProcessor::estimateMemory(void)
+{
+	uint32_t tile_x = m_tileIndex % m_cp->t_grid_width;
+	uint32_t tile_y = m_tileIndex / m_cp->t_grid_width;
+	auto bounds = m_cp->getTileBounds(headerImage, tile_x, tile_y);
+	uint8_t reduce = m_isCompressor ? 0 : m_cp->m_coding_params.m_dec.m_reduce;
+	uint64_t bytes = 0;
+	for(uint16_t compno = 0; compno < headerImage->numcomps; ++compno)
+	{
+		auto imageComp = headerImage->comps + compno;
+		if(imageComp->dx == 0 || imageComp->dy == 0)
+			continue;
+		auto compBounds =
+			bounds.rectceildiv(imageComp->dx, imageComp->dy).rectceildivpow2(reduce);
+		if(compBounds.width() == 0 || compBounds.height() == 0)
+			continue;
+		// tile component window buffer
+		bytes += (uint64_t)grkMakeAlignedWidth(compBounds.width()) * compBounds.height() *
+				 sizeof(int32_t);
+		// compressed data buffers of the code blocks, which partition the component's
+		// sub-bands: see CompressCodeblock::allocData
+		if(m_isCompressor)
+			bytes += compBounds.area() * sizeof(uint32_t);
+	}
+
+	return bytes;
+}
 // RATE CONTROL ////////////////////////////////////////////
 bool TileProcessor::rateAllocate(uint32_t* allPacketBytes)
 {
+	GRK_TRACE_SCOPE(GRK_TRACE_STAGE_RATE_CONTROL, m_tileIndex, -1);
 	// rate control by rate/distortion or fixed quality
 	switch(m_cp->m_coding_params.m_enc.rateControlAlgorithm)
 	{
@@ -1184,11 +1866,7 @@ bool TileProcessor::pcrdBisectFeasible(uint32_t* allPacketBytes)
 		}
 	}
 
-	// final simulation will generate correct PLT lengths
-	// and correct tile length
-	return t2.compressPacketsSimulate(m_tileIndex, tcp->numlayers, allPacketBytes, maxLayerLength,
-									  newTilePartProgressionPosition,
-									  packetLengthCache.getMarkers());
+	return simulateFinalLayers(&t2, allPacketBytes, maxLayerLength);
 }
 /*
  Simple bisect algorithm to calculate optimal layer truncation points
@@ -1348,12 +2026,28 @@ bool TileProcessor::pcrdBisectSimple(uint32_t* allPacketBytes)
 			assert(layno == m_tcp->numlayers - 1);
 		}
 	}
-	// final simulation will generate correct PLT lengths
-	// and correct tile length
-	// GRK_INFO("Rate control final simulation");
-	return t2.compressPacketsSimulate(m_tileIndex, m_tcp->numlayers, allPacketBytes, maxLayerLength,
-									  newTilePartProgressionPosition,
-									  packetLengthCache.getMarkers());
+	return simulateFinalLayers(&t2, allPacketBytes, maxLayerLength);
+}
+/**
+ * Final simulation generates correct PLT lengths and correct tile length.
+ * Packet lengths don't depend on the byte budget, so the simulation is not
+ * limited: if even empty packets (SOP and EPH markers and packet headers) exceed
+ * the last layer's size, the tile is written larger than requested rather than
+ * failing
+ */
+bool TileProcessor::simulateFinalLayers(T2Compress* t2, uint32_t* allPacketBytes,
+										uint32_t maxLayerLength)
+{
+	if(!t2->compressPacketsSimulate(m_tileIndex, m_tcp->numlayers, allPacketBytes, UINT_MAX,
+									newTilePartProgressionPosition,
+									packetLengthCache.getMarkers()))
+		return false;
+	if(*allPacketBytes > maxLayerLength)
+		GRK_WARN("Tile %u: rate is too low for packet overhead, so tile is %u bytes larger than "
+				 "requested",
+				 m_tileIndex, *allPacketBytes - maxLayerLength);
+
+	return true;
 }
 static void prepareBlockForFirstLayer(CompressCodeblock* cblk)
 {
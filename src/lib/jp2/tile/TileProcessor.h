@@ -26,6 +26,10 @@
 
 namespace grk
 {
+class T1DecompressScheduler;
+struct T2Compress;
+struct DecompressBlockExec;
+
 /*
  * Tile structure.
  *
@@ -85,21 +89,37 @@ struct TileProcessor
 	bool canWritePocMarker(void);
 	bool writeTilePartT2(uint32_t* tileBytesWritten);
 	bool doCompress(void);
-	bool decompressT1(void);
+	bool decompressT1(bool doPostT1);
 	bool decompressT2(SparseBuffer* srcBuf);
 	bool decompressT2T1(TileCodingParams* tcp, GrkImage* outputImage, bool multiTile, bool doPost);
 	bool ingestUncompressedData(uint8_t* p_src, uint64_t src_length);
+	bool ingestCoefficients(TileProcessor* source);
 	bool needsRateControl();
 	void ingestImage();
 	bool prepareSodDecompress(CodeStreamDecompress* codeStream);
+	/**
+	 * Hint to the stream that the compressed tile part data read so far
+	 * will not be needed again
+	 */
+	void releaseCompressedData(void);
+	/**
+	 * Estimate memory that processing the tile will allocate, for memory budget
+	 * reservations: 32 bit sample buffers of the tile components, plus, when
+	 * compressing, 4 bytes per sample of compressed code block data.
+	 * Compressed tile data is already allocated when the tile is scheduled, and
+	 * T1 and wavelet scratch belong to worker threads, so neither is included.
+	 */
+	uint64_t estimateMemory(void);
 	void generateImage(GrkImage* src_image, Tile* src_tile);
 	GrkImage* getImage(void);
 	void setCorruptPacket(void);
+	void setHeaderOnlyPacket(void);
 	PacketTracker* getPacketTracker(void);
 	grkRectU32 getUnreducedTileWindow(void);
 	TileCodingParams* getTileCodingParams(void);
 	uint8_t getMaxNumDecompressResolutions(void);
 	IBufferedStream* getStream(void);
+	void setStream(IBufferedStream* stream);
 	uint32_t getPreCalculatedTileLen(void);
 	bool canPreCalculateTileLen(void);
 
@@ -128,25 +148,50 @@ struct TileProcessor
 	bool wholeTileDecompress;
 	CodingParams* m_cp;
 	PacketLengthCache packetLengthCache;
+	// Decompressing: if not null, T2 locates packets here instead of decompressing them.
+	// Compressing: if not null, packets are copied from here instead of being compressed
+	PACKET_SPANS* packetSpans;
+	// Decompressing only - true if tile image has been composited into the output
+	// image by the current decompress
+	bool imageComposited;
 
   private:
 	// Compressing only - track which packets have already been written
 	// to the code stream
 	PacketTracker m_packetTracker;
 	IBufferedStream* m_stream;
-	bool m_corrupt_packet;
+	std::atomic<bool> m_corrupt_packet;
 	/** position of the tile part flag in progression order*/
 	uint32_t newTilePartProgressionPosition;
 	// coding/decoding parameters for this tile
 	TileCodingParams* m_tcp;
 	bool isWholeTileDecompress(uint32_t compno);
+	void clearPacketState(void);
+	bool codeBlocksNeedDecompress(void);
+	bool reinit(void);
+	std::vector<grk_precision> outputPrecision(void);
+	bool isImageCurrent(void);
+	bool decompressComponentsT1(const std::vector<uint16_t>& components, bool doPostT1,
+								bool retainStripBlocks = false);
+	bool prepareStripBlocks(TileComponent* tilec, std::vector<DecompressBlockExec*>* blocks,
+							size_t first, bool retain);
+	uint64_t getStripHeight(void);
+	bool useStrips(void);
+	bool decompressStrips(GrkImage* outputImage, bool multiTile);
+	bool canPreview(const std::vector<uint16_t>& components);
+	bool decompressProgressive(T1DecompressScheduler* scheduler, uint16_t blockw, uint16_t blockh,
+							   std::vector<DecompressBlockExec*>* blocks);
+	void preview(uint8_t resno);
 	bool needsMctDecompress(uint32_t compno);
 	bool mctDecompress();
 	bool dcLevelShiftDecompress();
+	bool precisionDecompress();
 	bool dcLevelShiftCompress();
 	bool mct_encode();
 	bool dwt_encode();
 	void t1_encode();
+	bool dwt_t1_encode();
+	void getMctNorms(const double** mct_norms, uint16_t* mct_numcomps);
 	bool encodeT2(uint32_t* packet_bytes_written);
 	bool rateAllocate(uint32_t* allPacketBytes);
 	bool layerNeedsRateControl(uint32_t layno);
@@ -156,11 +201,29 @@ struct TileProcessor
 	void makeLayerSimple(uint32_t layno, double thresh, bool final);
 	bool pcrdBisectFeasible(uint32_t* p_data_written);
 	void makeLayerFeasible(uint32_t layno, uint16_t thresh, bool final);
+	bool simulateFinalLayers(T2Compress* t2, uint32_t* allPacketBytes, uint32_t maxLayerLength);
 	bool truncated;
+	// Decompressing only - number of layers read by the previous T2 pass
+	uint16_t numLayersDecompressed;
+	// Decompressing only - true if a packet header was read without its data
+	bool headerOnlyPackets;
 	GrkImage* m_image;
+	// Decompressing only - unreduced tile window of m_image
+	grkRectU32 m_imageWindow;
+	// Decompressing only - reduction that tile components were initialized with
+	uint8_t m_initReduce;
+	// Decompressing only - reduction of m_image
+	uint8_t m_imageReduce;
+	// Decompressing only - per component output precision of m_image
+	std::vector<grk_precision> m_imagePrecision;
 	bool m_isCompressor;
+	// Compressing only - true if tile holds quantized wavelet coefficients
+	// transcoded from another code stream
+	bool ingestedCoefficients;
 	grkRectU32 unreducedTileWindow;
 	uint32_t preCalculatedTileLen;
+	// Decompressing only - stream offset and length of each tile part's data
+	std::vector<std::pair<uint64_t, uint64_t>> tilePartDataSpans;
 };
 
 struct TileProcessorComparator
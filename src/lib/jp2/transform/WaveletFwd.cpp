@@ -196,6 +196,36 @@ void dwt97::encode_1_real(float* w, int32_t dn, int32_t sn, int32_t parity)
 	}
 #endif
 }
+/**
+ * Tracks completion of horizontal pass stripes at one decomposition level,
+ * and reports each advance of the contiguous run of final rows
+ */
+struct encode_stripe_tracker
+{
+	encode_stripe_tracker(uint8_t resno, uint32_t numRows, uint32_t stripeHeight,
+						  DWT_ROWS_FUNC rowsFinal)
+		: resno(resno), numRows(numRows), stripeHeight(stripeHeight),
+		  done((numRows + stripeHeight - 1) / stripeHeight, false), next(0), rowsFinal(rowsFinal)
+	{}
+	void complete(uint32_t stripe)
+	{
+		std::unique_lock<std::mutex> lk(mutex);
+		done[stripe] = true;
+		auto prev = next;
+		while(next < done.size() && done[next])
+			next++;
+		if(next != prev)
+			rowsFinal(resno, (uint32_t)std::min<uint64_t>((uint64_t)next * stripeHeight, numRows));
+	}
+	uint8_t resno;
+	uint32_t numRows;
+	uint32_t stripeHeight;
+	std::vector<bool> done;
+	size_t next;
+	DWT_ROWS_FUNC rowsFinal;
+	std::mutex mutex;
+};
+
 template<typename T, typename DWT>
 struct encode_h_job
 {
@@ -206,6 +236,8 @@ struct encode_h_job
 	uint32_t min_j;
 	uint32_t max_j;
 	DWT dwt;
+	encode_stripe_tracker* tracker;
+	uint32_t stripe;
 };
 
 template<typename T, typename DWT>
@@ -219,6 +251,8 @@ void encode_h_func(encode_h_job<T, DWT>* job)
 												   job->h.parity == 0 ? true : false);
 	}
 	grkAlignedFree(job->h.mem);
+	if(job->tracker)
+		job->tracker->complete(job->stripe);
 	delete job;
 }
 
@@ -430,7 +464,8 @@ void dwt97::grk_v8dwt_encode_step2(float* fl, float* fw, uint32_t end, uint32_t
 /* Forward 5-3 wavelet transform in 2-D. */
 /* </summary>                           */
 template<typename T, typename DWT>
-bool WaveletFwdImpl::encode_procedure(TileComponent* tilec)
+bool WaveletFwdImpl::encode_procedure(TileComponent* tilec, uint32_t stripeHeight,
+									  DWT_ROWS_FUNC rowsFinal)
 {
 	if(tilec->numresolutions == 1U)
 		return true;
@@ -553,7 +588,48 @@ bool WaveletFwdImpl::encode_procedure(TileComponent* tilec)
 		dn = (uint32_t)(rw - rw1);
 
 		/* Perform horizontal pass */
-		if(num_threads <= 1 || rh <= 1)
+		if(rowsFinal)
+		{
+			// stripes are queued top to bottom, so detail band rows become
+			// final in (roughly) raster order while later stripes are still
+			// being transformed
+			encode_stripe_tracker tracker((uint8_t)(currentRes - tilec->tileCompResolution), rh,
+										  stripeHeight, rowsFinal);
+			std::vector<std::future<int>> results;
+			for(uint32_t j = 0; j < (uint32_t)tracker.done.size(); j++)
+			{
+				auto job = new encode_h_job<T, DWT>();
+				job->h.mem = (T*)grkAlignedMalloc(dataSize);
+				if(!job->h.mem)
+				{
+					delete job;
+					rc = false;
+					break;
+				}
+				job->h.dn = dn;
+				job->h.sn = sn;
+				job->h.parity = parity_row;
+				job->rw = rw;
+				job->w = stride;
+				job->tiledp = tiledp;
+				job->min_j = j * stripeHeight;
+				job->max_j = std::min<uint32_t>(rh, job->min_j + stripeHeight);
+				job->tracker = &tracker;
+				job->stripe = j;
+				results.emplace_back(ThreadPool::get()->enqueue([job] {
+					encode_h_func<T, DWT>(job);
+					return 0;
+				}));
+			}
+			for(auto& result : results)
+				result.get();
+			if(!rc)
+			{
+				grkAlignedFree(bj);
+				return false;
+			}
+		}
+		else if(num_threads <= 1 || rh <= 1)
 		{
 			uint32_t j;
 			DWT dwt;
@@ -617,13 +693,21 @@ bool WaveletFwdImpl::encode_procedure(TileComponent* tilec)
 
 bool WaveletFwdImpl::compress(TileComponent* tile_comp, uint8_t qmfbid)
 {
+	return compress(tile_comp, qmfbid, 0, nullptr);
+}
+bool WaveletFwdImpl::compress(TileComponent* tile_comp, uint8_t qmfbid, uint32_t stripeHeight,
+							  DWT_ROWS_FUNC rowsFinal)
+{
+	// stripes rely on the thread pool
+	if(!stripeHeight || ThreadPool::get()->num_threads() <= 1)
+		rowsFinal = nullptr;
 	if(qmfbid == 1)
 	{
-		return encode_procedure<int32_t, dwt53>(tile_comp);
+		return encode_procedure<int32_t, dwt53>(tile_comp, stripeHeight, rowsFinal);
 	}
 	else if(qmfbid == 0)
 	{
-		return encode_procedure<float, dwt97>(tile_comp);
+		return encode_procedure<float, dwt97>(tile_comp, stripeHeight, rowsFinal);
 	}
 	return false;
 }
@@ -50,15 +50,28 @@ class dwt97
 	void encode_1_real(float* w, int32_t dn, int32_t sn, int32_t parity);
 };
 
+/**
+ * Notification that rows [0, rows) (buffer coordinates) of the detail bands of
+ * resolution resno are final. Called from worker threads, with non-decreasing
+ * rows for a given resolution.
+ */
+typedef std::function<void(uint8_t resno, uint32_t rows)> DWT_ROWS_FUNC;
+
 class WaveletFwdImpl
 {
   public:
 	virtual ~WaveletFwdImpl() = default;
 	bool compress(TileComponent* tile_comp, uint8_t qmfbid);
+	/**
+	 * Forward transform, with horizontal pass performed in stripes of stripeHeight rows;
+	 * rowsFinal is notified as each contiguous run of stripes completes
+	 */
+	bool compress(TileComponent* tile_comp, uint8_t qmfbid, uint32_t stripeHeight,
+				  DWT_ROWS_FUNC rowsFinal);
 
   private:
 	template<typename T, typename DWT>
-	bool encode_procedure(TileComponent* tilec);
+	bool encode_procedure(TileComponent* tilec, uint32_t stripeHeight, DWT_ROWS_FUNC rowsFinal);
 };
 
 } // namespace grk
@@ -798,18 +798,20 @@ static bool decompress_v_mt_53(uint32_t num_threads, size_t data_size, dwt_data<
 
 /* <summary>                            */
 /* Inverse wavelet transform in 2-D.    */
+/* Resolutions lowres+1 .. numres-1     */
+/* are synthesized                      */
 /* </summary>                           */
-static bool decompress_tile_53(TileComponent* tilec, uint32_t numres)
+static bool decompress_tile_53(TileComponent* tilec, uint8_t lowres, uint32_t numres)
 {
-	if(numres == 1U)
+	if(numres <= lowres + 1U)
 		return true;
 
-	auto tr = tilec->tileCompResolution;
+	auto tr = tilec->tileCompResolution + lowres;
 	uint32_t rw = tr->width();
 	uint32_t rh = tr->height();
 
 	uint32_t num_threads = (uint32_t)ThreadPool::get()->num_threads();
-	size_t data_size = max_resolution(tr, numres);
+	size_t data_size = max_resolution(tilec->tileCompResolution, numres);
 	/* overflow check */
 	if(data_size > (SIZE_MAX / PLL_COLS_53 / sizeof(int32_t)))
 	{
@@ -823,7 +825,7 @@ static bool decompress_tile_53(TileComponent* tilec, uint32_t numres)
 	dwt_data<int32_t> vert;
 	data_size *= PLL_COLS_53 * sizeof(int32_t);
 	bool rc = true;
-	for(uint8_t res = 1; res < numres; ++res)
+	for(uint8_t res = (uint8_t)(lowres + 1); res < numres; ++res)
 	{
 		horiz.sn_full = rw;
 		vert.sn_full = rh;
@@ -1268,17 +1270,19 @@ static bool decompress_v_mt_97(uint32_t num_threads, size_t data_size,
 
 /* <summary>                             */
 /* Inverse 9-7 wavelet transform in 2-D. */
+/* Resolutions lowres+1 .. numres-1      */
+/* are synthesized                       */
 /* </summary>                            */
-static bool decompress_tile_97(TileComponent* GRK_RESTRICT tilec, uint32_t numres)
+static bool decompress_tile_97(TileComponent* GRK_RESTRICT tilec, uint8_t lowres, uint32_t numres)
 {
-	if(numres == 1U)
+	if(numres <= lowres + 1U)
 		return true;
 
-	auto tr = tilec->tileCompResolution;
+	auto tr = tilec->tileCompResolution + lowres;
 	uint32_t rw = tr->width();
 	uint32_t rh = tr->height();
 
-	size_t data_size = max_resolution(tr, numres);
+	size_t data_size = max_resolution(tilec->tileCompResolution, numres);
 	dwt_data<vec4f> horiz;
 	dwt_data<vec4f> vert;
 	if(!horiz.alloc(data_size))
@@ -1288,7 +1292,7 @@ static bool decompress_tile_97(TileComponent* GRK_RESTRICT tilec, uint32_t numre
 	}
 	vert.mem = horiz.mem;
 	uint32_t num_threads = (uint32_t)ThreadPool::get()->num_threads();
-	for(uint8_t res = 1; res < numres; ++res)
+	for(uint8_t res = (uint8_t)(lowres + 1); res < numres; ++res)
 	{
 		horiz.sn_full = rw;
 		vert.sn_full = rh;
@@ -2079,10 +2083,11 @@ bool decompress_partial_tile(TileComponent* GRK_RESTRICT tilec, uint16_t compno,
 				   << ", total samples = " << len;
 				grk_memcheck_all<int32_t>((int32_t*)job->data.mem, len, ss.str());
 #endif
-				if(!sa->write(resno,
-							  grkRectU32(j, resWindowRect.y0, j + width,
-										 resWindowRect.y0 + job->data.win_l.length() +
-											 job->data.win_h.length()),
+				// padded band windows may extend below the resolution window
+				auto y1 = std::min<uint32_t>(resWindowRect.y1,
+											 resWindowRect.y0 + job->data.win_l.length() +
+												 job->data.win_h.length());
+				if(!sa->write(resno, grkRectU32(j, resWindowRect.y0, j + width, y1),
 							  (int32_t*)(job->data.mem + ((int64_t)resWindowRect.y0 -
 														  2 * (int64_t)job->data.win_l.x0) *
 															 VERT_PASS_WIDTH),
@@ -2235,7 +2240,7 @@ bool WaveletReverse::decompress(TileProcessor* p_tcd, TileComponent* tilec, uint
 	if(qmfbid == 1)
 	{
 		if(p_tcd->wholeTileDecompress)
-			return decompress_tile_53(tilec, numres);
+			return decompress_tile_53(tilec, 0, numres);
 		else
 		{
 			constexpr uint32_t VERT_PASS_WIDTH = 4;
@@ -2248,7 +2253,7 @@ bool WaveletReverse::decompress(TileProcessor* p_tcd, TileComponent* tilec, uint
 	else
 	{
 		if(p_tcd->wholeTileDecompress)
-			return decompress_tile_97(tilec, numres);
+			return decompress_tile_97(tilec, 0, numres);
 		else
 		{
 			constexpr uint32_t VERT_PASS_WIDTH = 1;
@@ -2260,5 +2265,16 @@ bool WaveletReverse::decompress(TileProcessor* p_tcd, TileComponent* tilec, uint
 	}
 }
 
+bool WaveletReverse::decompressResolution(TileProcessor* p_tcd, TileComponent* tilec,
+										  uint8_t resno, uint8_t qmfbid)
+{
+	GRK_UNUSED(p_tcd);
+	assert(p_tcd->wholeTileDecompress && resno > 0);
+	if(qmfbid == 1)
+		return decompress_tile_53(tilec, (uint8_t)(resno - 1), resno + 1U);
+	else
+		return decompress_tile_97(tilec, (uint8_t)(resno - 1), resno + 1U);
+}
+
 } // namespace grk
 #endif
@@ -57,6 +57,17 @@ class WaveletReverse
   public:
 	bool decompress(TileProcessor* p_tcd, TileComponent* tilec, uint16_t compno, grkRectU32 window,
 					uint8_t numres, uint8_t qmfbid);
+	/**
+	 * Synthesize a single resolution of a whole tile component
+	 * from the resolution directly below it
+	 *
+	 * @param p_tcd tile processor
+	 * @param tilec tile component
+	 * @param resno resolution to synthesize (must be greater than zero)
+	 * @param qmfbid wavelet filter
+	 */
+	bool decompressResolution(TileProcessor* p_tcd, TileComponent* tilec, uint8_t resno,
+							  uint8_t qmfbid);
 };
 
 } // namespace grk
@@ -29,7 +29,8 @@ void grk_read(const uint8_t* buffer, TYPE* value, uint32_t numBytes);
 // buffered stream
 BufferedStream::BufferedStream(uint8_t* buffer, size_t buffer_size, bool is_input)
 	: m_user_data(nullptr), m_free_user_data_fn(nullptr), m_user_data_length(0), m_read_fn(nullptr),
-	  m_zero_copy_read_fn(nullptr), m_write_fn(nullptr), m_seek_fn(nullptr),
+	  m_zero_copy_read_fn(nullptr), m_write_fn(nullptr), m_seek_fn(nullptr), m_prefetch_fn(nullptr),
+	  m_release_fn(nullptr), m_write_at_fn(nullptr),
 	  m_status(is_input ? GROK_STREAM_STATUS_INPUT : GROK_STREAM_STATUS_OUTPUT), m_buf(nullptr),
 	  m_buffered_bytes(0), m_read_bytes_seekable(0), m_stream_offset(0)
 {
@@ -53,6 +54,10 @@ void* BufferedStream::getUserData(void)
 {
 	return m_user_data;
 }
+grk_stream_free_user_data_fn BufferedStream::getFreeUserDataFunction(void)
+{
+	return m_free_user_data_fn;
+}
 void BufferedStream::setUserDataLength(uint64_t len)
 {
 	m_user_data_length = len;
@@ -77,6 +82,18 @@ void BufferedStream::setSeekFunction(grk_stream_seek_fn fn)
 {
 	m_seek_fn = fn;
 }
+void BufferedStream::setPrefetchFunction(grk_stream_prefetch_fn fn)
+{
+	m_prefetch_fn = fn;
+}
+void BufferedStream::setReleaseFunction(grk_stream_release_fn fn)
+{
+	m_release_fn = fn;
+}
+void BufferedStream::setWriteAtFunction(grk_stream_write_at_fn fn)
+{
+	m_write_at_fn = fn;
+}
 // note: passing in nullptr for buffer will execute a zero-copy read
 size_t BufferedStream::read(uint8_t* buffer, size_t p_size)
 {
@@ -468,6 +485,68 @@ bool BufferedStream::hasSeek(void)
 {
 	return m_seek_fn != nullptr;
 }
+void BufferedStream::prefetch(uint64_t offset, uint64_t numBytes)
+{
+	if(m_prefetch_fn && numBytes && (m_status & GROK_STREAM_STATUS_INPUT))
+		m_prefetch_fn(offset, numBytes, m_user_data);
+}
+void BufferedStream::release(uint64_t offset, uint64_t numBytes)
+{
+	if(m_release_fn && numBytes && (m_status & GROK_STREAM_STATUS_INPUT))
+		m_release_fn(offset, numBytes, m_user_data);
+}
+
+bool BufferedStream::supportsWriteAt(void)
+{
+	return m_write_at_fn && (m_status & GROK_STREAM_STATUS_OUTPUT);
+}
+bool BufferedStream::writeAt(const uint8_t* buffer, size_t numBytes, uint64_t offset)
+{
+	if(!supportsWriteAt() || (m_status & GROK_STREAM_STATUS_ERROR))
+		return false;
+	assert(m_buffered_bytes == 0);
+
+	return m_write_at_fn(buffer, numBytes, offset, m_user_data);
+}
+
+struct WriteAtStream
+{
+	WriteAtStream(IBufferedStream* parentStream, uint64_t offset)
+		: parent(parentStream), start(offset), off(0)
+	{}
+	IBufferedStream* parent;
+	uint64_t start;
+	uint64_t off;
+};
+static size_t write_at_stream_write(void* buffer, size_t numBytes, WriteAtStream* stream)
+{
+	if(!stream->parent->writeAt((const uint8_t*)buffer, numBytes, stream->start + stream->off))
+		return 0;
+	stream->off += numBytes;
+
+	return numBytes;
+}
+static bool write_at_stream_seek(uint64_t offset, WriteAtStream* stream)
+{
+	stream->off = offset;
+
+	return true;
+}
+static void write_at_stream_free(WriteAtStream* stream)
+{
+	delete stream;
+}
+grk_stream* BufferedStream::createWriteAtStream(IBufferedStream* parent, uint64_t offset,
+												 size_t bufferSize)
+{
+	auto streamImpl = new BufferedStream(nullptr, bufferSize, false);
+	streamImpl->setUserData(new WriteAtStream(parent, offset),
+							(grk_stream_free_user_data_fn)write_at_stream_free);
+	streamImpl->setWriteFunction((grk_stream_write_fn)write_at_stream_write);
+	streamImpl->setSeekFunction((grk_stream_seek_fn)write_at_stream_seek);
+
+	return streamImpl->getWrapper();
+}
 
 bool BufferedStream::isMemStream()
 {
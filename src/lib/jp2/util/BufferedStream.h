@@ -42,12 +42,29 @@ struct BufferedStream : public IBufferedStream
 
 	void setUserData(void* data, grk_stream_free_user_data_fn freeUserDataFun);
 	void* getUserData(void);
+	grk_stream_free_user_data_fn getFreeUserDataFunction(void);
 	void setUserDataLength(uint64_t len);
 	uint32_t getStatus(void);
 	void setReadFunction(grk_stream_read_fn fn);
 	void setZeroCopyReadFunction(grk_stream_zero_copy_read_fn fn);
 	void setWriteFunction(grk_stream_write_fn fn);
 	void setSeekFunction(grk_stream_seek_fn fn);
+	void setPrefetchFunction(grk_stream_prefetch_fn fn);
+	void setReleaseFunction(grk_stream_release_fn fn);
+	void setWriteAtFunction(grk_stream_write_at_fn fn);
+	/**
+	 * Create a buffered write stream for the bytes of parent starting at offset.
+	 * It flushes with parent->writeAt, so streams covering disjoint byte
+	 * ranges of the same parent can be written concurrently.
+	 *
+	 * @param		parent		stream supporting positional writes
+	 * @param		offset		absolute offset in parent of first byte
+	 * @param		bufferSize	size of write buffer
+	 *
+	 * @return		new stream (release with grk_object_unref)
+	 */
+	static grk_stream* createWriteAtStream(IBufferedStream* parent, uint64_t offset,
+										   size_t bufferSize);
 	/**
 	 * Reads some bytes from the stream.
 	 * @param		buffer	pointer to the data buffer
@@ -112,6 +129,10 @@ struct BufferedStream : public IBufferedStream
 	 * Check if stream is seekable.
 	 */
 	bool hasSeek();
+	void prefetch(uint64_t offset, uint64_t numBytes);
+	void release(uint64_t offset, uint64_t numBytes);
+	bool supportsWriteAt(void);
+	bool writeAt(const uint8_t* buffer, size_t numBytes, uint64_t offset);
 	bool supportsZeroCopy();
 	uint8_t* getZeroCopyPtr();
 
@@ -189,6 +210,18 @@ struct BufferedStream : public IBufferedStream
 	 * Pointer to actual seek function (if available).
 	 */
 	grk_stream_seek_fn m_seek_fn;
+	/**
+	 * Pointer to prefetch function (if available).
+	 */
+	grk_stream_prefetch_fn m_prefetch_fn;
+	/**
+	 * Pointer to release function (if available).
+	 */
+	grk_stream_release_fn m_release_fn;
+	/**
+	 * Pointer to positional write function (if available).
+	 */
+	grk_stream_write_at_fn m_write_at_fn;
 	/**
 	 * Stream status flags
 	 */
@@ -0,0 +1,229 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "grk_includes.h"
+#include <map>
+#include <mutex>
+
+namespace grk
+{
+const size_t chunkedMemStreamDefaultChunkSize = 1024 * 1024;
+
+/**
+ * Process-wide pool of free chunks, so that chunks of streams
+ * that have been destroyed are reused by later streams
+ */
+class ChunkPool
+{
+  public:
+	~ChunkPool()
+	{
+		for(auto& entry : freeChunks)
+		{
+			for(auto chunk : entry.second)
+				delete[] chunk;
+		}
+	}
+	static ChunkPool* get(void)
+	{
+		static ChunkPool pool;
+		return &pool;
+	}
+	uint8_t* acquire(size_t chunkSize)
+	{
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			auto& chunks = freeChunks[chunkSize];
+			if(!chunks.empty())
+			{
+				auto chunk = chunks.back();
+				chunks.pop_back();
+				pooledBytes -= chunkSize;
+				return chunk;
+			}
+		}
+		return new uint8_t[chunkSize];
+	}
+	void release(uint8_t* chunk, size_t chunkSize)
+	{
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			if(pooledBytes + chunkSize <= maxPooledBytes)
+			{
+				freeChunks[chunkSize].push_back(chunk);
+				pooledBytes += chunkSize;
+				return;
+			}
+		}
+		delete[] chunk;
+	}
+
+  private:
+	ChunkPool() : pooledBytes(0) {}
+	// upper bound on memory held by free chunks
+	static const size_t maxPooledBytes = 64 * 1024 * 1024;
+	std::mutex poolMutex;
+	std::map<size_t, std::vector<uint8_t*>> freeChunks;
+	size_t pooledBytes;
+};
+
+/**
+ * Growable write stream stored in fixed size chunks.
+ *
+ * Positional writes to disjoint byte ranges may run concurrently:
+ * chunk allocation and the stream length are guarded by a mutex,
+ * while bytes are copied without holding it.
+ */
+class ChunkedMemStream
+{
+  public:
+	explicit ChunkedMemStream(size_t chunkSize) : m_chunkSize(chunkSize), m_off(0), m_len(0) {}
+	~ChunkedMemStream()
+	{
+		for(auto chunk : m_chunks)
+			ChunkPool::get()->release(chunk, m_chunkSize);
+	}
+	size_t write(const uint8_t* buffer, size_t numBytes)
+	{
+		if(!writeAt(buffer, numBytes, m_off))
+			return 0;
+		m_off += numBytes;
+
+		return numBytes;
+	}
+	bool seek(uint64_t offset)
+	{
+		m_off = offset;
+
+		return true;
+	}
+	bool writeAt(const uint8_t* buffer, size_t numBytes, uint64_t offset)
+	{
+		uint64_t end = offset + numBytes;
+		size_t firstChunk = (size_t)(offset / m_chunkSize);
+		std::vector<uint8_t*> chunks;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			while((uint64_t)m_chunks.size() * m_chunkSize < end)
+				m_chunks.push_back(ChunkPool::get()->acquire(m_chunkSize));
+			// bytes skipped over must not expose stale contents of recycled chunks
+			if(offset > m_len)
+				fill(m_len, offset);
+			m_len = std::max<uint64_t>(m_len, end);
+			chunks.assign(m_chunks.begin() + (ptrdiff_t)firstChunk, m_chunks.end());
+		}
+		size_t chunkOffset = (size_t)(offset % m_chunkSize);
+		for(auto chunk : chunks)
+		{
+			if(!numBytes)
+				break;
+			size_t len = std::min<size_t>(numBytes, m_chunkSize - chunkOffset);
+			memcpy(chunk + chunkOffset, buffer, len);
+			buffer += len;
+			numBytes -= len;
+			chunkOffset = 0;
+		}
+
+		return true;
+	}
+	size_t getChunks(grk_stream_chunk* chunks, size_t maxChunks)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t numChunks = (size_t)((m_len + m_chunkSize - 1) / m_chunkSize);
+		for(size_t i = 0; chunks && i < std::min<size_t>(numChunks, maxChunks); ++i)
+		{
+			chunks[i].data = m_chunks[i];
+			chunks[i].len = (size_t)std::min<uint64_t>(m_chunkSize, m_len - (uint64_t)i * m_chunkSize);
+		}
+
+		return numChunks;
+	}
+
+  private:
+	// zero [begin, end): caller holds the mutex
+	void fill(uint64_t begin, uint64_t end)
+	{
+		while(begin < end)
+		{
+			size_t chunkOffset = (size_t)(begin % m_chunkSize);
+			size_t len = (size_t)std::min<uint64_t>(end - begin, m_chunkSize - chunkOffset);
+			memset(m_chunks[(size_t)(begin / m_chunkSize)] + chunkOffset, 0, len);
+			begin += len;
+		}
+	}
+	size_t m_chunkSize;
+	std::vector<uint8_t*> m_chunks;
+	// current position of sequential writes
+	uint64_t m_off;
+	// number of bytes in stream
+	uint64_t m_len;
+	std::mutex m_mutex;
+};
+
+static size_t chunked_write(void* buffer, size_t numBytes, ChunkedMemStream* stream)
+{
+	return stream->write((const uint8_t*)buffer, numBytes);
+}
+
+static bool chunked_seek(uint64_t offset, ChunkedMemStream* stream)
+{
+	return stream->seek(offset);
+}
+
+static bool chunked_write_at(const uint8_t* buffer, size_t numBytes, uint64_t offset,
+							 ChunkedMemStream* stream)
+{
+	return stream->writeAt(buffer, numBytes, offset);
+}
+
+static void chunked_free(void* user_data)
+{
+	delete(ChunkedMemStream*)user_data;
+}
+
+grk_stream* create_chunked_mem_write_stream(size_t chunkSize)
+{
+	if(!chunkSize)
+		chunkSize = chunkedMemStreamDefaultChunkSize;
+	auto stream = grk_stream_new(chunkSize, false);
+	grk_stream_set_user_data(stream, new ChunkedMemStream(chunkSize), chunked_free);
+	grk_stream_set_write_function(stream, (grk_stream_write_fn)chunked_write);
+	grk_stream_set_seek_function(stream, (grk_stream_seek_fn)chunked_seek);
+	BufferedStream::getImpl(stream)->setWriteAtFunction((grk_stream_write_at_fn)chunked_write_at);
+
+	return stream;
+}
+
+size_t get_chunked_mem_stream_chunks(grk_stream* stream, grk_stream_chunk* chunks,
+									 size_t maxChunks)
+{
+	if(!stream)
+		return 0;
+	auto streamImpl = BufferedStream::getImpl(stream);
+	// user data of any other kind of stream is not a ChunkedMemStream
+	if(streamImpl->getFreeUserDataFunction() != chunked_free || !streamImpl->getUserData())
+	{
+		GRK_ERROR("Stream is not a chunked memory stream");
+		return 0;
+	}
+	// bytes still held in the stream's write buffer belong to the last chunks
+	if(!streamImpl->flush())
+		return 0;
+
+	return ((ChunkedMemStream*)streamImpl->getUserData())->getChunks(chunks, maxChunks);
+}
+
+} // namespace grk
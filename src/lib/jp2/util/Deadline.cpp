@@ -0,0 +1,60 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "grk_includes.h"
+
+namespace grk
+{
+Deadline::Deadline() : m_budgetMs(0), m_cancelled(false), m_interrupted(false) {}
+void Deadline::setBudget(uint32_t budgetMs)
+{
+	m_budgetMs = budgetMs;
+}
+void Deadline::start(void)
+{
+	m_interrupted = false;
+	if(m_budgetMs)
+		m_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_budgetMs);
+}
+void Deadline::cancel(void)
+{
+	m_cancelled = true;
+}
+bool Deadline::expired(void)
+{
+	if(m_interrupted)
+		return true;
+	if(m_cancelled || (m_budgetMs && std::chrono::steady_clock::now() >= m_end))
+	{
+		m_interrupted = true;
+		return true;
+	}
+
+	return false;
+}
+void Deadline::finish(void)
+{
+	m_cancelled = false;
+	if(m_interrupted)
+		GRK_WARN("Decompress was interrupted: image was reconstructed from partially decoded "
+				 "data");
+}
+bool Deadline::interrupted(void) const
+{
+	return m_interrupted;
+}
+
+} // namespace grk
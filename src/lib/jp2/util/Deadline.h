@@ -0,0 +1,68 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <atomic>
+#include <chrono>
+
+#pragma once
+namespace grk
+{
+/*  Deadline
+
+ Time budget for a decompress, which may also be cancelled from another thread.
+ Once the deadline has passed, T2 stops reading packets and T1 stops decompressing
+ code blocks: the image is reconstructed from the coefficients decoded so far.
+ */
+class Deadline
+{
+  public:
+	Deadline(void);
+	/**
+	 * Set time budget for each decompress
+	 *
+	 * @param budgetMs	budget in milliseconds, or zero for no time limit
+	 */
+	void setBudget(uint32_t budgetMs);
+	/**
+	 * Start the clock for a new decompress
+	 */
+	void start(void);
+	/**
+	 * Cancel the current decompress, or the next one if none is running
+	 */
+	void cancel(void);
+	/**
+	 * Check whether remaining work should be skipped. Callers only check
+	 * when they have work left, so a true return marks the decompress as interrupted.
+	 */
+	bool expired(void);
+	/**
+	 * Finish the current decompress, clearing any pending cancellation
+	 */
+	void finish(void);
+	/**
+	 * @return true if the last decompress was cut short
+	 */
+	bool interrupted(void) const;
+
+  private:
+	uint32_t m_budgetMs;
+	std::chrono::steady_clock::time_point m_end;
+	std::atomic<bool> m_cancelled;
+	std::atomic<bool> m_interrupted;
+};
+
+} // namespace grk
@@ -191,6 +191,44 @@ static int32_t close_fd(grk_handle fd)
 	return close(fd);
 }
 
+/**
+ * Apply madvise advice to the pages of the mapping covering [offset, offset + numBytes).
+ * If inner is true, only pages lying completely inside the range are advised,
+ * so that neighbouring data sharing a page is left alone.
+ */
+static void advise(MemStream* memStream, uint64_t offset, uint64_t numBytes, int advice, bool inner)
+{
+	if(!memStream || !memStream->buf || offset >= memStream->len)
+		return;
+	uint64_t end = std::min<uint64_t>(offset + numBytes, memStream->len);
+	static const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+	uint64_t begin;
+	if(inner)
+	{
+		begin = ((offset + pageSize - 1) / pageSize) * pageSize;
+		// the final page of the mapping may be partial
+		if(end != memStream->len)
+			end = (end / pageSize) * pageSize;
+	}
+	else
+	{
+		begin = (offset / pageSize) * pageSize;
+	}
+	if(end <= begin)
+		return;
+	madvise(memStream->buf + begin, (size_t)(end - begin), advice);
+}
+
+static void mapped_prefetch(uint64_t offset, uint64_t numBytes, void* user_data)
+{
+	advise((MemStream*)user_data, offset, numBytes, MADV_WILLNEED, false);
+}
+
+static void mapped_release(uint64_t offset, uint64_t numBytes, void* user_data)
+{
+	advise((MemStream*)user_data, offset, numBytes, MADV_DONTNEED, true);
+}
+
 #endif
 
 static void mem_map_free(void* user_data)
@@ -235,6 +273,18 @@ grk_stream* create_mapped_file_read_stream(const char* fname)
 	auto stream = streamImpl->getWrapper();
 	grk_stream_set_user_data(stream, memStream, (grk_stream_free_user_data_fn)mem_map_free);
 	set_up_mem_stream(stream, memStream->len, true);
+#ifndef _WIN32
+	// tiles are read out of order, so kernel read-ahead mostly fetches pages we
+	// don't need: instead, the code stream prefetches the tile parts it is about to
+	// decompress (from TLM or SOT markers) and releases them once they are decompressed
+	madvise(memStream->buf, memStream->len, MADV_RANDOM);
+#ifdef MADV_HUGEPAGE
+	// best effort: only honoured by kernels supporting huge pages for the page cache
+	madvise(memStream->buf, memStream->len, MADV_HUGEPAGE);
+#endif
+	streamImpl->setPrefetchFunction(mapped_prefetch);
+	streamImpl->setReleaseFunction(mapped_release);
+#endif
 
 	return stream;
 }
@@ -0,0 +1,400 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "grk_includes.h"
+
+#ifdef GROK_HAVE_URING
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <map>
+#include <deque>
+#include <liburing.h>
+#endif
+
+namespace grk
+{
+#ifdef GROK_HAVE_URING
+
+const size_t uringDefaultBlockSize = 1024 * 1024;
+const uint32_t uringDefaultQueueDepth = 16;
+
+/**
+ * Block of file read asynchronously
+ */
+struct UringReadBlock
+{
+	UringReadBlock(uint64_t blockIndex, size_t blockLength)
+		: index(blockIndex), data(new uint8_t[blockLength]), len(0), pending(true), error(false)
+	{}
+	~UringReadBlock()
+	{
+		delete[] data;
+	}
+	uint64_t index;
+	uint8_t* data;
+	// number of valid bytes, once read has completed
+	size_t len;
+	// true while read is in flight
+	bool pending;
+	bool error;
+};
+
+/**
+ * Read-ahead file reader backed by io_uring.
+ *
+ * The file is split into fixed size blocks. Blocks are read asynchronously,
+ * either because the stream has been told that they will be needed soon
+ * (prefetch hints derived from TLM/SOT markers), or as sequential read-ahead
+ * from the current position. At most queueDepth reads are in flight, and at most
+ * 2 * queueDepth blocks are resident, so memory use is bounded.
+ */
+struct UringReadStream
+{
+	UringReadStream(int fd, uint64_t fileLength, size_t blockSize, uint32_t queueDepth)
+		: m_fd(fd), m_length(fileLength), m_off(0), m_blockSize(blockSize),
+		  m_queueDepth(queueDepth), m_maxBlocks(2 * (size_t)queueDepth), m_inFlight(0),
+		  m_ringInitialized(false)
+	{
+		memset(&m_ring, 0, sizeof(m_ring));
+	}
+	~UringReadStream()
+	{
+		if(m_ringInitialized)
+		{
+			// kernel may still be writing into blocks, so wait for all reads to complete
+			while(m_inFlight)
+			{
+				if(!reap(true))
+					break;
+			}
+			io_uring_queue_exit(&m_ring);
+		}
+		for(auto& b : m_blocks)
+			delete b.second;
+		if(m_fd >= 0)
+			::close(m_fd);
+	}
+	bool init(void)
+	{
+		int ret = io_uring_queue_init(m_queueDepth, &m_ring, 0);
+		if(ret < 0)
+		{
+			GRK_ERROR("io_uring queue initialization failed: %s", strerror(-ret));
+			return false;
+		}
+		m_ringInitialized = true;
+
+		return true;
+	}
+	size_t read(uint8_t* buffer, size_t numBytes)
+	{
+		size_t totalRead = 0;
+		while(totalRead < numBytes && m_off < m_length)
+		{
+			uint64_t blockIndex = m_off / m_blockSize;
+			auto block = acquire(blockIndex);
+			if(!block)
+				break;
+			size_t inBlock = (size_t)(m_off - blockIndex * m_blockSize);
+			if(inBlock >= block->len)
+				break;
+			size_t toCopy = std::min<size_t>(numBytes - totalRead, block->len - inBlock);
+			memcpy(buffer + totalRead, block->data + inBlock, toCopy);
+			totalRead += toCopy;
+			m_off += toCopy;
+		}
+		evict();
+		topUp();
+
+		return totalRead;
+	}
+	bool seek(uint64_t offset)
+	{
+		if(offset > m_length)
+			return false;
+		m_off = offset;
+
+		return true;
+	}
+	void prefetch(uint64_t offset, uint64_t numBytes)
+	{
+		if(offset >= m_length)
+			return;
+		uint64_t end = std::min<uint64_t>(offset + numBytes, m_length);
+		for(uint64_t b = offset / m_blockSize; b * m_blockSize < end; ++b)
+			m_hints.push_back(b);
+		topUp();
+	}
+
+  private:
+	uint64_t numBlocks(void)
+	{
+		return (m_length + m_blockSize - 1) / m_blockSize;
+	}
+	uint64_t currentBlock(void)
+	{
+		return m_off / m_blockSize;
+	}
+	/**
+	 * Get block, waiting for its read to complete if necessary
+	 */
+	UringReadBlock* acquire(uint64_t blockIndex)
+	{
+		auto it = m_blocks.find(blockIndex);
+		if(it == m_blocks.end())
+		{
+			if(!submit(blockIndex))
+				return nullptr;
+			it = m_blocks.find(blockIndex);
+		}
+		auto block = it->second;
+		while(block->pending)
+		{
+			if(!reap(true))
+				return nullptr;
+		}
+		if(block->error)
+			return nullptr;
+
+		return block;
+	}
+	/**
+	 * Queue asynchronous read of block
+	 */
+	bool submit(uint64_t blockIndex)
+	{
+		// respect queue depth and resident block limit
+		while(m_inFlight >= m_queueDepth || m_blocks.size() >= m_maxBlocks)
+		{
+			if(m_blocks.size() >= m_maxBlocks && evictFarthest())
+				continue;
+			if(!m_inFlight || !reap(true))
+				return false;
+		}
+		auto sqe = io_uring_get_sqe(&m_ring);
+		if(!sqe)
+		{
+			GRK_ERROR("io_uring submission queue full");
+			return false;
+		}
+		uint64_t offset = blockIndex * m_blockSize;
+		auto len = (size_t)std::min<uint64_t>(m_blockSize, m_length - offset);
+		auto block = new UringReadBlock(blockIndex, len);
+		io_uring_prep_read(sqe, m_fd, block->data, (unsigned)len, (off_t)offset);
+		io_uring_sqe_set_data(sqe, block);
+		int ret = io_uring_submit(&m_ring);
+		if(ret < 0)
+		{
+			GRK_ERROR("io_uring submit failed: %s", strerror(-ret));
+			delete block;
+			return false;
+		}
+		m_blocks[blockIndex] = block;
+		m_inFlight++;
+
+		return true;
+	}
+	/**
+	 * Process a completed read
+	 *
+	 * @param wait if true, block until a completion is available
+	 * @return true if a completion was processed
+	 */
+	bool reap(bool wait)
+	{
+		io_uring_cqe* cqe = nullptr;
+		int ret = wait ? io_uring_wait_cqe(&m_ring, &cqe) : io_uring_peek_cqe(&m_ring, &cqe);
+		if(ret < 0 || !cqe)
+		{
+			if(wait)
+				GRK_ERROR("io_uring wait for completion failed: %s", strerror(-ret));
+			return false;
+		}
+		auto block = (UringReadBlock*)io_uring_cqe_get_data(cqe);
+		if(cqe->res < 0)
+		{
+			GRK_ERROR("io_uring read failed: %s", strerror(-cqe->res));
+			block->error = true;
+		}
+		else
+		{
+			block->len = (size_t)cqe->res;
+		}
+		block->pending = false;
+		m_inFlight--;
+		io_uring_cqe_seen(&m_ring, cqe);
+
+		return true;
+	}
+	/**
+	 * Free completed blocks that lie behind the current position
+	 */
+	void evict(void)
+	{
+		auto current = currentBlock();
+		for(auto it = m_blocks.begin(); it != m_blocks.end() && it->first < current;)
+		{
+			if(it->second->pending)
+			{
+				++it;
+				continue;
+			}
+			delete it->second;
+			it = m_blocks.erase(it);
+		}
+	}
+	/**
+	 * Free the completed block farthest from the current position
+	 *
+	 * @return true if a block was freed
+	 */
+	bool evictFarthest(void)
+	{
+		auto current = currentBlock();
+		auto victim = m_blocks.end();
+		uint64_t maxDistance = 0;
+		for(auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+		{
+			if(it->second->pending || it->first == current)
+				continue;
+			uint64_t distance = it->first > current ? it->first - current : current - it->first;
+			if(victim == m_blocks.end() || distance > maxDistance)
+			{
+				victim = it;
+				maxDistance = distance;
+			}
+		}
+		if(victim == m_blocks.end())
+			return false;
+		delete victim->second;
+		m_blocks.erase(victim);
+
+		return true;
+	}
+	/**
+	 * Keep queue full: hinted blocks first, then sequential read-ahead
+	 */
+	void topUp(void)
+	{
+		while(reap(false))
+		{
+		}
+		auto current = currentBlock();
+		while(!m_hints.empty() && m_inFlight < m_queueDepth && m_blocks.size() < m_maxBlocks)
+		{
+			auto b = m_hints.front();
+			m_hints.pop_front();
+			if(b < current || m_blocks.find(b) != m_blocks.end())
+				continue;
+			if(!submit(b))
+				return;
+		}
+		for(uint64_t b = current; b < numBlocks() && b < current + m_queueDepth; ++b)
+		{
+			if(m_inFlight >= m_queueDepth || m_blocks.size() >= m_maxBlocks)
+				break;
+			if(m_blocks.find(b) == m_blocks.end() && !submit(b))
+				return;
+		}
+	}
+	int m_fd;
+	uint64_t m_length;
+	uint64_t m_off;
+	size_t m_blockSize;
+	uint32_t m_queueDepth;
+	size_t m_maxBlocks;
+	uint32_t m_inFlight;
+	io_uring m_ring;
+	bool m_ringInitialized;
+	std::map<uint64_t, UringReadBlock*> m_blocks;
+	std::deque<uint64_t> m_hints;
+};
+
+static size_t uring_read(void* buffer, size_t numBytes, UringReadStream* stream)
+{
+	return stream->read((uint8_t*)buffer, numBytes);
+}
+
+static bool uring_seek(uint64_t offset, UringReadStream* stream)
+{
+	return stream->seek(offset);
+}
+
+static void uring_prefetch(uint64_t offset, uint64_t numBytes, UringReadStream* stream)
+{
+	stream->prefetch(offset, numBytes);
+}
+
+static void uring_free(void* user_data)
+{
+	delete(UringReadStream*)user_data;
+}
+
+grk_stream* create_uring_file_read_stream(const char* fname, size_t blockSize,
+										  uint32_t queueDepth)
+{
+	if(!fname)
+		return nullptr;
+	if(!blockSize)
+		blockSize = uringDefaultBlockSize;
+	if(!queueDepth)
+		queueDepth = uringDefaultQueueDepth;
+	int fd = open(fname, O_RDONLY);
+	if(fd < 0)
+	{
+		GRK_ERROR("%s: %s", fname, strerror(errno));
+		return nullptr;
+	}
+	struct stat sb;
+	if(fstat(fd, &sb) < 0)
+	{
+		GRK_ERROR("%s: %s", fname, strerror(errno));
+		close(fd);
+		return nullptr;
+	}
+	auto uringStream = new UringReadStream(fd, (uint64_t)sb.st_size, blockSize, queueDepth);
+	if(!uringStream->init())
+	{
+		delete uringStream;
+		return nullptr;
+	}
+	auto stream = grk_stream_new(blockSize, true);
+	grk_stream_set_user_data(stream, uringStream, uring_free);
+	grk_stream_set_user_data_length(stream, (uint64_t)sb.st_size);
+	grk_stream_set_read_function(stream, (grk_stream_read_fn)uring_read);
+	grk_stream_set_seek_function(stream, (grk_stream_seek_fn)uring_seek);
+	BufferedStream::getImpl(stream)->setPrefetchFunction((grk_stream_prefetch_fn)uring_prefetch);
+
+	return stream;
+}
+
+#else
+
+grk_stream* create_uring_file_read_stream(const char* fname, size_t blockSize,
+										  uint32_t queueDepth)
+{
+	GRK_UNUSED(fname);
+	GRK_UNUSED(blockSize);
+	GRK_UNUSED(queueDepth);
+	GRK_ERROR("io_uring streams are not supported by this build");
+
+	return nullptr;
+}
+
+#endif
+
+} // namespace grk
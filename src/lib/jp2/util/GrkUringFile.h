@@ -0,0 +1,8 @@
+#pragma once
+
+namespace grk
+{
+grk_stream* create_uring_file_read_stream(const char* fname, size_t blockSize,
+										  uint32_t queueDepth);
+
+} // namespace grk
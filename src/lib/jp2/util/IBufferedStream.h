@@ -91,6 +91,39 @@ struct IBufferedStream
 	 * @return	 true if stream is seekable, otherwise false
 	 */
 	virtual bool hasSeek() = 0;
+
+	/**
+	 * Hint that a byte range will be read soon, so that the underlying
+	 * media can start reading it asynchronously. No-op if not supported.
+	 * @param		offset		absolute offset in stream
+	 * @param		numBytes	number of bytes in range
+	 */
+	virtual void prefetch(uint64_t offset, uint64_t numBytes) = 0;
+
+	/**
+	 * Hint that a byte range will not be read again, so that the underlying
+	 * media can drop it from memory. No-op if not supported.
+	 * @param		offset		absolute offset in stream
+	 * @param		numBytes	number of bytes in range
+	 */
+	virtual void release(uint64_t offset, uint64_t numBytes) = 0;
+
+	/**
+	 * Check if stream supports positional writes
+	 */
+	virtual bool supportsWriteAt(void) = 0;
+
+	/**
+	 * Write bytes at an absolute offset, without changing the stream position.
+	 * Safe to call concurrently for disjoint byte ranges. Bytes buffered by
+	 * the stream must be flushed first.
+	 * @param		buffer		data to write
+	 * @param		numBytes	number of bytes to write
+	 * @param		offset		absolute offset in stream
+	 *
+	 * @return		true if successful, otherwise false.
+	 */
+	virtual bool writeAt(const uint8_t* buffer, size_t numBytes, uint64_t offset) = 0;
 };
 
 } // namespace grk
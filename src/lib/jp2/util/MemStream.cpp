@@ -86,6 +86,15 @@ static size_t write_to_mem(void* dest, size_t numBytes, MemStream* src)
 	return numBytes;
 }
 
+static bool write_at_mem(const uint8_t* buffer, size_t numBytes, uint64_t offset, MemStream* dest)
+{
+	if(offset + numBytes > dest->len)
+		return false;
+	memcpy(dest->buf + offset, buffer, numBytes);
+
+	return true;
+}
+
 static bool seek_from_mem(uint64_t numBytes, MemStream* src)
 {
 	if(numBytes < src->len)
@@ -123,7 +132,10 @@ void set_up_mem_stream(grk_stream* stream, size_t len, bool is_read_stream)
 			stream, (grk_stream_zero_copy_read_fn)zero_copy_read_from_mem);
 	}
 	else
+	{
 		grk_stream_set_write_function(stream, (grk_stream_write_fn)write_to_mem);
+		BufferedStream::getImpl(stream)->setWriteAtFunction((grk_stream_write_at_fn)write_at_mem);
+	}
 	grk_stream_set_seek_function(stream, (grk_stream_seek_fn)seek_from_mem);
 }
 
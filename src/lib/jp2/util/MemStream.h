@@ -29,6 +29,26 @@ typedef int32_t grk_handle;
  */
 typedef size_t (*grk_stream_zero_copy_read_fn)(void** buffer, size_t numBytes, void* user_data);
 
+/*
+ * Callback function prototype for prefetch function: hints to the stream
+ * that the byte range [offset, offset + numBytes) will be read soon
+ */
+typedef void (*grk_stream_prefetch_fn)(uint64_t offset, uint64_t numBytes, void* user_data);
+
+/*
+ * Callback function prototype for release function: hints to the stream
+ * that the byte range [offset, offset + numBytes) will not be read again
+ */
+typedef void (*grk_stream_release_fn)(uint64_t offset, uint64_t numBytes, void* user_data);
+
+/*
+ * Callback function prototype for positional write function: writes numBytes
+ * at absolute offset, without changing the stream position. It may be called
+ * concurrently for disjoint byte ranges.
+ */
+typedef bool (*grk_stream_write_at_fn)(const uint8_t* buffer, size_t numBytes, uint64_t offset,
+									   void* user_data);
+
 struct MemStream
 {
 	MemStream(uint8_t* buffer, size_t offset, size_t length, bool owns);
@@ -0,0 +1,82 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "grk_includes.h"
+
+namespace grk
+{
+MemoryBudget::MemoryBudget(void)
+	: m_limit(0), m_live(0), m_peak(0), m_reserved(0), m_numThrottled(0)
+{}
+MemoryBudget* MemoryBudget::get(void)
+{
+	// never destroyed, as memory may still be freed during static destruction
+	static MemoryBudget* budget = new MemoryBudget();
+	return budget;
+}
+uint64_t MemoryBudget::liveBytes(void)
+{
+	auto live = m_live.load(std::memory_order_relaxed);
+	return live > 0 ? (uint64_t)live : 0;
+}
+void MemoryBudget::setLimit(uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// live bytes are counted from the time a budget is set
+	if(bytes && !s_tracking)
+	{
+		m_live = 0;
+		m_peak = 0;
+	}
+	m_limit = bytes;
+	s_tracking = bytes != 0;
+	m_cv.notify_all();
+}
+void MemoryBudget::reserve(uint64_t bytes)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto fits = [this, bytes] {
+		uint64_t limit = m_limit;
+		if(!limit || !m_reserved)
+			return true;
+		// reservations of tiles in flight may not be allocated yet
+		return std::max<uint64_t>(m_reserved, liveBytes()) + bytes <= limit;
+	};
+	if(!fits())
+	{
+		m_numThrottled++;
+		m_cv.wait(lock, fits);
+	}
+	m_reserved += bytes;
+}
+void MemoryBudget::release(uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_reserved -= std::min<uint64_t>(bytes, m_reserved);
+	m_cv.notify_all();
+}
+void MemoryBudget::getStats(grk_memory_stats* stats)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats->budget = m_limit;
+	stats->liveBytes = liveBytes();
+	auto peak = m_peak.load(std::memory_order_relaxed);
+	stats->peakBytes = peak > 0 ? (uint64_t)peak : 0;
+	stats->reservedBytes = m_reserved;
+	stats->numThrottledTiles = m_numThrottled;
+}
+
+} // namespace grk
@@ -0,0 +1,95 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace grk
+{
+/*  MemoryBudget
+
+ Process-wide memory budget, shared by all codecs. While a budget is set, the grk
+ allocators track live heap bytes; without a budget, allocations are not tracked,
+ so that they do not pay for a shared atomic and a block size query. Tile
+ schedulers reserve an estimate of each tile's memory before starting it. Once the budget is exhausted, new tiles wait until tiles
+ in flight, from any codec, release their reservations. When nothing at all is
+ reserved, a tile always starts, so that a tile larger than the budget is still
+ processed.
+ */
+class MemoryBudget
+{
+  public:
+	static MemoryBudget* get(void);
+	/**
+	 * Set budget
+	 *
+	 * @param bytes	maximum number of bytes, or zero for no limit
+	 */
+	void setLimit(uint64_t bytes);
+	/**
+	 * Returns true if allocations should be reported to allocated() and freed()
+	 */
+	static bool isTracking(void)
+	{
+		return s_tracking.load(std::memory_order_relaxed);
+	}
+	void allocated(size_t bytes)
+	{
+		auto live = m_live.fetch_add((int64_t)bytes, std::memory_order_relaxed) + (int64_t)bytes;
+		auto peak = m_peak.load(std::memory_order_relaxed);
+		while(live > peak && !m_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+			;
+	}
+	void freed(size_t bytes)
+	{
+		m_live.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+	}
+	/**
+	 * Reserve memory for a tile, waiting until it fits in the budget
+	 *
+	 * @param bytes	number of bytes to reserve
+	 */
+	void reserve(uint64_t bytes);
+	/**
+	 * Release a reservation, waking tiles waiting for budget
+	 *
+	 * @param bytes	number of bytes reserved
+	 */
+	void release(uint64_t bytes);
+	void getStats(grk_memory_stats* stats);
+
+  private:
+	MemoryBudget(void);
+	uint64_t liveBytes(void);
+	std::atomic<uint64_t> m_limit;
+	// true while a budget is set. Buffers allocated before tracking started may
+	// be freed while tracking, which is another way for them to escape accounting
+	static inline std::atomic<bool> s_tracking{false};
+	// signed, as buffers may be freed by a different allocator than the one that
+	// allocated them, and so escape accounting
+	std::atomic<int64_t> m_live;
+	std::atomic<int64_t> m_peak;
+	// guarded by m_mutex
+	uint64_t m_reserved;
+	uint64_t m_numThrottled;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+};
+
+} // namespace grk
@@ -38,10 +38,10 @@ struct SparseBuffer
 	size_t skip(size_t numBytes);
 	void increment(void);
 	size_t read(void* buffer, size_t numBytes);
-
-  private:
 	// Treat segmented buffer as single contiguous buffer, and get current offset
 	size_t getGlobalOffset(void);
+
+  private:
 	// Copy all chunks, in sequence, into contiguous array
 	bool copyToContiguousBuffer(uint8_t* buffer);
 	// Clean up internal resources
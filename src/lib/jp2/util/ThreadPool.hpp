@@ -28,6 +28,9 @@
 #include <stdexcept>
 #include <map>
 #include <type_traits>
+#include <fstream>
+#include <sstream>
+#include <string>
 
 /*
 	tf::Executor executor;
@@ -47,7 +50,7 @@
 class ThreadPool
 {
   public:
-	ThreadPool(size_t);
+	ThreadPool(size_t threads, GRK_THREAD_AFFINITY affinity = GRK_THREAD_AFFINITY_CORE);
 	template<class F, class... Args>
 	auto enqueue(F&& f, Args&&... args)
 		-> std::future<typename std::invoke_result<F, Args...>::type>;
@@ -62,16 +65,36 @@ class ThreadPool
 	{
 		return m_num_threads;
 	}
+	GRK_THREAD_AFFINITY affinity()
+	{
+		return m_affinity;
+	}
 
 	static ThreadPool* get()
 	{
 		return instance(0);
 	}
-	static ThreadPool* instance(uint32_t numthreads)
+	static ThreadPool* instance(uint32_t numthreads,
+								GRK_THREAD_AFFINITY affinity = GRK_THREAD_AFFINITY_CORE)
 	{
 		std::unique_lock<std::mutex> lock(singleton_mutex);
 		if(!singleton)
-			singleton = new ThreadPool(numthreads ? numthreads : hardware_concurrency());
+			singleton =
+				new ThreadPool(numthreads ? numthreads : hardware_concurrency(), affinity);
+		return singleton;
+	}
+	// re-create pool with a different number of threads and the same affinity
+	static ThreadPool* resize(uint32_t numthreads)
+	{
+		std::unique_lock<std::mutex> lock(singleton_mutex);
+		if(!numthreads)
+			numthreads = hardware_concurrency();
+		auto affinity = singleton ? singleton->m_affinity : GRK_THREAD_AFFINITY_CORE;
+		if(!singleton || singleton->m_num_threads != numthreads)
+		{
+			delete singleton;
+			singleton = new ThreadPool(numthreads, affinity);
+		}
 		return singleton;
 	}
 	static void release()
@@ -94,12 +117,69 @@ class ThreadPool
 #endif
 		return ret;
 	}
+	/**
+	 * Get CPUs of each NUMA node. A machine without NUMA information
+	 * is treated as a single node.
+	 */
+	static std::vector<std::vector<uint32_t>> numa_nodes()
+	{
+		std::vector<std::vector<uint32_t>> nodes;
+#ifdef __linux__
+		for(uint32_t node = 0;; ++node)
+		{
+			std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			if(!f)
+				break;
+			// list of ranges such as 0-15,32-47
+			std::vector<uint32_t> cpus;
+			std::string range;
+			while(std::getline(f, range, ','))
+			{
+				uint32_t first = 0, last = 0;
+				char dash = 0;
+				std::istringstream r(range);
+				if(!(r >> first))
+					continue;
+				last = first;
+				if(r >> dash >> last && dash != '-')
+					last = first;
+				for(uint32_t cpu = first; cpu <= last; ++cpu)
+					cpus.push_back(cpu);
+			}
+			// skip memory-only nodes
+			if(!cpus.empty())
+				nodes.push_back(cpus);
+		}
+#endif
+		return nodes;
+	}
 
   private:
+	// pop next task for a worker on node: tasks queued for its own node come first,
+	// then tasks for any node
+	std::function<void()> pop(int node)
+	{
+		size_t any = tasks.size() - 1;
+		size_t q = any;
+		if(node >= 0 && !tasks[(size_t)node].empty())
+			q = (size_t)node;
+		else if(tasks[any].empty())
+		{
+			// steal from another node, rather than leaving this thread idle
+			q = 0;
+			while(tasks[q].empty())
+				q++;
+		}
+		auto task = std::move(tasks[q].front());
+		tasks[q].pop();
+		num_tasks--;
+		return task;
+	}
 	// need to keep track of threads so we can join them
 	std::vector<std::thread> workers;
-	// the task queue
-	std::queue<std::function<void()>> tasks;
+	// task queue for each NUMA node, followed by queue for tasks that can run on any node
+	std::vector<std::queue<std::function<void()>>> tasks;
+	size_t num_tasks;
 
 	// synchronization
 	std::mutex queue_mutex;
@@ -108,52 +188,76 @@ class ThreadPool
 
 	std::map<std::thread::id, size_t> id_map;
 	size_t m_num_threads;
+	GRK_THREAD_AFFINITY m_affinity;
+	std::vector<std::vector<uint32_t>> nodes;
+	// NUMA node of the current thread, if it belongs to a NUMA aware pool,
+	// otherwise -1. Tasks enqueued from this thread are queued for the same node.
+	static inline thread_local int current_node = -1;
 
 	static ThreadPool* singleton;
 	static std::mutex singleton_mutex;
 };
 
 // the constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads) : stop(false), m_num_threads(threads)
+inline ThreadPool::ThreadPool(size_t threads, GRK_THREAD_AFFINITY affinity)
+	: num_tasks(0), stop(false), m_num_threads(threads), m_affinity(affinity)
 {
+	if(affinity == GRK_THREAD_AFFINITY_NUMA)
+		nodes = numa_nodes();
+	tasks.resize(nodes.size() + 1);
 	if(threads == 1)
 		return;
 
 	for(size_t i = 0; i < threads; ++i)
-		workers.emplace_back([this] {
+	{
+		// workers are spread evenly over the NUMA nodes
+		int node = nodes.empty() ? -1 : (int)(i % nodes.size());
+		workers.emplace_back([this, node] {
+			current_node = node;
 			for(;;)
 			{
 				std::function<void()> task;
 
 				{
 					std::unique_lock<std::mutex> lock(this->queue_mutex);
-					this->condition.wait(lock,
-										 [this] { return this->stop || !this->tasks.empty(); });
-					if(this->stop && this->tasks.empty())
+					GRK_TRACE_IDLE_SCOPE();
+					this->condition.wait(lock, [this] { return this->stop || this->num_tasks; });
+					if(this->stop && !this->num_tasks)
 						return;
-					task = std::move(this->tasks.front());
-					this->tasks.pop();
+					task = pop(node);
 				}
 
 				task();
 			}
 		});
+	}
 	size_t thread_count = 0;
 	for(std::thread& worker : workers)
 	{
 		id_map[worker.get_id()] = thread_count;
 #ifdef __linux__
-		// Create a cpu_set_t object representing a set of CPUs. Clear it and mark
-		// only CPU i as set.
-		// Note: we assume that the second half of the logical cores
-		// are hyper-threaded siblings to the first half
-		cpu_set_t cpuset;
-		CPU_ZERO(&cpuset);
-		CPU_SET(thread_count, &cpuset);
-		int rc = pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpuset);
-		if(rc != 0)
+		if(affinity != GRK_THREAD_AFFINITY_NONE)
 		{
-			std::cerr << "Error calling pthread_setaffinity_np: " << rc << "\n";
+			cpu_set_t cpuset;
+			CPU_ZERO(&cpuset);
+			if(nodes.empty())
+			{
+				// Mark only CPU i as set.
+				// Note: we assume that the second half of the logical cores
+				// are hyper-threaded siblings to the first half
+				CPU_SET(thread_count, &cpuset);
+			}
+			else
+			{
+				// any CPU of the worker's node
+				for(auto cpu : nodes[thread_count % nodes.size()])
+					CPU_SET(cpu, &cpuset);
+			}
+			int rc = pthread_setaffinity_np(worker.native_handle(), sizeof(cpu_set_t), &cpuset);
+			if(rc != 0)
+			{
+				std::cerr << "Error calling pthread_setaffinity_np: " << rc << "\n";
+			}
 		}
 #endif
 		thread_count++;
@@ -179,7 +283,12 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
 		if(stop)
 			throw std::runtime_error("enqueue on stopped ThreadPool");
 
-		tasks.emplace([task]() { (*task)(); });
+		// queue for node of calling thread, if this pool has a queue for it
+		size_t q = (current_node >= 0 && (size_t)current_node + 1 < tasks.size())
+					   ? (size_t)current_node
+					   : tasks.size() - 1;
+		tasks[q].emplace([task]() { (*task)(); });
+		num_tasks++;
 	}
 	condition.notify_one();
 	return res;
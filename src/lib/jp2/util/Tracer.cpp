@@ -0,0 +1,149 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include "grk_includes.h"
+
+#ifdef GROK_HAVE_TRACE
+namespace grk
+{
+// cap memory used by long running processes: stage totals are still
+// accumulated once the event buffer is full
+const size_t maxTraceEvents = 1 << 20;
+
+static const char* stageNames[GRK_TRACE_STAGE_COUNT] = {
+	"T2", "T1", "DWT", "MCT", "DC shift", "rate control", "precision", "composite"};
+
+static int64_t steadyMicros(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+Tracer::Tracer(void) : epoch(steadyMicros()), droppedEvents(0)
+{
+	for(auto& c : counters)
+		c = 0;
+	for(auto& s : stageUs)
+		s = 0;
+}
+Tracer* Tracer::get(void)
+{
+	static Tracer tracer;
+	return &tracer;
+}
+uint64_t Tracer::now(void)
+{
+	auto elapsed = steadyMicros() - epoch.load(std::memory_order_relaxed);
+	return elapsed > 0 ? (uint64_t)elapsed : 0;
+}
+void Tracer::addEvent(GRK_TRACE_STAGE stage, uint16_t tileIndex, int32_t compno,
+					  uint64_t startUs)
+{
+	auto end = now();
+	// a reset may have happened while the event was in progress
+	if(startUs > end)
+		startUs = 0;
+	grk_trace_event event;
+	event.stage = stage;
+	event.tileIndex = tileIndex;
+	event.compno = compno;
+	auto threadnum = ThreadPool::get()->thread_number(std::this_thread::get_id());
+	event.thread = (uint32_t)(threadnum + 1);
+	event.startUs = startUs;
+	event.durationUs = end - startUs;
+	stageUs[stage].fetch_add(event.durationUs, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(eventMutex);
+	if(events.size() < maxTraceEvents)
+		events.push_back(event);
+	else
+		droppedEvents++;
+}
+void Tracer::getStats(grk_trace_stats* stats)
+{
+	for(uint32_t i = 0; i < GRK_TRACE_STAGE_COUNT; ++i)
+		stats->stageUs[i] = stageUs[i];
+	stats->numCodeBlocks = counters[TRACE_CODE_BLOCKS];
+	stats->bytesParsed = counters[TRACE_BYTES_PARSED];
+	stats->numAllocations = counters[TRACE_ALLOCATIONS];
+	stats->bytesAllocated = counters[TRACE_BYTES_ALLOCATED];
+	stats->threadIdleUs = counters[TRACE_THREAD_IDLE_US];
+	stats->numDroppedEvents = droppedEvents;
+	std::lock_guard<std::mutex> lock(eventMutex);
+	stats->numEvents = events.size();
+}
+size_t Tracer::getEvents(grk_trace_event* dest, size_t maxEvents)
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+	if(dest)
+		std::copy_n(events.begin(), std::min(maxEvents, events.size()), dest);
+	return events.size();
+}
+bool Tracer::writeChromeTrace(const char* fileName)
+{
+	auto fp = fopen(fileName, "w");
+	if(!fp)
+	{
+		GRK_ERROR("Unable to open trace file %s", fileName);
+		return false;
+	}
+	grk_trace_stats stats;
+	getStats(&stats);
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	{
+		std::lock_guard<std::mutex> lock(eventMutex);
+		for(size_t i = 0; i < events.size(); ++i)
+		{
+			auto& e = events[i];
+			fprintf(fp,
+					"{\"name\":\"%s\",\"cat\":\"grok\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+					"\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+					",\"args\":{\"tile\":%u,\"component\":%d}},\n",
+					stageNames[e.stage], e.thread, e.startUs, e.durationUs, e.tileIndex,
+					e.compno);
+		}
+	}
+	// counters are written as a final counter event, which also terminates the array
+	fprintf(fp,
+			"{\"name\":\"counters\",\"cat\":\"grok\",\"ph\":\"C\",\"pid\":1,\"tid\":0,"
+			"\"ts\":%" PRIu64 ",\"args\":{\"code blocks\":%" PRIu64 ",\"bytes parsed\":%" PRIu64
+			",\"allocations\":%" PRIu64 ",\"bytes allocated\":%" PRIu64
+			",\"thread idle us\":%" PRIu64 ",\"dropped events\":%" PRIu64 "}}\n]}\n",
+			now(), stats.numCodeBlocks, stats.bytesParsed, stats.numAllocations,
+			stats.bytesAllocated, stats.threadIdleUs, stats.numDroppedEvents);
+	bool rc = !ferror(fp);
+	if(fclose(fp))
+		rc = false;
+	if(!rc)
+		GRK_ERROR("Error writing trace file %s", fileName);
+
+	return rc;
+}
+void Tracer::reset(void)
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+	events.clear();
+	for(auto& c : counters)
+		c = 0;
+	for(auto& s : stageUs)
+		s = 0;
+	droppedEvents = 0;
+	epoch = steadyMicros();
+}
+
+} // namespace grk
+#endif
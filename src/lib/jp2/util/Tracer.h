@@ -0,0 +1,126 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#ifdef GROK_HAVE_TRACE
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace grk
+{
+enum TraceCounter
+{
+	TRACE_CODE_BLOCKS,
+	TRACE_BYTES_PARSED,
+	TRACE_ALLOCATIONS,
+	TRACE_BYTES_ALLOCATED,
+	TRACE_THREAD_IDLE_US,
+	TRACE_NUM_COUNTERS
+};
+
+/*  Tracer
+
+ Process-wide collector of timed stage events and counters, for all codecs.
+ It is only compiled in when the library is built with the GRK_TRACE option:
+ otherwise, the GRK_TRACE_* macros below expand to nothing.
+ */
+class Tracer
+{
+  public:
+	static Tracer* get(void);
+	/**
+	 * @return microseconds since last reset
+	 */
+	uint64_t now(void);
+	void addEvent(GRK_TRACE_STAGE stage, uint16_t tileIndex, int32_t compno, uint64_t startUs);
+	void count(TraceCounter counter, uint64_t n)
+	{
+		counters[counter].fetch_add(n, std::memory_order_relaxed);
+	}
+	void getStats(grk_trace_stats* stats);
+	size_t getEvents(grk_trace_event* dest, size_t maxEvents);
+	bool writeChromeTrace(const char* fileName);
+	void reset(void);
+
+  private:
+	Tracer(void);
+	std::atomic<int64_t> epoch;
+	std::atomic<uint64_t> counters[TRACE_NUM_COUNTERS];
+	std::atomic<uint64_t> stageUs[GRK_TRACE_STAGE_COUNT];
+	std::atomic<uint64_t> droppedEvents;
+	std::mutex eventMutex;
+	std::vector<grk_trace_event> events;
+};
+
+/**
+ * Record an event for the lifetime of the scope
+ */
+class TraceScope
+{
+  public:
+	TraceScope(GRK_TRACE_STAGE stage, uint16_t tileIndex, int32_t compno)
+		: m_stage(stage), m_tileIndex(tileIndex), m_compno(compno),
+		  m_start(Tracer::get()->now())
+	{}
+	~TraceScope()
+	{
+		Tracer::get()->addEvent(m_stage, m_tileIndex, m_compno, m_start);
+	}
+
+  private:
+	GRK_TRACE_STAGE m_stage;
+	uint16_t m_tileIndex;
+	int32_t m_compno;
+	uint64_t m_start;
+};
+
+/**
+ * Accumulate thread pool idle time for the lifetime of the scope
+ */
+class TraceIdleScope
+{
+  public:
+	TraceIdleScope() : m_start(Tracer::get()->now()) {}
+	~TraceIdleScope()
+	{
+		auto now = Tracer::get()->now();
+		if(now > m_start)
+			Tracer::get()->count(TRACE_THREAD_IDLE_US, now - m_start);
+	}
+
+  private:
+	uint64_t m_start;
+};
+
+} // namespace grk
+
+#define GRK_TRACE_CONCAT_(a, b) a##b
+#define GRK_TRACE_CONCAT(a, b) GRK_TRACE_CONCAT_(a, b)
+#define GRK_TRACE_SCOPE(stage, tileIndex, compno) \
+	grk::TraceScope GRK_TRACE_CONCAT(grkTraceScope, __LINE__)(stage, tileIndex, compno)
+#define GRK_TRACE_IDLE_SCOPE() grk::TraceIdleScope GRK_TRACE_CONCAT(grkTraceIdle, __LINE__)
+#define GRK_TRACE_COUNT(counter, n) grk::Tracer::get()->count(grk::counter, n)
+
+#else
+
+#define GRK_TRACE_SCOPE(stage, tileIndex, compno)
+#define GRK_TRACE_IDLE_SCOPE()
+#define GRK_TRACE_COUNT(counter, n)
+
+#endif
@@ -0,0 +1,1217 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Micro-benchmarks for the individual codec kernels:
+ *
+ * - T1 MQ block coder (compress / decompress) for several code block sizes and mode switches
+ * - HT block coder (compress / decompress)
+ * - forward and inverse 5/3 and 9/7 wavelet transforms, whole tile and windowed
+ * - reversible, irreversible and custom multi-component transforms
+ * - tag trees and T2 packet headers
+ *
+ * All kernels run on deterministic synthetic data, so that results are comparable
+ * from run to run and from machine to machine. Results are written as JSON.
+ */
+
+#include "ojph_block_decoder.h"
+#include "ojph_block_encoder.h"
+#include "ojph_mem.h"
+
+#include "grk_includes.h"
+#include "T1.h"
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#define TCLAP_NAMESTARTSTRING "-"
+#include "tclap/CmdLine.h"
+using namespace TCLAP;
+
+using namespace grk;
+
+namespace grk
+{
+/**
+ * Deterministic pseudo-random sample generator (xorshift32)
+ */
+class SyntheticSource
+{
+  public:
+	explicit SyntheticSource(uint32_t seed) : state(seed ? seed : 0x9E3779B9) {}
+	uint32_t next(void)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+	/**
+	 * Signed value with a roughly Laplacian magnitude distribution,
+	 * as found in wavelet sub-bands
+	 *
+	 * @param magnitudeBits maximum number of magnitude bits (at most 24)
+	 */
+	int32_t coefficient(uint8_t magnitudeBits)
+	{
+		uint32_t r = next();
+		auto mag = (int32_t)((r & ((1U << magnitudeBits) - 1)) >> ((r >> 24) % magnitudeBits));
+		return (r & 0x80000000) ? -mag : mag;
+	}
+
+  private:
+	uint32_t state;
+};
+
+struct BenchParams
+{
+	BenchParams()
+		: size(2048), numResolutions(6), iterations(5), samplesPerBlockBench(1 << 20),
+		  check(false)
+	{}
+	bool enabled(const std::string& kernel) const
+	{
+		if(filters.empty())
+			return true;
+		for(auto& f : filters)
+		{
+			if(kernel.find(f) != std::string::npos)
+				return true;
+		}
+		return false;
+	}
+	// image size for transforms
+	uint32_t size;
+	uint8_t numResolutions;
+	uint32_t iterations;
+	// number of samples coded by each block coder benchmark
+	uint32_t samplesPerBlockBench;
+	bool check;
+	std::vector<std::string> filters;
+};
+
+struct BenchResult
+{
+	BenchResult(const std::string& kern, const std::string& conf, uint32_t threads)
+		: kernel(kern), config(conf), numThreads(threads), iterations(0), samples(0), bytes(0),
+		  minMs(0), meanMs(0), verified(false), checked(false)
+	{}
+	std::string kernel;
+	std::string config;
+	uint32_t numThreads;
+	uint32_t iterations;
+	// number of samples (or tag tree leaves / code blocks) processed per iteration
+	uint64_t samples;
+	// compressed bytes produced or consumed per iteration, if applicable
+	uint64_t bytes;
+	double minMs;
+	double meanMs;
+	bool verified;
+	bool checked;
+};
+
+class BenchReport
+{
+  public:
+	void add(const BenchResult& result)
+	{
+		double msps = result.minMs > 0 ? (double)result.samples / (result.minMs * 1000.0) : 0;
+		spdlog::info("{:<20} {:<24} threads={:<3} min={:9.3f} ms  mean={:9.3f} ms  {:9.2f} "
+					 "Msamples/s{}",
+					 result.kernel, result.config, result.numThreads, result.minMs,
+					 result.meanMs, msps,
+					 result.checked ? (result.verified ? "  [verified]" : "  [MISMATCH]") : "");
+		results.push_back(result);
+	}
+	bool failed(void) const
+	{
+		for(auto& r : results)
+		{
+			if(r.checked && !r.verified)
+				return true;
+		}
+		return false;
+	}
+	void write(std::ostream& os) const
+	{
+		os << "{\n";
+		os << "  \"version\": \"" << grk_version() << "\",\n";
+		os << "  \"hardware_concurrency\": " << ThreadPool::hardware_concurrency() << ",\n";
+		os << "  \"results\": [";
+		for(size_t i = 0; i < results.size(); ++i)
+		{
+			auto& r = results[i];
+			double msps = r.minMs > 0 ? (double)r.samples / (r.minMs * 1000.0) : 0;
+			os << (i ? ",\n" : "\n");
+			os << "    {\"kernel\": \"" << r.kernel << "\", \"config\": \"" << r.config
+			   << "\", \"threads\": " << r.numThreads << ", \"iterations\": " << r.iterations
+			   << ", \"samples\": " << r.samples << ", \"bytes\": " << r.bytes << std::fixed
+			   << std::setprecision(4) << ", \"min_ms\": " << r.minMs
+			   << ", \"mean_ms\": " << r.meanMs << ", \"msamples_per_sec\": " << msps
+			   << std::defaultfloat;
+			if(r.checked)
+				os << ", \"verified\": " << (r.verified ? "true" : "false");
+			os << "}";
+		}
+		os << "\n  ]\n}\n";
+	}
+
+  private:
+	std::vector<BenchResult> results;
+};
+
+/**
+ * Run kernel once to warm up caches, then time the requested number of iterations
+ */
+template<typename F>
+void timeKernel(BenchResult& result, uint32_t iterations, F&& kernel)
+{
+	kernel();
+	double total = 0;
+	double best = std::numeric_limits<double>::max();
+	for(uint32_t i = 0; i < iterations; ++i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		kernel();
+		std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::high_resolution_clock::now() - start;
+		total += elapsed.count();
+		best = std::min<double>(best, elapsed.count());
+	}
+	result.iterations = iterations;
+	result.minMs = best;
+	result.meanMs = total / iterations;
+}
+
+/**
+ * Spread blocks over worker threads; each worker owns its own coder state
+ *
+ * @param job called with worker index and block index
+ */
+template<typename F>
+void forEachBlock(uint32_t numWorkers, size_t numBlocks, F&& job)
+{
+	if(numWorkers == 1)
+	{
+		for(size_t i = 0; i < numBlocks; ++i)
+			job(0, i);
+		return;
+	}
+	std::vector<std::future<void>> results;
+	for(uint32_t worker = 0; worker < numWorkers; ++worker)
+	{
+		results.emplace_back(ThreadPool::get()->enqueue([worker, numWorkers, numBlocks, &job] {
+			for(size_t i = worker; i < numBlocks; i += numWorkers)
+				job(worker, i);
+		}));
+	}
+	for(auto& r : results)
+		r.get();
+}
+
+struct BlockSize
+{
+	uint32_t w;
+	uint32_t h;
+};
+const BlockSize blockSizes[] = {{16, 16}, {32, 32}, {64, 64}, {128, 32}};
+// magnitude bits of synthetic code block samples
+const uint8_t blockMagnitudeBits = 12;
+
+/**
+ * Synthetic code blocks shared by block coder benchmarks
+ */
+struct SyntheticBlocks
+{
+	SyntheticBlocks(BlockSize dims, uint32_t totalSamples) : size(dims), numBlocks(0)
+	{
+		uint32_t area = size.w * size.h;
+		numBlocks = std::max<uint32_t>(totalSamples / area, 1);
+		SyntheticSource source(area);
+		samples.resize((size_t)numBlocks * area);
+		for(auto& s : samples)
+			s = source.coefficient(blockMagnitudeBits);
+	}
+	const int32_t* block(size_t index) const
+	{
+		return samples.data() + index * size.w * size.h;
+	}
+	uint64_t numSamples(void) const
+	{
+		return samples.size();
+	}
+	BlockSize size;
+	uint32_t numBlocks;
+	std::vector<int32_t> samples;
+};
+
+struct MQMode
+{
+	const char* name;
+	uint8_t cblk_sty;
+};
+const MQMode mqModes[] = {
+	{"default", 0},
+	{"bypass", GRK_CBLKSTY_LAZY},
+	{"restart", GRK_CBLKSTY_RESET | GRK_CBLKSTY_TERMALL},
+	{"vsc", GRK_CBLKSTY_VSC},
+	{"segsym", GRK_CBLKSTY_SEGSYM},
+	{"all", GRK_CBLKSTY_LAZY | GRK_CBLKSTY_RESET | GRK_CBLKSTY_TERMALL | GRK_CBLKSTY_VSC |
+				GRK_CBLKSTY_PTERM | GRK_CBLKSTY_SEGSYM}};
+
+struct MQEncodedBlock
+{
+	MQEncodedBlock() : numbps(0) {}
+	std::vector<uint8_t> data;
+	uint8_t numbps;
+	// (number of passes, length) of each terminated segment
+	std::vector<std::pair<uint32_t, uint32_t>> segments;
+};
+
+/**
+ * Per-worker MQ compressor state
+ */
+struct MQCompressor
+{
+	MQCompressor(BlockSize size)
+		: t1(true, size.w, size.h),
+		  buffer(grk_cblk_enc_compressed_data_pad_left + size.w * size.h * sizeof(int32_t))
+	{
+		memset(&cblk, 0, sizeof(cblk));
+		cblk.data = buffer.data() + grk_cblk_enc_compressed_data_pad_left;
+	}
+	~MQCompressor()
+	{
+		t1.code_block_enc_deallocate(&cblk);
+	}
+	void compress(const int32_t* src, BlockSize size, uint8_t cblk_sty)
+	{
+		t1.alloc(size.w, size.h);
+		auto dest = t1.getUncompressedData();
+		uint32_t maximum = 0;
+		for(uint32_t i = 0; i < size.w * size.h; ++i)
+		{
+			int32_t temp = src[i] * (1 << T1_NMSEDEC_FRACBITS);
+			temp = (int32_t)to_smr(temp);
+			maximum = std::max<uint32_t>(maximum, smr_abs(temp));
+			dest[i] = temp;
+		}
+		cblk.x1 = size.w;
+		cblk.y1 = size.h;
+		t1.compress_cblk(&cblk, maximum, BAND_ORIENT_HL, 0, 0, 1, 1.0, cblk_sty, nullptr, 0,
+						 false);
+	}
+	void save(MQEncodedBlock* block) const
+	{
+		block->numbps = cblk.numbps;
+		uint32_t rate = 0;
+		uint32_t numpasses = 0;
+		for(uint32_t passno = 0; passno < cblk.numPassesTotal; ++passno)
+		{
+			auto pass = cblk.passes + passno;
+			numpasses++;
+			if(pass->term || passno == cblk.numPassesTotal - 1)
+			{
+				block->segments.push_back(std::make_pair(numpasses, pass->rate - rate));
+				rate = pass->rate;
+				numpasses = 0;
+			}
+		}
+		block->data.assign(cblk.data, cblk.data + rate);
+	}
+	T1 t1;
+	cblk_enc cblk;
+	std::vector<uint8_t> buffer;
+};
+
+bool checkMQBlock(const int32_t* original, const int32_t* decompressed, size_t area)
+{
+	for(size_t i = 0; i < area; ++i)
+	{
+		// reversible decompressor output carries one extra half bit
+		int32_t mag = std::abs(decompressed[i]) >> 1;
+		int32_t val = decompressed[i] < 0 ? -mag : mag;
+		if(val != original[i])
+			return false;
+	}
+	return true;
+}
+
+void benchMQ(const BenchParams& params, uint32_t numThreads, BenchReport& report)
+{
+	for(auto& size : blockSizes)
+	{
+		SyntheticBlocks blocks(size, params.samplesPerBlockBench);
+		size_t area = (size_t)size.w * size.h;
+		for(auto& mode : mqModes)
+		{
+			std::stringstream config;
+			config << size.w << "x" << size.h << " " << mode.name;
+
+			// reference compressed blocks for the decompressor
+			std::vector<MQEncodedBlock> encoded(blocks.numBlocks);
+			uint64_t compressedBytes = 0;
+			{
+				MQCompressor compressor(size);
+				for(uint32_t i = 0; i < blocks.numBlocks; ++i)
+				{
+					compressor.compress(blocks.block(i), size, mode.cblk_sty);
+					compressor.save(&encoded[i]);
+					compressedBytes += encoded[i].data.size();
+				}
+			}
+			if(params.enabled("t1_mq_compress"))
+			{
+				std::vector<std::unique_ptr<MQCompressor>> compressors;
+				for(uint32_t i = 0; i < numThreads; ++i)
+					compressors.emplace_back(new MQCompressor(size));
+				BenchResult result("t1_mq_compress", config.str(), numThreads);
+				result.samples = blocks.numSamples();
+				result.bytes = compressedBytes;
+				timeKernel(result, params.iterations, [&]() {
+					forEachBlock(numThreads, blocks.numBlocks, [&](uint32_t worker, size_t i) {
+						compressors[worker]->compress(blocks.block(i), size, mode.cblk_sty);
+					});
+				});
+				report.add(result);
+			}
+			if(params.enabled("t1_mq_decompress"))
+			{
+				std::vector<std::unique_ptr<DecompressCodeblock>> cblks;
+				for(auto& e : encoded)
+				{
+					auto cblk = new DecompressCodeblock();
+					cblk->numbps = e.numbps;
+					for(auto& s : e.segments)
+					{
+						auto seg = cblk->nextSegment();
+						seg->numpasses = s.first;
+						seg->len = s.second;
+					}
+					cblks.emplace_back(cblk);
+				}
+				std::vector<std::unique_ptr<T1>> decompressors;
+				std::vector<std::vector<int32_t>> outputs(numThreads);
+				for(uint32_t i = 0; i < numThreads; ++i)
+				{
+					decompressors.emplace_back(new T1(false, size.w, size.h));
+					outputs[i].resize(area);
+				}
+				std::atomic<bool> verified(true);
+				bool verify = false;
+				auto job = [&](uint32_t worker, size_t i) {
+					auto t1 = decompressors[worker].get();
+					auto& e = encoded[i];
+					// T1 terminates the MQ byte stream in place, so decompress from a copy,
+					// as the library does with code block segment buffers
+					t1->allocCompressedData(e.data.size() + grk_cblk_dec_compressed_data_pad_right);
+					auto compressedData = t1->getCompressedDataBuffer();
+					if(!e.data.empty())
+						memcpy(compressedData, e.data.data(), e.data.size());
+					auto dest = outputs[worker].data();
+					memset(dest, 0, area * sizeof(int32_t));
+					t1->attachUncompressedData(dest, size.w, size.h);
+					if(!t1->decompress_cblk(cblks[i].get(), compressedData, BAND_ORIENT_HL,
+											mode.cblk_sty))
+						verified = false;
+					else if(verify && !checkMQBlock(blocks.block(i), dest, area))
+						verified = false;
+				};
+				BenchResult result("t1_mq_decompress", config.str(), numThreads);
+				result.samples = blocks.numSamples();
+				result.bytes = compressedBytes;
+				timeKernel(result, params.iterations,
+						   [&]() { forEachBlock(numThreads, blocks.numBlocks, job); });
+				if(params.check)
+				{
+					verify = true;
+					forEachBlock(numThreads, blocks.numBlocks, job);
+					result.checked = true;
+					result.verified = verified;
+				}
+				report.add(result);
+			}
+		}
+	}
+}
+
+/**
+ * Per-worker HT compressor state
+ */
+struct HTCompressor
+{
+	HTCompressor(BlockSize size) : elastic(nullptr), unencoded(size.w * size.h), length(0) {}
+	~HTCompressor()
+	{
+		delete elastic;
+	}
+	// the elastic allocator only grows, so start afresh for each pass over the blocks
+	void reset(void)
+	{
+		delete elastic;
+		elastic = new ojph::mem_elastic_allocator(1048576);
+	}
+	const uint8_t* compress(const int32_t* src, BlockSize size, uint32_t missing_msbs)
+	{
+		// MSB aligned sign-magnitude representation
+		uint32_t shift = 30 - missing_msbs;
+		for(uint32_t i = 0; i < size.w * size.h; ++i)
+		{
+			uint32_t val = (uint32_t)std::abs(src[i]);
+			unencoded[i] = (src[i] < 0 ? 0x80000000 : 0) | (val << shift);
+		}
+		uint32_t pass_length[2] = {0, 0};
+		ojph::coded_lists* coded = nullptr;
+		ojph::local::ojph_encode_codeblock(unencoded.data(), missing_msbs, 1, size.w, size.h,
+										   size.w, pass_length, elastic, coded);
+		length = pass_length[0];
+
+		return coded->buf;
+	}
+	ojph::mem_elastic_allocator* elastic;
+	std::vector<uint32_t> unencoded;
+	uint32_t length;
+};
+
+const uint8_t htPad = 8;
+
+bool checkHTBlock(const int32_t* original, const uint32_t* decompressed, size_t area,
+				  uint32_t missing_msbs)
+{
+	uint32_t shift = 30 - missing_msbs;
+	for(size_t i = 0; i < area; ++i)
+	{
+		auto mag = (int32_t)((decompressed[i] & 0x7FFFFFFF) >> shift);
+		int32_t val = (decompressed[i] & 0x80000000) ? -mag : mag;
+		if(val != original[i])
+			return false;
+	}
+	return true;
+}
+
+void benchHT(const BenchParams& params, uint32_t numThreads, BenchReport& report)
+{
+	// single cleanup pass; HT exponents of the coded samples (2 * magnitude - 1)
+	// need one more bit plane than the samples themselves
+	const uint32_t missing_msbs = blockMagnitudeBits;
+	for(auto& size : blockSizes)
+	{
+		SyntheticBlocks blocks(size, params.samplesPerBlockBench);
+		size_t area = (size_t)size.w * size.h;
+		std::stringstream config;
+		config << size.w << "x" << size.h;
+
+		// reference compressed blocks, padded on both sides for the decompressor
+		std::vector<std::vector<uint8_t>> encoded(blocks.numBlocks);
+		uint64_t compressedBytes = 0;
+		{
+			HTCompressor compressor(size);
+			compressor.reset();
+			for(uint32_t i = 0; i < blocks.numBlocks; ++i)
+			{
+				auto data = compressor.compress(blocks.block(i), size, missing_msbs);
+				encoded[i].assign(2 * htPad + compressor.length, 0);
+				memcpy(encoded[i].data() + htPad, data, compressor.length);
+				compressedBytes += compressor.length;
+			}
+		}
+		if(params.enabled("ht_compress"))
+		{
+			std::vector<std::unique_ptr<HTCompressor>> compressors;
+			for(uint32_t i = 0; i < numThreads; ++i)
+				compressors.emplace_back(new HTCompressor(size));
+			BenchResult result("ht_compress", config.str(), numThreads);
+			result.samples = blocks.numSamples();
+			result.bytes = compressedBytes;
+			timeKernel(result, params.iterations, [&]() {
+				for(auto& c : compressors)
+					c->reset();
+				forEachBlock(numThreads, blocks.numBlocks, [&](uint32_t worker, size_t i) {
+					compressors[worker]->compress(blocks.block(i), size, missing_msbs);
+				});
+			});
+			report.add(result);
+		}
+		if(params.enabled("ht_decompress"))
+		{
+			std::vector<std::vector<uint32_t>> outputs(numThreads);
+			for(auto& o : outputs)
+				o.resize(area);
+			std::atomic<bool> verified(true);
+			bool verify = false;
+			auto job = [&](uint32_t worker, size_t i) {
+				auto& e = encoded[i];
+				auto dest = outputs[worker].data();
+				if(!ojph::local::ojph_decode_codeblock(e.data() + htPad, dest, missing_msbs, 1,
+													   (uint32_t)(e.size() - 2 * htPad), 0,
+													   size.w, size.h, size.w))
+					verified = false;
+				else if(verify && !checkHTBlock(blocks.block(i), dest, area, missing_msbs))
+					verified = false;
+			};
+			BenchResult result("ht_decompress", config.str(), numThreads);
+			result.samples = blocks.numSamples();
+			result.bytes = compressedBytes;
+			timeKernel(result, params.iterations,
+					   [&]() { forEachBlock(numThreads, blocks.numBlocks, job); });
+			if(params.check)
+			{
+				verify = true;
+				forEachBlock(numThreads, blocks.numBlocks, job);
+				result.checked = true;
+				result.verified = verified;
+			}
+			report.add(result);
+		}
+	}
+}
+
+/**
+ * Single tile set up directly, without a code stream, so that
+ * transforms can be run in isolation
+ */
+class TransformHarness : public CodeStreamDecompress
+{
+  public:
+	TransformHarness(uint16_t numcomps, uint32_t size, uint8_t numResolutions, uint8_t qmfbid,
+					 bool isCompressor, grkRectU32 window)
+		: CodeStreamDecompress(nullptr), processor(nullptr), tccps(numcomps)
+	{
+		const uint8_t prec = 8;
+		m_headerImage = new GrkImage();
+		m_headerImage->x1 = size;
+		m_headerImage->y1 = size;
+		m_headerImage->numcomps = numcomps;
+		m_headerImage->comps = new grk_image_comp[numcomps];
+		memset(m_headerImage->comps, 0, numcomps * sizeof(grk_image_comp));
+		for(uint16_t compno = 0; compno < numcomps; ++compno)
+		{
+			auto comp = m_headerImage->comps + compno;
+			comp->dx = 1;
+			comp->dy = 1;
+			comp->w = size;
+			comp->h = size;
+			comp->prec = prec;
+		}
+		grkRectU32 bounds(0, 0, size, size);
+		bool wholeTile = (window == bounds);
+		processor = new TileProcessor(this, nullptr, isCompressor, wholeTile);
+		auto tile = processor->tile;
+		tile->x1 = size;
+		tile->y1 = size;
+		for(uint16_t compno = 0; compno < numcomps; ++compno)
+		{
+			auto tccp = &tccps[compno];
+			tccp->numresolutions = numResolutions;
+			tccp->qmfbid = qmfbid;
+			tccp->cblkw = 6;
+			tccp->cblkh = 6;
+			tccp->numgbits = 2;
+			for(uint32_t i = 0; i < GRK_J2K_MAXRLVLS; ++i)
+			{
+				tccp->precinctWidthExp[i] = 15;
+				tccp->precinctHeightExp[i] = 15;
+			}
+			for(uint32_t i = 0; i < GRK_J2K_MAXBANDS; ++i)
+				tccp->stepsizes[i].expn = prec + 2;
+			auto tilec = tile->comps + compno;
+			if(!tilec->init(isCompressor, wholeTile, bounds, prec, &m_cp, &tcp, tccp, nullptr))
+				throw std::runtime_error("unable to initialize tile component");
+			if(!tilec->allocWindowBuffer(window) || !tilec->getBuffer()->alloc())
+				throw std::runtime_error("unable to allocate tile component buffer");
+			if(!wholeTile)
+			{
+				// the T2 decompressor creates precincts as packets are read
+				for(uint8_t resno = 0; resno < numResolutions; ++resno)
+				{
+					auto res = tilec->tileCompResolution + resno;
+					for(uint32_t bandIndex = 0; bandIndex < res->numTileBandWindows; ++bandIndex)
+					{
+						auto band = res->tileBand + bandIndex;
+						for(uint64_t p = 0; p < band->numPrecincts; ++p)
+						{
+							band->createPrecinct(false, p, res->precinctStart, res->precinctExpn,
+												 res->precinctGridWidth, res->cblkExpn);
+						}
+					}
+				}
+				tilec->resolutions_decompressed = (uint8_t)(numResolutions - 1);
+				tilec->allocSparseCanvas(numResolutions, true);
+			}
+		}
+		fill(qmfbid);
+	}
+	~TransformHarness()
+	{
+		delete processor;
+	}
+	/**
+	 * Fill tile buffers with deterministic data. Windowed decompression reads
+	 * sub-band samples from the (zeroed) sparse canvas instead.
+	 */
+	void fill(uint8_t qmfbid)
+	{
+		auto tile = processor->tile;
+		for(uint16_t compno = 0; compno < tile->numcomps; ++compno)
+		{
+			auto win = tile->comps[compno].getBuffer()->getHighestBufferResWindowREL();
+			SyntheticSource source(compno + 1);
+			auto data = win->getBuffer();
+			for(uint32_t j = 0; j < win->height(); ++j)
+			{
+				auto row = data + (size_t)j * win->stride;
+				for(uint32_t i = 0; i < win->width(); ++i)
+				{
+					int32_t val = source.coefficient(8);
+					if(qmfbid == 1)
+					{
+						row[i] = val;
+					}
+					else
+					{
+						float f = (float)val;
+						memcpy(row + i, &f, sizeof(float));
+					}
+				}
+			}
+		}
+	}
+	Tile* getTile(void)
+	{
+		return processor->tile;
+	}
+	TileProcessor* getProcessor(void)
+	{
+		return processor;
+	}
+	TileComponentCodingParams* getTccps(void)
+	{
+		return tccps.data();
+	}
+
+  private:
+	TileProcessor* processor;
+	TileCodingParams tcp;
+	std::vector<TileComponentCodingParams> tccps;
+};
+
+void benchDWT(const BenchParams& params, uint32_t numThreads, BenchReport& report)
+{
+	grkRectU32 bounds(0, 0, params.size, params.size);
+	uint32_t quarter = params.size / 4;
+	grkRectU32 window(quarter + 1, quarter + 3, 3 * quarter - 1, 3 * quarter - 3);
+	for(uint8_t qmfbid = 0; qmfbid <= 1; ++qmfbid)
+	{
+		const char* name = qmfbid ? "5/3" : "9/7";
+		std::stringstream config;
+		config << name << " " << params.size << "x" << params.size << " r"
+			   << (uint32_t)params.numResolutions;
+		if(params.enabled("dwt_forward"))
+		{
+			TransformHarness harness(1, params.size, params.numResolutions, qmfbid, true, bounds);
+			BenchResult result("dwt_forward", config.str(), numThreads);
+			result.samples = bounds.area();
+			bool rc = true;
+			// data is transformed in place; only timing matters here
+			timeKernel(result, params.iterations, [&]() {
+				WaveletFwdImpl w;
+				rc = w.compress(harness.getTile()->comps, qmfbid) && rc;
+			});
+			result.checked = true;
+			result.verified = rc;
+			report.add(result);
+		}
+		if(params.enabled("dwt_inverse"))
+		{
+			TransformHarness harness(1, params.size, params.numResolutions, qmfbid, false, bounds);
+			auto tilec = harness.getTile()->comps;
+			BenchResult result("dwt_inverse", config.str(), numThreads);
+			result.samples = bounds.area();
+			bool rc = true;
+			timeKernel(result, params.iterations, [&]() {
+				WaveletReverse w;
+				rc = w.decompress(harness.getProcessor(), tilec, 0,
+								  tilec->getBuffer()->unreducedBounds(), params.numResolutions,
+								  qmfbid) &&
+					 rc;
+			});
+			if(params.check && qmfbid == 1)
+			{
+				// round trip through forward and inverse 5/3 must be lossless
+				TransformHarness fwd(1, params.size, params.numResolutions, qmfbid, true, bounds);
+				TransformHarness inv(1, params.size, params.numResolutions, qmfbid, false,
+									 bounds);
+				auto src = fwd.getTile()->comps->getBuffer()->getHighestBufferResWindowREL();
+				auto dest = inv.getTile()->comps->getBuffer()->getHighestBufferResWindowREL();
+				std::vector<int32_t> original(src->getBuffer(),
+											  src->getBuffer() + (size_t)src->stride * src->height());
+				WaveletFwdImpl f;
+				rc = f.compress(fwd.getTile()->comps, qmfbid) && rc;
+				memcpy(dest->getBuffer(), src->getBuffer(),
+					   (size_t)src->stride * src->height() * sizeof(int32_t));
+				WaveletReverse w;
+				auto invc = inv.getTile()->comps;
+				rc = w.decompress(inv.getProcessor(), invc, 0,
+								  invc->getBuffer()->unreducedBounds(), params.numResolutions,
+								  qmfbid) &&
+					 rc;
+				rc = rc && !memcmp(original.data(), dest->getBuffer(),
+								   original.size() * sizeof(int32_t));
+			}
+			result.checked = true;
+			result.verified = rc;
+			report.add(result);
+		}
+		if(params.enabled("dwt_inverse_window"))
+		{
+			TransformHarness harness(1, params.size, params.numResolutions, qmfbid, false, window);
+			auto tilec = harness.getTile()->comps;
+			std::stringstream windowConfig;
+			windowConfig << config.str() << " w" << window.width() << "x" << window.height();
+			BenchResult result("dwt_inverse_window", windowConfig.str(), numThreads);
+			result.samples = window.area();
+			bool rc = true;
+			timeKernel(result, params.iterations, [&]() {
+				WaveletReverse w;
+				rc = w.decompress(harness.getProcessor(), tilec, 0,
+								  tilec->getBuffer()->unreducedBounds(), params.numResolutions,
+								  qmfbid) &&
+					 rc;
+			});
+			result.checked = true;
+			result.verified = rc;
+			report.add(result);
+		}
+	}
+}
+
+void benchMCT(const BenchParams& params, uint32_t numThreads, BenchReport& report)
+{
+	grkRectU32 bounds(0, 0, params.size, params.size);
+	std::stringstream config;
+	config << params.size << "x" << params.size << " x3";
+	for(uint8_t qmfbid = 0; qmfbid <= 1; ++qmfbid)
+	{
+		const char* kernelCompress = qmfbid ? "mct_compress_rev" : "mct_compress_irrev";
+		const char* kernelDecompress = qmfbid ? "mct_decompress_rev" : "mct_decompress_irrev";
+		if(params.enabled(kernelCompress))
+		{
+			// forward MCT operates on integer image samples in both cases
+			TransformHarness harness(3, params.size, 1, 1, true, bounds);
+			auto tile = harness.getTile();
+			int32_t* c[3];
+			for(uint16_t compno = 0; compno < 3; ++compno)
+				c[compno] = tile->comps[compno].getBuffer()->getHighestBufferResWindowREL()->getBuffer();
+			uint64_t n = tile->comps->getBuffer()->stridedArea();
+			BenchResult result(kernelCompress, config.str(), numThreads);
+			result.samples = 3 * bounds.area();
+			timeKernel(result, params.iterations, [&]() {
+				if(qmfbid == 1)
+					mct::compress_rev(c[0], c[1], c[2], n);
+				else
+					mct::compress_irrev(c[0], c[1], c[2], n);
+			});
+			report.add(result);
+		}
+		if(params.enabled(kernelDecompress))
+		{
+			TransformHarness harness(3, params.size, 1, qmfbid, false, bounds);
+			BenchResult result(kernelDecompress, config.str(), numThreads);
+			result.samples = 3 * bounds.area();
+			timeKernel(result, params.iterations, [&]() {
+				if(qmfbid == 1)
+					mct::decompress_rev(harness.getTile(), harness.getHeaderImage(),
+										harness.getTccps());
+				else
+					mct::decompress_irrev(harness.getTile(), harness.getHeaderImage(),
+										  harness.getTccps());
+			});
+			report.add(result);
+		}
+	}
+	// custom (Part 2) transforms use a floating point matrix
+	const float matrix[9] = {0.299f,  0.587f,	 0.114f,  -0.1687f, -0.3313f,
+							 0.5f,	  0.5f,		 -0.4187f, -0.0813f};
+	if(params.enabled("mct_compress_custom") || params.enabled("mct_decompress_custom"))
+	{
+		TransformHarness harness(3, params.size, 1, 1, true, bounds);
+		auto tile = harness.getTile();
+		uint8_t* data[3];
+		for(uint16_t compno = 0; compno < 3; ++compno)
+			data[compno] = (uint8_t*)tile->comps[compno]
+							   .getBuffer()
+							   ->getHighestBufferResWindowREL()
+							   ->getBuffer();
+		uint64_t n = tile->comps->getBuffer()->stridedArea();
+		if(params.enabled("mct_compress_custom"))
+		{
+			BenchResult result("mct_compress_custom", config.str(), numThreads);
+			result.samples = 3 * bounds.area();
+			bool rc = true;
+			timeKernel(result, params.iterations, [&]() {
+				rc = mct::compress_custom((uint8_t*)matrix, n, data, 3, 1) && rc;
+			});
+			result.checked = true;
+			result.verified = rc;
+			report.add(result);
+		}
+		if(params.enabled("mct_decompress_custom"))
+		{
+			BenchResult result("mct_decompress_custom", config.str(), numThreads);
+			result.samples = 3 * bounds.area();
+			bool rc = true;
+			timeKernel(result, params.iterations, [&]() {
+				rc = mct::decompress_custom((uint8_t*)matrix, n, data, 3, 1) && rc;
+			});
+			result.checked = true;
+			result.verified = rc;
+			report.add(result);
+		}
+	}
+}
+
+const BlockSize tagTreeSizes[] = {{4, 4}, {16, 16}, {64, 64}};
+
+void benchTagTree(const BenchParams& params, BenchReport& report)
+{
+	const uint8_t maxValue = 15;
+	for(auto& size : tagTreeSizes)
+	{
+		uint64_t numLeaves = (uint64_t)size.w * size.h;
+		SyntheticSource source(size.w);
+		std::vector<uint8_t> values(numLeaves);
+		for(auto& v : values)
+			v = (uint8_t)(source.next() % maxValue);
+		std::vector<uint8_t> buffer(numLeaves * 8 + 16);
+		TagTreeU8 tree(size.w, size.h);
+		size_t numBytes = 0;
+		auto compress = [&]() {
+			tree.reset();
+			for(uint64_t i = 0; i < numLeaves; ++i)
+				tree.setvalue(i, values[i]);
+			BitIO bio(buffer.data(), buffer.size(), true);
+			for(uint64_t i = 0; i < numLeaves; ++i)
+				tree.compress(&bio, i, maxValue);
+			bio.flush();
+			numBytes = bio.numBytes();
+		};
+		std::stringstream config;
+		config << size.w << "x" << size.h;
+		compress();
+		if(params.enabled("tagtree_compress"))
+		{
+			BenchResult result("tagtree_compress", config.str(), 1);
+			result.samples = numLeaves;
+			result.bytes = numBytes;
+			timeKernel(result, params.iterations, compress);
+			report.add(result);
+		}
+		if(params.enabled("tagtree_decompress"))
+		{
+			bool verified = true;
+			BenchResult result("tagtree_decompress", config.str(), 1);
+			result.samples = numLeaves;
+			result.bytes = numBytes;
+			timeKernel(result, params.iterations, [&]() {
+				tree.reset();
+				BitIO bio(buffer.data(), numBytes, false);
+				for(uint64_t i = 0; i < numLeaves; ++i)
+				{
+					uint8_t value;
+					tree.decodeValue(&bio, i, maxValue, &value);
+					if(value != values[i])
+						verified = false;
+				}
+			});
+			result.checked = true;
+			result.verified = verified;
+			report.add(result);
+		}
+	}
+}
+
+/**
+ * Synthetic first-layer contribution of a code block to a packet
+ */
+struct PacketBlock
+{
+	bool included;
+	uint8_t zeroBitPlanes;
+	uint32_t numPasses;
+	uint32_t len;
+};
+
+const BlockSize precinctSizes[] = {{4, 4}, {16, 16}, {64, 64}};
+
+/**
+ * Single layer packet header for one precinct, coded the way T2Compress
+ * and T2Decompress code it: inclusion and zero bit plane tag trees,
+ * number of passes, length increment comma code and segment length
+ */
+void benchPacketHeader(const BenchParams& params, BenchReport& report)
+{
+	for(auto& size : precinctSizes)
+	{
+		uint64_t numBlocks = (uint64_t)size.w * size.h;
+		SyntheticSource source((uint32_t)numBlocks);
+		std::vector<PacketBlock> blocks(numBlocks);
+		for(auto& b : blocks)
+		{
+			uint32_t r = source.next();
+			b.included = (r & 0xF) != 0;
+			b.zeroBitPlanes = (uint8_t)((r >> 4) % 6);
+			b.numPasses = 1 + (r >> 8) % 37;
+			b.len = 1 + (r >> 16) % (b.numPasses * 96);
+		}
+		std::vector<uint8_t> buffer(numBlocks * 16 + 16);
+		TagTreeU16 inclTree(size.w, size.h);
+		TagTreeU8 imsbTree(size.w, size.h);
+		size_t numBytes = 0;
+		bool rc = true;
+		auto compress = [&]() {
+			inclTree.reset();
+			imsbTree.reset();
+			for(uint64_t i = 0; i < numBlocks; ++i)
+			{
+				imsbTree.setvalue(i, blocks[i].zeroBitPlanes);
+				if(blocks[i].included)
+					inclTree.setvalue(i, 0);
+			}
+			BitIO bio(buffer.data(), buffer.size(), true);
+			rc = bio.write(1, 1) && rc;
+			for(uint64_t i = 0; i < numBlocks; ++i)
+			{
+				auto& b = blocks[i];
+				rc = inclTree.compress(&bio, i, 1) && rc;
+				if(!b.included)
+					continue;
+				rc = imsbTree.compress(&bio, i, imsbTree.getUninitializedValue()) && rc;
+				bio.putnumpasses(b.numPasses);
+				uint8_t numlenbits = 3;
+				auto increment = (uint8_t)std::max<int8_t>(
+					0, int8_t(floorlog2(b.len) + 1 - (numlenbits + floorlog2(b.numPasses))));
+				bio.putcommacode(increment);
+				numlenbits = (uint8_t)(numlenbits + increment);
+				rc = bio.write(b.len, numlenbits + floorlog2(b.numPasses)) && rc;
+			}
+			rc = bio.flush() && rc;
+			numBytes = bio.numBytes();
+		};
+		std::stringstream config;
+		config << size.w << "x" << size.h << " blocks";
+		compress();
+		if(params.enabled("t2_header_compress"))
+		{
+			BenchResult result("t2_header_compress", config.str(), 1);
+			result.samples = numBlocks;
+			result.bytes = numBytes;
+			timeKernel(result, params.iterations, compress);
+			result.checked = true;
+			result.verified = rc;
+			report.add(result);
+		}
+		if(params.enabled("t2_header_decompress"))
+		{
+			bool verified = rc;
+			BenchResult result("t2_header_decompress", config.str(), 1);
+			result.samples = numBlocks;
+			result.bytes = numBytes;
+			timeKernel(result, params.iterations, [&]() {
+				inclTree.reset();
+				imsbTree.reset();
+				BitIO bio(buffer.data(), numBytes, false);
+				uint32_t present = 0;
+				bio.read(&present, 1);
+				for(uint64_t i = 0; i < numBlocks; ++i)
+				{
+					auto& b = blocks[i];
+					uint16_t inclusion;
+					inclTree.decodeValue(&bio, i, 1, &inclusion);
+					bool included = inclusion <= 0;
+					if(included != b.included)
+						verified = false;
+					if(!included)
+						continue;
+					uint8_t K_msbs = 0;
+					uint8_t value;
+					imsbTree.decodeValue(&bio, i, K_msbs, &value);
+					while(value >= K_msbs)
+					{
+						++K_msbs;
+						imsbTree.decodeValue(&bio, i, K_msbs, &value);
+					}
+					K_msbs--;
+					uint32_t numPasses = 0;
+					uint8_t increment = 0;
+					uint32_t len = 0;
+					bio.getnumpasses(&numPasses);
+					bio.getcommacode(&increment);
+					bio.read(&len, 3U + increment + floorlog2(numPasses));
+					if(K_msbs != b.zeroBitPlanes || numPasses != b.numPasses || len != b.len)
+						verified = false;
+				}
+				bio.inalign();
+			});
+			result.checked = true;
+			result.verified = verified;
+			report.add(result);
+		}
+	}
+}
+
+void usage(void)
+{
+	printf("bench_kernels [-H num_threads] [-S] [-s size] [-n num_resolutions] [-i iterations]\n");
+	printf("[-k kernel[,kernel...]] [-o output.json] [-c]\n");
+}
+
+class GrokOutput : public StdOutput
+{
+  public:
+	virtual void usage(CmdLineInterface& c)
+	{
+		(void)c;
+		::usage();
+	}
+};
+} // namespace grk
+
+int main(int argc, char** argv)
+{
+	BenchParams params;
+	uint32_t numThreads = 0;
+
+	CmdLine cmd("bench_kernels command line", ' ', grk_version());
+
+	// set the output
+	GrokOutput output;
+	cmd.setOutput(&output);
+
+	SwitchArg checkArg("c", "check", "verify kernel output", cmd);
+	ValueArg<uint32_t> sizeArg("s", "size", "Size of image for transforms", false, 0,
+							   "unsigned integer", cmd);
+	ValueArg<uint32_t> numThreadsArg("H", "num_threads", "Number of threads", false, 0,
+									 "unsigned integer", cmd);
+	ValueArg<uint32_t> numResolutionsArg("n", "Resolutions", "Number of resolutions", false, 0,
+										 "unsigned integer", cmd);
+	ValueArg<uint32_t> iterationsArg("i", "iterations", "Number of timed iterations", false, 0,
+									 "unsigned integer", cmd);
+	ValueArg<std::string> kernelsArg("k", "kernels",
+									 "Comma separated list of kernels (or kernel prefixes)",
+									 false, "", "string", cmd);
+	ValueArg<std::string> outputArg("o", "output", "JSON output file (default: stdout)", false,
+									"", "string", cmd);
+	SwitchArg threadScalingArg("S", "ThreadScaling", "Thread scaling", cmd);
+
+	cmd.parse(argc, argv);
+
+	// keep stdout free for the JSON report
+	spdlog::set_default_logger(spdlog::stderr_color_mt("bench_kernels"));
+	spdlog::set_pattern("%v");
+
+	params.check = checkArg.isSet();
+	if(sizeArg.isSet())
+		params.size = sizeArg.getValue();
+	if(params.size < 16)
+	{
+		spdlog::error("Image size must be at least 16");
+		return 1;
+	}
+	if(numResolutionsArg.isSet())
+	{
+		auto numResolutions = numResolutionsArg.getValue();
+		if(numResolutions == 0 || numResolutions > GRK_J2K_MAXRLVLS)
+		{
+			spdlog::error("Invalid value for num_resolutions. "
+						  "Should be >= 1 and <= {}",
+						  GRK_J2K_MAXRLVLS);
+			return 1;
+		}
+		params.numResolutions = (uint8_t)numResolutions;
+	}
+	if(iterationsArg.isSet() && iterationsArg.getValue())
+		params.iterations = iterationsArg.getValue();
+	if(kernelsArg.isSet())
+	{
+		std::stringstream ss(kernelsArg.getValue());
+		std::string kernel;
+		while(std::getline(ss, kernel, ','))
+		{
+			if(!kernel.empty())
+				params.filters.push_back(kernel);
+		}
+	}
+	if(numThreadsArg.isSet())
+		numThreads = numThreadsArg.getValue();
+	if(numThreads == 0)
+		numThreads = std::max<uint32_t>(ThreadPool::hardware_concurrency(), 1);
+
+	// thread scaling sweeps powers of two, plus the requested number of threads
+	std::vector<uint32_t> threadCounts;
+	if(threadScalingArg.isSet())
+	{
+		for(uint32_t k = 1; k < numThreads; k *= 2)
+			threadCounts.push_back(k);
+	}
+	threadCounts.push_back(numThreads);
+
+	BenchReport report;
+	try
+	{
+		// T2 kernels are single threaded
+		ThreadPool::instance(1);
+		benchTagTree(params, report);
+		benchPacketHeader(params, report);
+		ThreadPool::release();
+		for(auto k : threadCounts)
+		{
+			ThreadPool::instance(k);
+			benchMQ(params, k, report);
+			benchHT(params, k, report);
+			benchDWT(params, k, report);
+			benchMCT(params, k, report);
+			ThreadPool::release();
+		}
+	}
+	catch(std::exception& ex)
+	{
+		spdlog::error("{}", ex.what());
+		return 1;
+	}
+
+	if(outputArg.isSet() && !outputArg.getValue().empty())
+	{
+		std::ofstream os(outputArg.getValue());
+		if(!os)
+		{
+			spdlog::error("Unable to open {} for writing", outputArg.getValue());
+			return 1;
+		}
+		report.write(os);
+	}
+	else
+	{
+		report.write(std::cout);
+	}
+
+	return report.failed() ? 1 : 0;
+}
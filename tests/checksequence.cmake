@@ -0,0 +1,40 @@
+#
+#    Copyright (C) 2016-2021 Grok Image Compression Inc.
+#
+#    This source code is free software: you can redistribute it and/or  modify
+#    it under the terms of the GNU Affero General Public License, version 3,
+#    as published by the Free Software Foundation.
+#
+#    This source code is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU Affero General Public License for more details.
+#
+#    You should have received a copy of the GNU Affero General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# check sequence
+#
+# A compressed sequence must hold, in frame order, exactly the code streams that
+# are produced by compressing each frame on its own.
+#
+# This script expects three inputs
+# SEQUENCE: Path to the sequence file
+# FRAME_PREFIX: Path of the frame code streams, without frame index and extension
+# NUM_FRAMES: Number of frames; frame code streams are FRAME_PREFIX0.j2k and so on
+
+file(READ ${SEQUENCE} sequence HEX)
+set(frames "")
+math(EXPR last_frame "${NUM_FRAMES} - 1")
+foreach(frame RANGE ${last_frame})
+  file(READ ${FRAME_PREFIX}${frame}.j2k code_stream HEX)
+  if(NOT code_stream)
+    message(SEND_ERROR "Empty code stream: ${FRAME_PREFIX}${frame}.j2k")
+  endif()
+  string(APPEND frames "${code_stream}")
+endforeach()
+
+if(NOT "${sequence}" STREQUAL "${frames}")
+  message(SEND_ERROR "${SEQUENCE} does not match frames ${FRAME_PREFIX}0 to ${FRAME_PREFIX}${last_frame}")
+endif()
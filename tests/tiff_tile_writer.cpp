@@ -0,0 +1,170 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Write a tiled TIFF, together with a PNM holding the same samples, so that
+ * the tiled TIFF reader can be checked against the PNM reader
+ *
+ * usage: tiff_tile_writer <numcomps> <prec> <width> <height> <tile width>
+ *                         <tile height> <separate planes> <tif file> <pnm file>
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <tiffio.h>
+
+static uint16_t sample(uint32_t x, uint32_t y, uint16_t c, uint8_t prec)
+{
+	uint32_t noise = ((x * 7919U) ^ (y * 104729U) ^ (c * 31U)) & 0x1F;
+	uint32_t val = ((x * 3 + y * 5 + c * 40) & 0xFF) + noise;
+	return (uint16_t)((val * ((1U << prec) - 1)) / (0xFF + 0x1F));
+}
+
+static void put(uint8_t*& dest, uint16_t val, uint8_t prec, bool bigEndian)
+{
+	if(prec <= 8)
+	{
+		*dest++ = (uint8_t)val;
+	}
+	else if(bigEndian)
+	{
+		*dest++ = (uint8_t)(val >> 8);
+		*dest++ = (uint8_t)val;
+	}
+	else
+	{
+		*dest++ = (uint8_t)val;
+		*dest++ = (uint8_t)(val >> 8);
+	}
+}
+
+static bool writeTiff(const char* filename, uint16_t numcomps, uint8_t prec, uint32_t width,
+					  uint32_t height, uint32_t tileWidth, uint32_t tileHeight, bool separate)
+{
+	auto tif = TIFFOpen(filename, "w");
+	if(!tif)
+		return false;
+	TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, width);
+	TIFFSetField(tif, TIFFTAG_IMAGELENGTH, height);
+	TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, numcomps);
+	TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, prec);
+	TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
+	TIFFSetField(tif, TIFFTAG_PHOTOMETRIC,
+				 numcomps >= 3 ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK);
+	TIFFSetField(tif, TIFFTAG_PLANARCONFIG,
+				 separate ? PLANARCONFIG_SEPARATE : PLANARCONFIG_CONTIG);
+	TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+	TIFFSetField(tif, TIFFTAG_TILEWIDTH, tileWidth);
+	TIFFSetField(tif, TIFFTAG_TILELENGTH, tileHeight);
+
+	uint16_t samplesPerTile = separate ? 1 : numcomps;
+	uint16_t numPlanes = separate ? numcomps : 1;
+	size_t bytesPerSample = prec <= 8 ? 1 : 2;
+	std::vector<uint8_t> buf((size_t)tileWidth * tileHeight * samplesPerTile * bytesPerSample);
+	bool rc = true;
+	for(uint16_t plane = 0; plane < numPlanes && rc; ++plane)
+	{
+		for(uint32_t ty = 0; ty < height && rc; ty += tileHeight)
+		{
+			for(uint32_t tx = 0; tx < width && rc; tx += tileWidth)
+			{
+				// samples beyond the image are padding
+				auto dest = buf.data();
+				for(uint32_t y = ty; y < ty + tileHeight; ++y)
+				{
+					for(uint32_t x = tx; x < tx + tileWidth; ++x)
+					{
+						for(uint16_t s = 0; s < samplesPerTile; ++s)
+						{
+							uint16_t c = (uint16_t)(separate ? plane : s);
+							bool inside = x < width && y < height;
+							put(dest, inside ? sample(x, y, c, prec) : 0, prec, false);
+						}
+					}
+				}
+				rc = TIFFWriteTile(tif, buf.data(), tx, ty, 0, plane) >= 0;
+			}
+		}
+	}
+	TIFFClose(tif);
+
+	return rc;
+}
+
+static bool writePnm(const char* filename, uint16_t numcomps, uint8_t prec, uint32_t width,
+					 uint32_t height)
+{
+	auto fp = fopen(filename, "wb");
+	if(!fp)
+		return false;
+	fprintf(fp, "P%d\n%u %u\n%u\n", numcomps >= 3 ? 6 : 5, width, height, (1U << prec) - 1);
+	size_t bytesPerSample = prec <= 8 ? 1 : 2;
+	std::vector<uint8_t> row((size_t)width * numcomps * bytesPerSample);
+	bool rc = true;
+	for(uint32_t y = 0; y < height && rc; ++y)
+	{
+		auto dest = row.data();
+		for(uint32_t x = 0; x < width; ++x)
+		{
+			for(uint16_t c = 0; c < numcomps; ++c)
+				put(dest, sample(x, y, c, prec), prec, true);
+		}
+		rc = fwrite(row.data(), 1, row.size(), fp) == row.size();
+	}
+	if(fclose(fp))
+		rc = false;
+
+	return rc;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc != 10)
+	{
+		fprintf(stderr,
+				"usage: %s <numcomps> <prec> <width> <height> <tile width> <tile height> "
+				"<separate planes> <tif file> <pnm file>\n",
+				argv[0]);
+		return 1;
+	}
+	auto numcomps = (uint16_t)atoi(argv[1]);
+	auto prec = (uint8_t)atoi(argv[2]);
+	auto width = (uint32_t)atoi(argv[3]);
+	auto height = (uint32_t)atoi(argv[4]);
+	auto tileWidth = (uint32_t)atoi(argv[5]);
+	auto tileHeight = (uint32_t)atoi(argv[6]);
+	bool separate = atoi(argv[7]) != 0;
+	if((numcomps != 1 && numcomps != 3) || (prec != 8 && prec != 16) || !width || !height ||
+	   !tileWidth || !tileHeight || tileWidth % 16 || tileHeight % 16)
+	{
+		fprintf(stderr, "%s: unsupported image or tile dimensions\n", argv[0]);
+		return 1;
+	}
+	if(!writeTiff(argv[8], numcomps, prec, width, height, tileWidth, tileHeight, separate))
+	{
+		fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[8]);
+		return 1;
+	}
+	if(!writePnm(argv[9], numcomps, prec, width, height))
+	{
+		fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[9]);
+		return 1;
+	}
+
+	return 0;
+}
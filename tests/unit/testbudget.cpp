@@ -0,0 +1,122 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Memory budget. A budget smaller than two tiles must throttle the tiles that
+ * compress and decompress concurrently, down to one tile at a time, and still
+ * give back the original image, while without a budget no tile may wait
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+const uint32_t dim = 1024;
+const uint32_t tileDim = 256;
+
+static uint64_t numThrottled(void)
+{
+    grk_memory_stats stats;
+    grk_get_memory_stats(&stats);
+
+    return stats.numThrottledTiles;
+}
+
+static bool check(uint64_t budget)
+{
+    grk_set_memory_budget(budget);
+    uint64_t throttledBefore = numThrottled();
+
+    grk_cparameters parameters;
+    grk_compress_set_default_params(&parameters);
+    parameters.cod_format = GRK_J2K_FMT;
+    parameters.tile_size_on = true;
+    parameters.t_width = tileDim;
+    parameters.t_height = tileDim;
+    std::vector<uint8_t> data;
+    auto image = grk_test::create_image(3, dim, dim, 8);
+    bool rc = image && grk_test::compress(&parameters, image, data);
+    if(image)
+        grk_object_unref(&image->obj);
+    if(!rc)
+    {
+        printf("budget %llu: compress failed\n", (unsigned long long)budget);
+        return false;
+    }
+    uint64_t throttledCompress = numThrottled() - throttledBefore;
+
+    grk_dparameters dparameters;
+    grk_decompress_set_default_params(&dparameters);
+    grk_test::decompressed_image decompressed;
+    if(!decompressed.decompress(data, &dparameters))
+    {
+        printf("budget %llu: decompress failed\n", (unsigned long long)budget);
+        return false;
+    }
+    uint64_t throttledDecompress = numThrottled() - throttledBefore - throttledCompress;
+    auto original = grk_test::create_image(3, dim, dim, 8);
+    rc = grk_test::equal(decompressed.image, original);
+    if(original)
+        grk_object_unref(&original->obj);
+    if(!rc)
+    {
+        printf("budget %llu: decompressed image differs from original\n",
+               (unsigned long long)budget);
+        return false;
+    }
+    // 16 tiles: all but the first may have to wait
+    bool expectThrottled = budget != 0;
+    if((throttledCompress != 0) != expectThrottled ||
+       (throttledDecompress != 0) != expectThrottled)
+    {
+        printf("budget %llu: %llu compressed and %llu decompressed tiles throttled\n",
+               (unsigned long long)budget, (unsigned long long)throttledCompress,
+               (unsigned long long)throttledDecompress);
+        return false;
+    }
+    grk_memory_stats stats;
+    grk_get_memory_stats(&stats);
+    if(budget && !stats.peakBytes)
+    {
+        printf("budget %llu: allocations were not tracked\n", (unsigned long long)budget);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    // tiles are only throttled when several are in flight
+    grk_initialize_ex(nullptr, 4, GRK_THREAD_AFFINITY_NONE);
+    grk_test::set_handlers();
+
+    // no budget, and a budget of less than one tile's sample buffers
+    bool rc = check(0);
+    rc = rc && check((uint64_t)tileDim * tileDim * sizeof(int32_t));
+    rc = rc && check(0);
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
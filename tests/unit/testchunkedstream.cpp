@@ -0,0 +1,203 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Chunked memory write stream: chunks are added as the stream grows, positional
+ * writes to disjoint ranges may run concurrently across chunk boundaries, bytes
+ * skipped over read as zero even in chunks recycled from the chunk pool, and
+ * chunks are listed in stream order. Only non-chunked streams are rejected.
+ */
+
+#include <assert.h>
+#include <set>
+#include <thread>
+
+#include "grk_includes.h"
+#include "unit_test_common.h"
+
+const size_t chunkSize = 100;
+
+static uint8_t pattern(uint64_t offset)
+{
+    return (uint8_t)(offset * 7 + 3);
+}
+
+static std::vector<grk_stream_chunk> get_chunks(grk_stream* stream)
+{
+    size_t numChunks = grk::get_chunked_mem_stream_chunks(stream, nullptr, 0);
+    std::vector<grk_stream_chunk> chunks(numChunks);
+    grk::get_chunked_mem_stream_chunks(stream, chunks.data(), numChunks);
+
+    return chunks;
+}
+
+/**
+ * Check that stream holds length bytes, where bytes in [gapBegin, gapEnd) are zero
+ * and all others follow the pattern
+ */
+static bool check_contents(grk_stream* stream, uint64_t length, uint64_t gapBegin, uint64_t gapEnd)
+{
+    auto chunks = get_chunks(stream);
+    if(chunks.size() != (length + chunkSize - 1) / chunkSize)
+        return false;
+    uint64_t offset = 0;
+    for(auto& chunk : chunks)
+    {
+        if(chunk.len != std::min<uint64_t>(chunkSize, length - offset))
+            return false;
+        auto data = (uint8_t*)chunk.data;
+        for(size_t i = 0; i < chunk.len; ++i, ++offset)
+        {
+            uint8_t expected = (offset >= gapBegin && offset < gapEnd) ? 0 : pattern(offset);
+            if(data[i] != expected)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool check_sequential(void)
+{
+    auto stream = grk::create_chunked_mem_write_stream(chunkSize);
+    auto impl = grk::BufferedStream::getImpl(stream);
+    const uint64_t length = 1050;
+    bool rc = true;
+    // odd sized writes straddle chunk boundaries
+    for(uint64_t offset = 0; rc && offset < length; offset += 33)
+    {
+        uint8_t buf[33];
+        size_t len = (size_t)std::min<uint64_t>(sizeof(buf), length - offset);
+        for(size_t i = 0; i < len; ++i)
+            buf[i] = pattern(offset + i);
+        rc = impl->writeBytes(buf, len) == len;
+    }
+    rc = rc && check_contents(stream, length, 0, 0);
+    grk_object_unref(stream);
+    if(!rc)
+        printf("sequential writes: stream contents differ\n");
+
+    return rc;
+}
+
+static bool check_concurrent(void)
+{
+    auto stream = grk::create_chunked_mem_write_stream(chunkSize);
+    auto impl = grk::BufferedStream::getImpl(stream);
+    // ranges start part way into a chunk, and are written last to first,
+    // so that every write but the first grows the stream over a gap
+    const uint64_t gap = 37;
+    const uint64_t rangeLength = 251;
+    const uint32_t numRanges = 16;
+    std::vector<std::thread> threads;
+    std::vector<bool> results(numRanges, false);
+    for(uint32_t r = numRanges; r-- > 0;)
+    {
+        threads.emplace_back([impl, r, gap, rangeLength, &results] {
+            uint64_t offset = gap + r * rangeLength;
+            std::vector<uint8_t> buf(rangeLength);
+            for(size_t i = 0; i < rangeLength; ++i)
+                buf[i] = pattern(offset + i);
+            results[r] = impl->writeAt(buf.data(), buf.size(), offset);
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+    bool rc = impl->supportsWriteAt();
+    for(uint32_t r = 0; r < numRanges; ++r)
+        rc = rc && results[r];
+    rc = rc && check_contents(stream, gap + numRanges * rangeLength, 0, gap);
+    grk_object_unref(stream);
+    if(!rc)
+        printf("concurrent writes: stream contents differ\n");
+
+    return rc;
+}
+
+static bool check_pool_reuse(void)
+{
+    // fill chunks with non-zero bytes, and return them to the pool
+    auto stream = grk::create_chunked_mem_write_stream(chunkSize);
+    auto impl = grk::BufferedStream::getImpl(stream);
+    std::vector<uint8_t> buf(chunkSize * 4, 0xFF);
+    bool rc = impl->writeBytes(buf.data(), buf.size()) == buf.size();
+    std::set<void*> released;
+    for(auto& chunk : get_chunks(stream))
+        released.insert(chunk.data);
+    grk_object_unref(stream);
+    if(!rc || released.size() != 4)
+    {
+        printf("pool reuse: unable to fill stream\n");
+        return false;
+    }
+
+    // a write past the start of a new stream must zero the recycled chunks it skips
+    stream = grk::create_chunked_mem_write_stream(chunkSize);
+    impl = grk::BufferedStream::getImpl(stream);
+    const uint64_t offset = chunkSize * 3 + 10;
+    uint8_t bytes[20];
+    for(size_t i = 0; i < sizeof(bytes); ++i)
+        bytes[i] = pattern(offset + i);
+    rc = impl->writeAt(bytes, sizeof(bytes), offset);
+    auto chunks = get_chunks(stream);
+    for(auto& chunk : chunks)
+        rc = rc && released.count(chunk.data);
+    if(!rc)
+        printf("pool reuse: chunks were not recycled\n");
+    else if(!check_contents(stream, offset + sizeof(bytes), 0, offset))
+    {
+        printf("pool reuse: skipped bytes of recycled chunks are not zero\n");
+        rc = false;
+    }
+    grk_object_unref(stream);
+
+    return rc;
+}
+
+static bool check_stream_kind(void)
+{
+    uint8_t buf[64];
+    auto stream = grk_stream_create_mem_stream(buf, sizeof(buf), false, false);
+    grk_stream_chunk chunk;
+    bool rc = grk::get_chunked_mem_stream_chunks(stream, &chunk, 1) == 0;
+    grk_object_unref(stream);
+    if(!rc)
+        printf("memory stream was accepted as a chunked memory stream\n");
+
+    return rc;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+    // rejecting a memory stream logs an error
+    grk_set_error_handler(grk_test::quiet_callback, nullptr);
+
+    bool rc = check_sequential() && check_concurrent() && check_pool_reuse() &&
+              check_stream_kind();
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
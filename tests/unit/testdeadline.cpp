@@ -0,0 +1,114 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Decompression with a time budget. A budget too small for the image must interrupt
+ * the decompress, which still succeeds with an image of full size reconstructed
+ * from what was decoded, while a budget that is never reached, or no budget at all,
+ * must give the original image back
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+const uint32_t dim = 2048;
+
+static bool check(std::vector<uint8_t>& data, const grk_image* original, uint32_t budgetMs,
+                  bool expectInterrupted)
+{
+    grk_dparameters parameters;
+    grk_decompress_set_default_params(&parameters);
+    parameters.timeBudgetMs = budgetMs;
+    grk_test::decompressed_image decompressed;
+    if(!decompressed.decompress(data, &parameters))
+    {
+        printf("budget %u ms: decompress failed\n", budgetMs);
+        return false;
+    }
+    bool interrupted = grk_decompress_was_interrupted(decompressed.codec);
+    if(interrupted != expectInterrupted)
+    {
+        printf("budget %u ms: decompress %s interrupted\n", budgetMs,
+               interrupted ? "was" : "was not");
+        return false;
+    }
+    auto image = decompressed.image;
+    if(image->numcomps != original->numcomps)
+        return false;
+    for(uint16_t i = 0; i < image->numcomps; ++i)
+    {
+        auto a = image->comps + i;
+        auto b = original->comps + i;
+        if(a->w != b->w || a->h != b->h || a->prec != b->prec || !a->data)
+        {
+            printf("budget %u ms: component %u has wrong dimensions\n", budgetMs, i);
+            return false;
+        }
+    }
+    if(grk_test::equal(image, original) == interrupted)
+    {
+        printf("budget %u ms: decompressed image %s original\n", budgetMs,
+               interrupted ? "equals" : "differs from");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    grk_cparameters parameters;
+    grk_compress_set_default_params(&parameters);
+    parameters.cod_format = GRK_J2K_FMT;
+    parameters.tile_size_on = true;
+    parameters.t_width = 512;
+    parameters.t_height = 512;
+    parameters.numlayers = 3;
+    parameters.layer_rate[0] = 40;
+    parameters.layer_rate[1] = 10;
+    parameters.layer_rate[2] = 0;
+    parameters.allocationByRateDistoration = true;
+
+    std::vector<uint8_t> data;
+    auto image = grk_test::create_image(3, dim, dim, 8);
+    bool rc = image && grk_test::compress(&parameters, image, data);
+    if(image)
+        grk_object_unref(&image->obj);
+    auto original = grk_test::create_image(3, dim, dim, 8);
+    rc = rc && original;
+
+    // no budget, a budget that is never reached, and a budget that is
+    rc = rc && check(data, original, 0, false);
+    rc = rc && check(data, original, 3600 * 1000, false);
+    rc = rc && check(data, original, 1, true);
+    if(original)
+        grk_object_unref(&original->obj);
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
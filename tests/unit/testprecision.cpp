@@ -0,0 +1,141 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Output precision applied by the library's tile workers must match the
+ * command line conversion (clip_component and scale_component) applied to
+ * an image decompressed at its original precision, and tile images must
+ * report the same precision as the composite image.
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+#include "convert.h"
+
+static bool check(std::vector<uint8_t>& data, const char* name)
+{
+    const grk_precision precisions[] = {{4, GRK_PREC_MODE_CLIP},  {1, GRK_PREC_MODE_CLIP},
+                                        {12, GRK_PREC_MODE_CLIP}, {4, GRK_PREC_MODE_SCALE},
+                                        {1, GRK_PREC_MODE_SCALE}, {12, GRK_PREC_MODE_SCALE},
+                                        {16, GRK_PREC_MODE_SCALE}};
+    grk_dparameters parameters;
+    grk_decompress_set_default_params(&parameters);
+    parameters.tileCacheStrategy = GRK_TILE_CACHE_ALL;
+    for(auto precision : precisions)
+    {
+        grk_test::decompressed_image original;
+        parameters.precision = nullptr;
+        parameters.numPrecision = 0;
+        if(!original.decompress(data, &parameters))
+            return false;
+        for(uint16_t compno = 0; compno < original.image->numcomps; ++compno)
+        {
+            auto comp = original.image->comps + compno;
+            if(precision.prec == comp->prec)
+                continue;
+            if(precision.mode == GRK_PREC_MODE_CLIP)
+                clip_component(comp, precision.prec);
+            else
+                scale_component(comp, precision.prec);
+        }
+        grk_test::decompressed_image library;
+        parameters.precision = &precision;
+        parameters.numPrecision = 1;
+        if(!library.decompress(data, &parameters) ||
+           !grk_test::equal(library.image, original.image))
+        {
+            printf("%s: library %s to precision %u differs from command line conversion\n",
+                   name, precision.mode == GRK_PREC_MODE_CLIP ? "clip" : "scale",
+                   precision.prec);
+            return false;
+        }
+        // cached tile images carry the output precision too
+        auto tileImage = grk_decompress_get_tile_image(library.codec, 0);
+        if(!tileImage)
+            return false;
+        for(uint16_t compno = 0; compno < tileImage->numcomps; ++compno)
+        {
+            if(tileImage->comps[compno].prec != library.image->comps[compno].prec)
+            {
+                printf("%s: tile image precision %u differs from composite image precision %u\n",
+                       name, tileImage->comps[compno].prec, library.image->comps[compno].prec);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    struct stream
+    {
+        const char* name;
+        bool sgnd;
+        bool irreversible;
+    } streams[] = {{"unsigned", false, false},
+                   {"signed", true, false},
+                   {"irreversible unsigned", false, true},
+                   {"irreversible signed", true, true}};
+    bool rc = true;
+    for(auto& s : streams)
+    {
+        auto image = grk_test::create_image(3, 200, 150, 8);
+        assert(image);
+        if(s.sgnd)
+        {
+            for(uint16_t compno = 0; compno < image->numcomps; ++compno)
+            {
+                auto comp = image->comps + compno;
+                comp->sgnd = true;
+                for(uint32_t y = 0; y < comp->h; ++y)
+                {
+                    for(uint32_t x = 0; x < comp->w; ++x)
+                        comp->data[(uint64_t)y * comp->stride + x] -= 1 << (comp->prec - 1);
+                }
+            }
+        }
+        grk_cparameters parameters;
+        grk_compress_set_default_params(&parameters);
+        parameters.cod_format = GRK_J2K_FMT;
+        parameters.irreversible = s.irreversible;
+        parameters.tile_size_on = true;
+        parameters.t_width = 128;
+        parameters.t_height = 128;
+        std::vector<uint8_t> data;
+        rc = grk_test::compress(&parameters, image, data) && check(data, s.name);
+        grk_object_unref(&image->obj);
+        if(!rc)
+            break;
+    }
+    assert(rc);
+
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
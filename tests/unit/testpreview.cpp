@@ -0,0 +1,180 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Resolution-progressive previews: every tile must be previewed at each
+ * intermediate resolution, lowest resolution first, and each preview must
+ * match that tile's region of the image decompressed with the same reduce
+ */
+
+#include <assert.h>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "unit_test_common.h"
+
+const uint32_t width = 300;
+const uint32_t height = 200;
+const uint8_t numresolutions = 4;
+
+struct previews
+{
+    std::mutex mutex;
+    // (tile index, reduce) => preview image
+    std::map<std::pair<uint16_t, uint8_t>, grk_image*> images;
+    bool ordered = true;
+
+    ~previews()
+    {
+        for(auto& p : images)
+            grk_object_unref(&p.second->obj);
+    }
+};
+
+static void preview_callback(uint16_t tileIndex, uint8_t reduce, grk_image* image,
+                             void* user_data)
+{
+    auto p = (previews*)user_data;
+    std::lock_guard<std::mutex> lock(p->mutex);
+    // previews of a tile arrive lowest resolution (highest reduce) first
+    auto prev = p->images.lower_bound(std::make_pair(tileIndex, (uint8_t)0));
+    if(prev != p->images.end() && prev->first.first == tileIndex && prev->first.second <= reduce)
+        p->ordered = false;
+    grk_object_ref(&image->obj);
+    p->images[std::make_pair(tileIndex, reduce)] = image;
+}
+
+/**
+ * Compare preview with the region it covers in a reduced image
+ */
+static bool equal_region(const grk_image* preview, const grk_image* reduced)
+{
+    if(preview->numcomps != reduced->numcomps)
+        return false;
+    for(uint16_t i = 0; i < preview->numcomps; ++i)
+    {
+        auto cp = preview->comps + i;
+        auto cr = reduced->comps + i;
+        if(cp->prec != cr->prec || cp->sgnd != cr->sgnd || cp->x0 < cr->x0 ||
+           cp->y0 < cr->y0 || cp->x0 - cr->x0 + cp->w > cr->w ||
+           cp->y0 - cr->y0 + cp->h > cr->h)
+            return false;
+        for(uint32_t y = 0; y < cp->h; ++y)
+        {
+            auto rowp = cp->data + (uint64_t)y * cp->stride;
+            auto rowr = cr->data + (uint64_t)(cp->y0 - cr->y0 + y) * cr->stride + cp->x0 - cr->x0;
+            if(memcmp(rowp, rowr, cp->w * sizeof(int32_t)) != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool check(const char* name, bool irreversible)
+{
+    grk_cparameters cparameters;
+    grk_compress_set_default_params(&cparameters);
+    cparameters.cod_format = GRK_J2K_FMT;
+    cparameters.numresolution = numresolutions;
+    cparameters.irreversible = irreversible;
+    cparameters.tile_size_on = true;
+    cparameters.t_width = 128;
+    cparameters.t_height = 128;
+    std::vector<uint8_t> data;
+    auto image = grk_test::create_image(3, width, height, 8);
+    bool rc = image && grk_test::compress(&cparameters, image, data);
+    if(image)
+        grk_object_unref(&image->obj);
+    if(!rc)
+    {
+        printf("%s: compress failed\n", name);
+        return false;
+    }
+
+    previews p;
+    grk_dparameters parameters;
+    grk_decompress_set_default_params(&parameters);
+    parameters.previewCallback = preview_callback;
+    parameters.previewUserData = &p;
+    grk_test::decompressed_image full;
+    if(!full.decompress(data, &parameters))
+    {
+        printf("%s: decompress failed\n", name);
+        return false;
+    }
+    uint16_t numTiles = (uint16_t)(((width + 127) / 128) * ((height + 127) / 128));
+    if(p.images.size() != (size_t)numTiles * (numresolutions - 1) || !p.ordered)
+    {
+        printf("%s: %u previews received, %s\n", name, (uint32_t)p.images.size(),
+               p.ordered ? "in order" : "out of order");
+        return false;
+    }
+    if(!irreversible)
+    {
+        auto original = grk_test::create_image(3, width, height, 8);
+        rc = grk_test::equal(full.image, original);
+        grk_object_unref(&original->obj);
+        if(!rc)
+        {
+            printf("%s: decompressed image differs from original\n", name);
+            return false;
+        }
+    }
+    for(uint8_t reduce = 1; reduce < numresolutions; ++reduce)
+    {
+        grk_decompress_set_default_params(&parameters);
+        parameters.cp_reduce = reduce;
+        grk_test::decompressed_image reduced;
+        if(!reduced.decompress(data, &parameters))
+        {
+            printf("%s: decompress at reduce %u failed\n", name, reduce);
+            return false;
+        }
+        for(uint16_t tileIndex = 0; tileIndex < numTiles; ++tileIndex)
+        {
+            auto it = p.images.find(std::make_pair(tileIndex, reduce));
+            if(it == p.images.end() || !equal_region(it->second, reduced.image))
+            {
+                printf("%s: preview of tile %u at reduce %u differs from reduced image\n", name,
+                       tileIndex, reduce);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    bool rc = check("reversible", false) && check("irreversible", true);
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
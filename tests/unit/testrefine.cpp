@@ -0,0 +1,128 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Refine a multi-tile decompress on the same codec: add quality layers,
+ * then change the reduction and the output precision. Each pass must match
+ * a fresh decompress with the same parameters.
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+static void set_decompress_params(grk_dparameters* parameters, uint16_t layers, uint8_t reduce,
+                                  grk_precision* precision)
+{
+    grk_decompress_set_default_params(parameters);
+    parameters->tileCacheStrategy = GRK_TILE_CACHE_ALL;
+    parameters->cp_layer = layers;
+    parameters->cp_reduce = reduce;
+    parameters->precision = precision;
+    parameters->numPrecision = precision ? 1 : 0;
+}
+
+static bool refine(std::vector<uint8_t>& data)
+{
+    grk_precision precision = {6, GRK_PREC_MODE_SCALE};
+    struct pass
+    {
+        uint16_t layers;
+        uint8_t reduce;
+        grk_precision* precision;
+    } passes[] = {{1, 0, nullptr}, {2, 0, nullptr},    {0, 0, nullptr},   {0, 1, nullptr},
+                  {0, 1, &precision}, {0, 0, &precision}, {0, 0, nullptr}};
+
+    grk_dparameters parameters;
+    set_decompress_params(&parameters, passes[0].layers, passes[0].reduce, passes[0].precision);
+    grk_stream* stream = nullptr;
+    auto codec = grk_test::open(data, &parameters, &stream);
+    if(!codec)
+        return false;
+    bool rc = true;
+    for(auto& p : passes)
+    {
+        set_decompress_params(&parameters, p.layers, p.reduce, p.precision);
+        rc = grk_decompress_init(codec, &parameters) && grk_decompress(codec, nullptr);
+        if(!rc)
+            break;
+        grk_test::decompressed_image fresh;
+        rc = fresh.decompress(data, &parameters) &&
+             grk_test::equal(grk_decompress_get_composited_image(codec), fresh.image);
+        if(!rc)
+        {
+            printf("refined decompress (layers %u, reduce %u, precision %u) differs from fresh "
+                   "decompress\n",
+                   p.layers, p.reduce, p.precision ? p.precision->prec : 0);
+            break;
+        }
+    }
+    grk_object_unref(codec);
+    grk_object_unref(stream);
+
+    return rc;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    auto image = grk_test::create_image(3, 256, 192, 8);
+    assert(image);
+
+    grk_cparameters parameters;
+    grk_compress_set_default_params(&parameters);
+    parameters.cod_format = GRK_J2K_FMT;
+    parameters.tile_size_on = true;
+    parameters.t_width = 128;
+    parameters.t_height = 128;
+    parameters.numlayers = 3;
+    parameters.layer_rate[0] = 40;
+    parameters.layer_rate[1] = 10;
+    parameters.layer_rate[2] = 0;
+    parameters.allocationByRateDistoration = true;
+    std::vector<uint8_t> data;
+    bool rc = grk_test::compress(&parameters, image, data) && refine(data);
+    assert(rc);
+
+    // high throughput code blocks are always decompressed again
+    grk_object_unref(&image->obj);
+    image = grk_test::create_image(3, 256, 192, 8);
+    assert(image);
+    grk_compress_set_default_params(&parameters);
+    parameters.cod_format = GRK_J2K_FMT;
+    parameters.tile_size_on = true;
+    parameters.t_width = 128;
+    parameters.t_height = 128;
+    parameters.cblk_sty = GRK_CBLKSTY_HT;
+    parameters.isHT = true;
+    parameters.numgbits = 1;
+    rc = rc && grk_test::compress(&parameters, image, data) && refine(data);
+    assert(rc);
+
+    grk_object_unref(&image->obj);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
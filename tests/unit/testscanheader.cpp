@@ -0,0 +1,248 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * grk_scan_header reads the main header and JP2 boxes without a codec. Everything
+ * it reports must agree with the header read by grk_decompress_read_header
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+const char* fname = "testscanheader.tmp";
+
+struct config
+{
+    const char* name;
+    GRK_CODEC_FORMAT format;
+    uint16_t numcomps;
+    uint8_t prec;
+    uint8_t chromaSubsampling;
+    uint32_t offset;
+    bool tiled;
+    bool irreversible;
+};
+
+static void set_compress_params(grk_cparameters* parameters, const config& c)
+{
+    grk_compress_set_default_params(parameters);
+    parameters->cod_format = c.format == GRK_CODEC_JP2 ? GRK_JP2_FMT : GRK_J2K_FMT;
+    parameters->irreversible = c.irreversible;
+    if(c.tiled)
+    {
+        parameters->tile_size_on = true;
+        parameters->tx0 = c.offset / 2;
+        parameters->ty0 = c.offset / 3;
+        parameters->t_width = 64;
+        parameters->t_height = 48;
+        parameters->numresolution = 4;
+        parameters->cblockw_init = 32;
+        parameters->cblockh_init = 16;
+        parameters->cblk_sty = 0x04;
+        parameters->csty = 0x06;
+        parameters->prog_order = GRK_RPCL;
+        parameters->numlayers = 2;
+        parameters->layer_rate[0] = 20;
+        parameters->layer_rate[1] = 0;
+        parameters->allocationByRateDistoration = true;
+        parameters->writeTLM = true;
+        parameters->writePLT = true;
+    }
+    if(c.format == GRK_CODEC_JP2)
+    {
+        parameters->write_capture_resolution = true;
+        parameters->capture_resolution[0] = 2834.0;
+        parameters->capture_resolution[1] = 1417.0;
+        parameters->write_display_resolution = true;
+        parameters->display_resolution[0] = 11811.0;
+        parameters->display_resolution[1] = 3937.0;
+    }
+}
+
+/**
+ * Compress a test image for config c to file fname
+ */
+static bool compress(const config& c)
+{
+    auto image = grk_test::create_image(c.numcomps, 200, 150, c.prec, c.chromaSubsampling);
+    if(!image)
+        return false;
+    // shift the image away from the canvas origin
+    image->x0 = c.offset;
+    image->y0 = c.offset;
+    image->x1 += c.offset;
+    image->y1 += c.offset;
+    for(uint16_t i = 0; i < image->numcomps; ++i)
+    {
+        auto comp = image->comps + i;
+        comp->x0 = (c.offset + comp->dx - 1) / comp->dx;
+        comp->y0 = (c.offset + comp->dy - 1) / comp->dy;
+        comp->w = (image->x1 + comp->dx - 1) / comp->dx - comp->x0;
+        comp->h = (image->y1 + comp->dy - 1) / comp->dy - comp->y0;
+    }
+    grk_cparameters parameters;
+    set_compress_params(&parameters, c);
+    char comment[] = "scan header test";
+    parameters.comment[0] = comment;
+    parameters.comment_len[0] = (uint16_t)strlen(comment);
+    parameters.num_comments = 1;
+    std::vector<uint8_t> data;
+    bool rc = grk_test::compress(&parameters, image, data, c.format);
+    grk_object_unref(&image->obj);
+    if(!rc)
+        return false;
+    auto fp = fopen(fname, "wb");
+    if(!fp)
+        return false;
+    rc = fwrite(data.data(), 1, data.size(), fp) == data.size();
+
+    return (fclose(fp) == 0) && rc;
+}
+
+#define CHECK(a, b)                                                          \
+    if((a) != (b))                                                           \
+    {                                                                        \
+        printf("%s: %s (%llu) != %s (%llu)\n", c.name, #a,                   \
+               (unsigned long long)(a), #b, (unsigned long long)(b));      \
+        return false;                                                        \
+    }
+
+static bool check(const config& c)
+{
+    if(!compress(c))
+    {
+        printf("%s: compress failed\n", c.name);
+        return false;
+    }
+    grk_header_scan scan;
+    if(!grk_scan_header(fname, &scan))
+    {
+        printf("%s: scan failed\n", c.name);
+        return false;
+    }
+    auto stream = grk_stream_create_file_stream(fname, 1024 * 1024, true);
+    if(!stream)
+        return false;
+    auto codec = grk_decompress_create(c.format, stream);
+    grk_dparameters parameters;
+    grk_decompress_set_default_params(&parameters);
+    grk_header_info info;
+    memset(&info, 0, sizeof(info));
+    bool rc = codec && grk_decompress_init(codec, &parameters) &&
+              grk_decompress_read_header(codec, &info);
+    auto image = rc ? grk_decompress_get_composited_image(codec) : nullptr;
+    if(!image)
+    {
+        printf("%s: read header failed\n", c.name);
+        rc = false;
+    }
+    rc = rc && [&]() {
+        CHECK(scan.format, c.format);
+        CHECK(scan.rsiz, info.rsiz);
+        CHECK(scan.x0, image->x0);
+        CHECK(scan.y0, image->y0);
+        CHECK(scan.x1, image->x1);
+        CHECK(scan.y1, image->y1);
+        CHECK(scan.tx0, info.tx0);
+        CHECK(scan.ty0, info.ty0);
+        CHECK(scan.t_width, info.t_width);
+        CHECK(scan.t_height, info.t_height);
+        CHECK(scan.t_grid_width, info.t_grid_width);
+        CHECK(scan.t_grid_height, info.t_grid_height);
+        CHECK(scan.numcomps, image->numcomps);
+        for(uint16_t i = 0; i < image->numcomps && i < GRK_HEADER_SCAN_MAX_COMPS; ++i)
+        {
+            CHECK(scan.comps[i].dx, image->comps[i].dx);
+            CHECK(scan.comps[i].dy, image->comps[i].dy);
+            CHECK(scan.comps[i].prec, image->comps[i].prec);
+            CHECK(scan.comps[i].sgnd, image->comps[i].sgnd);
+        }
+        // header info holds the component coding style, which lacks the SOP and EPH bits
+        CHECK(scan.csty & 0x01, info.csty);
+        CHECK(scan.numlayers, info.numlayers);
+        CHECK(scan.mct, info.mct);
+        CHECK(scan.numresolutions, info.numresolutions);
+        CHECK(scan.cblockw, info.cblockw_init);
+        CHECK(scan.cblockh, info.cblockh_init);
+        CHECK(scan.cblk_sty, info.cblk_sty);
+        CHECK(scan.irreversible, info.irreversible);
+        CHECK(scan.has_tlm, c.tiled);
+        CHECK(scan.num_comments, info.num_comments);
+        if(c.format == GRK_CODEC_JP2)
+        {
+            CHECK(scan.has_colr, true);
+            CHECK(scan.enumcs, image->numcomps >= 3 ? GRK_ENUM_CLRSPC_SRGB : GRK_ENUM_CLRSPC_GRAY);
+            CHECK(scan.has_capture_resolution, true);
+            CHECK(scan.has_display_resolution, true);
+            CHECK(scan.has_capture_resolution, image->has_capture_resolution);
+            CHECK(scan.has_display_resolution, image->has_display_resolution);
+            for(uint32_t i = 0; i < 2; ++i)
+            {
+                if(scan.capture_resolution[i] != image->capture_resolution[i] ||
+                   scan.display_resolution[i] != image->display_resolution[i])
+                {
+                    printf("%s: resolution differs\n", c.name);
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            CHECK(scan.codestream_offset, 0);
+        }
+        return true;
+    }();
+    if(codec)
+        grk_object_unref(codec);
+    grk_object_unref(stream);
+    remove(fname);
+
+    return rc;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    const config configs[] = {
+        {"j2k", GRK_CODEC_J2K, 3, 8, 1, 0, false, false},
+        {"j2k tiled", GRK_CODEC_J2K, 3, 8, 1, 21, true, true},
+        {"j2k gray 12 bit", GRK_CODEC_J2K, 1, 12, 1, 0, true, false},
+        {"j2k subsampled", GRK_CODEC_J2K, 3, 8, 2, 0, false, true},
+        {"j2k five components", GRK_CODEC_J2K, 5, 8, 1, 0, true, false},
+        {"jp2", GRK_CODEC_JP2, 3, 8, 1, 0, false, false},
+        {"jp2 gray tiled", GRK_CODEC_JP2, 1, 16, 1, 21, true, true}};
+    bool rc = true;
+    for(auto& c : configs)
+    {
+        rc = check(c);
+        if(!rc)
+            break;
+    }
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
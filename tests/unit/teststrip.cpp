@@ -0,0 +1,179 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Strip and windowed decompression both go through the partial (sparse canvas)
+ * wavelet synthesis. Strip decompresses at several strip heights must match a
+ * whole tile decompress, and windowed decompresses at odd offsets must match the
+ * corresponding crop of a whole tile decompress.
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+/**
+ * Check that every component of window lies inside the corresponding component
+ * of whole, and has the same samples
+ */
+static bool equal_crop(const grk_image* window, const grk_image* whole)
+{
+    if(!window || !whole || window->numcomps != whole->numcomps)
+        return false;
+    for(uint16_t i = 0; i < window->numcomps; ++i)
+    {
+        auto cw = window->comps + i;
+        auto cf = whole->comps + i;
+        if(cw->x0 < cf->x0 || cw->y0 < cf->y0 || cw->x0 + cw->w > cf->x0 + cf->w ||
+           cw->y0 + cw->h > cf->y0 + cf->h || cw->prec != cf->prec || !cw->data || !cf->data)
+            return false;
+        for(uint32_t y = 0; y < cw->h; ++y)
+        {
+            auto src = cf->data + (uint64_t)(cw->y0 - cf->y0 + y) * cf->stride + (cw->x0 - cf->x0);
+            if(memcmp(cw->data + (uint64_t)y * cw->stride, src, cw->w * sizeof(int32_t)) != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool decompress_window(std::vector<uint8_t>& data, grk_dparameters* parameters,
+                              const uint32_t* window, const grk_image* whole)
+{
+    grk_stream* stream = nullptr;
+    auto codec = grk_test::open(data, parameters, &stream);
+    if(!codec)
+        return false;
+    bool rc = grk_decompress_set_window(codec, window[0], window[1], window[2], window[3]) &&
+              grk_decompress(codec, nullptr) &&
+              equal_crop(grk_decompress_get_composited_image(codec), whole);
+    grk_object_unref(codec);
+    grk_object_unref(stream);
+
+    return rc;
+}
+
+static bool check(std::vector<uint8_t>& data, const char* name)
+{
+    const uint32_t stripHeights[] = {1, 7, 16, 33};
+    const uint32_t windows[][4] = {
+        {0, 0, 301, 1}, {3, 5, 97, 131}, {1, 127, 300, 129}, {130, 63, 139, 250}, {17, 29, 301, 257},
+        {200, 180, 301, 257}, {251, 213, 290, 240}};
+    for(uint8_t reduce = 0; reduce <= 2; ++reduce)
+    {
+        grk_dparameters parameters;
+        grk_decompress_set_default_params(&parameters);
+        parameters.cp_reduce = reduce;
+        grk_test::decompressed_image whole;
+        if(!whole.decompress(data, &parameters))
+        {
+            printf("%s: whole tile decompress failed (reduce %u)\n", name, reduce);
+            return false;
+        }
+        for(auto h : stripHeights)
+        {
+            parameters.dwtStripHeight = h;
+            grk_test::decompressed_image strips;
+            if(!strips.decompress(data, &parameters) || !grk_test::equal(strips.image, whole.image))
+            {
+                printf("%s: strip decompress (height %u, reduce %u) differs from whole tile "
+                       "decompress\n",
+                       name, h, reduce);
+                return false;
+            }
+        }
+        parameters.dwtStripHeight = 0;
+        for(auto w : windows)
+        {
+            if(!decompress_window(data, &parameters, w, whole.image))
+            {
+                printf("%s: window (%u,%u,%u,%u) decompress (reduce %u) differs from whole tile "
+                       "decompress\n",
+                       name, w[0], w[1], w[2], w[3], reduce);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void set_compress_params(grk_cparameters* parameters, uint32_t tileSize, bool irreversible,
+                                uint8_t numresolution, uint32_t cblkSize)
+{
+    grk_compress_set_default_params(parameters);
+    parameters->cod_format = GRK_J2K_FMT;
+    parameters->irreversible = irreversible;
+    parameters->numresolution = numresolution;
+    parameters->cblockw_init = cblkSize;
+    parameters->cblockh_init = cblkSize;
+    if(tileSize)
+    {
+        parameters->tile_size_on = true;
+        parameters->t_width = tileSize;
+        parameters->t_height = tileSize;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    struct stream
+    {
+        const char* name;
+        uint32_t tileSize;
+        bool irreversible;
+        uint8_t chromaSubsampling;
+        uint8_t numresolution;
+        uint32_t cblkSize;
+    } streams[] = {{"single tile", 0, false, 1, 6, 32},
+                   {"multi tile", 128, false, 1, 6, 32},
+                   {"irreversible multi tile", 128, true, 1, 6, 32},
+                   {"subsampled multi tile", 96, false, 2, 6, 32},
+                   // code blocks of the lowest resolution do not reach the tile origin
+                   {"small code blocks", 0, false, 1, 3, 8},
+                   {"irreversible small code blocks", 0, true, 1, 3, 8}};
+    bool rc = true;
+    for(auto& s : streams)
+    {
+        auto image = grk_test::create_image(3, 301, 257, 8, s.chromaSubsampling);
+        assert(image);
+        grk_cparameters parameters;
+        set_compress_params(&parameters, s.tileSize, s.irreversible, s.numresolution,
+                            s.cblkSize);
+        parameters.mct = s.chromaSubsampling == 1 ? 1 : 0;
+        std::vector<uint8_t> data;
+        rc = grk_test::compress(&parameters, image, data) && check(data, s.name);
+        grk_object_unref(&image->obj);
+        if(!rc)
+            break;
+    }
+    assert(rc);
+
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
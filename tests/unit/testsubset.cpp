@@ -0,0 +1,220 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * A subset extracted with grk_subset, for a given reduction, number of layers
+ * and window, must decompress to the same pixels as the source code stream
+ * decompressed with that reduction, number of layers and window. A subset of
+ * a truncated code stream must fail.
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+const uint32_t width = 301;
+const uint32_t height = 257;
+
+struct stream_config
+{
+    const char* name;
+    uint32_t tileSize;
+    uint8_t csty;
+    bool writePLT;
+    bool writeTLM;
+};
+
+struct subset_config
+{
+    uint8_t reduce;
+    uint16_t layers;
+    // full resolution canvas coordinates of window in source; all zero for no window
+    uint32_t window[4];
+};
+
+/**
+ * Extract subset of data for reduce, layers and window in c
+ */
+static bool subset(std::vector<uint8_t>& data, const subset_config& c, std::vector<uint8_t>& out)
+{
+    grk_dparameters dparameters;
+    grk_decompress_set_default_params(&dparameters);
+    dparameters.cp_reduce = c.reduce;
+    dparameters.cp_layer = c.layers;
+    grk_stream* stream = nullptr;
+    auto decompressCodec = grk_test::open(data, &dparameters, &stream);
+    if(!decompressCodec)
+        return false;
+    bool rc = !c.window[2] || grk_decompress_set_window(decompressCodec, c.window[0], c.window[1],
+                                                        c.window[2], c.window[3]);
+    size_t len = data.size() + 1024 * 1024;
+    auto buf = new uint8_t[len];
+    auto outStream = grk_stream_create_mem_stream(buf, len, false, false);
+    auto compressCodec = outStream ? grk_compress_create(GRK_CODEC_J2K, outStream) : nullptr;
+    grk_cparameters cparameters;
+    grk_compress_set_default_params(&cparameters);
+    rc = rc && compressCodec && grk_subset(decompressCodec, compressCodec, &cparameters);
+    if(rc)
+        out.assign(buf, buf + grk_stream_get_write_mem_stream_length(outStream));
+    if(compressCodec)
+        grk_object_unref(compressCodec);
+    if(outStream)
+        grk_object_unref(outStream);
+    delete[] buf;
+    grk_object_unref(decompressCodec);
+    grk_object_unref(stream);
+
+    return rc;
+}
+
+/**
+ * Decompress data with reduce, layers and window, where window is in full resolution
+ * canvas coordinates
+ */
+static grk_image* decompress(std::vector<uint8_t>& data, uint8_t reduce, uint16_t layers,
+                             const uint32_t* window, grk_test::decompressed_image& decompressed)
+{
+    grk_dparameters parameters;
+    grk_decompress_set_default_params(&parameters);
+    parameters.cp_reduce = reduce;
+    parameters.cp_layer = layers;
+    decompressed.codec = grk_test::open(data, &parameters, &decompressed.stream);
+    if(!decompressed.codec)
+        return nullptr;
+    if(window[2])
+    {
+        // decompress window is relative to the image origin
+        auto header = grk_decompress_get_composited_image(decompressed.codec);
+        if(!header || !grk_decompress_set_window(decompressed.codec, window[0] - header->x0,
+                                                 window[1] - header->y0, window[2] - header->x0,
+                                                 window[3] - header->y0))
+            return nullptr;
+    }
+    if(!grk_decompress(decompressed.codec, nullptr))
+        return nullptr;
+
+    return grk_decompress_get_composited_image(decompressed.codec);
+}
+
+static bool check(const stream_config& s, const subset_config& c, std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> sub;
+    if(!subset(data, c, sub))
+    {
+        printf("%s: subset (reduce %u, layers %u) failed\n", s.name, c.reduce, c.layers);
+        return false;
+    }
+    // subset canvas is the source canvas at the reduced resolution
+    uint32_t subWindow[4];
+    for(uint32_t i = 0; i < 4; ++i)
+        subWindow[i] = (c.window[i] + (1U << c.reduce) - 1) >> c.reduce;
+    grk_test::decompressed_image expected;
+    grk_test::decompressed_image actual;
+    auto expectedImage = decompress(data, c.reduce, c.layers, c.window, expected);
+    auto actualImage = decompress(sub, 0, 0, subWindow, actual);
+    bool rc = expectedImage && actualImage && grk_test::equal(actualImage, expectedImage);
+    for(uint16_t i = 0; rc && i < expectedImage->numcomps; ++i)
+        rc = actualImage->comps[i].x0 == expectedImage->comps[i].x0 &&
+             actualImage->comps[i].y0 == expectedImage->comps[i].y0;
+    if(!rc)
+        printf("%s: subset (reduce %u, layers %u, window (%u,%u,%u,%u)) differs from source\n",
+               s.name, c.reduce, c.layers, c.window[0], c.window[1], c.window[2], c.window[3]);
+
+    return rc;
+}
+
+static bool check(const stream_config& s)
+{
+    auto image = grk_test::create_image(3, width, height, 8);
+    if(!image)
+        return false;
+    grk_cparameters parameters;
+    grk_compress_set_default_params(&parameters);
+    parameters.cod_format = GRK_J2K_FMT;
+    if(s.tileSize)
+    {
+        parameters.tile_size_on = true;
+        parameters.t_width = s.tileSize;
+        parameters.t_height = s.tileSize;
+    }
+    parameters.csty = s.csty;
+    parameters.writePLT = s.writePLT;
+    parameters.writeTLM = s.writeTLM;
+    parameters.numlayers = 3;
+    parameters.layer_rate[0] = 40;
+    parameters.layer_rate[1] = 10;
+    parameters.layer_rate[2] = 0;
+    parameters.allocationByRateDistoration = true;
+    std::vector<uint8_t> data;
+    bool rc = grk_test::compress(&parameters, image, data);
+    grk_object_unref(&image->obj);
+    if(!rc)
+    {
+        printf("%s: compress failed\n", s.name);
+        return false;
+    }
+    const subset_config configs[] = {{0, 0, {0, 0, 0, 0}},      {1, 0, {0, 0, 0, 0}},
+                                     {2, 2, {0, 0, 0, 0}},      {0, 1, {0, 0, 0, 0}},
+                                     {0, 0, {37, 21, 190, 150}}, {1, 2, {70, 130, 301, 257}},
+                                     {2, 0, {5, 3, 9, 250}}};
+    for(auto& c : configs)
+    {
+        if(!check(s, c, data))
+            return false;
+    }
+
+    // packets of a code stream truncated in the middle of a tile part
+    // must not be copied
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + data.size() / 2);
+    std::vector<uint8_t> sub;
+    if(subset(truncated, configs[0], sub))
+    {
+        printf("%s: subset of truncated code stream succeeded\n", s.name);
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    const stream_config configs[] = {{"single tile", 0, 0, false, false},
+                                     {"multi tile", 64, 0, false, false},
+                                     {"SOP and EPH", 64, 0x06, false, false},
+                                     {"PLT and TLM", 64, 0, true, true},
+                                     {"SOP, EPH, PLT and TLM", 128, 0x06, true, true}};
+    bool rc = true;
+    for(auto& s : configs)
+    {
+        rc = check(s);
+        if(!rc)
+            break;
+    }
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
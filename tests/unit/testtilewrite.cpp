@@ -0,0 +1,152 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * Multi-threaded compression serializes tiles concurrently, at pre-calculated
+ * offsets in the output, when every tile is a single tile part. The code stream
+ * must be byte-identical to single-threaded compression, and lossless code
+ * streams must decompress to the original image. The last row of tiles is a
+ * single row high, so some of its bands are empty.
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+struct config
+{
+    const char* name;
+    bool lossless;
+    uint8_t csty;
+    bool writePLT;
+    bool writeTLM;
+    bool tileParts;
+    bool ht;
+};
+
+const uint32_t width = 300;
+const uint32_t height = 257;
+
+static void set_compress_params(grk_cparameters* parameters, const config& c)
+{
+    grk_compress_set_default_params(parameters);
+    parameters->cod_format = GRK_J2K_FMT;
+    parameters->tile_size_on = true;
+    parameters->t_width = 64;
+    parameters->t_height = 64;
+    parameters->csty = c.csty;
+    parameters->writePLT = c.writePLT;
+    parameters->writeTLM = c.writeTLM;
+    if(!c.lossless)
+    {
+        parameters->irreversible = true;
+        parameters->numlayers = 3;
+        parameters->layer_rate[0] = 40;
+        parameters->layer_rate[1] = 20;
+        parameters->layer_rate[2] = 10;
+        parameters->allocationByRateDistoration = true;
+    }
+    if(c.ht)
+    {
+        parameters->cblk_sty = GRK_CBLKSTY_HT;
+        parameters->isHT = true;
+        parameters->numgbits = 1;
+    }
+    if(c.tileParts)
+    {
+        parameters->enableTilePartGeneration = true;
+        parameters->newTilePartProgressionDivider = 'R';
+    }
+}
+
+static bool compress(const config& c, uint32_t numThreads, std::vector<uint8_t>& out)
+{
+    grk_initialize(nullptr, numThreads);
+    auto image = grk_test::create_image(3, width, height, 8);
+    if(!image)
+        return false;
+    grk_cparameters parameters;
+    set_compress_params(&parameters, c);
+    bool rc = grk_test::compress(&parameters, image, out);
+    grk_object_unref(&image->obj);
+    grk_deinitialize();
+
+    return rc;
+}
+
+static bool check(const config& c)
+{
+    std::vector<uint8_t> serial;
+    std::vector<uint8_t> parallel;
+    if(!compress(c, 1, serial) || !compress(c, 4, parallel))
+    {
+        printf("%s: compress failed\n", c.name);
+        return false;
+    }
+    if(serial != parallel)
+    {
+        printf("%s: multi-threaded code stream differs from single-threaded code stream\n",
+               c.name);
+        return false;
+    }
+    grk_initialize(nullptr, 4);
+    grk_dparameters parameters;
+    grk_decompress_set_default_params(&parameters);
+    grk_test::decompressed_image decompressed;
+    bool rc = decompressed.decompress(parallel, &parameters);
+    if(rc && c.lossless)
+    {
+        auto original = grk_test::create_image(3, width, height, 8);
+        rc = grk_test::equal(decompressed.image, original);
+        grk_object_unref(&original->obj);
+    }
+    if(!rc)
+        printf("%s: decompressed image differs from original\n", c.name);
+
+    return rc;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_test::set_handlers();
+
+    const config configs[] = {
+        {"lossless", true, 0, false, false, false, false},
+        {"lossy layers", false, 0, false, false, false, false},
+        {"SOP, EPH, PLT and TLM", true, 0x06, true, true, false, false},
+        {"lossy layers, SOP and EPH", false, 0x06, false, false, false, false},
+        {"HTJ2K lossless", true, 0, true, true, false, true},
+        // several tile parts per tile take the serial path
+        {"tile parts", true, 0, false, true, true, false}};
+    bool rc = true;
+    for(auto& c : configs)
+    {
+        rc = check(c);
+        grk_deinitialize();
+        if(!rc)
+            break;
+    }
+    assert(rc);
+    puts("end");
+
+    return rc ? 0 : 1;
+}
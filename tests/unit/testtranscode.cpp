@@ -0,0 +1,163 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+/*
+ * A code stream transcoded between the Part 1 and HTJ2K block coders must
+ * decompress to the same pixels as the source code stream: losslessly through
+ * Part 1 -> HTJ2K -> Part 1, and irreversibly through Part 1 -> Part 1, where
+ * the quantized coefficients are re-coded with the source step sizes
+ */
+
+#include <assert.h>
+
+#include "unit_test_common.h"
+
+const uint32_t width = 301;
+const uint32_t height = 257;
+
+struct transcode_config
+{
+    const char* name;
+    bool irreversible;
+    bool mct;
+    uint32_t tileSize;
+    uint16_t numLayers;
+    // block coder of each transcode, in order
+    std::vector<bool> toHT;
+};
+
+static bool transcode(std::vector<uint8_t>& data, bool toHT, std::vector<uint8_t>& out)
+{
+    grk_dparameters dparameters;
+    grk_decompress_set_default_params(&dparameters);
+    grk_stream* stream = nullptr;
+    auto decompressCodec = grk_test::open(data, &dparameters, &stream);
+    if(!decompressCodec)
+        return false;
+    // coefficients can't grow in size, but all layers go into one layer
+    size_t len = data.size() * 2 + 1024 * 1024;
+    auto buf = new uint8_t[len];
+    auto outStream = grk_stream_create_mem_stream(buf, len, false, false);
+    auto compressCodec = outStream ? grk_compress_create(GRK_CODEC_J2K, outStream) : nullptr;
+    grk_cparameters cparameters;
+    grk_compress_set_default_params(&cparameters);
+    cparameters.cod_format = GRK_J2K_FMT;
+    cparameters.cblk_sty = toHT ? GRK_CBLKSTY_HT : 0;
+    bool rc = compressCodec && grk_transcode(decompressCodec, compressCodec, &cparameters);
+    if(rc)
+        out.assign(buf, buf + grk_stream_get_write_mem_stream_length(outStream));
+    if(compressCodec)
+        grk_object_unref(compressCodec);
+    if(outStream)
+        grk_object_unref(outStream);
+    delete[] buf;
+    grk_object_unref(decompressCodec);
+    grk_object_unref(stream);
+
+    return rc;
+}
+
+static bool check(const transcode_config& c)
+{
+    auto image = grk_test::create_image(3, width, height, 8);
+    if(!image)
+        return false;
+    grk_cparameters parameters;
+    grk_compress_set_default_params(&parameters);
+    parameters.cod_format = GRK_J2K_FMT;
+    parameters.irreversible = c.irreversible;
+    parameters.mct = c.mct ? 1 : 0;
+    if(c.tileSize)
+    {
+        parameters.tile_size_on = true;
+        parameters.t_width = c.tileSize;
+        parameters.t_height = c.tileSize;
+    }
+    // the last layer holds all coding passes, so that coefficients are
+    // decompressed exactly as they were quantized
+    parameters.numlayers = c.numLayers;
+    for(uint16_t i = 0; i < c.numLayers; ++i)
+        parameters.layer_rate[i] = (float)((c.numLayers - 1 - i) * 20);
+    parameters.allocationByRateDistoration = c.numLayers > 1;
+    std::vector<uint8_t> data;
+    bool rc = grk_test::compress(&parameters, image, data);
+    grk_object_unref(&image->obj);
+    if(!rc)
+    {
+        printf("%s: compress failed\n", c.name);
+        return false;
+    }
+    grk_dparameters dparameters;
+    grk_decompress_set_default_params(&dparameters);
+    grk_test::decompressed_image expected;
+    if(!expected.decompress(data, &dparameters))
+    {
+        printf("%s: decompress of source failed\n", c.name);
+        return false;
+    }
+    auto source = data;
+    for(size_t i = 0; i < c.toHT.size(); ++i)
+    {
+        std::vector<uint8_t> out;
+        if(!transcode(source, c.toHT[i], out))
+        {
+            printf("%s: transcode %zu failed\n", c.name, i);
+            return false;
+        }
+        grk_test::decompressed_image actual;
+        if(!actual.decompress(out, &dparameters) ||
+           !grk_test::equal(actual.image, expected.image))
+        {
+            printf("%s: transcode %zu differs from source\n", c.name, i);
+            return false;
+        }
+        source = out;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    grk_initialize(nullptr, 0);
+    grk_test::set_handlers();
+
+    const transcode_config configs[] = {
+        {"lossless Part 1 -> HTJ2K -> Part 1", false, false, 0, 1, {true, false}},
+        {"lossless tiled Part 1 -> HTJ2K -> Part 1", false, true, 64, 1, {true, false}},
+        {"irreversible Part 1 -> Part 1", true, false, 0, 1, {false}},
+        {"irreversible MCT Part 1 -> Part 1", true, true, 0, 1, {false}},
+        {"irreversible layered Part 1 -> Part 1", true, false, 0, 3, {false}},
+        {"irreversible tiled Part 1 -> Part 1", true, false, 64, 1, {false, false}}};
+    bool rc = true;
+    for(auto& c : configs)
+    {
+        rc = check(c);
+        if(!rc)
+            break;
+    }
+    assert(rc);
+    grk_deinitialize();
+    puts("end");
+
+    return rc ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ *    Copyright (C) 2016-2021 Grok Image Compression Inc.
+ *
+ *    This source code is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This source code is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *    This source code incorporates work covered by the BSD 2-clause license.
+ *    Please see the LICENSE file in the root directory for details.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+
+#include "grk_config.h"
+#include "grok.h"
+
+/*
+ * Helpers shared by the round trip unit tests: a synthetic test image,
+ * compression to memory, decompression from memory and pixel comparison
+ */
+namespace grk_test
+{
+inline void error_callback(const char* msg, void* v)
+{
+    (void)v;
+    puts(msg);
+}
+inline void quiet_callback(const char* msg, void* v)
+{
+    (void)msg;
+    (void)v;
+}
+inline void set_handlers(void)
+{
+    grk_set_info_handler(quiet_callback, nullptr);
+    grk_set_warning_handler(quiet_callback, nullptr);
+    grk_set_error_handler(error_callback, nullptr);
+}
+
+/**
+ * Create an image whose samples are a deterministic mix of gradients and noise,
+ * so that every layer and resolution carries information. All components but
+ * the first are subsampled by chromaSubsampling in both directions
+ */
+inline grk_image* create_image(uint16_t numcomps, uint32_t w, uint32_t h, uint8_t prec,
+                               uint8_t chromaSubsampling = 1)
+{
+    std::vector<grk_image_cmptparm> cmptparms(numcomps);
+    for(uint16_t i = 0; i < numcomps; ++i)
+    {
+        auto cp = &cmptparms[i];
+        memset(cp, 0, sizeof(grk_image_cmptparm));
+        cp->prec = prec;
+        cp->sgnd = false;
+        uint8_t sub = i ? chromaSubsampling : 1;
+        cp->dx = sub;
+        cp->dy = sub;
+        cp->w = (w + sub - 1) / sub;
+        cp->h = (h + sub - 1) / sub;
+    }
+    auto image = grk_image_new(numcomps, cmptparms.data(),
+                               numcomps >= 3 ? GRK_CLRSPC_SRGB : GRK_CLRSPC_GRAY, true);
+    if(!image)
+        return nullptr;
+    image->x0 = 0;
+    image->y0 = 0;
+    image->x1 = w;
+    image->y1 = h;
+    uint32_t maxVal = (1U << prec) - 1;
+    uint32_t seed = 12345;
+    for(uint16_t i = 0; i < numcomps; ++i)
+    {
+        auto comp = image->comps + i;
+        for(uint32_t y = 0; y < comp->h; ++y)
+        {
+            for(uint32_t x = 0; x < comp->w; ++x)
+            {
+                seed = seed * 1103515245 + 12345;
+                uint32_t noise = (seed >> 16) & 0x1F;
+                uint32_t val = ((x * 3 + y * 5 + i * 40) & 0xFF) + noise;
+                comp->data[(uint64_t)y * comp->stride + x] =
+                    (int32_t)((val * maxVal) / (0xFF + 0x1F));
+            }
+        }
+    }
+
+    return image;
+}
+
+/**
+ * Compress image to a memory buffer. The compressor takes over the image's sample
+ * buffers, so an image can only be compressed once
+ */
+inline bool compress(grk_cparameters* parameters, grk_image* image, std::vector<uint8_t>& out,
+                     GRK_CODEC_FORMAT format = GRK_CODEC_J2K)
+{
+    size_t len = 1024 * 1024;
+    for(uint16_t i = 0; i < image->numcomps; ++i)
+        len += (size_t)image->comps[i].w * image->comps[i].h * sizeof(int32_t);
+    auto buf = new uint8_t[len];
+    auto stream = grk_stream_create_mem_stream(buf, len, false, false);
+    if(!stream)
+    {
+        delete[] buf;
+        return false;
+    }
+    auto codec = grk_compress_create(format, stream);
+    bool rc = codec && grk_compress_init(codec, parameters, image) &&
+              grk_compress_start(codec) && grk_compress(codec) && grk_compress_end(codec);
+    if(rc)
+        out.assign(buf, buf + grk_stream_get_write_mem_stream_length(stream));
+    grk_object_unref(stream);
+    grk_object_unref(codec);
+    delete[] buf;
+
+    return rc;
+}
+
+/**
+ * Open a decompressor on a compressed buffer, and read the main header.
+ * Caller must unref both the returned codec and the stream
+ */
+inline grk_codec* open(std::vector<uint8_t>& data, grk_dparameters* parameters,
+                       grk_stream** stream, grk_header_info* header_info = nullptr)
+{
+    *stream = grk_stream_create_mem_stream(data.data(), data.size(), false, true);
+    if(!*stream)
+        return nullptr;
+    auto codec = grk_decompress_create(GRK_CODEC_J2K, *stream);
+    grk_header_info info;
+    memset(&info, 0, sizeof(info));
+    if(!codec || !grk_decompress_init(codec, parameters) ||
+       !grk_decompress_read_header(codec, header_info ? header_info : &info))
+    {
+        if(codec)
+            grk_object_unref(codec);
+        grk_object_unref(*stream);
+        *stream = nullptr;
+        return nullptr;
+    }
+
+    return codec;
+}
+
+/**
+ * Image returned by a fresh decompress of the full image with the given parameters
+ */
+struct decompressed_image
+{
+    grk_stream* stream = nullptr;
+    grk_codec* codec = nullptr;
+    grk_image* image = nullptr;
+
+    ~decompressed_image()
+    {
+        if(codec)
+            grk_object_unref(codec);
+        if(stream)
+            grk_object_unref(stream);
+    }
+    bool decompress(std::vector<uint8_t>& data, grk_dparameters* parameters)
+    {
+        codec = open(data, parameters, &stream);
+        if(!codec || !grk_decompress(codec, nullptr))
+            return false;
+        image = grk_decompress_get_composited_image(codec);
+
+        return image != nullptr;
+    }
+};
+
+/**
+ * Compare dimensions, precision and samples of two images
+ */
+inline bool equal(const grk_image* a, const grk_image* b)
+{
+    if(!a || !b || a->numcomps != b->numcomps)
+        return false;
+    for(uint16_t i = 0; i < a->numcomps; ++i)
+    {
+        auto ca = a->comps + i;
+        auto cb = b->comps + i;
+        if(ca->w != cb->w || ca->h != cb->h || ca->prec != cb->prec || ca->sgnd != cb->sgnd ||
+           !ca->data || !cb->data)
+            return false;
+        for(uint32_t y = 0; y < ca->h; ++y)
+        {
+            if(memcmp(ca->data + (uint64_t)y * ca->stride, cb->data + (uint64_t)y * cb->stride,
+                      ca->w * sizeof(int32_t)) != 0)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace grk_test